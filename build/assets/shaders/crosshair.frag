@@ -0,0 +1,13 @@
+#version 460 core
+out vec4 FragColor;  // Blended as 1 - destination
+
+uniform uvec2 windowSize;
+uniform float pointerRadius;
+
+void main()
+{
+    // Drawing crosshair
+    float distance = length(gl_FragCoord.xy-windowSize/2);
+    if (distance > pointerRadius) discard;
+    FragColor = vec4(1.0);
+}
@@ -1,9 +1,18 @@
 #version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
+uniform mat4 shadowMatrices[6];
+uniform int faces[6];  // Cubemap face of each instance
+uniform int layerBase;  // First layer of the cubemap in the array
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    int face = faces[gl_InstanceID];
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_layer)
+    gl_Layer = layerBase + face;
+#endif
+    gl_Position = shadowMatrices[face] * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -1,104 +1,62 @@
 #version 460 core
 
-#define NR_POINT_LIGHTS 4
+#include "lighting.glsl"
 
 out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 FragPos;
-in vec3 TangentLightPos[NR_POINT_LIGHTS];
-in vec3 TangentViewPos;
-in vec3 TangentFragPos;
+in mat3 TBN;
 
 uniform vec3 viewPos;
 
-uniform float FarPlaneShadow;
-uniform uvec2 windowSize;
-uniform float pointerRadius;
-
 struct Material {
     sampler2D diffuseMap;
     sampler2D specularMap;
-    float shininess;
     sampler2D normalMap;
 };
 uniform Material material;
 
-struct PointLight {
-    vec3 color;
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float linear;
-    float quadratic;
-    samplerCube depthCubemap;
-};
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+// Clustered lighting (see cluster.h)
+layout (std430, binding = 1) readonly buffer ClusterGrid { uvec2 clusters[]; };
+layout (std430, binding = 2) readonly buffer ClusterIndices { uint lightIndices[]; };
 
-const vec3 sampleOffsetDirections[20] = vec3[]
-(
-    vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-    vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-    vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-    vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-    vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-); 
+uniform uvec3 clusterDims;
+uniform vec2 clusterSliceParams;  // slice = log(depth)*x - y
+uniform vec2 clusterTileSize;
+uniform vec2 cameraPlanes;  // near, far
 
 
-float computeShadow(vec3 lightPos, samplerCube depthCubemap, vec3 lightDir, vec3 normal, float diskRadius)
+uint getClusterIndex()
 {
-    vec3 fragToLight = FragPos - lightPos;
+    // Linear view depth from the depth buffer value
+    float zNdc = gl_FragCoord.z * 2.0 - 1.0;
+    float depth = 2.0 * cameraPlanes.x * cameraPlanes.y / (cameraPlanes.y + cameraPlanes.x - zNdc * (cameraPlanes.y - cameraPlanes.x));
 
-    float shadow = 0.0;
-    // float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    const float bias = 0.005;
-    float currentDepth = (length(fragToLight)-bias) / FarPlaneShadow;
-    for (int i=0; i<20; i++)
-    {
-        float closestDepth = texture(depthCubemap, fragToLight + sampleOffsetDirections[i]*diskRadius).r;
-        // shadow += currentDepth > closestDepth ? 1.0 : 0.0;
-        shadow += currentDepth > closestDepth ? 0.05 : 0.0;
-    }
-    // shadow /= float(samples);
-
-    return shadow;
-}
-
-vec3 computePointLight(PointLight light, vec3 normal, vec3 viewDir, float diskRadius, vec3 tangentLightPos)
-{
-    vec3 color = texture(material.diffuseMap, TexCoords).rgb;
-
-    vec3 ambient = light.ambient * color;
-
-    vec3 lightDir = normalize(tangentLightPos - TangentFragPos);
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = diff * light.diffuse * color;
-
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    vec3 specular = spec * light.specular * vec3(texture(material.specularMap, TexCoords).r);
-
-    float distance = length(light.position - FragPos);
-    float attenuation = 1.0 / (1.0 + light.linear * distance + light.quadratic * (distance * distance));
-
-    float shadow = computeShadow(light.position, light.depthCubemap, lightDir, normal, diskRadius);
-
-    return (ambient + (1-shadow)*(diffuse+specular)) * light.color * attenuation;
+    uint slice = uint(clamp(floor(log(depth) * clusterSliceParams.x - clusterSliceParams.y), 0.0, float(clusterDims.z - 1)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterDims.xy - 1);
+    return tile.x + clusterDims.x * (tile.y + clusterDims.y * slice);
 }
 
 void main()
 {
     vec3 outputColor = vec3(0.0);
 
-    vec3 norm = normalize(texture(material.normalMap, TexCoords).rgb * 2.0 - 1.0);
-    vec3 FragToView = TangentViewPos - TangentFragPos;
+    // Material is sampled once, lights are evaluated in world space
+    Surface surface;
+    surface.position = FragPos;
+    surface.normal = normalize(TBN * (texture(material.normalMap, TexCoords).rgb * 2.0 - 1.0));
+    surface.albedo = texture(material.diffuseMap, TexCoords).rgb;
+    surface.specular = texture(material.specularMap, TexCoords).r;
+
+    vec3 FragToView = viewPos - FragPos;
     vec3 viewDir = normalize(FragToView);
-    float diskRadius = (1.0 + (length(FragToView) / FarPlaneShadow)) / 25.0;
-    for (int i = 0; i < NR_POINT_LIGHTS; i++) outputColor += computePointLight(pointLights[i], norm, viewDir, diskRadius, TangentLightPos[i]);
+    float diskRadius = shadowDiskRadius(length(FragToView));
+
+    // Only the lights of this fragment's cluster are evaluated
+    uvec2 cluster = clusters[getClusterIndex()];
+    for (uint i = 0; i < cluster.y; i++) outputColor += computePointLight(pointLights[lightIndices[cluster.x + i]], surface, viewDir, gl_FragCoord.xy, diskRadius);
 
-    // Draw circle crosshair
-    float distanceCenter = length(gl_FragCoord.xy-windowSize/2);
-    if (distanceCenter <= pointerRadius) FragColor = vec4(1.0-outputColor, 1.0);
-    else FragColor = vec4(outputColor, 1.0);
-}
\ No newline at end of file
+    // The crosshair is drawn over the upscaled image, at the resolution of the window (crosshair.frag)
+    FragColor = vec4(outputColor, 1.0);
+}
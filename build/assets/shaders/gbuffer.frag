@@ -0,0 +1,23 @@
+#version 460 core
+
+#include "octahedral.glsl"
+
+layout (location = 0) out vec4 gAlbedoSpec;  // Albedo, specular intensity
+layout (location = 1) out vec2 gNormal;  // Octahedral world normal
+
+in vec2 TexCoords;
+in vec3 FragPos;
+in mat3 TBN;
+
+struct Material {
+    sampler2D diffuseMap;
+    sampler2D specularMap;
+    sampler2D normalMap;
+};
+uniform Material material;
+
+void main()
+{
+    gAlbedoSpec = vec4(texture(material.diffuseMap, TexCoords).rgb, texture(material.specularMap, TexCoords).r);
+    gNormal = encodeNormal(normalize(TBN * (texture(material.normalMap, TexCoords).rgb * 2.0 - 1.0)));
+}
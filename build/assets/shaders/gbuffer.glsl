@@ -0,0 +1,34 @@
+#ifndef GBUFFER_GLSL
+#define GBUFFER_GLSL
+
+// G-buffer reads, shared by the deferred lighting shaders (see deferred.h)
+
+#include "lighting.glsl"
+#include "octahedral.glsl"
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform vec2 renderSize;  // Rendered region of the buffers, smaller than them under dynamic resolution
+
+// Surface stored at a pixel, false for the background
+bool readGBuffer(ivec2 pixel, out Surface surface)
+{
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth >= 1.0) return false;
+
+    vec2 uv = (vec2(pixel) + 0.5) / renderSize;
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    surface.position = position.xyz / position.w;
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    surface.albedo = albedoSpec.rgb;
+    surface.specular = albedoSpec.a;
+    surface.normal = decodeNormal(texelFetch(gNormal, pixel, 0).rg);
+    return true;
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef LIGHTING_GLSL
+#define LIGHTING_GLSL
+
+// Point light shading, shared by the forward and deferred renderers
+
+#include "lights.glsl"
+
+#define SHADOW_TIER_COUNT 3
+
+// Shadow filters (see shadow.h)
+#define SHADOW_FILTER_PCF 0
+#define SHADOW_FILTER_HARDWARE 1
+#define SHADOW_FILTER_MOMENTS 2
+
+// Parameters shared by every point light
+struct LightingModel {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float linear;
+    float quadratic;
+    float shininess;
+};
+uniform LightingModel lighting;
+
+// Shaded point, in world space
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    float specular;
+};
+
+uniform float NearPlaneShadow;
+uniform float FarPlaneShadow;
+
+// One cubemap array per resolution tier (see shadow.h)
+uniform samplerCubeArray shadowTiers[SHADOW_TIER_COUNT];
+uniform samplerCubeArrayShadow shadowCompareTiers[SHADOW_TIER_COUNT];  // Same depth, hardware comparison
+uniform samplerCubeArray shadowMomentTiers[SHADOW_TIER_COUNT];
+
+uniform int shadowFilter;
+uniform int shadowQuality;  // Taps, or blur radius of the moments
+uniform float shadowMomentBias;
+uniform uint shadowFrame;
+
+const vec3 sampleOffsetDirections[20] = vec3[]
+(
+    vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
+    vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
+    vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
+    vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
+    vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
+); 
+
+const vec2 poissonDisk[8] = vec2[]
+(
+    vec2(-0.7071,  0.7071), vec2( 0.3536, -0.1768), vec2(-0.2500, -0.8660), vec2( 0.9239,  0.3827),
+    vec2(-0.4330, -0.2500), vec2( 0.1768,  0.8536), vec2( 0.6124, -0.7071), vec2(-0.9659,  0.0000)
+);
+
+// Hamburger 4MSM dequantization, inverse of the transform in moments.comp
+const mat4 momentDequantization = mat4(
+    0.2227744146,  0.0771972861,  0.7926986636,  0.0319417555,
+    0.1549679261,  0.1394629426,  0.7963415838, -0.1722823173,
+    0.1451988946,  0.2120202157,  0.7258694464, -0.2758014811,
+    0.163127443,   0.2591432266,  0.6539092497, -0.3376131734
+);
+
+
+// Depth cubemaps hold the hardware depth of the distance along the face axis
+float shadowDepth(vec3 fragToLight, float bias)
+{
+    vec3 absFragToLight = abs(fragToLight);
+    float axisDistance = max(absFragToLight.x, max(absFragToLight.y, absFragToLight.z)) - bias;
+    float n = NearPlaneShadow, f = FarPlaneShadow;
+    return ((f+n)/(f-n) - 2.0*f*n/((f-n)*axisDistance)) * 0.5 + 0.5;
+}
+
+float computeShadowPCF(vec3 fragToLight, samplerCubeArray depthCubemaps, int slot, float diskRadius)
+{
+    float shadow = 0.0;
+    const float bias = 0.005;
+    float currentDepth = shadowDepth(fragToLight, bias);
+    for (int i=0; i<shadowQuality; i++)
+    {
+        float closestDepth = texture(depthCubemaps, vec4(fragToLight + sampleOffsetDirections[i]*diskRadius, slot)).r;
+        shadow += currentDepth > closestDepth ? 1.0 : 0.0;
+    }
+
+    return shadow / float(shadowQuality);
+}
+
+// Per pixel rotation, changing every frame so that few taps average out over time
+float interleavedGradientNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+float computeShadowHardware(vec3 fragToLight, vec2 pixel, samplerCubeArrayShadow depthCubemaps, int slot, float diskRadius)
+{
+    const float bias = 0.005;
+    float currentDepth = shadowDepth(fragToLight, bias);
+
+    // Kernel lies in the plane facing the light
+    vec3 direction = normalize(fragToLight);
+    vec3 tangent = normalize(cross(direction, abs(direction.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(direction, tangent);
+    float angle = 6.2831853 * interleavedGradientNoise(pixel + 5.588238 * float(shadowFrame % 64u));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+    float lit = 0.0;
+    for (int i=0; i<shadowQuality; i++)
+    {
+        vec2 offset = rotation * poissonDisk[i] * diskRadius;
+        lit += texture(depthCubemaps, vec4(fragToLight + tangent*offset.x + bitangent*offset.y, slot), currentDepth);
+    }
+
+    return 1.0 - lit / float(shadowQuality);
+}
+
+// Peters and Klein, Moment Shadow Mapping (2015)
+float computeShadowMoments(vec3 fragToLight, samplerCubeArray momentCubemaps, int slot)
+{
+    vec4 moments = texture(momentCubemaps, vec4(fragToLight, slot));
+    vec4 b = (moments - vec4(0.035955884801, 0.0, 0.0, 0.0)) * momentDequantization;
+    b = mix(b, vec4(0.5), shadowMomentBias);
+
+    const float bias = 0.005;
+    vec3 absFragToLight = abs(fragToLight);
+    float axisDistance = max(absFragToLight.x, max(absFragToLight.y, absFragToLight.z));
+    vec3 z;
+    z[0] = (axisDistance - NearPlaneShadow) / (FarPlaneShadow - NearPlaneShadow) - bias;
+
+    // Cholesky decomposition of the Hankel matrix, then roots of the quadratic
+    float L32D22 = -b[0] * b[1] + b[2];
+    float D22 = -b[0] * b[0] + b[1];
+    float squaredDepthVariance = -b[1] * b[1] + b[3];
+    float D33D22 = dot(vec2(squaredDepthVariance, -L32D22), vec2(D22, L32D22));
+    float InvD22 = 1.0 / D22;
+    float L32 = L32D22 * InvD22;
+
+    vec3 c = vec3(1.0, z[0], z[0] * z[0]);
+    c[1] -= b.x;
+    c[2] -= b.y + L32 * c[1];
+    c[1] *= InvD22;
+    c[2] *= D22 / D33D22;
+    c[1] -= L32 * c[2];
+    c[0] -= dot(c.yz, b.xy);
+
+    float p = c[1] / c[2];
+    float q = c[0] / c[2];
+    float r = sqrt(max(p * p * 0.25 - q, 0.0));
+    z[1] = -p * 0.5 - r;
+    z[2] = -p * 0.5 + r;
+
+    vec4 switchVal = (z[2] < z[0]) ? vec4(z[1], z[0], 1.0, 1.0) :
+                     ((z[1] < z[0]) ? vec4(z[0], z[1], 0.0, 1.0) : vec4(0.0));
+    float quotient = (switchVal[0] * z[2] - b[0] * (switchVal[0] + z[2]) + b[1]) / ((z[2] - switchVal[1]) * (z[0] - z[1]));
+    return clamp(switchVal[2] + switchVal[3] * quotient, 0.0, 1.0);
+}
+
+// Samplers can't be indexed with a non uniform index
+float computeShadowIndexed(int shadowIndex, vec3 fragToLight, vec2 pixel, float diskRadius)
+{
+    if (shadowIndex < 0) return 0.0;
+    int tier = shadowIndex >> 8;
+    int slot = shadowIndex & 0xFF;
+
+    if (shadowFilter == SHADOW_FILTER_HARDWARE) switch (tier)
+    {
+        case 0: return computeShadowHardware(fragToLight, pixel, shadowCompareTiers[0], slot, diskRadius);
+        case 1: return computeShadowHardware(fragToLight, pixel, shadowCompareTiers[1], slot, diskRadius);
+        case 2: return computeShadowHardware(fragToLight, pixel, shadowCompareTiers[2], slot, diskRadius);
+        default: return 0.0;
+    }
+    if (shadowFilter == SHADOW_FILTER_MOMENTS) switch (tier)
+    {
+        case 0: return computeShadowMoments(fragToLight, shadowMomentTiers[0], slot);
+        case 1: return computeShadowMoments(fragToLight, shadowMomentTiers[1], slot);
+        case 2: return computeShadowMoments(fragToLight, shadowMomentTiers[2], slot);
+        default: return 0.0;
+    }
+    switch (tier)
+    {
+        case 0: return computeShadowPCF(fragToLight, shadowTiers[0], slot, diskRadius);
+        case 1: return computeShadowPCF(fragToLight, shadowTiers[1], slot, diskRadius);
+        case 2: return computeShadowPCF(fragToLight, shadowTiers[2], slot, diskRadius);
+        default: return 0.0;
+    }
+}
+
+// Shadow filter radius, grows with the distance to the camera
+float shadowDiskRadius(float viewDistance)
+{
+    return (1.0 + (viewDistance / FarPlaneShadow)) / 25.0;
+}
+
+vec3 computePointLight(PointLight light, Surface surface, vec3 viewDir, vec2 pixel, float diskRadius)
+{
+    vec3 fragToLight = surface.position - light.position;
+    float distance = length(fragToLight);
+    if (distance >= light.radius) return vec3(0.0);
+
+    vec3 ambient = lighting.ambient * surface.albedo;
+
+    vec3 lightDir = -fragToLight / distance;
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    vec3 diffuse = diff * lighting.diffuse * surface.albedo;
+
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(surface.normal, halfwayDir), 0.0), lighting.shininess);
+    vec3 specular = spec * lighting.specular * surface.specular;
+
+    // Smooth window so that the light fades to 0 at its radius
+    float window = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (1.0 + lighting.linear * distance + lighting.quadratic * (distance * distance));
+
+    float shadow = computeShadowIndexed(light.shadowIndex, fragToLight, pixel, diskRadius);
+
+    return (ambient + (1-shadow)*(diffuse+specular)) * light.color * attenuation;
+}
+
+#endif
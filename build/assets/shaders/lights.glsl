@@ -0,0 +1,14 @@
+#ifndef LIGHTS_GLSL
+#define LIGHTS_GLSL
+
+// Point lights as uploaded by cluster.c (GPUPointLight)
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 color;
+    int shadowIndex;  // tier << 8 | slot, -1 if none
+};
+
+layout (std430, binding = 0) readonly buffer ClusterLights { PointLight pointLights[]; };
+
+#endif
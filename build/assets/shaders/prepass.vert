@@ -0,0 +1,15 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+// Must compute gl_Position exactly like vertex.vert for the GL_EQUAL depth test
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 460 core
+out vec4 FragColor;
+
+uniform sampler2D scene;  // Bilinear sampler
+uniform vec2 renderSize;  // Rendered region of the scene texture, in pixels
+uniform vec2 windowSize;
+uniform float sharpness;  // 0 for plain bilinear
+
+// Clamped half a texel inside the rendered region, so that the rest of the texture never bleeds in
+vec3 sampleScene(vec2 position)
+{
+    return texture(scene, clamp(position, vec2(0.5), renderSize - 0.5) / vec2(textureSize(scene, 0))).rgb;
+}
+
+void main()
+{
+    // Window pixel to rendered pixel
+    vec2 position = gl_FragCoord.xy / windowSize * renderSize;
+    vec3 center = sampleScene(position);
+    if (sharpness <= 0.0)
+    {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    // Unsharp mask over the cross of rendered neighbours, restores what the bilinear filter blurred
+    vec3 left = sampleScene(position - vec2(1.0, 0.0));
+    vec3 right = sampleScene(position + vec2(1.0, 0.0));
+    vec3 down = sampleScene(position - vec2(0.0, 1.0));
+    vec3 up = sampleScene(position + vec2(0.0, 1.0));
+    vec3 sharpened = center + (4.0*center - left - right - down - up) * 0.25 * sharpness;
+
+    // Edges are kept within their neighbours, so that they don't ring
+    vec3 low = min(center, min(min(left, right), min(down, up)));
+    vec3 high = max(center, max(max(left, right), max(down, up)));
+    FragColor = vec4(clamp(sharpened, low, high), 1.0);
+}
@@ -5,29 +5,16 @@ layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
-struct PointLight {
-    vec3 color;
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float linear;
-    float quadratic;
-    samplerCube depthCubemap;
-};
-#define NR_POINT_LIGHTS 4
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-
 out vec2 TexCoords;
 out vec3 FragPos;
-out vec3 TangentLightPos[NR_POINT_LIGHTS];
-out vec3 TangentViewPos;
-out vec3 TangentFragPos;
+out mat3 TBN;  // Tangent to world space
+
+invariant gl_Position;  // Shared with prepass.vert
 
 uniform mat4 model;
+uniform mat3 normalMatrix;  // Inverse transpose of the model matrix, computed once per draw
 uniform mat4 view;
 uniform mat4 projection;
-uniform vec3 viewPos;
 
 
 void main()
@@ -36,21 +23,11 @@ void main()
     FragPos = vec3(model * vec4(aPos, 1.0));
     gl_Position = projection * view * vec4(FragPos, 1.0);
 
-    // Expensive, should be done only once per model
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 N = normalize(normalMatrix * aNormal);
     T = normalize(T - dot(T, N) * N);
     vec3 B = cross(N, T);
     // vec3 B = normalize(normalMatrix * aBitangent);
 
-    mat3 TBN = transpose(mat3(T, B, N));
-
-    for (int i = 0; i < NR_POINT_LIGHTS; i++)
-    {
-        TangentLightPos[i] = TBN * pointLights[i].position;
-    }
-    TangentViewPos = TBN * viewPos;
-    TangentFragPos = TBN * FragPos;
+    TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 460 core
+
+#include "gbuffer.glsl"
+
+out vec4 FragColor;  // Added to the other lights
+
+flat in int lightIndex;
+
+void main()
+{
+    Surface surface;
+    if (!readGBuffer(ivec2(gl_FragCoord.xy), surface)) discard;
+
+    vec3 FragToView = viewPos - surface.position;
+    vec3 viewDir = normalize(FragToView);
+    FragColor = vec4(computePointLight(pointLights[lightIndex], surface, viewDir, gl_FragCoord.xy, shadowDiskRadius(length(FragToView))), 0.0);
+}
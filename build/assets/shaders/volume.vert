@@ -0,0 +1,17 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;  // Unit cube
+
+#include "lights.glsl"
+
+flat out int lightIndex;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    // One instance per light, the cube encloses the range of the light
+    PointLight light = pointLights[gl_InstanceID];
+    lightIndex = gl_InstanceID;
+    gl_Position = projection * view * vec4(light.position + aPos * 2.0 * light.radius, 1.0);
+}
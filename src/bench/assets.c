@@ -0,0 +1,132 @@
+#include "bench.h"
+#include "game/camera.h"
+#include "game/model.h"
+#include "game/shader.h"
+
+
+#define MESH_SIDE 64  // Vertices on a side of the generated grid mesh
+#define BINDINGS_PATH "assets/settings/bindings.stg"
+#define SHADER_SOURCE "fragment.frag"  // Has includes
+
+
+/**
+ * @brief Assimp mesh built in memory, a grid of MESH_SIDE x MESH_SIDE vertices
+*/
+typedef struct {
+    struct aiMesh mesh;
+    struct aiVector3D vertices[MESH_SIDE * MESH_SIDE];
+    struct aiVector3D normals[MESH_SIDE * MESH_SIDE];
+    struct aiVector3D textureCoords[MESH_SIDE * MESH_SIDE];
+    struct aiVector3D tangents[MESH_SIDE * MESH_SIDE];
+    struct aiVector3D bitangents[MESH_SIDE * MESH_SIDE];
+    struct aiFace faces[2 * (MESH_SIDE - 1) * (MESH_SIDE - 1)];
+    unsigned int indices[6 * (MESH_SIDE - 1) * (MESH_SIDE - 1)];
+} GridMesh;
+
+
+static void initGridMesh(GridMesh *grid)
+{
+    memset(&grid->mesh, 0, sizeof(grid->mesh));
+    for (unsigned int z=0; z<MESH_SIDE; z++)
+    {
+        for (unsigned int x=0; x<MESH_SIDE; x++)
+        {
+            const unsigned int i = z * MESH_SIDE + x;
+            grid->vertices[i] = (struct aiVector3D){(float)x, 0.1f * (float)((x * 7 + z * 3) % 5), (float)z};
+            grid->normals[i] = (struct aiVector3D){0.0f, 1.0f, 0.0f};
+            grid->textureCoords[i] = (struct aiVector3D){(float)x / (MESH_SIDE - 1), (float)z / (MESH_SIDE - 1), 0.0f};
+            grid->tangents[i] = (struct aiVector3D){1.0f, 0.0f, 0.0f};
+            grid->bitangents[i] = (struct aiVector3D){0.0f, 0.0f, 1.0f};
+        }
+    }
+
+    unsigned int face = 0;
+    for (unsigned int z=0; z<MESH_SIDE-1; z++)
+    {
+        for (unsigned int x=0; x<MESH_SIDE-1; x++)
+        {
+            const unsigned int corner = z * MESH_SIDE + x;
+            const unsigned int quad[6] = {corner, corner + MESH_SIDE, corner + 1, corner + 1, corner + MESH_SIDE, corner + MESH_SIDE + 1};
+            for (int j=0; j<2; j++, face++)
+            {
+                memcpy(&grid->indices[3 * face], &quad[3 * j], 3 * sizeof(unsigned int));
+                grid->faces[face].mNumIndices = 3;
+                grid->faces[face].mIndices = &grid->indices[3 * face];
+            }
+        }
+    }
+
+    grid->mesh.mNumVertices = MESH_SIDE * MESH_SIDE;
+    grid->mesh.mVertices = grid->vertices;
+    grid->mesh.mNormals = grid->normals;
+    grid->mesh.mTextureCoords[0] = grid->textureCoords;
+    grid->mesh.mTangents = grid->tangents;
+    grid->mesh.mBitangents = grid->bitangents;
+    grid->mesh.mNumFaces = face;
+    grid->mesh.mFaces = grid->faces;
+}
+
+
+// One call converts the whole mesh
+static void benchConvertMesh(void *data, unsigned int iterations)
+{
+    const GridMesh *grid = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        Mesh mesh = {0};
+        if (convertMesh(&mesh, &grid->mesh) < 0) return;
+        benchSink += mesh.indexCount;
+        free(mesh.vertices);
+        free(mesh.indices);
+    }
+}
+
+static void benchImportBindings(void *data, unsigned int iterations)
+{
+    Bindings *bindings = data;
+    for (unsigned int i=0; i<iterations; i++) benchSink += importBindings(BINDINGS_PATH, bindings);
+}
+
+static void benchShaderSource(void *data, unsigned int iterations)
+{
+    (void)data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        char *source = loadShaderSource(SHADER_SOURCE);
+        benchSink += source != NULL;
+        free(source);
+    }
+}
+
+
+int benchAssets(Bench *bench)
+{
+    GridMesh *grid = (GridMesh*)malloc(sizeof(GridMesh));
+    if (grid == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the mesh benchmarks\n");
+        return -1;
+    }
+    initGridMesh(grid);
+    const int status = runBenchmark(bench, "mesh/convertMesh", benchConvertMesh, grid);
+    free(grid);
+    if (status < 0) return -1;
+
+    // The files are read from the assets directory, each is checked once so that errors are not logged in a loop
+    Bindings bindings;
+    if (benchSelected(bench, "bindings/importBindings"))
+    {
+        if (importBindings(BINDINGS_PATH, &bindings) < 0) LOG_WARN("Skipped bindings/importBindings, run the benchmarks from the build directory\n");
+        else if (runBenchmark(bench, "bindings/importBindings", benchImportBindings, &bindings) < 0) return -1;
+    }
+
+    if (benchSelected(bench, "shader/loadShaderSource"))
+    {
+        char *source = loadShaderSource(SHADER_SOURCE);
+        if (source == NULL) LOG_WARN("Skipped shader/loadShaderSource, run the benchmarks from the build directory\n");
+        else if (runBenchmark(bench, "shader/loadShaderSource", benchShaderSource, NULL) < 0) {free(source); return -1;}
+        free(source);
+    }
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "bench.h"
+
+
+volatile uint32_t benchSink = 0;
+
+
+static int compareTimes(const void *a, const void *b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted samples
+static double percentile(const double *times, unsigned int count, double p)
+{
+    unsigned int rank = (unsigned int)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return times[rank - 1];
+}
+
+
+int initBench(Bench *bench, const char *filter, unsigned int samples)
+{
+    memset(bench, 0, sizeof(Bench));
+    bench->filter = filter;
+    bench->samples = samples;
+    bench->resultSize = 32;
+    bench->results = (BenchResult*)malloc(bench->resultSize * sizeof(BenchResult));
+    bench->times = (double*)malloc(samples * sizeof(double));
+    if (bench->results == NULL || bench->times == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the benchmarks\n");
+        destroyBench(bench);
+        return -1;
+    }
+
+    printf("%-32s %10s %12s %12s %12s %12s %12s\n", "Benchmark (ns per call)", "Batch", "Min", "Mean", "P50", "P90", "P99");
+    return 0;
+}
+
+
+bool benchSelected(const Bench *bench, const char *name)
+{
+    return bench->filter == NULL || strstr(name, bench->filter) != NULL;
+}
+
+
+int runBenchmark(Bench *bench, const char *name, BenchFunction function, void *data)
+{
+    return runBurstBenchmark(bench, name, function, NULL, data, BENCH_MAX_BATCH);
+}
+
+int runBurstBenchmark(Bench *bench, const char *name, BenchFunction function, BenchFunction reset, void *data, unsigned int maxBatch)
+{
+    if (!benchSelected(bench, name)) return 0;
+
+    if (bench->resultCount == bench->resultSize)
+    {
+        BenchResult *results = (BenchResult*)realloc(bench->results, 2 * bench->resultSize * sizeof(BenchResult));
+        if (results == NULL)
+        {
+            LOG_ERROR("Failed to allocate memory for the benchmark results\n");
+            return -1;
+        }
+        bench->results = results;
+        bench->resultSize *= 2;
+    }
+
+    const double frequency = (double)SDL_GetPerformanceFrequency();
+    const Uint64 sampleTicks = (Uint64)(BENCH_SAMPLE_TIME * frequency);
+
+    // Warm up, doubling the batch until it lasts long enough to be timed precisely
+    unsigned int batch = 1;
+    const Uint64 warmupEnd = SDL_GetPerformanceCounter() + (Uint64)(BENCH_WARMUP_TIME * frequency);
+    for (;;)
+    {
+        if (reset) reset(data, batch);
+        const Uint64 start = SDL_GetPerformanceCounter();
+        function(data, batch);
+        const Uint64 end = SDL_GetPerformanceCounter();
+        if (end - start < sampleTicks && batch < maxBatch) batch *= 2;
+        else if (end >= warmupEnd) break;
+    }
+
+    double total = 0.0;
+    for (unsigned int i=0; i<bench->samples; i++)
+    {
+        if (reset) reset(data, batch);
+        const Uint64 start = SDL_GetPerformanceCounter();
+        function(data, batch);
+        const Uint64 end = SDL_GetPerformanceCounter();
+        bench->times[i] = (double)(end - start) * 1e9 / frequency / batch;
+        total += bench->times[i];
+    }
+    qsort(bench->times, bench->samples, sizeof(double), compareTimes);
+
+    BenchResult *result = &bench->results[bench->resultCount++];
+    snprintf(result->name, BENCH_NAME_SIZE, "%s", name);
+    result->batch = batch;
+    result->samples = bench->samples;
+    result->min = bench->times[0];
+    result->mean = total / bench->samples;
+    result->p50 = percentile(bench->times, bench->samples, 0.50);
+    result->p90 = percentile(bench->times, bench->samples, 0.90);
+    result->p99 = percentile(bench->times, bench->samples, 0.99);
+
+    printf("%-32s %10u %12.1f %12.1f %12.1f %12.1f %12.1f\n", result->name, result->batch, result->min, result->mean, result->p50, result->p90, result->p99);
+    fflush(stdout);
+    return 0;
+}
+
+
+int checkBenchmark(Bench *bench, const char *name, bool passed, const char *format, ...)
+{
+    char detail[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(detail, sizeof(detail), format, args);
+    va_end(args);
+
+    printf("%-32s %10s   %s\n", name, passed ? "ok" : "FAILED", detail);
+    fflush(stdout);
+    if (passed) return 0;
+    bench->failures++;
+    return -1;
+}
+
+
+int writeBenchJSON(const Bench *bench, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    fprintf(file, "{\n  \"unit\": \"ns\",\n  \"benchmarks\": [\n");
+    for (unsigned int i=0; i<bench->resultCount; i++)
+    {
+        const BenchResult *result = &bench->results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"batch\": %u, \"samples\": %u, \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f}%s\n",
+                result->name, result->batch, result->samples, result->min, result->mean, result->p50, result->p90, result->p99,
+                i + 1 < bench->resultCount ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    if (fclose(file) != 0)
+    {
+        LOG_ERROR("Failed to write file: %s\n", path);
+        return -1;
+    }
+    LOG_INFO("Wrote %d benchmark results to %s\n", bench->resultCount, path);
+    return 0;
+}
+
+
+void destroyBench(Bench *bench)
+{
+    free(bench->results);
+    free(bench->times);
+    memset(bench, 0, sizeof(Bench));
+}
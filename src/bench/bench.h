@@ -0,0 +1,175 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "game/logs.h"
+
+
+/* --- MACROS --- */
+
+#define BENCH_WARMUP_TIME 0.05  // Seconds a benchmark runs before being measured (caches, branch predictors, clocks)
+#define BENCH_SAMPLE_TIME 0.001  // Shortest sample in seconds, calls are batched until a batch lasts that long
+#define BENCH_MAX_BATCH (1u << 24)  // Most calls in a batch
+#define BENCH_SAMPLES 200  // Samples per benchmark, unless given with --samples
+#define BENCH_NAME_SIZE 64
+
+
+/* --- TYPEDEFS --- */
+
+// Benchmarked code, run iterations times over the data of the benchmark
+typedef void (*BenchFunction)(void *data, unsigned int iterations);
+
+/**
+ * @brief Result of a benchmark
+ * 
+ * @param name Name of the benchmark, group/function
+ * @param batch Calls per sample
+ * @param samples Number of samples
+ * @param min Fastest sample, in nanoseconds per call
+ * @param mean Mean of the samples, in nanoseconds per call
+ * @param p50 Median of the samples, in nanoseconds per call
+ * @param p90 90th percentile of the samples, in nanoseconds per call
+ * @param p99 99th percentile of the samples, in nanoseconds per call
+*/
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    unsigned int batch;
+    unsigned int samples;
+    double min, mean, p50, p90, p99;
+} BenchResult;
+
+/**
+ * @brief Benchmark suite structure
+ * 
+ * @param filter Only the benchmarks whose name contains it are run, all of them if NULL
+ * @param samples Samples per benchmark
+ * @param results Results of the benchmarks run
+ * @param resultCount Number of results
+ * @param resultSize Allocated size of results
+ * @param times Samples of the current benchmark
+ * @param program Path of the benchmark executable, run again by the checks needing their own process
+ * @param failures Number of checks failed
+*/
+typedef struct {
+    const char *filter;
+    unsigned int samples;
+    BenchResult *results;
+    unsigned int resultCount, resultSize;
+    double *times;
+    const char *program;
+    unsigned int failures;
+} Bench;
+
+
+/* --- VARIABLES --- */
+
+// Benchmarks add their results here, so that the compiler cannot drop the code computing them
+extern volatile uint32_t benchSink;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Initialize a benchmark suite
+ * 
+ * @param bench Pointer to the suite
+ * @param filter Only the benchmarks whose name contains it are run, all of them if NULL
+ * @param samples Samples per benchmark
+ * @return int 0 if success, -1 if error
+*/
+int initBench(Bench *bench, const char *filter, unsigned int samples);
+
+/**
+ * @brief Warm up, measure and print a benchmark
+ * 
+ * @param bench Pointer to the suite
+ * @param name Name of the benchmark, group/function
+ * @param function Benchmarked code
+ * @param data Data given to the function
+ * @return int 0 if success, -1 if error
+ * 
+ * @note Skipped if the name does not match the filter of the suite
+*/
+int runBenchmark(Bench *bench, const char *name, BenchFunction function, void *data);
+
+/**
+ * @brief Warm up, measure and print a benchmark whose cost changes as it runs (buffers filling up)
+ * 
+ * @param bench Pointer to the suite
+ * @param name Name of the benchmark, group/function
+ * @param function Benchmarked code
+ * @param reset Run before each batch and not timed, NULL if none
+ * @param data Data given to the functions
+ * @param maxBatch Most calls in a batch, a power of two
+ * @return int 0 if success, -1 if error
+ * 
+ * @note Skipped if the name does not match the filter of the suite
+*/
+int runBurstBenchmark(Bench *bench, const char *name, BenchFunction function, BenchFunction reset, void *data, unsigned int maxBatch);
+
+/**
+ * @brief Whether a benchmark matches the filter of the suite, to skip the setup of the others
+ * 
+ * @param bench Pointer to the suite
+ * @param name Name of the benchmark
+ * @return true The benchmark runs
+ * @return false The benchmark is filtered out
+*/
+bool benchSelected(const Bench *bench, const char *name);
+
+/**
+ * @brief Print the outcome of a check, the claims a suite verifies beside its timings
+ * 
+ * @param bench Pointer to the suite
+ * @param name Name of the check, group/check
+ * @param passed Whether the check passed, counted in the failures of the suite otherwise
+ * @param format printf format of what was measured
+ * @param ... Arguments of the format
+ * @return int 0 if passed, -1 if failed
+ * 
+ * @note Not filtered, the suite tests benchSelected before running the check
+*/
+int checkBenchmark(Bench *bench, const char *name, bool passed, const char *format, ...);
+
+/**
+ * @brief Write the results of a suite as JSON
+ * 
+ * @param bench Pointer to the suite
+ * @param path Path of the file
+ * @return int 0 if success, -1 if error
+*/
+int writeBenchJSON(const Bench *bench, const char *path);
+
+/**
+ * @brief Free a benchmark suite
+ * 
+ * @param bench Pointer to the suite
+*/
+void destroyBench(Bench *bench);
+
+
+/* --- SUITES --- */
+
+// Each suite builds its data, runs its benchmarks, and returns 0 if success, -1 if error
+
+int benchCollisions(Bench *bench);  // collision.c
+int benchView(Bench *bench);  // Camera and light matrices
+int benchAssets(Bench *bench);  // Mesh conversion, bindings and shader sources, from the assets directory
+int benchLogs(Bench *bench);  // Asynchronous logger, and checks that no log is lost by threads or crashes
+int benchWorld(Bench *bench);  // Game systems over the entities of a busy level
+int benchBodies(Bench *bench);  // Broadphase of many moving bodies, and checks of its pairs against brute force
+int benchMixing(Bench *bench);  // Audio mixer without a device, and checks of the resampler quality
+int benchLevel(Bench *bench);  // BVH of a level and shotgun hitscan, and checks of their queries against brute force
+
+// Child process of the crash check of benchLogs, logs to a file then crashes
+void crashLogs(const char *path);
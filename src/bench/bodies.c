@@ -0,0 +1,175 @@
+#include "bench.h"
+#include "game/broadphase.h"
+#include "game/random.h"
+
+
+#define BODY_COUNT 4000
+#define DENSE_EXTENT 60.0f  // Bodies crowd a small arena, about 12000 overlapping pairs
+#define SPARSE_EXTENT 400.0f  // Bodies spread over a large level, few pairs
+#define BIG_BODY_INTERVAL 500  // One body out of this many is a large trigger volume
+#define CELL_SIZE 1.0f  // About the size of the common bodies
+#define CHECK_UPDATES 8  // Updates compared against brute force
+
+
+/**
+ * @brief Moving boxes, bouncing inside the arena
+ * 
+ * @param extent Size of the arena on the horizontal axes, a tenth of it vertically
+ * @param positions Center of each body
+ * @param velocities Velocity of each body
+ * @param halves Half size of each body
+ * @param ids Identifier of each body in the broadphase
+*/
+typedef struct {
+    Broadphase broadphase;
+    float extent;
+    vec3 positions[BODY_COUNT];
+    vec3 velocities[BODY_COUNT];
+    float halves[BODY_COUNT];
+    int ids[BODY_COUNT];
+} BodiesData;
+
+
+static void getBodyBox(const BodiesData *d, unsigned int i, vec3 dest[2])
+{
+    for (int k=0; k<3; k++)
+    {
+        dest[0][k] = d->positions[i][k] - d->halves[i];
+        dest[1][k] = d->positions[i][k] + d->halves[i];
+    }
+}
+
+static int initBodiesData(BodiesData *d, BroadphaseMode mode, float extent)
+{
+    if (initBroadphase(&d->broadphase, mode, BODY_COUNT, CELL_SIZE) < 0) return -1;
+    d->extent = extent;
+    uint32_t seed = 0x9e3779b9u;
+    for (unsigned int i=0; i<BODY_COUNT; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            d->positions[i][k] = randomRange(&seed, 0.0f, extent);
+            d->velocities[i][k] = randomRange(&seed, -1.0f, 1.0f);
+        }
+        d->positions[i][1] *= 0.1f;
+        d->halves[i] = i % BIG_BODY_INTERVAL == 0 ? 20.0f : randomRange(&seed, 0.3f, 0.7f);
+
+        vec3 box[2];
+        getBodyBox(d, i, box);
+        if ((d->ids[i] = addBroadphaseBody(&d->broadphase, box)) < 0)
+        {
+            destroyBroadphase(&d->broadphase);
+            return -1;
+        }
+    }
+    return updateBroadphase(&d->broadphase);
+}
+
+// One frame : every body moves, then the pairs are updated
+static void moveBodies(BodiesData *d)
+{
+    for (unsigned int i=0; i<BODY_COUNT; i++)
+    {
+        glm_vec3_muladds(d->velocities[i], 1.0f / 60.0f, d->positions[i]);
+        for (int k=0; k<3; k++)
+        {
+            const float limit = k == 1 ? 0.1f * d->extent : d->extent;
+            if (d->positions[i][k] < 0.0f || d->positions[i][k] > limit) d->velocities[i][k] = -d->velocities[i][k];
+        }
+        vec3 box[2];
+        getBodyBox(d, i, box);
+        moveBroadphaseBody(&d->broadphase, d->ids[i], box);
+    }
+}
+
+
+static void benchUpdateBroadphase(void *data, unsigned int iterations)
+{
+    BodiesData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        moveBodies(d);
+        updateBroadphase(&d->broadphase);
+        benchSink += d->broadphase.eventCount;
+    }
+}
+
+
+// The pairs are the overlapping pairs brute force finds, each once, and the events lead from the previous pairs to them
+static bool checkPairs(const BodiesData *d, unsigned int previousCount, char *detail, size_t size)
+{
+    const Broadphase *broadphase = &d->broadphase;
+    unsigned int expected = 0;
+    for (unsigned int i=0; i<BODY_COUNT; i++)
+    {
+        vec3 box[2], other[2];
+        getBodyBox(d, i, box);
+        for (unsigned int j=i+1; j<BODY_COUNT; j++)
+        {
+            getBodyBox(d, j, other);
+            expected += glm_aabb_aabb(box, other);
+        }
+    }
+
+    unsigned int added = 0, removed = 0;
+    for (unsigned int i=0; i<broadphase->eventCount; i++)
+    {
+        if (broadphase->events[i].type == BROADPHASE_PAIR_ADDED) added++;
+        else removed++;
+    }
+
+    bool overlapping = true;
+    for (unsigned int i=0; i<broadphase->pairCount && overlapping; i++)
+    {
+        unsigned int a, b;
+        getBroadphasePair(broadphase->pairs[i], &a, &b);
+        overlapping = glm_aabb_aabb(broadphase->boxes[a], broadphase->boxes[b]) && (i == 0 || broadphase->pairs[i] > broadphase->pairs[i - 1]);
+    }
+
+    snprintf(detail, size, "%u pairs, %u by brute force, %u added, %u removed", broadphase->pairCount, expected, added, removed);
+    return overlapping && broadphase->pairCount == expected && previousCount + added - removed == broadphase->pairCount;
+}
+
+
+static int benchBroadphase(Bench *bench, BodiesData *data, BroadphaseMode mode, float extent, const char *name, const char *check)
+{
+    if (!benchSelected(bench, name) && !benchSelected(bench, check)) return 0;
+    if (initBodiesData(data, mode, extent) < 0) return -1;
+
+    int status = runBenchmark(bench, name, benchUpdateBroadphase, data);
+    if (status == 0 && benchSelected(bench, check))
+    {
+        bool passed = true;
+        char detail[128];
+        for (unsigned int i=0; i<CHECK_UPDATES && passed; i++)
+        {
+            const unsigned int previousCount = data->broadphase.pairCount;
+            moveBodies(data);
+            if (updateBroadphase(&data->broadphase) < 0) {status = -1; break;}
+            passed = checkPairs(data, previousCount, detail, sizeof(detail));
+        }
+        if (status == 0) checkBenchmark(bench, check, passed, "%s", detail);
+    }
+
+    destroyBroadphase(&data->broadphase);
+    return status;
+}
+
+
+int benchBodies(Bench *bench)
+{
+    BodiesData *data = (BodiesData*)malloc(sizeof(BodiesData));
+    if (data == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the broadphase benchmarks\n");
+        return -1;
+    }
+
+    int status = benchBroadphase(bench, data, BROADPHASE_SAP, DENSE_EXTENT, "broadphase/sapDense", "broadphase/sapDensePairs");
+    if (status == 0) status = benchBroadphase(bench, data, BROADPHASE_SAP, SPARSE_EXTENT, "broadphase/sapSparse", "broadphase/sapSparsePairs");
+    if (status == 0) status = benchBroadphase(bench, data, BROADPHASE_GRID, DENSE_EXTENT, "broadphase/gridDense", "broadphase/gridDensePairs");
+    if (status == 0) status = benchBroadphase(bench, data, BROADPHASE_GRID, SPARSE_EXTENT, "broadphase/gridSparse", "broadphase/gridSparsePairs");
+
+    free(data);
+    return status;
+}
@@ -0,0 +1,376 @@
+#include "bench.h"
+#include "game/collision.h"
+#include "game/random.h"
+
+
+#define SHAPE_COUNT 256  // Shapes of each kind, a power of two, small enough to stay in cache
+#define SHAPE_MASK (SHAPE_COUNT - 1)
+#define SCENE_SIZE 8.0f  // Shapes are spread in a cube of this size, so that about half the tests hit
+#define PACKET_COUNT (SHAPE_COUNT / COLLISION_PACKET_SIZE)
+#define PARTIAL_COUNT (COLLISION_PACKET_SIZE - 3)  // Lanes used by the partial packets of the checks
+
+// Second shape of a pair, so that each shape meets several others
+#define OTHER(i) (((i) * 37 + ((i) >> 8)) & SHAPE_MASK)
+
+
+/**
+ * @brief Shapes tested against each other
+*/
+typedef struct {
+    Ray rays[SHAPE_COUNT];
+    BoxCollider boxes[SHAPE_COUNT];
+    SphereCollider spheres[SHAPE_COUNT];
+    TriangleCollider triangles[SHAPE_COUNT];
+    CapsuleCollider capsules[SHAPE_COUNT];
+    vec3 points[SHAPE_COUNT];
+    vec3 moves[SHAPE_COUNT];
+
+    RayPacket rayPackets[PACKET_COUNT];
+    SpherePacket spherePackets[PACKET_COUNT];
+    BoxPacket boxPackets[PACKET_COUNT];
+    uint8_t masks[SHAPE_COUNT];
+} CollisionData;
+
+// Static, packets need an alignment malloc does not give
+static CollisionData collisionData;
+
+
+static void randomPoint(uint32_t *seed, float extent, vec3 dest)
+{
+    for (int i=0; i<3; i++) dest[i] = randomRange(seed, -extent, extent);
+}
+
+static void initCollisionData(CollisionData *data)
+{
+    uint32_t seed = 0x2545f491u;
+    for (unsigned int i=0; i<SHAPE_COUNT; i++)
+    {
+        vec3 origin, direction, size;
+        randomPoint(&seed, SCENE_SIZE, origin);
+        randomPoint(&seed, 1.0f, direction);
+        glm_vec3_normalize(direction);
+        initRay(&data->rays[i], origin, direction, randomRange(&seed, 1.0f, 2.0f * SCENE_SIZE));
+
+        randomPoint(&seed, SCENE_SIZE, origin);
+        for (int j=0; j<3; j++) size[j] = randomRange(&seed, 0.25f, 2.0f);
+        glm_vec3_sub(origin, size, data->boxes[i].min);
+        glm_vec3_add(origin, size, data->boxes[i].max);
+
+        randomPoint(&seed, SCENE_SIZE, data->spheres[i].position);
+        data->spheres[i].radius = randomRange(&seed, 0.25f, 2.0f);
+
+        TriangleCollider *triangle = &data->triangles[i];
+        randomPoint(&seed, SCENE_SIZE, origin);
+        for (int j=0; j<3; j++)
+        {
+            randomPoint(&seed, 2.0f, triangle->vertices[j]);
+            glm_vec3_add(triangle->vertices[j], origin, triangle->vertices[j]);
+        }
+        vec3 edge1, edge2;
+        glm_vec3_sub(triangle->vertices[1], triangle->vertices[0], edge1);
+        glm_vec3_sub(triangle->vertices[2], triangle->vertices[0], edge2);
+        glm_vec3_crossn(edge1, edge2, triangle->normal);
+
+        // Standing character
+        randomPoint(&seed, SCENE_SIZE, data->capsules[i].base);
+        glm_vec3_add(data->capsules[i].base, (vec3){0.0f, 1.0f, 0.0f}, data->capsules[i].tip);
+        data->capsules[i].radius = 0.4f;
+        randomPoint(&seed, 2.0f, data->moves[i]);
+
+        randomPoint(&seed, SCENE_SIZE, data->points[i]);
+    }
+
+    for (unsigned int i=0; i<PACKET_COUNT; i++)
+    {
+        initRayPacket(&data->rayPackets[i], &data->rays[i * COLLISION_PACKET_SIZE], COLLISION_PACKET_SIZE);
+        initSpherePacket(&data->spherePackets[i], &data->spheres[i * COLLISION_PACKET_SIZE], COLLISION_PACKET_SIZE);
+        initBoxPacket(&data->boxPackets[i], &data->boxes[i * COLLISION_PACKET_SIZE], COLLISION_PACKET_SIZE);
+    }
+}
+
+
+static void benchPointInBox(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += pointInBox((float*)d->points[i & SHAPE_MASK], &d->boxes[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchPointInSphere(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += pointInSphere((float*)d->points[i & SHAPE_MASK], &d->spheres[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchRayBox(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += rayBoxIntersect(&d->rays[i & SHAPE_MASK], &d->boxes[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchRaySphere(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += raySphereIntersect(&d->rays[i & SHAPE_MASK], &d->spheres[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchRayTriangle(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    float distance;
+    for (unsigned int i=0; i<iterations; i++) hits += rayTriangleIntersect(&d->rays[i & SHAPE_MASK], &d->triangles[OTHER(i)], &distance);
+    benchSink += hits;
+}
+
+static void benchBoxBox(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += boxBoxIntersect(&d->boxes[i & SHAPE_MASK], &d->boxes[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchSphereSphere(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += sphereSphereIntersect(&d->spheres[i & SHAPE_MASK], &d->spheres[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchBoxSphere(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += boxSphereIntersect(&d->boxes[i & SHAPE_MASK], &d->spheres[OTHER(i)]);
+    benchSink += hits;
+}
+
+static void benchSegmentTriangle(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    float distance = 0.0f;
+    vec3 onSegment, onTriangle;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        const CapsuleCollider *capsule = &d->capsules[i & SHAPE_MASK];
+        distance += closestPointsSegmentTriangle((float*)capsule->base, (float*)capsule->tip, &d->triangles[OTHER(i)], onSegment, onTriangle);
+    }
+    benchSink += (uint32_t)distance;
+}
+
+static void benchCapsuleSweep(void *data, unsigned int iterations)
+{
+    const CollisionData *d = data;
+    uint32_t hits = 0;
+    float toi;
+    vec3 normal;
+    for (unsigned int i=0; i<iterations; i++) hits += capsuleTriangleSweep(&d->capsules[i & SHAPE_MASK], (float*)d->moves[i & SHAPE_MASK], &d->triangles[OTHER(i)], &toi, normal);
+    benchSink += hits;
+}
+
+// Packets are tested against every box, one call per packet
+static void benchRayPacketBoxes(void *data, unsigned int iterations)
+{
+    CollisionData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        rayPacketBoxes(&d->rayPackets[i % PACKET_COUNT], d->boxes, SHAPE_COUNT, d->masks);
+        benchSink += d->masks[i & SHAPE_MASK];
+    }
+}
+
+static void benchRayPacketClosestBoxes(void *data, unsigned int iterations)
+{
+    CollisionData *d = data;
+    float distances[COLLISION_PACKET_SIZE];
+    int indices[COLLISION_PACKET_SIZE];
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        rayPacketClosestBoxes(&d->rayPackets[i % PACKET_COUNT], d->boxes, SHAPE_COUNT, distances, indices);
+        benchSink += indices[0];
+    }
+}
+
+static void benchSpherePacketBoxes(void *data, unsigned int iterations)
+{
+    CollisionData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        spherePacketBoxes(&d->spherePackets[i % PACKET_COUNT], d->boxes, SHAPE_COUNT, d->masks);
+        benchSink += d->masks[i & SHAPE_MASK];
+    }
+}
+
+static void benchBoxPacketBoxes(void *data, unsigned int iterations)
+{
+    CollisionData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        boxPacketBoxes(&d->boxPackets[i % PACKET_COUNT], d->boxes, SHAPE_COUNT, d->masks);
+        benchSink += d->masks[i & SHAPE_MASK];
+    }
+}
+
+
+// Distance where a ray enters a box, as the single ray query finds it (0 if the ray starts inside)
+static float rayBoxEntry(const Ray *ray, const BoxCollider *box)
+{
+    float tmin = -FLT_MAX;
+    for (int k=0; k<3; k++)
+    {
+        const float t1 = (box->min[k] - ray->origin[k]) * ray->invDirection[k];
+        const float t2 = (box->max[k] - ray->origin[k]) * ray->invDirection[k];
+        tmin = fmaxf(tmin, fminf(t1, t2));
+    }
+    return fmaxf(tmin, 0.0f);
+}
+
+// Rays along the axes, their inverse directions are infinite, half of them start in the plane of a box face
+static void initAxisRays(const CollisionData *d, Ray rays[COLLISION_PACKET_SIZE])
+{
+    for (unsigned int i=0; i<COLLISION_PACKET_SIZE; i++)
+    {
+        const int axis = i % 3;
+        vec3 origin, direction = {0.0f, 0.0f, 0.0f};
+        glm_vec3_copy((float*)d->points[i], origin);
+        direction[axis] = i & 1 ? -1.0f : 1.0f;
+        if (i >= COLLISION_PACKET_SIZE / 2) origin[(axis + 1) % 3] = d->boxes[i].min[(axis + 1) % 3];
+        initRay(&rays[i], origin, direction, 2.0f * SCENE_SIZE);
+    }
+}
+
+/**
+ * @brief Compare the lanes of a ray packet to the single ray queries, against every box
+ * 
+ * @param d Shapes
+ * @param rays Rays of the packet
+ * @param count Number of rays used
+ * @param closestErrors Incremented for each ray whose first box is not the one the single queries find
+ * @return unsigned int Number of ray and box pairs whose bit of the mask is wrong
+*/
+static unsigned int checkRayPacket(CollisionData *d, const Ray *rays, unsigned int count, unsigned int *closestErrors)
+{
+    RayPacket packet;
+    float distances[COLLISION_PACKET_SIZE];
+    int indices[COLLISION_PACKET_SIZE];
+    initRayPacket(&packet, rays, count);
+    rayPacketBoxes(&packet, d->boxes, SHAPE_COUNT, d->masks);
+    rayPacketClosestBoxes(&packet, d->boxes, SHAPE_COUNT, distances, indices);
+
+    unsigned int errors = 0;
+    for (unsigned int lane=0; lane<COLLISION_PACKET_SIZE; lane++)
+    {
+        int closest = -1;
+        float closestDistance = FLT_MAX;
+        for (unsigned int b=0; b<SHAPE_COUNT; b++)
+        {
+            const bool hit = lane < count && rayBoxIntersect(&rays[lane], &d->boxes[b]);
+            errors += hit != ((d->masks[b] >> lane) & 1);
+            if (hit && rayBoxEntry(&rays[lane], &d->boxes[b]) < closestDistance)
+            {
+                closest = (int)b;
+                closestDistance = rayBoxEntry(&rays[lane], &d->boxes[b]);
+            }
+        }
+        *closestErrors += indices[lane] != closest || fabsf(distances[lane] - closestDistance) > 1e-5f * fmaxf(closestDistance, 1.0f);
+    }
+    return errors;
+}
+
+// Sphere packets against every box, pairs whose bit of the mask is not what boxSphereIntersect finds
+static unsigned int checkSpherePacket(CollisionData *d, const SphereCollider *spheres, unsigned int count)
+{
+    SpherePacket packet;
+    initSpherePacket(&packet, spheres, count);
+    spherePacketBoxes(&packet, d->boxes, SHAPE_COUNT, d->masks);
+
+    unsigned int errors = 0;
+    for (unsigned int b=0; b<SHAPE_COUNT; b++)
+        for (unsigned int lane=0; lane<COLLISION_PACKET_SIZE; lane++)
+            errors += (lane < count && boxSphereIntersect(&d->boxes[b], &spheres[lane])) != ((d->masks[b] >> lane) & 1);
+    return errors;
+}
+
+// Box packets against every box, pairs whose bit of the mask is not what boxBoxIntersect finds
+static unsigned int checkBoxPacket(CollisionData *d, const BoxCollider *boxes, unsigned int count)
+{
+    BoxPacket packet;
+    initBoxPacket(&packet, boxes, count);
+    boxPacketBoxes(&packet, d->boxes, SHAPE_COUNT, d->masks);
+
+    unsigned int errors = 0;
+    for (unsigned int b=0; b<SHAPE_COUNT; b++)
+        for (unsigned int lane=0; lane<COLLISION_PACKET_SIZE; lane++)
+            errors += (lane < count && boxBoxIntersect(&boxes[lane], &d->boxes[b])) != ((d->masks[b] >> lane) & 1);
+    return errors;
+}
+
+// Every lane of the packets matches the single queries, in full packets, partial packets and with rays along the axes
+static void checkPackets(Bench *bench, CollisionData *d)
+{
+    if (!benchSelected(bench, "collision/rayPacketLanes") && !benchSelected(bench, "collision/rayPacketClosestLanes") &&
+        !benchSelected(bench, "collision/spherePacketLanes") && !benchSelected(bench, "collision/boxPacketLanes")) return;
+
+    unsigned int rayErrors = 0, closestErrors = 0, sphereErrors = 0, boxErrors = 0;
+    for (unsigned int i=0; i<PACKET_COUNT; i++)
+    {
+        const unsigned int first = i * COLLISION_PACKET_SIZE;
+        rayErrors += checkRayPacket(d, &d->rays[first], COLLISION_PACKET_SIZE, &closestErrors);
+        rayErrors += checkRayPacket(d, &d->rays[first], PARTIAL_COUNT, &closestErrors);
+        sphereErrors += checkSpherePacket(d, &d->spheres[first], COLLISION_PACKET_SIZE);
+        sphereErrors += checkSpherePacket(d, &d->spheres[first], PARTIAL_COUNT);
+        boxErrors += checkBoxPacket(d, &d->boxes[first], COLLISION_PACKET_SIZE);
+        boxErrors += checkBoxPacket(d, &d->boxes[first], PARTIAL_COUNT);
+    }
+    Ray axisRays[COLLISION_PACKET_SIZE];
+    initAxisRays(d, axisRays);
+    rayErrors += checkRayPacket(d, axisRays, COLLISION_PACKET_SIZE, &closestErrors);
+    rayErrors += checkRayPacket(d, axisRays, PARTIAL_COUNT, &closestErrors);
+
+    // Each packet is checked full and partial, the unused lanes included
+    const unsigned int lanes = 2 * PACKET_COUNT * COLLISION_PACKET_SIZE, rayLanes = lanes + 2 * COLLISION_PACKET_SIZE;
+    if (benchSelected(bench, "collision/rayPacketLanes")) checkBenchmark(bench, "collision/rayPacketLanes", rayErrors == 0, "%u of %u ray and box pairs differ from rayBoxIntersect", rayErrors, rayLanes * SHAPE_COUNT);
+    if (benchSelected(bench, "collision/rayPacketClosestLanes")) checkBenchmark(bench, "collision/rayPacketClosestLanes", closestErrors == 0, "%u of %u rays differ from the closest single ray hit", closestErrors, rayLanes);
+    if (benchSelected(bench, "collision/spherePacketLanes")) checkBenchmark(bench, "collision/spherePacketLanes", sphereErrors == 0, "%u of %u sphere and box pairs differ from boxSphereIntersect", sphereErrors, lanes * SHAPE_COUNT);
+    if (benchSelected(bench, "collision/boxPacketLanes")) checkBenchmark(bench, "collision/boxPacketLanes", boxErrors == 0, "%u of %u box pairs differ from boxBoxIntersect", boxErrors, lanes * SHAPE_COUNT);
+}
+
+
+int benchCollisions(Bench *bench)
+{
+    CollisionData *data = &collisionData;
+    initCollisionData(data);
+
+    const struct {const char *name; BenchFunction function;} benchmarks[] = {
+        {"collision/pointInBox", benchPointInBox},
+        {"collision/pointInSphere", benchPointInSphere},
+        {"collision/rayBox", benchRayBox},
+        {"collision/raySphere", benchRaySphere},
+        {"collision/rayTriangle", benchRayTriangle},
+        {"collision/boxBox", benchBoxBox},
+        {"collision/sphereSphere", benchSphereSphere},
+        {"collision/boxSphere", benchBoxSphere},
+        {"collision/segmentTriangle", benchSegmentTriangle},
+        {"collision/capsuleSweep", benchCapsuleSweep},
+        {"collision/rayPacketBoxes", benchRayPacketBoxes},
+        {"collision/rayPacketClosestBoxes", benchRayPacketClosestBoxes},
+        {"collision/spherePacketBoxes", benchSpherePacketBoxes},
+        {"collision/boxPacketBoxes", benchBoxPacketBoxes}
+    };
+
+    int status = 0;
+    for (unsigned int i=0; i<sizeof(benchmarks)/sizeof(benchmarks[0]) && status == 0; i++)
+        status = runBenchmark(bench, benchmarks[i].name, benchmarks[i].function, data);
+
+    if (status == 0) checkPackets(bench, data);
+    return status;
+}
@@ -0,0 +1,645 @@
+#include "bench.h"
+#include "game/level.h"
+#include "game/random.h"
+#include "game/weapon.h"
+
+
+#define GROUND_CELLS 64  // Cells of the ground on each side, two triangles each
+#define GROUND_HEIGHT 2.0f  // Height of the hills
+#define BLOCK_COUNT 256  // Crates and walls standing on the ground, twelve triangles each
+#define BLOCK_MATERIALS 8
+#define CLEARING 12.0f  // Half size of the middle of the level, free of blocks and targets but for the wall of the hitscan checks
+#define LEVEL_TRIANGLES (2 * GROUND_CELLS * GROUND_CELLS + 12 * (BLOCK_COUNT + 1))
+#define QUERY_COUNT 512  // Rays and volumes cycled by the benchmarks, all of them checked against brute force
+#define QUERY_MASK (QUERY_COUNT - 1)
+#define RAY_LENGTH 80.0f
+#define GATHER_EXTENT 2.0f  // Half size of the boxes gathered around the characters
+#define BVH_CACHE_PATH "bench_level.bvh"  // Written by the checks in the working directory, then removed
+
+#define PLAYER_COUNT 8  // Players firing a shotgun blast in the same frame
+#define TARGET_COUNT 64  // Players and enemies that can be shot
+#define BLAST_RAYS (PLAYER_COUNT * SHOTGUN_PELLETS)
+#define HITSCAN_BUDGET 1e6  // Nanoseconds all the blasts of a frame may take
+
+
+/**
+ * @brief Level and the queries run against it
+ *
+ * @param level Ground and blocks, with their BVH built on the job system
+ * @param jobs Job system of the parallel builds
+ * @param rays Shots and lines of sight, from about the height of the eyes
+ * @param capsules Standing characters, some of them touching the ground or a block
+ * @param found Triangles found by a query
+ * @param expected Triangles found by brute force
+ * @param world Targets of the hitscan, boxes standing on the ground
+ * @param shooters Eyes of the players firing
+ * @param aims Directions of the blasts, each at a target
+ * @param seed State of the pellet spread
+ * @param blast Pellets of all the players
+ * @param hits Hits of the pellets
+ * @param hidden Target behind the wall across the middle
+*/
+typedef struct {
+    LevelCollision level;
+    JobSystem *jobs;
+    Ray rays[QUERY_COUNT];
+    CapsuleCollider capsules[QUERY_COUNT];
+    unsigned int found[LEVEL_TRIANGLES];
+    unsigned int expected[LEVEL_TRIANGLES];
+
+    World world;
+    vec3 shooters[PLAYER_COUNT];
+    vec3 aims[PLAYER_COUNT];
+    uint32_t seed;
+    Ray blast[BLAST_RAYS];
+    HitRecord hits[BLAST_RAYS];
+    Entity hidden;
+} LevelData;
+
+
+static float getGroundHeight(float x, float z)
+{
+    return GROUND_HEIGHT * sinf(0.15f * x) * cosf(0.11f * z);
+}
+
+static void addTriangle(LevelCollision *level, vec3 a, vec3 b, vec3 c, uint16_t material)
+{
+    TriangleCollider *triangle = &level->triangles[level->triangleCount];
+    level->materials[level->triangleCount++] = material;
+    glm_vec3_copy(a, triangle->vertices[0]);
+    glm_vec3_copy(b, triangle->vertices[1]);
+    glm_vec3_copy(c, triangle->vertices[2]);
+    vec3 e1, e2;
+    glm_vec3_sub(b, a, e1);
+    glm_vec3_sub(c, a, e2);
+    glm_vec3_crossn(e1, e2, triangle->normal);
+}
+
+// Corners in order around the quad
+static void addQuad(LevelCollision *level, vec3 a, vec3 b, vec3 c, vec3 d, uint16_t material)
+{
+    addTriangle(level, a, b, c, material);
+    addTriangle(level, a, c, d, material);
+}
+
+// Box from its center on the ground and its half size, sunk a little in the ground
+static void addBlock(LevelCollision *level, float x, float z, vec3 size, uint16_t material)
+{
+    // Corner i has the high x if bit 0 is set, the high y for bit 1 and the high z for bit 2
+    static const int faces[6][4] = {{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+    const float base = getGroundHeight(x, z) - 0.5f;
+    vec3 corners[8];
+    for (int i=0; i<8; i++)
+    {
+        corners[i][0] = i & 1 ? x + size[0] : x - size[0];
+        corners[i][1] = i & 2 ? base + size[1] : base;
+        corners[i][2] = i & 4 ? z + size[2] : z - size[2];
+    }
+    for (int f=0; f<6; f++) addQuad(level, corners[faces[f][0]], corners[faces[f][1]], corners[faces[f][2]], corners[faces[f][3]], material);
+}
+
+// Random position on the ground, out of the clearing
+static void getGroundPosition(uint32_t *seed, float margin, float *x, float *z)
+{
+    do
+    {
+        *x = randomRange(seed, margin - LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT - margin);
+        *z = randomRange(seed, margin - LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT - margin);
+    }
+    while (fabsf(*x) < CLEARING + margin && fabsf(*z) < CLEARING + margin);
+}
+
+// Hilly ground, blocks sunk a little in it, and a wall across the middle
+static int initBenchLevel(LevelCollision *level, JobSystem *jobs)
+{
+    memset(level, 0, sizeof(LevelCollision));
+    level->triangles = (TriangleCollider*)malloc(LEVEL_TRIANGLES * sizeof(TriangleCollider));
+    level->materials = (uint16_t*)malloc(LEVEL_TRIANGLES * sizeof(uint16_t));
+    if (!level->triangles || !level->materials)
+    {
+        LOG_ERROR("Failed to allocate memory for the level benchmarks\n");
+        destroyLevelCollision(level);
+        return -1;
+    }
+
+    const float cell = 2.0f * LEVEL_GROUND_EXTENT / GROUND_CELLS;
+    for (int z=0; z<GROUND_CELLS; z++)
+    {
+        for (int x=0; x<GROUND_CELLS; x++)
+        {
+            vec3 corners[4];
+            for (int i=0; i<4; i++)
+            {
+                corners[i][0] = -LEVEL_GROUND_EXTENT + (x + (i == 1 || i == 2)) * cell;
+                corners[i][2] = -LEVEL_GROUND_EXTENT + (z + (i >= 2)) * cell;
+                corners[i][1] = getGroundHeight(corners[i][0], corners[i][2]);
+            }
+            addQuad(level, corners[0], corners[3], corners[2], corners[1], LEVEL_MATERIAL_GROUND);
+        }
+    }
+
+    uint32_t seed = 0x6a09e667u;
+    for (unsigned int b=0; b<BLOCK_COUNT; b++)
+    {
+        float x, z;
+        getGroundPosition(&seed, 4.0f, &x, &z);
+        vec3 size = {randomRange(&seed, 0.5f, 3.0f), randomRange(&seed, 0.5f, 4.0f), randomRange(&seed, 0.5f, 3.0f)};
+        addBlock(level, x, z, size, (uint16_t)(1 + b % BLOCK_MATERIALS));
+    }
+    addBlock(level, 0.0f, 0.0f, (vec3){0.25f, 4.0f, 3.0f}, 1 + BLOCK_MATERIALS);
+
+    if (buildTriangleBVH(&level->bvh, level->triangles, level->triangleCount, jobs) < 0)
+    {
+        destroyLevelCollision(level);
+        return -1;
+    }
+    return 0;
+}
+
+static void initQueries(LevelData *d)
+{
+    uint32_t seed = 0xbb67ae85u;
+    for (unsigned int i=0; i<QUERY_COUNT; i++)
+    {
+        vec3 origin, direction;
+        origin[0] = randomRange(&seed, -LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT);
+        origin[2] = randomRange(&seed, -LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT);
+        origin[1] = getGroundHeight(origin[0], origin[2]) + randomRange(&seed, 0.5f, 6.0f);
+        direction[0] = randomRange(&seed, -1.0f, 1.0f);
+        direction[1] = randomRange(&seed, -0.3f, 0.1f);
+        direction[2] = randomRange(&seed, -1.0f, 1.0f);
+        glm_vec3_normalize(direction);
+        initRay(&d->rays[i], origin, direction, RAY_LENGTH);
+
+        CapsuleCollider *capsule = &d->capsules[i];
+        capsule->base[0] = randomRange(&seed, -LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT);
+        capsule->base[2] = randomRange(&seed, -LEVEL_GROUND_EXTENT, LEVEL_GROUND_EXTENT);
+        capsule->base[1] = getGroundHeight(capsule->base[0], capsule->base[2]) + randomRange(&seed, 0.0f, 1.5f);
+        glm_vec3_add(capsule->base, (vec3){0.0f, 1.2f, 0.0f}, capsule->tip);
+        capsule->radius = 0.4f;
+    }
+}
+
+// Sphere around the feet of a character
+static void getQuerySphere(const CapsuleCollider *capsule, SphereCollider *dest)
+{
+    glm_vec3_copy((float*)capsule->base, dest->position);
+    dest->radius = 1.0f;
+}
+
+static void getQueryBox(const CapsuleCollider *capsule, vec3 dest[2])
+{
+    glm_vec3_subs((float*)capsule->base, GATHER_EXTENT, dest[0]);
+    glm_vec3_adds((float*)capsule->base, GATHER_EXTENT, dest[1]);
+}
+
+// Eye of a player standing on the ground
+static void getEyePosition(float x, float z, vec3 dest)
+{
+    glm_vec3_copy((vec3){x, getGroundHeight(x, z) + 1.6f, z}, dest);
+}
+
+static int addTarget(World *world, float x, float z, Entity *entity)
+{
+    const BoxCollider collider = {{-0.4f, 0.0f, -0.4f}, {0.4f, 1.8f, 0.4f}};
+    vec3 position = {x, getGroundHeight(x, z), z};
+    if (createEntity(world, entity) < 0 || addComponent(world, *entity, COMPONENT_POSITION, position) < 0) return -1;
+    return addComponent(world, *entity, COMPONENT_COLLIDER, &collider);
+}
+
+// Targets around the clearing, and players each aiming at one of them
+static int initTargets(LevelData *d)
+{
+    if (initGameWorld(&d->world) < 0) return -1;
+
+    uint32_t seed = 0x3c6ef372u;
+    vec3 chests[PLAYER_COUNT];
+    for (unsigned int i=0; i<TARGET_COUNT; i++)
+    {
+        float x, z;
+        Entity entity;
+        getGroundPosition(&seed, 1.0f, &x, &z);
+        if (addTarget(&d->world, x, z, &entity) < 0) return -1;
+        if (i < PLAYER_COUNT) glm_vec3_copy((vec3){x, getGroundHeight(x, z) + 1.2f, z}, chests[i]);
+    }
+    // A few steps away, so that most pellets reach their target
+    for (unsigned int i=0; i<PLAYER_COUNT; i++)
+    {
+        float x, z;
+        do
+        {
+            const float angle = randomRange(&seed, 0.0f, 2.0f * GLM_PIf), distance = randomRange(&seed, 5.0f, 15.0f);
+            x = chests[i][0] + distance * cosf(angle);
+            z = chests[i][2] + distance * sinf(angle);
+        }
+        while (fabsf(x) > LEVEL_GROUND_EXTENT - 1.0f || fabsf(z) > LEVEL_GROUND_EXTENT - 1.0f || (fabsf(x) < CLEARING && fabsf(z) < CLEARING));
+        getEyePosition(x, z, d->shooters[i]);
+        glm_vec3_sub(chests[i], d->shooters[i], d->aims[i]);
+        glm_vec3_normalize(d->aims[i]);
+    }
+    d->seed = seed;
+    return addTarget(&d->world, 4.0f, 0.0f, &d->hidden);
+}
+
+
+static void benchBuild(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        TriangleBVH bvh;
+        buildTriangleBVH(&bvh, d->level.triangles, d->level.triangleCount, NULL);
+        benchSink += bvh.nodeCount;
+        destroyTriangleBVH(&bvh);
+    }
+}
+
+static void benchBuildParallel(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        TriangleBVH bvh;
+        buildTriangleBVH(&bvh, d->level.triangles, d->level.triangleCount, d->jobs);
+        benchSink += bvh.nodeCount;
+        destroyTriangleBVH(&bvh);
+    }
+}
+
+// The cached tree, validated, instead of a build
+static void benchLoad(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        TriangleBVH bvh;
+        loadTriangleBVH(&bvh, d->level.triangles, d->level.triangleCount, BVH_CACHE_PATH);
+        benchSink += bvh.nodeCount;
+        destroyTriangleBVH(&bvh);
+    }
+}
+
+static void benchRaycast(void *data, unsigned int iterations)
+{
+    const LevelData *d = data;
+    uint32_t hits = 0;
+    float distance;
+    unsigned int triangle;
+    for (unsigned int i=0; i<iterations; i++) hits += raycastBVH(&d->level.bvh, &d->rays[i & QUERY_MASK], &distance, &triangle);
+    benchSink += hits;
+}
+
+static void benchRaycastAny(void *data, unsigned int iterations)
+{
+    const LevelData *d = data;
+    uint32_t hits = 0;
+    for (unsigned int i=0; i<iterations; i++) hits += raycastAnyBVH(&d->level.bvh, &d->rays[i & QUERY_MASK]);
+    benchSink += hits;
+}
+
+static void benchOverlapCapsule(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++) benchSink += overlapCapsuleBVH(&d->level.bvh, &d->capsules[i & QUERY_MASK], d->found, LEVEL_TRIANGLES);
+}
+
+static void benchGather(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        vec3 box[2];
+        getQueryBox(&d->capsules[i & QUERY_MASK], box);
+        benchSink += gatherBVHTriangles(&d->level.bvh, box, d->found, LEVEL_TRIANGLES);
+    }
+}
+
+// A shotgun blast of every player, in the same frame
+static void benchBlasts(void *data, unsigned int iterations)
+{
+    LevelData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        for (unsigned int p=0; p<PLAYER_COUNT; p++) spreadPellets(&d->blast[p * SHOTGUN_PELLETS], SHOTGUN_PELLETS, d->shooters[p], d->aims[p], glm_rad(SHOTGUN_SPREAD), SHOTGUN_RANGE, &d->seed);
+        benchSink += traceHitscan(d->blast, BLAST_RAYS, &d->level, &d->world, d->hits);
+    }
+}
+
+
+// Closest and any hit of each ray, against every triangle
+static void checkRaycasts(Bench *bench, const LevelData *d)
+{
+    const LevelCollision *level = &d->level;
+    unsigned int closestErrors = 0, anyErrors = 0, hits = 0;
+    for (unsigned int i=0; i<QUERY_COUNT; i++)
+    {
+        const Ray *ray = &d->rays[i];
+        float expected = ray->length, t;
+        bool expectedHit = false;
+        for (unsigned int j=0; j<level->triangleCount; j++)
+        {
+            if (!rayTriangleIntersect(ray, &level->triangles[j], &t) || t >= expected) continue;
+            expected = t;
+            expectedHit = true;
+        }
+
+        // Triangles hit at the same distance are equally right
+        float distance;
+        unsigned int triangle;
+        const bool hit = raycastBVH(&level->bvh, ray, &distance, &triangle);
+        closestErrors += hit != expectedHit || (hit && (distance != expected || !rayTriangleIntersect(ray, &level->triangles[triangle], &t) || t != distance));
+        anyErrors += raycastAnyBVH(&level->bvh, ray) != expectedHit;
+        hits += expectedHit;
+    }
+
+    if (benchSelected(bench, "bvh/closestHits")) checkBenchmark(bench, "bvh/closestHits", closestErrors == 0, "%u of %u rays differ from brute force, %u of them hit", closestErrors, QUERY_COUNT, hits);
+    if (benchSelected(bench, "bvh/anyHits")) checkBenchmark(bench, "bvh/anyHits", anyErrors == 0, "%u of %u rays differ from brute force", anyErrors, QUERY_COUNT);
+}
+
+static int compareIndices(const void *a, const void *b)
+{
+    const unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+// Whether a query found the triangles brute force found, in any order
+static bool isSameTriangles(unsigned int *found, unsigned int foundCount, unsigned int *expected, unsigned int expectedCount)
+{
+    if (foundCount != expectedCount) return false;
+    qsort(found, foundCount, sizeof(unsigned int), compareIndices);
+    qsort(expected, expectedCount, sizeof(unsigned int), compareIndices);
+    return memcmp(found, expected, foundCount * sizeof(unsigned int)) == 0;
+}
+
+// Triangles within a capsule, or whose bounds overlap a box, against every triangle
+static void checkOverlaps(Bench *bench, LevelData *d)
+{
+    const LevelCollision *level = &d->level;
+    unsigned int sphereErrors = 0, capsuleErrors = 0, gatherErrors = 0, found = 0;
+    for (unsigned int i=0; i<QUERY_COUNT; i++)
+    {
+        const CapsuleCollider *capsule = &d->capsules[i];
+        SphereCollider sphere;
+        vec3 box[2];
+        getQuerySphere(capsule, &sphere);
+        getQueryBox(capsule, box);
+
+        for (int query=0; query<3; query++)
+        {
+            unsigned int expectedCount = 0;
+            for (unsigned int j=0; j<level->triangleCount; j++)
+            {
+                const TriangleCollider *triangle = &level->triangles[j];
+                vec3 onSegment, onTriangle, bounds[2];
+                bool overlap;
+                if (query == 0) overlap = closestPointsSegmentTriangle(sphere.position, sphere.position, triangle, onSegment, onTriangle) <= sphere.radius * sphere.radius;
+                else if (query == 1) overlap = closestPointsSegmentTriangle((float*)capsule->base, (float*)capsule->tip, triangle, onSegment, onTriangle) <= capsule->radius * capsule->radius;
+                else
+                {
+                    glm_vec3_minv((float*)triangle->vertices[0], (float*)triangle->vertices[1], bounds[0]);
+                    glm_vec3_minv(bounds[0], (float*)triangle->vertices[2], bounds[0]);
+                    glm_vec3_maxv((float*)triangle->vertices[0], (float*)triangle->vertices[1], bounds[1]);
+                    glm_vec3_maxv(bounds[1], (float*)triangle->vertices[2], bounds[1]);
+                    overlap = glm_aabb_aabb(bounds, box);
+                }
+                if (overlap) d->expected[expectedCount++] = j;
+            }
+
+            unsigned int foundCount;
+            if (query == 0) foundCount = overlapSphereBVH(&level->bvh, &sphere, d->found, LEVEL_TRIANGLES);
+            else if (query == 1) foundCount = overlapCapsuleBVH(&level->bvh, capsule, d->found, LEVEL_TRIANGLES);
+            else foundCount = gatherBVHTriangles(&level->bvh, box, d->found, LEVEL_TRIANGLES);
+            const bool same = isSameTriangles(d->found, foundCount, d->expected, expectedCount);
+            if (query == 0) sphereErrors += !same;
+            else if (query == 1) capsuleErrors += !same;
+            else gatherErrors += !same;
+            found += expectedCount;
+        }
+    }
+
+    if (benchSelected(bench, "bvh/overlapSphere")) checkBenchmark(bench, "bvh/overlapSphere", sphereErrors == 0, "%u of %u spheres differ from brute force", sphereErrors, QUERY_COUNT);
+    if (benchSelected(bench, "bvh/overlapCapsules")) checkBenchmark(bench, "bvh/overlapCapsules", capsuleErrors == 0, "%u of %u capsules differ from brute force", capsuleErrors, QUERY_COUNT);
+    if (benchSelected(bench, "bvh/gatherBoxes")) checkBenchmark(bench, "bvh/gatherBoxes", gatherErrors == 0, "%u of %u boxes differ from brute force, %u triangles found by all the queries", gatherErrors, QUERY_COUNT, found);
+}
+
+// Save a tree with its nodes or indices replaced, whether loading it fails
+static bool isCorruptionRejected(const LevelCollision *level, BVHNode *nodes, uint32_t *indices)
+{
+    TriangleBVH corrupted = level->bvh;
+    corrupted.nodes = nodes;
+    corrupted.indices = indices;
+    TriangleBVH loaded;
+    return saveTriangleBVH(&corrupted, BVH_CACHE_PATH) == 0 && loadTriangleBVH(&loaded, level->triangles, level->triangleCount, BVH_CACHE_PATH) < 0;
+}
+
+// Overwrite the start of the saved file, or cut it, whether loading it fails
+static bool isFileCorruptionRejected(const LevelCollision *level, bool truncate)
+{
+    if (saveTriangleBVH(&level->bvh, BVH_CACHE_PATH) < 0) return false;
+    FILE *file = fopen(BVH_CACHE_PATH, truncate ? "wb" : "r+b");
+    if (file == NULL) return false;
+    const uint32_t zero = 0;
+    const bool written = truncate || fwrite(&zero, sizeof(zero), 1, file) == 1;
+    fclose(file);
+    TriangleBVH loaded;
+    return written && loadTriangleBVH(&loaded, level->triangles, level->triangleCount, BVH_CACHE_PATH) < 0;
+}
+
+// A saved tree loads as it was, a damaged or stale one is rejected
+static int checkCache(Bench *bench, LevelData *d)
+{
+    const LevelCollision *level = &d->level;
+    const TriangleBVH *bvh = &level->bvh;
+    BVHNode *nodes = (BVHNode*)malloc(bvh->nodeCount * sizeof(BVHNode));
+    uint32_t *indices = (uint32_t*)malloc(level->triangleCount * sizeof(uint32_t));
+    TriangleCollider *moved = (TriangleCollider*)malloc(level->triangleCount * sizeof(TriangleCollider));
+    if (!nodes || !indices || !moved)
+    {
+        LOG_ERROR("Failed to allocate memory for the BVH cache check\n");
+        free(nodes);
+        free(indices);
+        free(moved);
+        return -1;
+    }
+
+    TriangleBVH loaded;
+    bool roundTrip = saveTriangleBVH(bvh, BVH_CACHE_PATH) == 0 && loadTriangleBVH(&loaded, level->triangles, level->triangleCount, BVH_CACHE_PATH) == 0;
+    if (roundTrip)
+    {
+        roundTrip = loaded.nodeCount == bvh->nodeCount && loaded.key == bvh->key && glm_vec3_eqv(loaded.origin, (float*)bvh->origin) && glm_vec3_eqv(loaded.scale, (float*)bvh->scale)
+            && memcmp(loaded.nodes, bvh->nodes, bvh->nodeCount * sizeof(BVHNode)) == 0 && memcmp(loaded.indices, bvh->indices, level->triangleCount * sizeof(uint32_t)) == 0;
+        destroyTriangleBVH(&loaded);
+    }
+
+    // The first leaf, depth first, and the root, an inner node
+    unsigned int leaf = 0;
+    while (!(bvh->nodes[leaf].data >> BVH_COUNT_SHIFT)) leaf++;
+    const size_t nodesSize = bvh->nodeCount * sizeof(BVHNode), indicesSize = level->triangleCount * sizeof(uint32_t);
+
+    unsigned int rejected = 0;
+    rejected += isFileCorruptionRejected(level, false);  // Magic
+    rejected += isFileCorruptionRejected(level, true);  // Empty file
+
+    // Second child of the root pointing back at the root
+    memcpy(nodes, bvh->nodes, nodesSize);
+    memcpy(indices, bvh->indices, indicesSize);
+    nodes[0].data = 0;
+    rejected += isCorruptionRejected(level, nodes, indices);
+
+    // Leaf past the last triangle
+    memcpy(nodes, bvh->nodes, nodesSize);
+    nodes[leaf].data = (bvh->nodes[leaf].data & ~BVH_INDEX_MASK) | (level->triangleCount - 1);
+    rejected += isCorruptionRejected(level, nodes, indices);
+
+    // Index of a triangle that does not exist
+    memcpy(nodes, bvh->nodes, nodesSize);
+    indices[0] = level->triangleCount;
+    rejected += isCorruptionRejected(level, nodes, indices);
+
+    // Stale : the triangles changed since the tree was saved
+    memcpy(moved, level->triangles, level->triangleCount * sizeof(TriangleCollider));
+    moved[0].vertices[0][1] += 0.5f;
+    rejected += saveTriangleBVH(bvh, BVH_CACHE_PATH) == 0 && loadTriangleBVH(&loaded, moved, level->triangleCount, BVH_CACHE_PATH) < 0;
+
+    const unsigned int corruptions = 6;
+    checkBenchmark(bench, "bvh/cache", roundTrip && rejected == corruptions, "round trip %s, %u of %u damaged or stale files rejected", roundTrip ? "identical" : "different", rejected, corruptions);
+
+    remove(BVH_CACHE_PATH);
+    free(nodes);
+    free(indices);
+    free(moved);
+    return 0;
+}
+
+// Shoot a ray at the hidden target from one side of the wall, whether it is hit
+static int shootHidden(LevelData *d, float x, bool *hit, HitRecord *first)
+{
+    vec3 eye, direction;
+    Ray ray;
+    getEyePosition(x, 0.0f, eye);
+    glm_vec3_sub((vec3){4.0f, getGroundHeight(4.0f, 0.0f) + 1.2f, 0.0f}, eye, direction);
+    glm_vec3_normalize(direction);
+    initRay(&ray, eye, direction, SHOTGUN_RANGE);
+
+    HitRecord hits[1];
+    const int count = traceHitscan(&ray, 1, &d->level, &d->world, hits);
+    if (count < 0) return -1;
+    *hit = count == 1 && hits[0].material == HIT_MATERIAL_ENTITY && hits[0].entity.index == d->hidden.index && hits[0].entity.generation == d->hidden.generation;
+    if (count == 1) *first = hits[0];
+    return 0;
+}
+
+// Hits of the blasts in order, the level ones as raycastLevel finds them, and no target shot through the wall
+static int checkHitscan(Bench *bench, LevelData *d, unsigned int budgetResult)
+{
+    unsigned int levelHits = 0, levelErrors = 0, entityHits = 0;
+    bool sorted = true;
+    for (unsigned int p=0; p<PLAYER_COUNT; p++) spreadPellets(&d->blast[p * SHOTGUN_PELLETS], SHOTGUN_PELLETS, d->shooters[p], d->aims[p], glm_rad(SHOTGUN_SPREAD), SHOTGUN_RANGE, &d->seed);
+    const int count = traceHitscan(d->blast, BLAST_RAYS, &d->level, &d->world, d->hits);
+    if (count < 0) return -1;
+    for (int i=0; i<count; i++)
+    {
+        const HitRecord *hit = &d->hits[i];
+        sorted &= i == 0 || hit->distance >= d->hits[i - 1].distance;
+        if (hit->material == HIT_MATERIAL_ENTITY)
+        {
+            entityHits++;
+            continue;
+        }
+        LevelHit expected;
+        levelHits++;
+        levelErrors += !raycastLevel(&d->level, &d->blast[hit->ray], &expected) || expected.distance != hit->distance
+            || d->level.materials[expected.triangle] != hit->material || !glm_vec3_eqv(expected.normal, (float*)hit->normal);
+    }
+    if (benchSelected(bench, "hitscan/order")) checkBenchmark(bench, "hitscan/order", sorted, "%d hits of %u pellets %s by distance", count, BLAST_RAYS, sorted ? "sorted" : "not sorted");
+    if (benchSelected(bench, "hitscan/levelHits")) checkBenchmark(bench, "hitscan/levelHits", levelErrors == 0, "%u of %u level hits differ from raycastLevel, %u targets hit", levelErrors, levelHits, entityHits);
+
+    // Seen from its side of the wall, the wall is hit from the other
+    if (benchSelected(bench, "hitscan/walls"))
+    {
+        bool seen, shotThrough;
+        HitRecord front, behind = {0};
+        if (shootHidden(d, 8.0f, &seen, &front) < 0 || shootHidden(d, -6.0f, &shotThrough, &behind) < 0) return -1;
+        const bool wall = !shotThrough && behind.material == 1 + BLOCK_MATERIALS;
+        checkBenchmark(bench, "hitscan/walls", seen && wall, "target %s from its side, %s from behind the wall", seen ? "hit" : "missed", shotThrough ? "hit" : wall ? "wall hit" : "wall missed");
+    }
+
+    // Mean time of the blasts, only known if they were benchmarked
+    if (budgetResult < bench->resultCount && benchSelected(bench, "hitscan/budget"))
+    {
+        const double mean = bench->results[budgetResult].mean;
+        checkBenchmark(bench, "hitscan/budget", mean < HITSCAN_BUDGET / 4.0, "%.3f ms for %u players, a quarter of the %.0f ms budget at most", mean * 1e-6, PLAYER_COUNT, HITSCAN_BUDGET * 1e-6);
+    }
+    return 0;
+}
+
+
+int benchLevel(Bench *bench)
+{
+    static const char *const names[] = {
+        "bvh/build", "bvh/buildParallel", "bvh/load", "bvh/raycast", "bvh/raycastAny", "bvh/overlapCapsule", "bvh/gather",
+        "bvh/closestHits", "bvh/anyHits", "bvh/overlapSphere", "bvh/overlapCapsules", "bvh/gatherBoxes", "bvh/cache",
+        "hitscan/blasts", "hitscan/order", "hitscan/levelHits", "hitscan/walls", "hitscan/budget"
+    };
+    bool selected = false;
+    for (unsigned int i=0; i<sizeof(names)/sizeof(names[0]); i++) selected |= benchSelected(bench, names[i]);
+    if (!selected) return 0;
+
+    LevelData *data = (LevelData*)malloc(sizeof(LevelData));
+    if (data == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the level benchmarks\n");
+        return -1;
+    }
+
+    JobSystem jobs;
+    data->jobs = &jobs;
+    if (initJobSystem(&jobs, -1) < 0)
+    {
+        free(data);
+        return -1;
+    }
+    if (initBenchLevel(&data->level, &jobs) < 0)
+    {
+        destroyJobSystem(&jobs);
+        free(data);
+        return -1;
+    }
+    initQueries(data);
+    if (initTargets(data) < 0)
+    {
+        LOG_ERROR("Could not create the hitscan targets\n");
+        destroyWorld(&data->world);
+        destroyLevelCollision(&data->level);
+        destroyJobSystem(&jobs);
+        free(data);
+        return -1;
+    }
+
+    int status = runBenchmark(bench, "bvh/build", benchBuild, data);
+    if (status == 0) status = runBenchmark(bench, "bvh/buildParallel", benchBuildParallel, data);
+    if (status == 0 && benchSelected(bench, "bvh/load"))
+    {
+        status = saveTriangleBVH(&data->level.bvh, BVH_CACHE_PATH);
+        if (status == 0) status = runBenchmark(bench, "bvh/load", benchLoad, data);
+        remove(BVH_CACHE_PATH);
+    }
+    if (status == 0) status = runBenchmark(bench, "bvh/raycast", benchRaycast, data);
+    if (status == 0) status = runBenchmark(bench, "bvh/raycastAny", benchRaycastAny, data);
+    if (status == 0) status = runBenchmark(bench, "bvh/overlapCapsule", benchOverlapCapsule, data);
+    if (status == 0) status = runBenchmark(bench, "bvh/gather", benchGather, data);
+
+    if (status == 0 && (benchSelected(bench, "bvh/closestHits") || benchSelected(bench, "bvh/anyHits"))) checkRaycasts(bench, data);
+    if (status == 0 && (benchSelected(bench, "bvh/overlapSphere") || benchSelected(bench, "bvh/overlapCapsules") || benchSelected(bench, "bvh/gatherBoxes"))) checkOverlaps(bench, data);
+    if (status == 0 && benchSelected(bench, "bvh/cache")) status = checkCache(bench, data);
+
+    const unsigned int budgetResult = bench->resultCount;
+    if (status == 0) status = runBenchmark(bench, "hitscan/blasts", benchBlasts, data);
+    if (status == 0) status = checkHitscan(bench, data, budgetResult);
+
+    destroyWorld(&data->world);
+    destroyLevelCollision(&data->level);
+    destroyJobSystem(&jobs);
+    free(data);
+    return status;
+}
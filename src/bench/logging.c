@@ -0,0 +1,157 @@
+#include "bench.h"
+
+#include <signal.h>
+
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+#define LOGS_PATH "bench_logs.txt"  // Written by the checks in the working directory, then removed
+#define THREAD_COUNT 3
+#define THREAD_LOGS 20000  // Entries logged by each thread, many times the size of a ring
+#define CRASH_LOGS 300  // Entries logged before crashing, less than a ring so that the writer has not written them yet
+#define BURST_LOGS (LOGS_RING_SLOTS / 2)  // Entries logged at once by the burst benchmarks, the ring never fills
+
+
+// Logged at the info level whatever LOGS_LEVEL is, so that the benchmarks are the same in every build
+static void benchLogWrite(void *data, unsigned int iterations)
+{
+    (void)data;
+    for (unsigned int i=0; i<iterations; i++) LOG_AT(INFO_LOGS, "Mesh has %u vertices, %u indices and %d textures.\n", i, 3 * i, 2);
+}
+
+static void benchLogString(void *data, unsigned int iterations)
+{
+    const char *name = data;
+    for (unsigned int i=0; i<iterations; i++) LOG_AT(INFO_LOGS, "Loaded texture %s (%u of %zu)\n", name, i, (size_t)iterations);
+}
+
+// Empties the ring before a burst, not timed
+static void drainLogs(void *data, unsigned int iterations)
+{
+    (void)data;
+    (void)iterations;
+    flushLogs();
+}
+
+
+static int logThread(void *data)
+{
+    const int thread = (int)(intptr_t)data;
+    for (int i=0; i<THREAD_LOGS; i++) LOG_AT(INFO_LOGS, "Thread %d entry %d\n", thread, i);
+    return 0;
+}
+
+/**
+ * @brief Find the entries of the checks in a log file
+ * 
+ * @param path Path of the file
+ * @param found Set for each entry "Thread t entry i" written, at t * THREAD_LOGS + i
+ * @param crashed Set to whether the crash handler logged the crash
+ * @return int Number of distinct entries found, -1 if error
+*/
+static int readLogFile(const char *path, bool *found, bool *crashed)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    int count = 0;
+    *crashed = false;
+    char line[LOGS_LINE_SIZE + 1];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned int thread, entry;
+        const char *message = strstr(line, "Thread ");
+        if (strstr(line, "Crashed with signal")) *crashed = true;
+        else if (message && sscanf(message, "Thread %u entry %u", &thread, &entry) == 2 && thread < THREAD_COUNT && entry < THREAD_LOGS)
+        {
+            count += !found[thread * THREAD_LOGS + entry];
+            found[thread * THREAD_LOGS + entry] = true;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Every entry logged by concurrent threads is written once the logger is closed
+static int checkThreads(Bench *bench, bool *found)
+{
+    if (initLogs(LOGS_PATH) < 0) return -1;
+    SDL_Thread *threads[THREAD_COUNT];
+    for (int i=0; i<THREAD_COUNT; i++) threads[i] = SDL_CreateThread(logThread, "bench logs", (void*)(intptr_t)i);
+    for (int i=0; i<THREAD_COUNT; i++) if (threads[i]) SDL_WaitThread(threads[i], NULL);
+    closeLogs();
+
+    bool crashed;
+    const int count = readLogFile(LOGS_PATH, found, &crashed);
+    remove(LOGS_PATH);
+    if (count < 0) return -1;
+    checkBenchmark(bench, "logs/threads", count == THREAD_COUNT * THREAD_LOGS, "%d of %d entries from %d threads", count, THREAD_COUNT * THREAD_LOGS, THREAD_COUNT);
+    return 0;
+}
+
+// Entries still buffered when a process crashes are written by the crash handler
+static int checkCrash(Bench *bench, bool *found)
+{
+    if (bench->program == NULL) return 0;
+    char command[512];
+    snprintf(command, sizeof(command), "\"%s\" --crash-logs=%s", bench->program, LOGS_PATH);
+    remove(LOGS_PATH);
+    fflush(stdout);
+    if (system(command) == 0) LOG_WARN("Crash check did not crash\n");
+
+    bool crashed;
+    const int count = readLogFile(LOGS_PATH, found, &crashed);
+    remove(LOGS_PATH);
+    if (count < 0) return -1;
+    checkBenchmark(bench, "logs/crash", crashed && count == CRASH_LOGS, "%d of %d entries buffered before a SIGSEGV%s", count, CRASH_LOGS, crashed ? "" : ", crash not logged");
+    return 0;
+}
+
+
+void crashLogs(const char *path)
+{
+    if (initLogs(path) < 0) exit(EXIT_FAILURE);
+    for (int i=0; i<CRASH_LOGS; i++) LOG_AT(INFO_LOGS, "Thread 0 entry %d\n", i);
+    raise(SIGSEGV);
+    exit(EXIT_FAILURE);
+}
+
+
+int benchLogs(Bench *bench)
+{
+    // The writer formats to a file the system discards, what is timed is the cost to the logging thread :
+    // in bursts that fit in its ring, and flooding the logger, where it waits for the writer
+    if (benchSelected(bench, "logs/logWrite") || benchSelected(bench, "logs/logString"))
+    {
+        if (initLogs(NULL_DEVICE) < 0) return -1;
+        int status = runBurstBenchmark(bench, "logs/logWrite", benchLogWrite, drainLogs, NULL, BURST_LOGS);
+        if (status == 0) status = runBurstBenchmark(bench, "logs/logString", benchLogString, drainLogs, "textures/wall_diffuse.png", BURST_LOGS);
+        if (status == 0) status = runBenchmark(bench, "logs/logWriteSustained", benchLogWrite, NULL);
+        closeLogs();
+        if (status < 0) return -1;
+    }
+
+    if (!benchSelected(bench, "logs/threads") && !benchSelected(bench, "logs/crash")) return 0;
+    bool *found = (bool*)malloc(THREAD_COUNT * THREAD_LOGS * sizeof(bool));
+    if (found == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the logs checks\n");
+        return -1;
+    }
+
+    int status = 0;
+    memset(found, 0, THREAD_COUNT * THREAD_LOGS * sizeof(bool));
+    if (benchSelected(bench, "logs/threads")) status = checkThreads(bench, found);
+    memset(found, 0, THREAD_COUNT * THREAD_LOGS * sizeof(bool));
+    if (status == 0 && benchSelected(bench, "logs/crash")) status = checkCrash(bench, found);
+
+    free(found);
+    return status;
+}
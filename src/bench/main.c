@@ -0,0 +1,64 @@
+/*
+ * Description: Microbenchmarks of the engine hot paths, each routine is
+ * measured on its own, away from the GPU and the window.
+ * 
+ * Build with `make bench`, then run `./bench` from the build directory
+ * (some benchmarks read the assets).
+*/
+
+
+/* --- INCLUDES --- */
+
+#include "bench.h"
+
+
+/* --- MAIN --- */
+
+/**
+ * @brief Main function
+ * 
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return int Exit code
+*/
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL;
+    const char *jsonPath = NULL;
+    unsigned int samples = BENCH_SAMPLES;
+
+    // --filter=<part of a name>, --samples=<count>, --json=<file>
+    for (int i=1; i<argc; i++)
+    {
+        if (strncmp(argv[i], "--crash-logs=", 13) == 0) crashLogs(argv[i] + 13);  // Run by the logs checks, does not return
+        else if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+        else if (strncmp(argv[i], "--samples=", 10) == 0) samples = (unsigned int)strtoul(argv[i] + 10, NULL, 10);
+        else if (strncmp(argv[i], "--json=", 7) == 0) jsonPath = argv[i] + 7;
+        else LOG_WARN("Unknown argument %s\n", argv[i]);
+    }
+    if (samples == 0)
+    {
+        LOG_ERROR("At least one sample is needed\n");
+        return EXIT_FAILURE;
+    }
+
+    Bench bench;
+    if (initBench(&bench, filter, samples) < 0) return EXIT_FAILURE;
+    bench.program = argv[0];
+
+    int status = benchCollisions(&bench);
+    if (status == 0) status = benchView(&bench);
+    if (status == 0) status = benchAssets(&bench);
+    if (status == 0) status = benchLogs(&bench);
+    if (status == 0) status = benchWorld(&bench);
+    if (status == 0) status = benchBodies(&bench);
+    if (status == 0) status = benchMixing(&bench);
+    if (status == 0) status = benchLevel(&bench);
+    if (status == 0 && jsonPath) status = writeBenchJSON(&bench, jsonPath);
+
+    // Failed checks fail the run, after the other results
+    if (status == 0 && bench.failures) LOG_ERROR("%u checks failed\n", bench.failures);
+    const bool success = status == 0 && bench.failures == 0;
+    destroyBench(&bench);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include "game/audio.h"
+
+
+#define TONE_FREQUENCY 1000.0  // Hz, well inside the passband of the resampler
+#define TONE_AMPLITUDE 16000  // Half the 16 bits range, so that the filter never clips
+#define TONE_SECONDS 1
+#define SNR_SKIP 2000  // Output frames left out of the SNR at the start, where the filter fills up
+#define SNR_FRAMES 26000  // Output frames compared to the ideal tone
+#define MIN_SNR 70.0  // dB, 16 bits samples of the tone are about 92 dB, the filter taps and phases cost the rest
+#define MIX_FRAMES 1024  // Frames of a device buffer, the default latency
+#define MIX_VOICES AUDIO_VOICES  // Every voice mixed and resampled
+
+
+/**
+ * @brief Sounds mixed by the offline mixer
+*/
+typedef struct {
+    SoundBuffer mono;
+    SoundBuffer stereo;
+    float output[MIX_FRAMES * 2];
+} MixingData;
+
+
+// Sine at a rate, the same on every channel
+static int initTone(SoundBuffer *buffer, int rate, int channels)
+{
+    buffer->rate = rate;
+    buffer->channels = channels;
+    buffer->frames = rate * TONE_SECONDS;
+    buffer->samples = (Sint16*)malloc(buffer->frames * channels * sizeof(Sint16));
+    if (buffer->samples == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the mixing benchmarks\n");
+        return -1;
+    }
+    for (Uint32 i=0; i<buffer->frames; i++)
+        for (int c=0; c<channels; c++) buffer->samples[i * channels + c] = (Sint16)lround(TONE_AMPLITUDE * sin(2.0 * GLM_PI * TONE_FREQUENCY * i / rate));
+    return 0;
+}
+
+
+static void benchRenderMixer(void *data, unsigned int iterations)
+{
+    MixingData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        renderMixer(d->output, MIX_FRAMES);
+        benchSink += (uint32_t)(d->output[i & (MIX_FRAMES - 1)] * 1000.0f);
+    }
+}
+
+
+/**
+ * @brief Signal to noise ratio of a tone resampled to a device rate, against the ideal tone at that rate
+ * 
+ * @param rate Rate of the tone
+ * @param deviceRate Rate it is mixed at
+ * @param snr Set to the SNR in dB
+ * @return int 0 if success, -1 if error
+*/
+static int resampleSNR(int rate, int deviceRate, double *snr)
+{
+    SoundBuffer tone;
+    if (initTone(&tone, rate, 1) < 0) return -1;
+    float *output = (float*)malloc((SNR_SKIP + SNR_FRAMES) * 2 * sizeof(float));
+    if (output == NULL || initOfflineMixer(deviceRate) < 0)
+    {
+        free(output);
+        free(tone.samples);
+        return -1;
+    }
+
+    // Not spatial, the tone is heard at full volume on both sides
+    const Sound sound = {&tone, AUDIO_MAX_VOLUME, AUDIO_PRIORITY_DEFAULT};
+    const int status = playSound(sound, 0) < 0 ? -1 : 0;
+    if (status == 0)
+    {
+        renderMixer(output, SNR_SKIP + SNR_FRAMES);
+        double signal = 0.0, noise = 0.0;
+        for (int i=SNR_SKIP; i<SNR_SKIP + SNR_FRAMES; i++)
+        {
+            const double ideal = TONE_AMPLITUDE / 32768.0 * sin(2.0 * GLM_PI * TONE_FREQUENCY * i / deviceRate);
+            signal += ideal * ideal;
+            noise += (output[2 * i] - ideal) * (output[2 * i] - ideal);
+        }
+        *snr = 10.0 * log10(signal / noise);
+    }
+
+    closeMixer();
+    free(output);
+    free(tone.samples);
+    return status;
+}
+
+
+int benchMixing(Bench *bench)
+{
+    // Both ways between the common rates of sound files and devices
+    const struct {const char *name; int rate, deviceRate;} checks[] = {
+        {"audio/upsampleSNR", 44100, 48000},
+        {"audio/downsampleSNR", 48000, 44100}
+    };
+    for (unsigned int i=0; i<sizeof(checks)/sizeof(checks[0]); i++)
+    {
+        if (!benchSelected(bench, checks[i].name)) continue;
+        double snr;
+        if (resampleSNR(checks[i].rate, checks[i].deviceRate, &snr) < 0) return -1;
+        checkBenchmark(bench, checks[i].name, snr >= MIN_SNR, "%.1f dB from %d Hz to %d Hz, at least %.0f dB expected", snr, checks[i].rate, checks[i].deviceRate, MIN_SNR);
+    }
+
+    if (!benchSelected(bench, "audio/renderMixer")) return 0;
+    MixingData *data = (MixingData*)malloc(sizeof(MixingData));
+    if (data == NULL || initTone(&data->mono, 44100, 1) < 0)
+    {
+        free(data);
+        return -1;
+    }
+    if (initTone(&data->stereo, 22050, 2) < 0 || initOfflineMixer(AUDIO_SAMPLERATE) < 0)
+    {
+        free(data->mono.samples);
+        free(data->stereo.samples);
+        free(data);
+        return -1;
+    }
+
+    // Voices around the listener, looping for longer than the benchmark
+    setListener((vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 0.0f, -1.0f}, (vec3){0.0f, 1.0f, 0.0f});
+    for (int i=0; i<MIX_VOICES; i++)
+    {
+        const Sound sound = {i % 2 ? &data->mono : &data->stereo, AUDIO_MAX_VOLUME, AUDIO_PRIORITY_DEFAULT};
+        playSoundAt(sound, (vec3){4.0f * sinf((float)i), 0.0f, 4.0f * cosf((float)i)}, 1000000);
+    }
+    const int status = runBenchmark(bench, "audio/renderMixer", benchRenderMixer, data);
+
+    closeMixer();
+    free(data->mono.samples);
+    free(data->stereo.samples);
+    free(data);
+    return status;
+}
@@ -0,0 +1,62 @@
+#include "bench.h"
+#include "game/camera.h"
+#include "game/light.h"
+
+
+/**
+ * @brief Camera and light updated every frame
+*/
+typedef struct {
+    Camera camera;
+    PointLight light;
+    mat4 lightProjection;
+    mat4 lightMatrices[6];
+} ViewData;
+
+
+static void benchRotateCamera(void *data, unsigned int iterations)
+{
+    ViewData *d = data;
+    // Small mouse motions going back and forth, as when aiming
+    for (unsigned int i=0; i<iterations; i++) rotateCamera(&d->camera, (int)(i & 7) - 3, (int)((i >> 3) & 3) - 1);
+}
+
+static void benchUpdateCamera(void *data, unsigned int iterations)
+{
+    ViewData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        d->camera.target[0] += 1e-3f;
+        updateCamera(&d->camera);
+    }
+}
+
+static void benchLightMatrices(void *data, unsigned int iterations)
+{
+    ViewData *d = data;
+    for (unsigned int i=0; i<iterations; i++)
+    {
+        d->light.position[0] += 1e-3f;
+        pointLightGetProjMatrices(&d->light, &d->lightProjection, &d->lightMatrices);
+    }
+}
+
+
+int benchView(Bench *bench)
+{
+    // Set by hand, initCamera and initPointLight read files and need a GPU
+    ViewData data = {0};
+    glm_vec3_copy((vec3){0.0f, EYE_Y, 0.0f}, data.camera.pos);
+    glm_vec3_copy((vec3){0.0f, EYE_Y, -1.0f}, data.camera.target);
+    glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, data.camera.up);
+    data.camera.sensitivity = SENSITIVITY;
+    glm_vec3_copy((vec3){2.0f, 3.0f, -4.0f}, data.light.position);
+    glm_perspective(glm_rad(90.0f), 1.0f, SHADOWMAP_ZNEAR, 32.0f, data.lightProjection);  // Shadow far plane of the high preset
+
+    if (runBenchmark(bench, "camera/rotateCamera", benchRotateCamera, &data) < 0) return -1;
+    if (runBenchmark(bench, "camera/updateCamera", benchUpdateCamera, &data) < 0) return -1;
+    if (runBenchmark(bench, "light/pointLightGetProjMatrices", benchLightMatrices, &data) < 0) return -1;
+
+    benchSink += (uint32_t)data.lightMatrices[5][3][0] + (uint32_t)data.camera.right2D[0];
+    return 0;
+}
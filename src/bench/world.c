@@ -0,0 +1,66 @@
+#include "bench.h"
+#include "game/entities.h"
+
+
+#define ENTITY_COUNT 5000  // Projectiles, pickups and enemies of a busy level
+#define ENTITY_LIFETIME 1e9f  // Seconds, long enough that no entity expires while benchmarked
+
+
+/**
+ * @brief Game world updated every frame
+*/
+typedef struct {
+    World world;
+    JobSystem *jobs;
+} WorldData;
+
+
+static void benchUpdateGameWorld(void *data, unsigned int iterations)
+{
+    WorldData *d = data;
+    for (unsigned int i=0; i<iterations; i++) updateGameWorld(&d->world, d->jobs, 1.0f / 60.0f);
+}
+
+
+// Five archetypes, each entity has a position and some of the other components
+static int fillGameWorld(World *world)
+{
+    const float lifetime = ENTITY_LIFETIME;
+    const BoxCollider collider = {{-0.5f, 0.0f, -0.5f}, {0.5f, 2.0f, 0.5f}};
+    for (unsigned int i=0; i<ENTITY_COUNT; i++)
+    {
+        Entity entity;
+        vec3 position = {(float)(i % 100), 0.0f, (float)(i / 100)};
+        vec3 velocity = {1.0f, 0.0f, (float)(i % 7) - 3.0f};
+        const unsigned int kind = i % 5;
+        if (createEntity(world, &entity) < 0 || addComponent(world, entity, COMPONENT_POSITION, position) < 0) return -1;
+        if (kind != 0 && kind != 2 && addComponent(world, entity, COMPONENT_VELOCITY, velocity) < 0) return -1;
+        if ((kind == 2 || kind == 3) && addComponent(world, entity, COMPONENT_LIFETIME, &lifetime) < 0) return -1;
+        if (kind == 4 && addComponent(world, entity, COMPONENT_COLLIDER, &collider) < 0) return -1;
+    }
+    return 0;
+}
+
+
+int benchWorld(Bench *bench)
+{
+    if (!benchSelected(bench, "ecs/updateGameWorld")) return 0;
+
+    JobSystem jobs;
+    WorldData data = {.jobs = &jobs};
+    if (initJobSystem(&jobs, -1) < 0) return -1;
+    if (initGameWorld(&data.world) < 0)
+    {
+        destroyJobSystem(&jobs);
+        return -1;
+    }
+
+    int status = fillGameWorld(&data.world);
+    if (status < 0) LOG_ERROR("Could not create the benchmark entities\n");
+    else status = runBenchmark(bench, "ecs/updateGameWorld", benchUpdateGameWorld, &data);
+
+    benchSink += data.world.archetypeCount;
+    destroyWorld(&data.world);
+    destroyJobSystem(&jobs);
+    return status;
+}
@@ -58,24 +58,39 @@ static void appCleanUp(Application* app)
     if (app->glContext) {SDL_GL_DeleteContext(app->glContext); app->glContext = NULL;}
     if (app->window) {SDL_DestroyWindow(app->window); app->window = NULL;}
     if (SDLInitialized) {SDL_Quit(); SDLInitialized = 0;}
-    if (mixerInitalized) {Mix_CloseAudio(); Mix_Quit(); mixerInitalized = 0;}
+    if (mixerInitalized) {closeMixer(); mixerInitalized = 0;}
 
     // OpenGL
     if (app->VBO) {glDeleteBuffers(1, &app->VBO); app->VBO = 0;}
     if (app->uiVBO) {glDeleteBuffers(1, &app->uiVBO); app->uiVBO = 0;}
 
     if (app->depthMapFBO) {glDeleteFramebuffers(1, &app->depthMapFBO); app->depthMapFBO = 0;}
+    destroyDeferredRenderer(&app->deferred);
+    destroyResolutionScaler(&app->scaler);
+    destroyRenderTarget(&app->sceneTarget);
 
     if (app->cubeVAO) {glDeleteVertexArrays(1, &app->cubeVAO); app->cubeVAO = 0;}
+    if (app->screenVAO) {glDeleteVertexArrays(1, &app->screenVAO); app->screenVAO = 0;}
 
     if (app->shaderProgram) {glDeleteProgram(app->shaderProgram); app->shaderProgram = 0;}
     if (app->shaderProgramSkybox) {glDeleteProgram(app->shaderProgramSkybox); app->shaderProgramSkybox = 0;}
     if (app->shaderProgramLight) {glDeleteProgram(app->shaderProgramLight); app->shaderProgramLight = 0;}
     if (app->shaderProgramDepth) {glDeleteProgram(app->shaderProgramDepth); app->shaderProgramDepth = 0;}
+    if (app->shaderProgramPrepass) {glDeleteProgram(app->shaderProgramPrepass); app->shaderProgramPrepass = 0;}
     if (app->shaderProgramUI) {glDeleteProgram(app->shaderProgramUI); app->shaderProgramUI = 0;}
+    if (app->shaderProgramCrosshair) {glDeleteProgram(app->shaderProgramCrosshair); app->shaderProgramCrosshair = 0;}
+    if (app->shaderProgramMoments) {glDeleteProgram(app->shaderProgramMoments); app->shaderProgramMoments = 0;}
+    destroyProfiler(&app->profiler);
 
     // Freeing other components
-    for (uint8_t i=0; i<sizeof(app->pointLights)/sizeof(PointLight); i++) destroyPointLight(&app->pointLights[i]);
+    closeReplay(&app->replay);
+    destroyWorld(&app->world);
+    destroyJobSystem(&app->jobs);
+    app->pointLightCount = 0;
+    destroyShadowPool(&app->shadowPool);
+    destroyLightClusters(&app->clusters);
+    destroyCharacterController(&app->player);
+    destroyLevelCollision(&app->level);
     if (app->scene.loaded) destroyScene(&app->scene);
 
     LOG_INFO("Application cleaned up\n");
@@ -83,10 +98,13 @@ static void appCleanUp(Application* app)
 
 static void appCleanUpAndExit(Application* app, bool exitCode, const char* log, ...)
 {
+    char message[LOGS_LINE_SIZE];
     va_list args;
     va_start(args, log);
-    LOG_ERROR(log, args);
+    vsnprintf(message, sizeof(message), log, args);
     va_end(args);
+    const size_t length = strlen(message);
+    LOG_ERROR(length && message[length-1] == '\n' ? "%s" : "%s\n", message);
 
     appCleanUp(app);
     exit(exitCode);
@@ -96,21 +114,38 @@ static void appCleanUpAndExit(Application* app, bool exitCode, const char* log,
 static void appInitScene(Application *app)
 {
     // Point lights
-    if (initPointLight(&app->pointLights[0], (vec3){0.0f, 2.0f, 2.0f}, (vec3){1.0f, 1.0f, 1.0f})<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
-    if (initPointLight(&app->pointLights[1], (vec3){2.3f, 3.3f, -4.0f}, (vec3){1.0f, 0.0f, 0.0f})<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
-    if (initPointLight(&app->pointLights[2], (vec3){-4.0f, 2.0f, -12.0f}, (vec3){0.0f, 1.0f, 0.0f})<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
-    if (initPointLight(&app->pointLights[3], (vec3){3.3f, 4.0f, -1.5f}, (vec3){0.0f, 0.0f, 1.0f})<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
+    app->pointLightCount = 4;
+    if (initPointLight(&app->pointLights[0], (vec3){0.0f, 2.0f, 2.0f}, (vec3){1.0f, 1.0f, 1.0f}, app->settings.shadowFar, true)<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
+    if (initPointLight(&app->pointLights[1], (vec3){2.3f, 3.3f, -4.0f}, (vec3){1.0f, 0.0f, 0.0f}, app->settings.shadowFar, true)<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
+    if (initPointLight(&app->pointLights[2], (vec3){-4.0f, 2.0f, -12.0f}, (vec3){0.0f, 1.0f, 0.0f}, app->settings.shadowFar, true)<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
+    if (initPointLight(&app->pointLights[3], (vec3){3.3f, 4.0f, -1.5f}, (vec3){0.0f, 0.0f, 1.0f}, app->settings.shadowFar, true)<0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating point light");
+
+    // Shadow maps
+    if (initShadowPool(&app->shadowPool, app->shaderProgramMoments, app->settings.shadowResolution, app->settings.shadowFar) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shadow pool");
+
+    // Light clusters
+    if (initLightClusters(&app->clusters, glm_rad(app->settings.fov), (float)app->windowWidth / (float)app->windowHeight, ZNEAR, app->settings.zFar) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating light clusters");
+
+    // Transforms, the camera is the root of the view model
+    if (initTransformHierarchy(&app->scene.transforms, 16) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating transform hierarchy");
+    app->cameraTransform = addTransform(&app->scene.transforms, TRANSFORM_NO_PARENT, app->camera.pos, (vec3){1.0f, 1.0f, 1.0f}, (vec3){0.0f, 1.0f, 0.0f}, 0.0f);
 
     // Load scene objects models
     app->scene.modelCount = 1;
     app->scene.models = malloc(sizeof(Model) * app->scene.modelCount);
-    if (loadModel(&app->scene.models[0], "guitar/backpack.obj", (vec3){3.0, 1.0, 3.0}, (vec3){1.0, 1.0, 1.0}, (vec3){0.0, 1.0, 0.0}, glm_rad(90.0f), false) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading guitar model");
+    if (loadModel(&app->scene.models[0], "guitar/backpack.obj", &app->scene.transforms, TRANSFORM_NO_PARENT, (vec3){3.0, 1.0, 3.0}, (vec3){1.0, 1.0, 1.0}, (vec3){0.0, 1.0, 0.0}, glm_rad(90.0f), false) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading guitar model");
     // if (loadModel(&app->scene.models[2], "medievalhouse/house.obj", (vec3){15.0, 0.0, 15.0}, (vec3){2.0, 2.0, 2.0}, true) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading house model");
     
+    // Level collision, from the static models in their initial pose
+    updateSceneTransforms(&app->scene);
+    if (initLevelCollision(&app->level, app->scene.models, app->scene.modelCount, &app->jobs, LEVEL_CACHE_PATH) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating level collision");
+    if (initCharacterController(&app->player, (vec3){app->camera.pos[0], app->camera.pos[1] - EYE_Y, app->camera.pos[2]}) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating character controller");
+
     // Load UI models (e.g. shotgun)
     app->scene.uiModelCount = 1;
     app->scene.uiModels = malloc(sizeof(Model) * app->scene.uiModelCount);
-    if (loadModel(&app->scene.uiModels[0], "shotgun/shotgun.obj", (vec3){0.0, 0.0, 0.0}, (vec3){1.0, 1.0, 1.0}, (vec3){0.0, 1.0, 0.0}, glm_rad(90.0f), true) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading shotgun model");
+    if (loadModel(&app->scene.uiModels[0], "shotgun/shotgun.obj", &app->scene.transforms, app->cameraTransform, (vec3){0.0, 0.0, 0.0}, (vec3){1.0, 1.0, 1.0}, (vec3){0.0, 1.0, 0.0}, glm_rad(90.0f), true) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading shotgun model");
+    app->muzzleTransform = addTransform(&app->scene.transforms, app->scene.uiModels[0].transform, (vec3)MUZZLE_OFFSET, (vec3){1.0f, 1.0f, 1.0f}, (vec3){0.0f, 1.0f, 0.0f}, 0.0f);
 
     // Load skybox
     if (loadSkybox(&app->scene, "skybox/") < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading skybox\n");
@@ -119,6 +154,10 @@ static void appInitScene(Application *app)
     app->scene.soundCount = 1;
     app->scene.sounds = malloc(sizeof(Sound) * app->scene.soundCount);
     if (loadSound(&app->scene.sounds[0], "shotgun.wav", -1) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading shotgun sound\n");
+    app->scene.sounds[0].priority = AUDIO_PRIORITY_DEFAULT + 1;  // The player's own shots are never stolen
+
+    // Ambience is streamed, the level is silent without it
+    if (openStream(&app->scene.ambience, "ambience.ogg", -1, true) < 0 || playStream(&app->scene.ambience) < 0) LOG_WARN("No ambience played\n");
 
     // Vertices for a cube (Temporary lights)
     float vertices[] = {
@@ -182,10 +221,22 @@ static void appInitScene(Application *app)
     app->scene.loaded = 1;
 }
 
+static void appSetLightingUniforms(GLuint shaderProgram, float shadowFar)
+{
+    glUniform1f(glGetUniformLocation(shaderProgram, "NearPlaneShadow"), SHADOWMAP_ZNEAR);
+    glUniform1f(glGetUniformLocation(shaderProgram, "FarPlaneShadow"), shadowFar);
+    glUniform3f(glGetUniformLocation(shaderProgram, "lighting.ambient"), 0.03f, 0.03f, 0.03f);
+    glUniform3f(glGetUniformLocation(shaderProgram, "lighting.diffuse"), 0.4f, 0.4f, 0.4f);
+    glUniform3f(glGetUniformLocation(shaderProgram, "lighting.specular"), 1.0f, 1.0f, 1.0f);
+    glUniform1f(glGetUniformLocation(shaderProgram, "lighting.linear"), 0.09f);
+    glUniform1f(glGetUniformLocation(shaderProgram, "lighting.quadratic"), 0.032f);
+    glUniform1f(glGetUniformLocation(shaderProgram, "lighting.shininess"), 64.0f);
+}
+
 static void appFirstPass(Application *app)
 {
-    // Projection matrix only needs to be calculated once
-    glm_perspective(glm_rad(FOV), (float)app->windowWidth / (float)app->windowHeight, ZNEAR, ZFAR, projection);
+    // Projection matrix only changes with the settings
+    glm_perspective(glm_rad(app->settings.fov), (float)app->windowWidth / (float)app->windowHeight, ZNEAR, app->settings.zFar, projection);
 
     // UI shader
     glUseProgram(app->shaderProgramUI);
@@ -194,44 +245,96 @@ static void appFirstPass(Application *app)
     // Light shader
     glUseProgram(app->shaderProgramLight);
     glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramLight, "projection"), 1, GL_FALSE, (float*)projection);
-    glUniform2ui(glGetUniformLocation(app->shaderProgramLight, "windowSize"), app->windowWidth, app->windowHeight);
-    glUniform1f(glGetUniformLocation(app->shaderProgramLight, "pointerRadius"), 2.0f);
 
-    // Skybox shader
-    glUseProgram(app->shaderProgramSkybox);
-    glUniform2ui(glGetUniformLocation(app->shaderProgramSkybox, "windowSize"), app->windowWidth, app->windowHeight);
-    glUniform1f(glGetUniformLocation(app->shaderProgramSkybox, "pointerRadius"), 2.0f);
+    // Crosshair shader, drawn over the upscaled scene
+    glUseProgram(app->shaderProgramCrosshair);
+    glUniform2ui(glGetUniformLocation(app->shaderProgramCrosshair, "windowSize"), app->windowWidth, app->windowHeight);
+    glUniform1f(glGetUniformLocation(app->shaderProgramCrosshair, "pointerRadius"), 2.0f);
+
+    // Depth pre-pass shader
+    glUseProgram(app->shaderProgramPrepass);
+    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramPrepass, "projection"), 1, GL_FALSE, (float*)projection);
 
     // Object shader
     glUseProgram(app->shaderProgram);
     glUniformMatrix4fv(glGetUniformLocation(app->shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-    glUniform2ui(glGetUniformLocation(app->shaderProgram, "windowSize"), app->windowWidth, app->windowHeight);
-    glUniform1f(glGetUniformLocation(app->shaderProgram, "pointerRadius"), 2.0f);
-    glUniform1f(glGetUniformLocation(app->shaderProgram, "FarPlaneShadow"), SHADOWMAP_ZFAR);
-    static const int textureStart = 1;  // Save texture unit 0 just in case
-    char locate[32];
-    for (uint8_t i=0; i<4; i++)
+    appSetLightingUniforms(app->shaderProgram, app->settings.shadowFar);
+
+    // Deferred shaders
+    if (app->renderMode != RENDER_FORWARD)
+    {
+        glUseProgram(app->deferred.shaderProgramGeometry);
+        glUniformMatrix4fv(glGetUniformLocation(app->deferred.shaderProgramGeometry, "projection"), 1, GL_FALSE, (float*)projection);
+        glUseProgram(app->deferred.shaderProgramLighting);
+        appSetLightingUniforms(app->deferred.shaderProgramLighting, app->settings.shadowFar);
+    }
+}
+
+// Relative mode hides the cursor and reports raw motion, the cursor never reaches the edges of the window
+static void appCaptureMouse(bool capture)
+{
+    if (SDL_SetRelativeMouseMode(capture ? SDL_TRUE : SDL_FALSE) == 0) return;
+
+    // No raw input, SDL keeps the cursor in the window by warping it instead
+    SDL_SetHint(SDL_HINT_MOUSE_RELATIVE_MODE_WARP, "1");
+    if (SDL_SetRelativeMouseMode(capture ? SDL_TRUE : SDL_FALSE) == 0) return;
+    LOG_WARN("Relative mouse mode unavailable : %s\n", SDL_GetError());
+    SDL_ShowCursor(capture ? SDL_DISABLE : SDL_ENABLE);
+}
+
+// Fullscreen runs at the resolution of the display
+static void appSetWindowMode(Application* app)
+{
+    SDL_DisplayMode displayMode;
+    app->windowWidth = WINDOW_WIDTH; app->windowHeight = WINDOW_HEIGHT;
+    if (app->settings.fullscreen && SDL_GetCurrentDisplayMode(0, &displayMode) == 0)
+    {
+        app->windowWidth = displayMode.w;
+        app->windowHeight = displayMode.h;
+    }
+    else if (app->settings.fullscreen)
+    {
+        LOG_ERROR("Error getting display mode : %s\n", SDL_GetError());
+        app->settings.fullscreen = false;
+    }
+    LOG_TRACE("Window size set to %dx%d\n", app->windowWidth, app->windowHeight);
+
+    // Before the window is created, only its size is needed
+    if (!app->window) return;
+    SDL_SetWindowFullscreen(app->window, 0);
+    SDL_SetWindowSize(app->window, app->windowWidth, app->windowHeight);
+    if (app->settings.fullscreen) SDL_SetWindowFullscreen(app->window, SDL_WINDOW_FULLSCREEN);
+    else SDL_SetWindowPosition(app->window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+}
+
+// Adaptive vsync tears rather than stalls when a frame is late, plain vsync is the fallback
+static void appSetSwapInterval(bool vsync)
+{
+    if (!vsync) SDL_GL_SetSwapInterval(0);
+    else if (SDL_GL_SetSwapInterval(-1) == -1) SDL_GL_SetSwapInterval(1);
+}
+
+// The geometry buffer can't be multisampled, deferred modes go without MSAA
+static int appInitSceneTarget(Application* app)
+{
+    GLint maxSamples = 1;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (app->settings.msaa > (unsigned int)maxSamples)
     {
-        sprintf(locate, "pointLights[%d].position", i);
-        glUniform3f(glGetUniformLocation(app->shaderProgram, locate), app->pointLights[i].position[0], app->pointLights[i].position[1], app->pointLights[i].position[2]);
-        sprintf(locate, "pointLights[%d].ambient", i);
-        glUniform3f(glGetUniformLocation(app->shaderProgram, locate), 0.03f, 0.03f, 0.03f);
-        sprintf(locate, "pointLights[%d].diffuse", i);
-        glUniform3f(glGetUniformLocation(app->shaderProgram, locate), 0.4f, 0.4f, 0.4f);
-        sprintf(locate, "pointLights[%d].specular", i);
-        glUniform3f(glGetUniformLocation(app->shaderProgram, locate), 1.0f, 1.0f, 1.0f);
-        sprintf(locate, "pointLights[%d].linear", i);
-        glUniform1f(glGetUniformLocation(app->shaderProgram, locate), 0.09f);
-        sprintf(locate, "pointLights[%d].quadratic", i);
-        glUniform1f(glGetUniformLocation(app->shaderProgram, locate), 0.032f);
-        sprintf(locate, "pointLights[%d].color", i);
-        glUniform3f(glGetUniformLocation(app->shaderProgram, locate), app->pointLights[i].color[0], app->pointLights[i].color[1], app->pointLights[i].color[2]);
-        sprintf(locate, "pointLights[%d].depthCubemap", i);
-        glActiveTexture(GL_TEXTURE0+i+textureStart);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, app->pointLights[i].depthCubemap);
-        glUniform1i(glGetUniformLocation(app->shaderProgram, locate), i+textureStart);
+        LOG_WARN("MSAA x%u not supported, x%d used\n", app->settings.msaa, maxSamples);
+        app->settings.msaa = maxSamples;
     }
-    glUniform1f(glGetUniformLocation(app->shaderProgram, "material.shininess"), 64.0f);
+    return initRenderTarget(&app->sceneTarget, app->windowWidth, app->windowHeight, app->renderMode == RENDER_FORWARD ? app->settings.msaa : 1);
+}
+
+// Frames should fit in the frame rate cap, or in a refresh of the display
+static double appGpuBudget(const Application* app)
+{
+    SDL_DisplayMode displayMode;
+    if (app->settings.gpuBudget > 0.0) return app->settings.gpuBudget;
+    if (app->settings.frameRate > 0.0) return 1000.0 / app->settings.frameRate;
+    if (SDL_GetWindowDisplayMode(app->window, &displayMode) == 0 && displayMode.refresh_rate > 0) return 1000.0 / displayMode.refresh_rate;
+    return 1000.0 / RESOLUTION_BUDGET_RATE;
 }
 
 static void appInit(Application* app)
@@ -244,21 +347,15 @@ static void appInit(Application* app)
     // Application
     app->quit = 0;
     app->pause = 0;
+    app->focused = app->visible = true;
     app->dt = 0.0f;
     app->keyboardState = SDL_GetKeyboardState(NULL);
+    app->motionPending = app->motionNewest = app->motionShown = 0;
 
 
     // Handling custom resolution when fullscreen
-    #if FULLSCREEN
-    SDL_DisplayMode displayMode;
-    if (SDL_GetCurrentDisplayMode(0, &displayMode))
-        appCleanUpAndExit(app, EXIT_FAILURE, "Error getting display mode : %s", SDL_GetError());
-    app->windowWidth = displayMode.w;
-    app->windowHeight = displayMode.h;
-    #else
-    app->windowWidth = 1280; app->windowHeight = 720;
-    #endif
-    LOG_TRACE("Window size set to %dx%d\n", app->windowWidth, app->windowHeight);
+    appSetWindowMode(app);
+    logSettings(&app->settings);
 
 
     // OpenGL attributes
@@ -271,16 +368,17 @@ static void appInit(Application* app)
     #if DEBUG
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
     #endif
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, MSAADEPTH);
+    // Multisampling is done offscreen (see sceneTarget), the window only receives the resolved image
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
 
 
     // Window creation
     app->window = SDL_CreateWindow("FPS", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, app->windowWidth, app->windowHeight, SDL_WINDOW_OPENGL);
     if (!app->window) appCleanUpAndExit(app, EXIT_FAILURE, "Window could not be created! SDL_Error: %s\n", SDL_GetError());
-    SDL_ShowCursor(SDL_DISABLE);
+    appCaptureMouse(true);
     // Handling fullscreen
-    SDL_SetWindowFullscreen(app->window, FULLSCREEN ? SDL_WINDOW_FULLSCREEN : 0);
+    SDL_SetWindowFullscreen(app->window, app->settings.fullscreen ? SDL_WINDOW_FULLSCREEN : 0);
     LOG_TRACE("Window created\n");
 
 
@@ -314,7 +412,7 @@ static void appInit(Application* app)
     LOG_DEBUG("> Vertex shader max attribribute count : %d\n", GL_MAX_VERTEX_ATTRIBS);
     #endif
 
-    if (VSYNC) {if (SDL_GL_SetSwapInterval(-1) == -1) SDL_GL_SetSwapInterval(1);}
+    appSetSwapInterval(app->settings.vsync);
     if (WIREFRAME) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_MULTISAMPLE);
@@ -324,7 +422,7 @@ static void appInit(Application* app)
 
     
     // Load SDL Mixer
-    if (initMixer(AUDIO_NUMCHANS) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error initialising Mixer : %s", Mix_GetError());
+    if (initMixer(app->settings.audioRate, app->settings.audioFrames) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error initialising Mixer : %s", SDL_GetError());
     mixerInitalized = 1;
 
     // OpenGL Buffer creation
@@ -332,42 +430,75 @@ static void appInit(Application* app)
     glGenBuffers(1, &app->uiVBO);
 
     glGenFramebuffers(1, &app->depthMapFBO);
+    if (appInitSceneTarget(app) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating scene render target");
+    if (app->renderMode != RENDER_FORWARD && initDeferredRenderer(&app->deferred, &app->sceneTarget, app->renderMode == RENDER_DEFERRED_TILED ? DEFERRED_TILED : DEFERRED_LIGHT_VOLUMES) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating deferred renderer");
     
     glGenVertexArrays(1, &app->cubeVAO);
+    glGenVertexArrays(1, &app->screenVAO);
 
     // OpenGL Shader creation
-    Shader vertexShader, vertexShaderSkybox, vertexShaderDepth, vertexShaderUI, geometryShaderDepth, fragmentShader, fragmentShaderSkybox, fragmentShaderLight, fragmentShaderDepth, fragmentShaderUI;
+    Shader vertexShader, vertexShaderSkybox, vertexShaderDepth, vertexShaderPrepass, vertexShaderUI, vertexShaderScreen, fragmentShader, fragmentShaderSkybox, fragmentShaderLight, fragmentShaderUI, fragmentShaderCrosshair, computeShaderMoments;
     if (loadShader(&vertexShader, "vertex.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader");
     if (loadShader(&vertexShaderSkybox, "skybox.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader for Skybox");
     if (loadShader(&vertexShaderDepth, "depth.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader for depth map");
+    if (loadShader(&vertexShaderPrepass, "prepass.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader for depth pre-pass");
     if (loadShader(&vertexShaderUI, "ui.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader for UI");
-    if (loadShader(&geometryShaderDepth, "depth.geom", GL_GEOMETRY_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating geometry shader for depth map");
+    if (loadShader(&vertexShaderScreen, "screen.vert", GL_VERTEX_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating vertex shader for crosshair");
     if (loadShader(&fragmentShader, "fragment.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader");
     if (loadShader(&fragmentShaderSkybox, "skybox.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader for Skybox");
     if (loadShader(&fragmentShaderLight, "light.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader for light");
-    if (loadShader(&fragmentShaderDepth, "depth.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader for depth map");
     if (loadShader(&fragmentShaderUI, "ui.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader for UI");
+    if (loadShader(&fragmentShaderCrosshair, "crosshair.frag", GL_FRAGMENT_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating fragment shader for crosshair");
+    if (loadShader(&computeShaderMoments, "moments.comp", GL_COMPUTE_SHADER) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating compute shader for moments");
 
     // If program crashes here, there's a memory leak (shaders are not freed)
     // This is done on purpose as they are only used for the next few lines
 
     // Shader programs
-    if (initShaderProgram(&app->shaderProgram, 2, vertexShader, fragmentShader) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program");
-    if (initShaderProgram(&app->shaderProgramLight, 2, vertexShader, fragmentShaderLight) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for light");
-    if (initShaderProgram(&app->shaderProgramSkybox, 2, vertexShaderSkybox, fragmentShaderSkybox) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for UI");
-    if (initShaderProgram(&app->shaderProgramDepth, 3, vertexShaderDepth, geometryShaderDepth, fragmentShaderDepth) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for depth map");
-    if (initShaderProgram(&app->shaderProgramUI, 2, vertexShaderUI, fragmentShaderUI) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for UI");
+    if (initShaderProgram(&app->shaderProgram, 2, &vertexShader, &fragmentShader) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program");
+    if (initShaderProgram(&app->shaderProgramLight, 2, &vertexShader, &fragmentShaderLight) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for light");
+    if (initShaderProgram(&app->shaderProgramSkybox, 2, &vertexShaderSkybox, &fragmentShaderSkybox) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for UI");
+    // Depth only : no fragment shader, so that early depth test is kept
+    if (initShaderProgram(&app->shaderProgramDepth, 1, &vertexShaderDepth) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for depth map");
+    if (initShaderProgram(&app->shaderProgramPrepass, 1, &vertexShaderPrepass) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for depth pre-pass");
+    if (initShaderProgram(&app->shaderProgramUI, 2, &vertexShaderUI, &fragmentShaderUI) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for UI");
+    if (initShaderProgram(&app->shaderProgramCrosshair, 2, &vertexShaderScreen, &fragmentShaderCrosshair) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for crosshair");
+    if (initShaderProgram(&app->shaderProgramMoments, 1, &computeShaderMoments) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating shader program for moments");
 
     // Delete now useless shaders
     destroyShader(&vertexShader);
     destroyShader(&vertexShaderSkybox);
     destroyShader(&vertexShaderDepth);
+    destroyShader(&vertexShaderPrepass);
     destroyShader(&vertexShaderUI);
+    destroyShader(&vertexShaderScreen);
     destroyShader(&fragmentShader);
     destroyShader(&fragmentShaderSkybox);
     destroyShader(&fragmentShaderLight);
-    destroyShader(&fragmentShaderDepth);
     destroyShader(&fragmentShaderUI);
+    destroyShader(&fragmentShaderCrosshair);
+    destroyShader(&computeShaderMoments);
+
+    // Profiler
+    if (initProfiler(&app->profiler) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating profiler");
+    // Dynamic resolution, driven by the GPU time of the profiler
+    if (initResolutionScaler(&app->scaler, &app->sceneTarget, app->settings.resolutionMin, appGpuBudget(app)) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating resolution scaler");
+    // Replays run as fast as possible, they are benchmarks
+    initFramePacer(&app->pacer, app->replayMode == REPLAY_PLAY ? 0.0 : app->settings.frameRate);
+    app->benchmarkFilter = -1;
+
+    // Game logic
+    if (initJobSystem(&app->jobs, -1) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating job system");
+    if (initGameWorld(&app->world) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating game world");
+    app->shotSeed = 1;
+
+    // Input log, the game logic starts from the recorded seed
+    if (app->replayMode == REPLAY_RECORD && startRecording(&app->replay, app->replayPath, app->shotSeed) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating input log");
+    if (app->replayMode == REPLAY_PLAY)
+    {
+        if (loadReplay(&app->replay, app->replayPath) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error loading input log");
+        app->shotSeed = app->replay.seed;
+    }
 
 
     /* --- Load game objects --- */
@@ -383,9 +514,195 @@ static void appInit(Application* app)
 }
 
 
+static void appStartBenchmark(Application* app)
+{
+    if (app->benchmarkFilter >= 0) return;
+    LOG_INFO("Shadow filter benchmark started, keep the camera still\n");
+    app->benchmarkRestore = app->shadowPool.filter;
+    app->benchmarkFilter = 0;
+    app->benchmarkFrame = 0;
+    setShadowFilter(&app->shadowPool, app->pointLights, app->pointLightCount, 0, app->shadowPool.filterQuality[0]);
+    // The frame pacing logged with the results covers the benchmark only
+    resetFramePacing(&app->pacer);
+}
+
+static void appUpdateBenchmark(Application* app)
+{
+    static const char *names[SHADOW_FILTER_COUNT] = SHADOW_FILTER_NAMES;
+
+    if (app->benchmarkFilter < 0) return;
+    app->benchmarkFrame++;
+    if (app->benchmarkFrame == SHADOW_BENCH_WARMUP) profilerReset(&app->profiler);
+    if (app->benchmarkFrame < SHADOW_BENCH_WARMUP + SHADOW_BENCH_FRAMES) return;
+
+    app->benchmarkResults[app->benchmarkFilter][0] = profilerGetAverage(&app->profiler, PROFILE_SHADOWS);
+    app->benchmarkResults[app->benchmarkFilter][1] = profilerGetAverage(&app->profiler, PROFILE_GEOMETRY);
+    app->benchmarkResults[app->benchmarkFilter][2] = profilerGetAverage(&app->profiler, PROFILE_SCENE);
+
+    // Next filter
+    app->benchmarkFrame = 0;
+    if (++app->benchmarkFilter < SHADOW_FILTER_COUNT)
+    {
+        setShadowFilter(&app->shadowPool, app->pointLights, app->pointLightCount, app->benchmarkFilter, app->shadowPool.filterQuality[app->benchmarkFilter]);
+        return;
+    }
+
+    // Results
+    LOG_INFO("Shadow filter benchmark (%d frames each) :\n", SHADOW_BENCH_FRAMES);
+    for (int f=0; f<SHADOW_FILTER_COUNT; f++)
+        LOG_INFO("  %-12s (quality %2d) : shadow pass %.3lf ms, geometry pass %.3lf ms, scene pass %.3lf ms\n", names[f], app->shadowPool.filterQuality[f], app->benchmarkResults[f][0], app->benchmarkResults[f][1], app->benchmarkResults[f][2]);
+    logFramePacing(&app->pacer);
+    app->benchmarkFilter = -1;
+    setShadowFilter(&app->shadowPool, app->pointLights, app->pointLightCount, app->benchmarkRestore, app->shadowPool.filterQuality[app->benchmarkRestore]);
+}
+
+
+// Only what the changed settings depend on is reallocated
+static void appApplySettings(Application* app, const Settings *settings)
+{
+    const Settings previous = app->settings;
+    app->settings = *settings;
+
+    // Window
+    const bool resized = settings->fullscreen != previous.fullscreen;
+    if (resized) appSetWindowMode(app);
+    if (settings->vsync != previous.vsync) appSetSwapInterval(settings->vsync);
+
+    // Offscreen targets, the previous samples are kept if the new ones can't be allocated
+    if (resized || settings->msaa != previous.msaa)
+    {
+        destroyRenderTarget(&app->sceneTarget);
+        if (appInitSceneTarget(app) < 0)
+        {
+            LOG_ERROR("Could not apply MSAA x%u\n", app->settings.msaa);
+            app->settings.msaa = previous.msaa;
+            if (appInitSceneTarget(app) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating scene render target");
+        }
+        if (app->renderMode != RENDER_FORWARD && resizeDeferredRenderer(&app->deferred, &app->sceneTarget) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating geometry buffer");
+        if (resizeResolutionScaler(&app->scaler, &app->sceneTarget) < 0) appCleanUpAndExit(app, EXIT_FAILURE, "Error creating resolution scaler");
+    }
+
+    // The budget follows the frame rate cap or the display
+    if (resized || settings->resolutionMin != previous.resolutionMin || settings->gpuBudget != previous.gpuBudget || settings->frameRate != previous.frameRate)
+        setResolutionBudget(&app->scaler, settings->resolutionMin, appGpuBudget(app));
+
+    // Shadows, the lights reach as far as their shadows
+    setShadowResolution(&app->shadowPool, app->pointLights, app->pointLightCount, settings->shadowResolution);
+    if (settings->shadowFar != previous.shadowFar)
+    {
+        for (unsigned int i=0; i<app->pointLightCount; i++) app->pointLights[i].radius = settings->shadowFar;
+        setShadowFarPlane(&app->shadowPool, app->pointLights, app->pointLightCount, settings->shadowFar);
+    }
+
+    // Camera, and every uniform depending on it or on the window
+    setLightClustersProjection(&app->clusters, glm_rad(app->settings.fov), (float)app->windowWidth / (float)app->windowHeight, ZNEAR, app->settings.zFar);
+    appFirstPass(app);
+
+    // Audio, the mixer goes back to its previous configuration if the new one fails
+    if ((settings->audioRate != previous.audioRate || settings->audioFrames != previous.audioFrames) && configureMixer(settings->audioRate, settings->audioFrames) < 0)
+    {
+        app->settings.audioRate = previous.audioRate;
+        app->settings.audioFrames = previous.audioFrames;
+    }
+
+    // Replays are never capped
+    if (settings->frameRate != previous.frameRate && app->replay.mode != REPLAY_PLAY) setFrameRate(&app->pacer, settings->frameRate);
+
+    logSettings(&app->settings);
+}
+
+
+// Pellets leave from the eye so that they go where the crosshair points
+static void appShoot(Application* app)
+{
+    Ray pellets[SHOTGUN_PELLETS];
+    HitRecord hits[SHOTGUN_PELLETS];
+    vec3 forward;
+    glm_vec3_negate_to(app->camera.direction, forward);
+    spreadPellets(pellets, SHOTGUN_PELLETS, app->camera.pos, forward, glm_rad(SHOTGUN_SPREAD), SHOTGUN_RANGE, &app->shotSeed);
+
+    const int hitCount = traceHitscan(pellets, SHOTGUN_PELLETS, &app->level, &app->world, hits);
+    if (hitCount > 0) LOG_DEBUG("Shot : %d/%d pellets hit, closest at %.2f (material %d)\n", hitCount, SHOTGUN_PELLETS, hits[0].distance, hits[0].material);
+}
+
+
+// Everything the game logic reads from the player goes through here, live or replayed
+static void appApplyInput(Application* app, const InputFrame *input)
+{
+    app->dt = input->dt;
+    if (input->flags & INPUT_FLAG_PAUSE)
+    {
+        app->pause = !app->pause;
+        if (app->replay.mode != REPLAY_PLAY) appCaptureMouse(!app->pause);
+    }
+    if (app->pause) return;
+
+    // Rotate camera
+    if (input->mouseX || input->mouseY) rotateCamera(&app->camera, input->mouseX, input->mouseY);
+
+    // Shoot
+    if (input->buttons & SDL_BUTTON(SDL_BUTTON_LEFT))
+    {
+        playSound(app->scene.sounds[0], 0);
+        appShoot(app);
+    }
+
+    // The player moves through the level, the camera follows at eye height
+    vec3 move, eye;
+    bool jump;
+    setInputKeys(&app->camera.bindings, input->keys, app->inputKeyboard);
+    getCameraMovement(&app->camera, app->inputKeyboard, app->dt, move, &jump);
+    moveCharacterController(&app->player, &app->level, move, jump, app->dt);
+    glm_vec3_add(app->player.position, (vec3){0.0f, EYE_Y, 0.0f}, eye);
+    setCameraPosition(&app->camera, eye);
+    updateCamera(&app->camera);
+
+    // Sounds are heard from the eye
+    vec3 forward;
+    glm_vec3_negate_to(app->camera.direction, forward);
+    setListener(app->camera.pos, forward, app->camera.up);
+
+    // Attached objects follow the camera
+    mat4 cameraView, cameraWorld;
+    versor cameraRotation;
+    glm_lookat(app->camera.pos, app->camera.target, app->camera.up, cameraView);
+    glm_mat4_inv_fast(cameraView, cameraWorld);
+    glm_mat4_quat(cameraWorld, cameraRotation);
+    setTransformPose(&app->scene.transforms, app->cameraTransform, app->camera.pos, cameraRotation);
+}
+
+static void appEndReplay(Application* app)
+{
+    const double seconds = (SDL_GetPerformanceCounter() - app->replayStart) / (double)SDL_GetPerformanceFrequency();
+    LOG_INFO("Replay done : %d frames in %.2lf s, %.3lf ms per frame, player at (%.3f, %.3f, %.3f)\n",
+        app->replay.frameCount, seconds, 1000.0 * seconds / glm_max(app->replay.frameCount, 1), app->player.position[0], app->player.position[1], app->player.position[2]);
+    logFramePacing(&app->pacer);
+    app->quit = 1;
+}
+
+
+// Remember the mouse motion to measure its latency once it is on screen
+static void appTrackMotion(Application* app, Uint32 timestamp)
+{
+    if (SDL_TICKS_PASSED(app->motionShown, timestamp)) return;
+    if (!app->motionPending) app->motionPending = timestamp;
+    app->motionNewest = timestamp;
+}
+
+// Event timestamps are in milliseconds, the latency is measured with the performance counter
+static Uint64 appEventTime(Uint32 timestamp)
+{
+    const Uint32 age = SDL_GetTicks() - timestamp;
+    return SDL_GetPerformanceCounter() - age * SDL_GetPerformanceFrequency() / 1000;
+}
+
 static void appHandleEvents(Application* app)
 {
     static SDL_Event e;
+    const bool replaying = app->replay.mode == REPLAY_PLAY;
+    InputFrame input = {(float)app->dt, 0, 0, 0, 0, 0};
+    int mouseX = 0, mouseY = 0;
+
     while (SDL_PollEvent(&e))
         {
             switch (e.type)
@@ -401,50 +718,100 @@ static void appHandleEvents(Application* app)
                         case SDL_SCANCODE_F1:
                             app->quit = 1;
                             break;
+                        case SDL_SCANCODE_F2:
+                            appStartBenchmark(app);
+                            break;
+                        case SDL_SCANCODE_F3:
+                            setShadowFilter(&app->shadowPool, app->pointLights, app->pointLightCount, (app->shadowPool.filter + 1) % SHADOW_FILTER_COUNT, app->shadowPool.filterQuality[(app->shadowPool.filter + 1) % SHADOW_FILTER_COUNT]);
+                            break;
+                        case SDL_SCANCODE_F4:
+                        {
+                            // Quality wraps around to its lowest value
+                            static const int maxQuality[SHADOW_FILTER_COUNT] = SHADOW_FILTER_QUALITY_MAX;
+                            const ShadowFilter filter = app->shadowPool.filter;
+                            const int quality = app->shadowPool.filterQuality[filter] >= maxQuality[filter] ? 0 : app->shadowPool.filterQuality[filter] + 1;
+                            setShadowFilter(&app->shadowPool, app->pointLights, app->pointLightCount, filter, quality);
+                            break;
+                        }
+                        case SDL_SCANCODE_F5:
+                            profilerLog(&app->profiler);
+                            LOG_INFO("Resolution scale %.0f%% (%ux%u)\n", 100.0f * app->scaler.scale, app->sceneTarget.viewWidth, app->sceneTarget.viewHeight);
+                            logFramePacing(&app->pacer);
+                            break;
+                        case SDL_SCANCODE_F6:
+                        {
+                            // Next quality preset, wrapping around to the lowest
+                            Settings settings = app->settings;
+                            applyPreset(&settings, (settings.preset + 1) % PRESET_COUNT);
+                            appApplySettings(app, &settings);
+                            break;
+                        }
+                        case SDL_SCANCODE_F7:
+                        {
+                            // The file is applied over the current settings, so that it can be tuned while playing
+                            Settings settings = app->settings;
+                            loadSettings(&settings, SETTINGS_PATH);
+                            appApplySettings(app, &settings);
+                            break;
+                        }
                         case SDL_SCANCODE_ESCAPE:
-                            app->pause = !app->pause;
-                            SDL_ShowCursor(app->pause ? SDL_ENABLE : SDL_DISABLE);
+                            input.flags |= INPUT_FLAG_PAUSE;
                             break;
                         default:
                             break;
                     }
                     break;
+                // Frames are only rendered on events while nobody looks at the window
+                case SDL_WINDOWEVENT:
+                    switch (e.window.event)
+                    {
+                        case SDL_WINDOWEVENT_FOCUS_GAINED: app->focused = true; break;
+                        case SDL_WINDOWEVENT_FOCUS_LOST: app->focused = false; break;
+                        case SDL_WINDOWEVENT_SHOWN:
+                        case SDL_WINDOWEVENT_RESTORED: app->visible = true; break;
+                        case SDL_WINDOWEVENT_HIDDEN:
+                        case SDL_WINDOWEVENT_MINIMIZED: app->visible = false; break;
+                        default: break;
+                    }
+                    break;
                 // Rotate camera
                 case SDL_MOUSEMOTION:
                     // Power saving
-                    if ((e.motion.xrel == 0 && e.motion.yrel == 0) || app->pause)
+                    if ((e.motion.xrel == 0 && e.motion.yrel == 0) || app->pause || replaying)
                         break;
-                    rotateCamera(&app->camera, e.motion.xrel, e.motion.yrel);
-                    SDL_WarpMouseInWindow(app->window, app->windowWidth/2, app->windowHeight/2);
+                    // Relative mode : motion adds up over the frame, the cursor is never warped back
+                    mouseX += e.motion.xrel;
+                    mouseY += e.motion.yrel;
+                    appTrackMotion(app, e.motion.timestamp);
                     break;
                 // Shoot
                 case SDL_MOUSEBUTTONDOWN:
-                    if (e.button.button == SDL_BUTTON_LEFT && !app->pause)
-                    {
-                        playSound(app->scene.sounds[0], 0);
-                        printf("Shoot !\n");
-                    }
+                    input.buttons |= SDL_BUTTON(e.button.button);
                     break;
                 default:
                     break;
             }
         }
-        if (!app->pause)
-        {
-            translateCamera(&app->camera, app->keyboardState, app->dt);
-            updateCamera(&app->camera);
-        }
+
+    // The tick is recorded as applied, so that replays match
+    input.keys = getInputKeys(&app->camera.bindings, app->keyboardState);
+    input.mouseX = (int16_t)glm_clamp(mouseX, INT16_MIN, INT16_MAX);
+    input.mouseY = (int16_t)glm_clamp(mouseY, INT16_MIN, INT16_MAX);
+    if (replaying && !nextReplayFrame(&app->replay, &input))
+    {
+        appEndReplay(app);
+        return;
+    }
+    if (app->replay.mode == REPLAY_RECORD) recordInputFrame(&app->replay, &input);
+    appApplyInput(app, &input);
 }
 
 static bool appUpdate(Application* app)
 {
-    static Uint64 lastFrameTime = 0;
-    static Uint64 currentFrameTime;
-
-    // Time
-    currentFrameTime = SDL_GetPerformanceCounter();
-    app->dt = (currentFrameTime - lastFrameTime) / (double)SDL_GetPerformanceFrequency();
-    lastFrameTime = currentFrameTime;
+    // Time, hitches and idle waits are slowed down rather than simulated at once
+    const Uint64 currentFrameTime = SDL_GetPerformanceCounter();
+    app->dt = fmin((currentFrameTime - app->lastFrameTime) / (double)SDL_GetPerformanceFrequency(), MAX_DT);
+    app->lastFrameTime = currentFrameTime;
     #if PRINT_FPS
     LOG_INFO("FPS : %lf\n", 1.0 / app->dt);
     #endif
@@ -454,47 +821,148 @@ static bool appUpdate(Application* app)
 
     if (!app->pause)
     {
-        // TODO: Game logic
+        updateGameWorld(&app->world, &app->jobs, app->dt);
     }
+    appUpdateBenchmark(app);
 
     return 0;
 }
 
 
+// View of the main pass, turned by the mouse motion received since the game update
+// Events are only peeked : the next update applies them to the camera as usual, so replays do not depend on rendering
+static void appLateLatch(Application* app, mat4 view)
+{
+    vec3 target;
+    glm_vec3_copy(app->camera.target, target);
+
+    #if LATE_LATCH
+    if (!app->pause && app->replay.mode != REPLAY_PLAY)
+    {
+        SDL_Event events[LATE_LATCH_EVENTS];
+        int mouseX = 0, mouseY = 0;
+        SDL_PumpEvents();
+        const int count = SDL_PeepEvents(events, LATE_LATCH_EVENTS, SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+        for (int i=0; i<count; i++)
+        {
+            if (events[i].motion.xrel == 0 && events[i].motion.yrel == 0) continue;
+            mouseX += events[i].motion.xrel;
+            mouseY += events[i].motion.yrel;
+            appTrackMotion(app, events[i].motion.timestamp);
+        }
+        if (mouseX || mouseY) getRotatedTarget(&app->camera, mouseX, mouseY, target);
+    }
+    #endif
+
+    glm_lookat(app->camera.pos, target, app->camera.up, view);
+
+    // This frame shows the motion read so far
+    if (app->motionPending)
+    {
+        profilerInput(&app->profiler, appEventTime(app->motionPending));
+        app->motionShown = app->motionNewest;
+        app->motionPending = 0;
+    }
+}
+
 static void appRender(Application* app)
 {
+    profilerNewFrame(&app->profiler);
+    profilerBegin(&app->profiler, PROFILE_FRAME);
+
+    // View matrix of the game update, used until the shadows are sent
+    static mat4 view = GLM_MAT4_IDENTITY_INIT;
+    static mat4 viewProjection = GLM_MAT4_IDENTITY_INIT;
+    glm_lookat(app->camera.pos, app->camera.target, app->camera.up, view);
+    glm_mat4_mul(projection, view, viewProjection);
+
+    // World matrices, shared by every pass
+    updateSceneTransforms(&app->scene);
+
+
     /* --- RENDER ON DEPTH MAP --- */
 
-    renderPointLightsShadowMap(&app->scene, app->shaderProgramDepth, app->depthMapFBO, app->pointLights);
+    // Lights that look the biggest on screen get the sharpest shadows
+    profilerBegin(&app->profiler, PROFILE_SHADOWS);
+    assignShadowSlots(&app->shadowPool, app->pointLights, app->pointLightCount, app->camera.pos, viewProjection, app->clusters.tanHalfFovY);
+    renderPointLightsShadowMap(&app->scene, app->shaderProgramDepth, app->depthMapFBO, &app->shadowPool, app->pointLights, app->pointLightCount);
+    profilerEnd(&app->profiler, PROFILE_SHADOWS);
 
 
     /* --- RENDER ON SCREEN --- */
 
+    // Latest mouse motion, as late as possible
+    static mat4 mainView = GLM_MAT4_IDENTITY_INIT;
+    appLateLatch(app, mainView);
+
+    // Region of the scene target rendered this frame, frozen while the shadow filters are benchmarked
+    if (app->benchmarkFilter < 0) updateResolutionScale(&app->scaler, &app->sceneTarget, &app->profiler);
+
     // Clear screen
-    glViewport(0, 0, app->windowWidth, app->windowHeight);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bindRenderTarget(&app->sceneTarget);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // View matrix
-    static mat4 view = GLM_MAT4_IDENTITY_INIT;
-    glm_lookat(app->camera.pos, app->camera.target, app->camera.up, view);
-
+    #if DEPTH_PREPASS
+    // Depth only, sceneTarget.depthTexture holds the scene depth from here on
+    if (app->renderMode == RENDER_FORWARD)
+    {
+        profilerBegin(&app->profiler, PROFILE_GEOMETRY);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glUseProgram(app->shaderProgramPrepass);
+        glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramPrepass, "view"), 1, GL_FALSE, (float*)mainView);
+        renderSceneDepth(&app->scene, app->shaderProgramPrepass, app->camera.pos);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        profilerEnd(&app->profiler, PROFILE_GEOMETRY);
+    }
+    #endif
 
-    /* --- User Interface --- */
+    // Light culling
+    assignLightClusters(&app->clusters, app->pointLights, app->pointLightCount, mainView);
 
-    // Use UI shader
-    glUseProgram(app->shaderProgramUI);
-    glBindVertexArray(app->cubeVAO);
 
-    // Send to shader
-    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramUI, "view"), 1, GL_FALSE, (float*)view);
+    /* --- Objects --- */
 
-    // TODO: Move UI to a Player struct ?
-    for (int i=0; i<app->scene.uiModelCount; i++)
+    if (app->renderMode == RENDER_FORWARD)
     {
-        drawModel(&app->scene.uiModels[i], app->shaderProgramUI);
+        profilerBegin(&app->profiler, PROFILE_SCENE);
+        glUseProgram(app->shaderProgram);
+
+        // Send to shader
+        glUniformMatrix4fv(glGetUniformLocation(app->shaderProgram, "view"), 1, GL_FALSE, (float*)mainView);
+        glUniform3f(glGetUniformLocation(app->shaderProgram, "viewPos"), app->camera.pos[0], app->camera.pos[1], app->camera.pos[2]);
+        setLightClustersUniforms(&app->clusters, app->shaderProgram, app->sceneTarget.viewWidth, app->sceneTarget.viewHeight);
+        bindLightClusters(&app->clusters);
+        bindShadowPool(&app->shadowPool, app->shaderProgram);
+
+        // Rendering
+        #if DEPTH_PREPASS
+        // Only the closest fragment of each pixel passes, depth is already written
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        renderScene(&app->scene, app->shaderProgram);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        #else
+        renderScene(&app->scene, app->shaderProgram);
+        #endif
+        profilerEnd(&app->profiler, PROFILE_SCENE);
+    }
+    else
+    {
+        // Geometry buffer shares the scene depth, the scene target is bound again after lighting
+        profilerBegin(&app->profiler, PROFILE_GEOMETRY);
+        renderDeferredGeometry(&app->deferred, &app->sceneTarget, &app->scene, mainView);
+        profilerEnd(&app->profiler, PROFILE_GEOMETRY);
+
+        profilerBegin(&app->profiler, PROFILE_SCENE);
+        glUseProgram(app->deferred.shaderProgramLighting);
+        bindLightClusters(&app->clusters);
+        bindShadowPool(&app->shadowPool, app->deferred.shaderProgramLighting);
+        renderDeferredLighting(&app->deferred, &app->sceneTarget, app->clusters.lightCount, app->cubeVAO, mainView, projection, app->camera.pos);
+        profilerEnd(&app->profiler, PROFILE_SCENE);
     }
 
+
     /* --- Light sources --- */
 
     // TODO: Replace cubes by models (e.g. lamps)
@@ -504,12 +972,12 @@ static void appRender(Application* app)
     glUseProgram(app->shaderProgramLight);
 
     // Send to shader
-    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramLight, "view"), 1, GL_FALSE, (float*)view);
+    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramLight, "view"), 1, GL_FALSE, (float*)mainView);
 
     // Rendering
     glBindVertexArray(app->cubeVAO);
     
-    for (uint8_t i=0; i<4; i++)
+    for (unsigned int i=0; i<app->pointLightCount; i++)
     {
         glUniform3f(glGetUniformLocation(app->shaderProgramLight, "lightColor"), app->pointLights[i].color[0], app->pointLights[i].color[1], app->pointLights[i].color[2]);
 
@@ -527,18 +995,6 @@ static void appRender(Application* app)
     glBindVertexArray(0);
 
 
-    /* --- Objects --- */
-
-    glUseProgram(app->shaderProgram);
-
-    // Send to shader
-    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-    glUniform3f(glGetUniformLocation(app->shaderProgram, "viewPos"), app->camera.pos[0], app->camera.pos[1], app->camera.pos[2]);
-
-    // Rendering
-    renderScene(&app->scene, app->shaderProgram);
-
-
     /* --- SkyBox --- */
 
     glDepthFunc(GL_LEQUAL);
@@ -550,7 +1006,7 @@ static void appRender(Application* app)
     glBindTexture(GL_TEXTURE_CUBE_MAP, app->scene.skybox.id);
     glUniform1i(glGetUniformLocation(app->shaderProgramSkybox, "skybox"), 0);
 
-    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramSkybox, "view"), 1, GL_FALSE, (float*)view);
+    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramSkybox, "view"), 1, GL_FALSE, (float*)mainView);
     glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramSkybox, "projection"), 1, GL_FALSE, (float*)projection);
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -558,6 +1014,43 @@ static void appRender(Application* app)
     glEnable(GL_CULL_FACE);
     glDepthFunc(GL_LESS);
 
+    // Upscale to the window, what follows is drawn at its resolution
+    profilerBegin(&app->profiler, PROFILE_UPSCALE);
+    upscaleToScreen(&app->scaler, &app->sceneTarget, app->windowWidth, app->windowHeight);
+    profilerEnd(&app->profiler, PROFILE_UPSCALE);
+
+
+    /* --- User Interface --- */
+
+    // The weapon only hides itself, it is drawn over the scene
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // Use UI shader
+    glUseProgram(app->shaderProgramUI);
+    glBindVertexArray(app->cubeVAO);
+
+    // Send to shader, the weapon follows the camera of the game update so it stays still on screen whatever the late latch did
+    glUniformMatrix4fv(glGetUniformLocation(app->shaderProgramUI, "view"), 1, GL_FALSE, (float*)view);
+
+    // TODO: Move UI to a Player struct ?
+    for (int i=0; i<app->scene.uiModelCount; i++)
+    {
+        drawModel(&app->scene.uiModels[i], app->shaderProgramUI);
+    }
+
+    // Crosshair : 1 - color of what is under it
+    glUseProgram(app->shaderProgramCrosshair);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_DST_COLOR, GL_ZERO);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(app->screenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    profilerEnd(&app->profiler, PROFILE_FRAME);
+
     // Swap buffers
     SDL_GL_SwapWindow(app->window);
 }
@@ -567,11 +1060,19 @@ int appRun(Application* app)
 {
     appInit(app);
     LOG_DEBUG("Application initialized\n");
+    // A replay is timed from here, the frames of the loading are left out of its frame pacing
+    resetFramePacing(&app->pacer);
+    app->replayStart = app->lastFrameTime = SDL_GetPerformanceCounter();
 
     while (!app->quit)
     {
+        // Nothing moves while paused and nobody looks while unfocused, frames wait for an event (replays never wait)
+        const bool idle = app->replay.mode != REPLAY_PLAY && (app->pause || !app->focused || !app->visible);
+        if (idle) waitIdle(&app->pacer, app->pause ? PACING_IDLE_PAUSED : PACING_IDLE_UNFOCUSED);
+        waitNextFrame(&app->pacer);
+
         if (appUpdate(app)) continue;
-        appRender(app);
+        if (app->visible) appRender(app);
     }
 
     appCleanUp(app);
@@ -13,17 +13,30 @@
 #include <cglm/cglm.h>
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_opengl.h>
 
 
+#include "core/pacing.h"
+#include "core/profiler.h"
+#include "core/replay.h"
+#include "core/resolution.h"
+#include "core/settings.h"
 #include "game/audio.h"
 #include "game/camera.h"
+#include "game/cluster.h"
+#include "game/controller.h"
+#include "game/deferred.h"
+#include "game/entities.h"
+#include "game/jobs.h"
+#include "game/framebuffer.h"
+#include "game/level.h"
 #include "game/light.h"
 #include "game/logs.h"
 #include "game/model.h"
 #include "game/shader.h"
+#include "game/shadow.h"
 #include "game/textures.h"
+#include "game/weapon.h"
 
 
 /* --- MACROS --- */
@@ -33,19 +46,38 @@
 #define PRINT_FPS 0
 #define WIREFRAME 0
 
-// Graphic options
-#define VSYNC 0
-#define FULLSCREEN 0
-#define MSAADEPTH 4
+// Graphic options, the others are runtime settings (see core/settings.h)
+#define WINDOW_WIDTH 1280  // Size of the window when not fullscreen
+#define WINDOW_HEIGHT 720
+#define DEPTH_PREPASS 1  // Lay depth down first, so that scene objects are shaded at most once per pixel (forward only)
+#define RENDER_MODE_DEFAULT RENDER_FORWARD  // Can be changed at startup with --renderer
+
+// Input
+#define LATE_LATCH 1  // Turn the view by the mouse motion received during the frame, right before the main pass
+#define LATE_LATCH_EVENTS 64  // Mouse events read by the late latch, the others wait for the next update
+
+// Simulation
+#define MAX_DT 0.1  // Longest tick in seconds, longer ones (hitches, idle waits) are slowed down
+
+// Weapon
+#define MUZZLE_OFFSET {0.6f, 0.05f, 0.0f}  // End of the shotgun barrel, in shotgun space
 
 // View options
-#define FOV 70.0f
 #define ZNEAR 0.1f
-#define ZFAR  64.0f
+
+// Shadow filter benchmark (F2), every filter is timed in turn
+#define SHADOW_BENCH_WARMUP 60  // Frames skipped after switching filter
+#define SHADOW_BENCH_FRAMES 300  // Frames timed per filter
 
 
 /* --- TYPEDEFS --- */
 
+typedef enum {
+    RENDER_FORWARD,  // Clustered forward shading
+    RENDER_DEFERRED_VOLUMES,  // Deferred shading, light volumes
+    RENDER_DEFERRED_TILED  // Deferred shading, tiled compute lighting
+} RenderMode;
+
 typedef struct {
     // Context
     SDL_Window* window;
@@ -53,29 +85,74 @@ typedef struct {
     SDL_GLContext glContext;
     bool quit;
     bool pause;
+    bool focused;  // The window has the keyboard focus
+    bool visible;  // The window is not minimized or hidden
 
     // OpenGL
     GLuint cubeVAO;  // Light sources
+    GLuint screenVAO;  // Empty, for fullscreen triangles
 
     GLuint VBO;  // Vertices
     GLuint uiVBO;  // Vertices for UI
 
     GLuint depthMapFBO;  // Depth map framebuffer
+    RenderTarget sceneTarget;  // Offscreen color and depth at the size of the window, only a scaled region of it is rendered
+    ResolutionScaler scaler;  // Scale of the scene region, and its upscale to the window
+    RenderMode renderMode;
+    DeferredRenderer deferred;  // Only used by deferred render modes
 
     GLuint shaderProgram;  // Shader program for scene objects
     GLuint shaderProgramSkybox;  // Shader program for UI
     GLuint shaderProgramLight;  // Shader program for light
     GLuint shaderProgramDepth;  // Shader program for depth map
+    GLuint shaderProgramPrepass;  // Shader program for depth pre-pass
     GLuint shaderProgramUI;  // Shader program for UI
+    GLuint shaderProgramCrosshair;  // Shader program inverting the crosshair pixels, at the resolution of the window
+    GLuint shaderProgramMoments;  // Compute shader program for moment shadow maps
+
+    Profiler profiler;  // GPU timings
+    FramePacer pacer;  // Frame rate cap and frame time statistics
+    Settings settings;  // Set from the settings file and the command line before appRun, applied at runtime afterwards
 
     // Properties
     double dt;
+    Uint64 lastFrameTime;  // Start of the last tick, performance counter
     const Uint8 *keyboardState;
+    Uint8 inputKeyboard[SDL_NUM_SCANCODES];  // Bindings held this tick, live or replayed
+
+    // Input latency, event timestamps in milliseconds (SDL_GetTicks)
+    Uint32 motionPending;  // Oldest mouse motion not shown yet, 0 if none
+    Uint32 motionNewest;  // Newest mouse motion read
+    Uint32 motionShown;  // Newest mouse motion shown, later frames do not measure it again
+
+    // Input log
+    ReplayMode replayMode;  // Set from the command line, before appRun
+    const char *replayPath;
+    Replay replay;
+    Uint64 replayStart;
 
     // Game objects
     Camera camera;
+    CharacterController player;  // Moves the camera through the level
+    int cameraTransform;  // Root of the objects attached to the player (weapon)
+    int muzzleTransform;  // Where shot effects come from, attached to the weapon
+    uint32_t shotSeed;  // Pellet spread random state
     Scene scene;
-    PointLight pointLights[4];  // 4 point lights
+    LevelCollision level;  // Static collision geometry
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    unsigned int pointLightCount;
+    LightClusters clusters;  // Clustered forward lighting
+    ShadowPool shadowPool;  // Point light shadow maps
+
+    // Game logic
+    JobSystem jobs;  // Worker threads shared by the game systems
+    World world;  // Game entities
+
+    // Shadow filter benchmark
+    int benchmarkFilter;  // Filter being timed, -1 if not running
+    unsigned int benchmarkFrame;
+    ShadowFilter benchmarkRestore;  // Filter to go back to
+    double benchmarkResults[SHADOW_FILTER_COUNT][3];  // Shadow, geometry and scene passes
 
 } Application;
 
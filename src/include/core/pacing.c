@@ -0,0 +1,139 @@
+#include "pacing.h"
+
+
+void initFramePacer(FramePacer *pacer, double fps)
+{
+    memset(pacer, 0, sizeof(FramePacer));
+    pacer->sleepMean = PACING_SLEEP_GUESS * SDL_GetPerformanceFrequency();
+    setFrameRate(pacer, fps);
+    LOG_TRACE("Frame pacer initialized\n");
+}
+
+void setFrameRate(FramePacer *pacer, double fps)
+{
+    pacer->period = fps > 0.0 ? (Uint64)(SDL_GetPerformanceFrequency() / fps) : 0;
+    pacer->deadline = SDL_GetPerformanceCounter();
+    if (fps > 0.0) LOG_INFO("Frame rate capped at %.1lf FPS\n", fps);
+    else LOG_INFO("Frame rate not capped\n");
+}
+
+
+static void recordFrameTime(FramePacer *pacer, Uint64 now)
+{
+    if (pacer->last)
+    {
+        const double ms = (now - pacer->last) * 1000.0 / SDL_GetPerformanceFrequency();
+        pacer->times[pacer->timeNext] = ms;
+        pacer->timeNext = (pacer->timeNext + 1) % PACING_WINDOW;
+        if (pacer->timeCount < PACING_WINDOW) pacer->timeCount++;
+
+        const unsigned int bin = (unsigned int)(ms / PACING_HISTOGRAM_STEP);
+        pacer->histogram[bin < PACING_HISTOGRAM_BINS ? bin : PACING_HISTOGRAM_BINS - 1]++;
+    }
+    pacer->last = now;
+}
+
+void waitNextFrame(FramePacer *pacer)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if (pacer->period)
+    {
+        // Sleep while a sleep is unlikely to overshoot the deadline
+        const double sleepMax = PACING_SLEEP_MAX * SDL_GetPerformanceFrequency();
+        while (now < pacer->deadline && pacer->deadline - now > fmin(pacer->sleepMean + 2.0*sqrt(pacer->sleepVariance), sleepMax))
+        {
+            SDL_Delay(1);
+            const Uint64 after = SDL_GetPerformanceCounter();
+            const double slept = (double)(after - now);
+            const double deviation = slept - pacer->sleepMean;
+            pacer->sleepMean += deviation * PACING_SLEEP_SMOOTHING;
+            pacer->sleepVariance += (deviation*deviation - pacer->sleepVariance) * PACING_SLEEP_SMOOTHING;
+            now = after;
+        }
+
+        // Spin the rest, the system timer is too coarse for it
+        while (now < pacer->deadline) now = SDL_GetPerformanceCounter();
+
+        // Frames keep their cadence when a little late, and start again from now when a whole frame was missed
+        pacer->deadline = now - pacer->deadline < pacer->period ? pacer->deadline + pacer->period : now + pacer->period;
+    }
+
+    recordFrameTime(pacer, now);
+}
+
+bool waitIdle(FramePacer *pacer, int timeout)
+{
+    const bool event = SDL_WaitEventTimeout(NULL, timeout) == 1;
+    pacer->last = 0;
+    pacer->deadline = SDL_GetPerformanceCounter();
+    return event;
+}
+
+
+void resetFramePacing(FramePacer *pacer)
+{
+    pacer->timeCount = 0;
+    pacer->timeNext = 0;
+    memset(pacer->histogram, 0, sizeof(pacer->histogram));
+}
+
+
+static int compareTimes(const void *a, const void *b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int getFramePacing(const FramePacer *pacer, FramePacingStats *stats)
+{
+    memset(stats, 0, sizeof(FramePacingStats));
+    const unsigned int count = pacer->timeCount;
+    if (count == 0) return 0;
+
+    // Oldest first, for the jitter
+    const unsigned int first = count < PACING_WINDOW ? 0 : pacer->timeNext;
+    double sum = 0.0, jitter = 0.0;
+    for (unsigned int i=0; i<count; i++)
+    {
+        const double time = pacer->times[(first + i) % PACING_WINDOW];
+        sum += time;
+        if (i > 0) jitter += fabs(time - pacer->times[(first + i - 1) % PACING_WINDOW]);
+    }
+
+    double *sorted = malloc(count * sizeof(double));
+    if (sorted == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for frame times\n");
+        return -1;
+    }
+    memcpy(sorted, pacer->times, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compareTimes);
+
+    stats->frames = count;
+    stats->average = sum / count;
+    stats->low1 = 1000.0 / sorted[(unsigned int)(count * 0.99)];
+    stats->low01 = 1000.0 / sorted[(unsigned int)(count * 0.999)];
+    stats->jitter = count > 1 ? jitter / (count - 1) : 0.0;
+
+    free(sorted);
+    return 0;
+}
+
+void logFramePacing(const FramePacer *pacer)
+{
+    FramePacingStats stats;
+    if (getFramePacing(pacer, &stats) < 0 || stats.frames == 0) return;
+
+    LOG_INFO("Frame pacing (%u frames) : %.3lf ms, %.1lf FPS, 1%% low %.1lf FPS, 0.1%% low %.1lf FPS, jitter %.3lf ms\n",
+        stats.frames, stats.average, 1000.0 / stats.average, stats.low1, stats.low01, stats.jitter);
+
+    unsigned int total = 0;
+    for (int b=0; b<PACING_HISTOGRAM_BINS; b++) total += pacer->histogram[b];
+    for (int b=0; b<PACING_HISTOGRAM_BINS; b++)
+    {
+        if (!pacer->histogram[b]) continue;
+        if (b == PACING_HISTOGRAM_BINS - 1) LOG_INFO("  %5.1lf ms and more : %6.2lf %%\n", b * PACING_HISTOGRAM_STEP, 100.0 * pacer->histogram[b] / total);
+        else LOG_INFO("  %5.1lf - %5.1lf ms : %6.2lf %%\n", b * PACING_HISTOGRAM_STEP, (b + 1) * PACING_HISTOGRAM_STEP, 100.0 * pacer->histogram[b] / total);
+    }
+}
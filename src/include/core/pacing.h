@@ -0,0 +1,137 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdbool.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "game/logs.h"
+
+
+/* --- MACROS --- */
+
+#define PACING_FPS_DEFAULT 0  // Frame rate cap, 0 for none, the fps setting changes it
+#define PACING_SLEEP_GUESS 0.002  // First guess of how long a 1 ms sleep lasts, in seconds, measured afterwards
+#define PACING_SLEEP_MAX 0.004  // Longest sleep estimate in seconds, longer sleeps are the thread being preempted, not the timer
+#define PACING_SLEEP_SMOOTHING 0.05  // Weight of the newest sleep in its mean and variance
+#define PACING_IDLE_PAUSED 500  // Longest wait for an event while paused, in milliseconds
+#define PACING_IDLE_UNFOCUSED 50  // Longest wait for an event while the window is unfocused, the game still runs
+#define PACING_WINDOW 4096  // Latest frame times kept for the lows and jitter
+#define PACING_HISTOGRAM_BINS 80  // The last bin also counts the longer frames
+#define PACING_HISTOGRAM_STEP 0.5  // Width of a histogram bin in milliseconds
+
+
+/* --- TYPEDEFS --- */
+
+/**
+ * @brief Frame pacing statistics
+ * 
+ * @param frames Number of frames the statistics are computed from
+ * @param average Average frame time in milliseconds
+ * @param low1 Frame rate of the 1% slowest frames (99th percentile frame time)
+ * @param low01 Frame rate of the 0.1% slowest frames (99.9th percentile frame time)
+ * @param jitter Average difference between two consecutive frame times, in milliseconds
+*/
+typedef struct {
+    unsigned int frames;
+    double average;
+    double low1, low01;
+    double jitter;
+} FramePacingStats;
+
+/**
+ * @brief Frame pacing structure
+ * 
+ * @param period Time between two frames in performance counter ticks, 0 if not capped
+ * @param deadline When the next frame starts, in performance counter ticks
+ * @param sleepMean Mean duration of a 1 ms sleep, in performance counter ticks
+ * @param sleepVariance Variance of the duration of a 1 ms sleep
+ * @param last When the last frame started, 0 if the next frame time is not measured (after idling)
+ * @param times Latest frame times in milliseconds, in a ring
+ * @param timeCount Number of frame times in the ring
+ * @param timeNext Next slot of the ring
+ * @param histogram Frame times since the last reset, in PACING_HISTOGRAM_STEP bins
+ * 
+ * @note Waits sleep while the system can be trusted to wake up in time, then spin until the deadline
+*/
+typedef struct {
+    Uint64 period;
+    Uint64 deadline;
+    double sleepMean, sleepVariance;
+    Uint64 last;
+
+    double times[PACING_WINDOW];
+    unsigned int timeCount, timeNext;
+    unsigned int histogram[PACING_HISTOGRAM_BINS];
+} FramePacer;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Initialize a frame pacer
+ * 
+ * @param pacer Pointer to the pacer
+ * @param fps Frame rate cap, 0 for none
+*/
+void initFramePacer(FramePacer *pacer, double fps);
+
+/**
+ * @brief Change the frame rate cap
+ * 
+ * @param pacer Pointer to the pacer
+ * @param fps Frame rate cap, 0 for none
+*/
+void setFrameRate(FramePacer *pacer, double fps);
+
+/**
+ * @brief Wait for the start of the next frame and measure the last one
+ * 
+ * @param pacer Pointer to the pacer
+ * 
+ * @note Should be called once per frame, before reading the input so that it is as recent as possible
+ * @note Deadlines missed by more than a frame are dropped rather than caught up with
+*/
+void waitNextFrame(FramePacer *pacer);
+
+/**
+ * @brief Sleep until an event comes, instead of rendering frames nobody needs
+ * 
+ * @param pacer Pointer to the pacer
+ * @param timeout Longest wait in milliseconds
+ * @return true An event is waiting in the queue
+ * @return false The wait timed out
+ * 
+ * @note The event is left in the queue, the time spent idle is not measured as a frame
+*/
+bool waitIdle(FramePacer *pacer, int timeout);
+
+/**
+ * @brief Reset the statistics, e.g. at the start of a benchmark
+ * 
+ * @param pacer Pointer to the pacer
+*/
+void resetFramePacing(FramePacer *pacer);
+
+/**
+ * @brief Compute the statistics of the latest frames
+ * 
+ * @param pacer Pointer to the pacer
+ * @param stats Statistics, zeroed if no frame was measured
+ * @return int 0 if success, -1 if error
+*/
+int getFramePacing(const FramePacer *pacer, FramePacingStats *stats);
+
+/**
+ * @brief Log the statistics and the histogram of the frame times
+ * 
+ * @param pacer Pointer to the pacer
+*/
+void logFramePacing(const FramePacer *pacer);
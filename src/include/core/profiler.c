@@ -0,0 +1,129 @@
+#include "profiler.h"
+
+
+static const char *scopeNames[PROFILE_SCOPE_COUNT] = PROFILE_SCOPE_NAMES;
+
+
+static double counterToNanoseconds(Uint64 counter)
+{
+    return counter * (1e9 / SDL_GetPerformanceFrequency());
+}
+
+// Reading the GPU clock waits for the commands already sent to reach the GPU, so this is not done every frame
+static void calibrateClocks(Profiler *profiler)
+{
+    GLint64 gpu = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    profiler->clockOffset = (double)gpu - counterToNanoseconds(SDL_GetPerformanceCounter());
+    profiler->calibration = 0;
+}
+
+
+int initProfiler(Profiler *profiler)
+{
+    memset(profiler, 0, sizeof(Profiler));
+
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+    if (timestampBits == 0)
+    {
+        LOG_ERROR("Timestamp queries are not supported\n");
+        return -1;
+    }
+    glGenQueries(PROFILER_LATENCY*PROFILE_SCOPE_COUNT*2, &profiler->queries[0][0][0]);
+    calibrateClocks(profiler);
+    LOG_TRACE("Initialized GPU profiler\n");
+    return 0;
+}
+
+
+void profilerNewFrame(Profiler *profiler)
+{
+    profiler->frame = (profiler->frame + 1) % PROFILER_LATENCY;
+    if (++profiler->calibration >= PROFILER_CALIBRATION) calibrateClocks(profiler);
+    const Uint64 input = profiler->input[profiler->frame];
+    profiler->input[profiler->frame] = 0;
+
+    // The slot we are about to reuse holds the oldest frame, its results should be ready by now
+    for (int s=0; s<PROFILE_SCOPE_COUNT; s++)
+    {
+        if (!profiler->issued[profiler->frame][s]) continue;
+        profiler->issued[profiler->frame][s] = false;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(profiler->queries[profiler->frame][s][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;  // Drop the sample rather than stall
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(profiler->queries[profiler->frame][s][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(profiler->queries[profiler->frame][s][1], GL_QUERY_RESULT, &end);
+        const double ms = (end - begin) / 1e6;
+
+        profiler->latest[s] = ms;
+        profiler->average[s] = profiler->average[s] > 0.0 ? profiler->average[s] + (ms - profiler->average[s])*PROFILER_SMOOTHING : ms;
+        profiler->total[s] += ms;
+        profiler->samples[s]++;
+
+        // The frame ends when its last command is done, the input is brought to the GPU clock
+        if (s != PROFILE_FRAME || !input) continue;
+        const double latency = ((double)end - profiler->clockOffset - counterToNanoseconds(input)) / 1e6;
+        if (latency < 0.0) continue;  // Clocks drifted since the last calibration
+        profiler->latencyAverage = profiler->latencyAverage > 0.0 ? profiler->latencyAverage + (latency - profiler->latencyAverage)*PROFILER_SMOOTHING : latency;
+        profiler->latencyTotal += latency;
+        if (latency > profiler->latencyWorst) profiler->latencyWorst = latency;
+        profiler->latencySamples++;
+    }
+}
+
+void profilerBegin(Profiler *profiler, ProfileScope scope)
+{
+    glQueryCounter(profiler->queries[profiler->frame][scope][0], GL_TIMESTAMP);
+}
+
+void profilerEnd(Profiler *profiler, ProfileScope scope)
+{
+    glQueryCounter(profiler->queries[profiler->frame][scope][1], GL_TIMESTAMP);
+    profiler->issued[profiler->frame][scope] = true;
+}
+
+void profilerInput(Profiler *profiler, Uint64 time)
+{
+    if (!profiler->input[profiler->frame] || time < profiler->input[profiler->frame]) profiler->input[profiler->frame] = time;
+}
+
+
+void profilerReset(Profiler *profiler)
+{
+    for (int s=0; s<PROFILE_SCOPE_COUNT; s++)
+    {
+        profiler->total[s] = 0.0;
+        profiler->samples[s] = 0;
+    }
+    profiler->latencyTotal = 0.0;
+    profiler->latencyWorst = 0.0;
+    profiler->latencySamples = 0;
+}
+
+double profilerGetAverage(const Profiler *profiler, ProfileScope scope)
+{
+    return profiler->samples[scope] ? profiler->total[scope] / profiler->samples[scope] : 0.0;
+}
+
+double profilerGetLatency(const Profiler *profiler)
+{
+    return profiler->latencySamples ? profiler->latencyTotal / profiler->latencySamples : 0.0;
+}
+
+void profilerLog(const Profiler *profiler)
+{
+    for (int s=0; s<PROFILE_SCOPE_COUNT; s++)
+        LOG_INFO("GPU %-8s : %.3lf ms\n", scopeNames[s], profiler->average[s]);
+    LOG_INFO("Input to frame end : %.3lf ms (worst %.3lf ms over %u frames)\n", profiler->latencyAverage, profiler->latencyWorst, profiler->latencySamples);
+}
+
+
+void destroyProfiler(Profiler *profiler)
+{
+    if (profiler->queries[0][0][0]) glDeleteQueries(PROFILER_LATENCY*PROFILE_SCOPE_COUNT*2, &profiler->queries[0][0][0]);
+    memset(profiler->queries, 0, sizeof(profiler->queries));
+}
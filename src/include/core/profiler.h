@@ -0,0 +1,160 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#include "game/logs.h"
+
+
+/* --- MACROS --- */
+
+#define PROFILER_LATENCY 4  // Frames kept in flight before reading queries back, so the CPU never waits on the GPU
+#define PROFILER_SMOOTHING 0.05  // Weight of the newest sample in the moving average
+#define PROFILER_CALIBRATION 600  // Frames between two measures of the offset between the CPU and GPU clocks, which drift apart
+
+
+/* --- TYPEDEFS --- */
+
+// GPU passes that can be timed
+typedef enum {
+    PROFILE_FRAME,
+    PROFILE_SHADOWS,
+    PROFILE_GEOMETRY,  // Depth pre-pass or geometry buffer, mostly vertex work
+    PROFILE_SCENE,  // Shading of the scene objects, mostly fragment work
+    PROFILE_UPSCALE,  // Scene to the window, at its resolution (see core/resolution.h)
+    PROFILE_SCOPE_COUNT
+} ProfileScope;
+
+#define PROFILE_SCOPE_NAMES {"Frame", "Shadows", "Geometry", "Scene", "Upscale"}
+
+/**
+ * @brief GPU profiler structure
+ * 
+ * @param queries Begin and end timestamp queries of each scope, for each frame in flight
+ * @param issued Whether the scope was timed in each frame in flight
+ * @param frame Index of the current frame in the ring
+ * @param latest Newest sample of each scope in milliseconds, 0 if none yet
+ * @param average Moving average of each scope in milliseconds
+ * @param total Accumulated time of each scope since the last reset, in milliseconds
+ * @param samples Number of samples accumulated since the last reset
+ * @param input Performance counter of the oldest input shown by each frame in flight, 0 if none
+ * @param clockOffset GPU time minus CPU time, in nanoseconds
+ * @param calibration Frames since the clocks were last compared
+ * @param latencyAverage Moving average of the time from an input to the end of the frame showing it, in milliseconds
+ * @param latencyTotal Accumulated latency since the last reset, in milliseconds
+ * @param latencyWorst Longest latency since the last reset, in milliseconds
+ * @param latencySamples Number of latency samples accumulated since the last reset
+ * 
+ * @note Timestamps are read PROFILER_LATENCY frames after being issued
+ * @note The latency ends when the GPU is done with the frame, the time the display takes to show it is not measured
+*/
+typedef struct {
+    GLuint queries[PROFILER_LATENCY][PROFILE_SCOPE_COUNT][2];
+    bool issued[PROFILER_LATENCY][PROFILE_SCOPE_COUNT];
+    unsigned int frame;
+
+    double latest[PROFILE_SCOPE_COUNT];
+    double average[PROFILE_SCOPE_COUNT];
+    double total[PROFILE_SCOPE_COUNT];
+    unsigned int samples[PROFILE_SCOPE_COUNT];
+
+    Uint64 input[PROFILER_LATENCY];
+    double clockOffset;
+    unsigned int calibration;
+    double latencyAverage;
+    double latencyTotal;
+    double latencyWorst;
+    unsigned int latencySamples;
+} Profiler;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Create the timer queries of the profiler
+ * 
+ * @param profiler Pointer to the profiler
+ * @return int 0 if success, -1 if error
+*/
+int initProfiler(Profiler *profiler);
+
+/**
+ * @brief Collect the results of the oldest frame in flight and start a new frame
+ * 
+ * @param profiler Pointer to the profiler
+ * 
+ * @note Should be called once per frame, before any scope
+*/
+void profilerNewFrame(Profiler *profiler);
+
+/**
+ * @brief Start timing a scope
+ * 
+ * @param profiler Pointer to the profiler
+ * @param scope Scope to time
+*/
+void profilerBegin(Profiler *profiler, ProfileScope scope);
+
+/**
+ * @brief Stop timing a scope
+ * 
+ * @param profiler Pointer to the profiler
+ * @param scope Scope to time
+*/
+void profilerEnd(Profiler *profiler, ProfileScope scope);
+
+/**
+ * @brief Mark the current frame as showing an input, to measure the latency from that input
+ * 
+ * @param profiler Pointer to the profiler
+ * @param time Performance counter when the input happened (SDL_GetPerformanceCounter)
+ * 
+ * @note The oldest input of the frame is kept
+*/
+void profilerInput(Profiler *profiler, Uint64 time);
+
+/**
+ * @brief Reset the accumulated times, e.g. at the start of a benchmark
+ * 
+ * @param profiler Pointer to the profiler
+*/
+void profilerReset(Profiler *profiler);
+
+/**
+ * @brief Get the accumulated average time of a scope since the last reset
+ * 
+ * @param profiler Pointer to the profiler
+ * @param scope Scope to read
+ * @return double Time in milliseconds, 0 if no sample
+*/
+double profilerGetAverage(const Profiler *profiler, ProfileScope scope);
+
+/**
+ * @brief Get the accumulated average latency from an input to the end of the frame showing it, since the last reset
+ * 
+ * @param profiler Pointer to the profiler
+ * @return double Time in milliseconds, 0 if no sample
+*/
+double profilerGetLatency(const Profiler *profiler);
+
+/**
+ * @brief Log the moving averages of every scope
+ * 
+ * @param profiler Pointer to the profiler
+*/
+void profilerLog(const Profiler *profiler);
+
+/**
+ * @brief Delete the timer queries of the profiler
+ * 
+ * @param profiler Pointer to the profiler
+*/
+void destroyProfiler(Profiler *profiler);
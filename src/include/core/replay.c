@@ -0,0 +1,163 @@
+#include "replay.h"
+
+
+static void writeU16(uint8_t *dest, uint16_t value)
+{
+    dest[0] = value & 0xff;
+    dest[1] = value >> 8;
+}
+
+static void writeU32(uint8_t *dest, uint32_t value)
+{
+    for (int i=0; i<4; i++) dest[i] = (value >> (8*i)) & 0xff;
+}
+
+static uint16_t readU16(const uint8_t *src)
+{
+    return (uint16_t)(src[0] | src[1] << 8);
+}
+
+static uint32_t readU32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+
+int startRecording(Replay *replay, const char *path, uint32_t seed)
+{
+    memset(replay, 0, sizeof(Replay));
+    replay->file = fopen(path, "wb");
+    if (replay->file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    writeU32(header, REPLAY_MAGIC);
+    writeU32(header + 4, REPLAY_VERSION);
+    writeU32(header + 8, seed);
+    if (fwrite(header, REPLAY_HEADER_SIZE, 1, replay->file) != 1)
+    {
+        LOG_ERROR("Failed to write file: %s\n", path);
+        closeReplay(replay);
+        return -1;
+    }
+
+    replay->mode = REPLAY_RECORD;
+    replay->seed = seed;
+    LOG_INFO("Recording input to %s\n", path);
+    return 0;
+}
+
+
+int recordInputFrame(Replay *replay, const InputFrame *input)
+{
+    uint32_t dt;
+    memcpy(&dt, &input->dt, sizeof(dt));
+
+    uint8_t frame[REPLAY_FRAME_SIZE];
+    writeU32(frame, dt);
+    frame[4] = input->keys;
+    frame[5] = input->buttons;
+    frame[6] = input->flags;
+    writeU16(frame + 7, (uint16_t)input->mouseX);
+    writeU16(frame + 9, (uint16_t)input->mouseY);
+    if (fwrite(frame, REPLAY_FRAME_SIZE, 1, replay->file) != 1)
+    {
+        LOG_ERROR("Failed to write input frame %d\n", replay->frameCount);
+        return -1;
+    }
+    replay->frameCount++;
+    return 0;
+}
+
+
+int loadReplay(Replay *replay, const char *path)
+{
+    memset(replay, 0, sizeof(Replay));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < REPLAY_HEADER_SIZE)
+    {
+        LOG_ERROR("Invalid replay file: %s\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    replay->data = malloc(size);
+    if (replay->data == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for file: %s\n", path);
+        fclose(file);
+        return -1;
+    }
+    const size_t read = fread(replay->data, 1, size, file);
+    fclose(file);
+    if (read != (size_t)size || readU32(replay->data) != REPLAY_MAGIC || readU32(replay->data + 4) != REPLAY_VERSION)
+    {
+        LOG_ERROR("Invalid replay file: %s\n", path);
+        closeReplay(replay);
+        return -1;
+    }
+
+    // A log cut short by a crash keeps its whole frames
+    replay->mode = REPLAY_PLAY;
+    replay->seed = readU32(replay->data + 8);
+    replay->frameCount = (size - REPLAY_HEADER_SIZE) / REPLAY_FRAME_SIZE;
+    LOG_INFO("Replaying %d input frames from %s\n", replay->frameCount, path);
+    return 0;
+}
+
+
+bool nextReplayFrame(Replay *replay, InputFrame *input)
+{
+    if (replay->frame >= replay->frameCount) return false;
+
+    const uint8_t *frame = replay->data + REPLAY_HEADER_SIZE + replay->frame * REPLAY_FRAME_SIZE;
+    const uint32_t dt = readU32(frame);
+    memcpy(&input->dt, &dt, sizeof(dt));
+    input->keys = frame[4];
+    input->buttons = frame[5];
+    input->flags = frame[6];
+    input->mouseX = (int16_t)readU16(frame + 7);
+    input->mouseY = (int16_t)readU16(frame + 9);
+    replay->frame++;
+    return true;
+}
+
+
+uint8_t getInputKeys(const Bindings *bindings, const Uint8 *keyboardState)
+{
+    const SDL_Scancode scancodes[8] = {bindings->forward, bindings->backward, bindings->left, bindings->right, bindings->sprint, bindings->jump, bindings->use, bindings->reload};
+    uint8_t keys = 0;
+    for (int i=0; i<8; i++) if (keyboardState[scancodes[i]]) keys |= 1 << i;
+    return keys;
+}
+
+
+void setInputKeys(const Bindings *bindings, uint8_t keys, Uint8 *keyboardState)
+{
+    const SDL_Scancode scancodes[8] = {bindings->forward, bindings->backward, bindings->left, bindings->right, bindings->sprint, bindings->jump, bindings->use, bindings->reload};
+    for (int i=0; i<8; i++) keyboardState[scancodes[i]] = (keys >> i) & 1;
+}
+
+
+void closeReplay(Replay *replay)
+{
+    if (replay->file)
+    {
+        if (fclose(replay->file) != 0) LOG_ERROR("Failed to write input log\n");
+        else LOG_INFO("Recorded %d input frames\n", replay->frameCount);
+    }
+    free(replay->data);
+    memset(replay, 0, sizeof(Replay));
+}
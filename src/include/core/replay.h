@@ -0,0 +1,153 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "game/camera.h"
+#include "game/logs.h"
+
+
+/* --- MACROS --- */
+
+#define REPLAY_MAGIC 0x314c5052u  // "RPL1"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 12  // Magic, version, random seed
+#define REPLAY_FRAME_SIZE 11  // Timestep, keys, buttons, flags, mouse x, mouse y
+
+// Keys of the camera bindings held during a tick
+#define INPUT_KEY_FORWARD (1 << 0)
+#define INPUT_KEY_BACKWARD (1 << 1)
+#define INPUT_KEY_LEFT (1 << 2)
+#define INPUT_KEY_RIGHT (1 << 3)
+#define INPUT_KEY_SPRINT (1 << 4)
+#define INPUT_KEY_JUMP (1 << 5)
+#define INPUT_KEY_USE (1 << 6)
+#define INPUT_KEY_RELOAD (1 << 7)
+
+// Events of a tick
+#define INPUT_FLAG_PAUSE (1 << 0)  // Pause toggled
+
+
+/* --- TYPEDEFS --- */
+
+/**
+ * @brief Input of one game tick, everything the game logic reads from the player
+ * 
+ * @param dt Timestep of the tick
+ * @param keys Bindings held, INPUT_KEY_* bits
+ * @param buttons Mouse buttons pressed during the tick, SDL_BUTTON() bits
+ * @param flags INPUT_FLAG_* bits
+ * @param mouseX Relative mouse motion during the tick
+ * @param mouseY Relative mouse motion during the tick
+*/
+typedef struct {
+    float dt;
+    uint8_t keys;
+    uint8_t buttons;
+    uint8_t flags;
+    int16_t mouseX, mouseY;
+} InputFrame;
+
+// What the replay does with the input
+typedef enum {
+    REPLAY_OFF,
+    REPLAY_RECORD,  // Live input is written to the log
+    REPLAY_PLAY  // Input is read from the log, window input is ignored
+} ReplayMode;
+
+/**
+ * @brief Input log structure
+ * 
+ * @param mode What the replay does
+ * @param file Log being written (REPLAY_RECORD)
+ * @param data Log read (REPLAY_PLAY)
+ * @param frameCount Number of frames in the log (REPLAY_PLAY), or written so far (REPLAY_RECORD)
+ * @param frame Next frame to read (REPLAY_PLAY)
+ * @param seed Random seed of the game logic when the log was recorded
+ * 
+ * @note Logs are little endian, so that they replay on any machine
+*/
+typedef struct {
+    ReplayMode mode;
+    FILE *file;
+    uint8_t *data;
+    uint32_t frameCount;
+    uint32_t frame;
+    uint32_t seed;
+} Replay;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Start writing an input log
+ * 
+ * @param replay Pointer to the replay
+ * @param path Path of the log
+ * @param seed Random seed of the game logic
+ * @return int 0 if success, -1 if error
+*/
+int startRecording(Replay *replay, const char *path, uint32_t seed);
+
+/**
+ * @brief Append the input of a tick to the log
+ * 
+ * @param replay Pointer to the replay
+ * @param input Input of the tick
+ * @return int 0 if success, -1 if error
+*/
+int recordInputFrame(Replay *replay, const InputFrame *input);
+
+/**
+ * @brief Read an input log
+ * 
+ * @param replay Pointer to the replay
+ * @param path Path of the log
+ * @return int 0 if success, -1 if error
+ * 
+ * @note The random seed of the log is in replay->seed
+*/
+int loadReplay(Replay *replay, const char *path);
+
+/**
+ * @brief Get the input of the next tick from the log
+ * 
+ * @param replay Pointer to the replay
+ * @param input Input of the tick
+ * @return true Input read
+ * @return false End of the log
+*/
+bool nextReplayFrame(Replay *replay, InputFrame *input);
+
+/**
+ * @brief Pack the held bindings into INPUT_KEY_* bits
+ * 
+ * @param bindings Bindings of the camera
+ * @param keyboardState Keyboard state, from SDL_GetKeyboardState
+ * @return uint8_t INPUT_KEY_* bits
+*/
+uint8_t getInputKeys(const Bindings *bindings, const Uint8 *keyboardState);
+
+/**
+ * @brief Unpack INPUT_KEY_* bits into a keyboard state
+ * 
+ * @param bindings Bindings of the camera
+ * @param keys INPUT_KEY_* bits
+ * @param keyboardState Keyboard state of SDL_NUM_SCANCODES keys, only the bindings are written
+*/
+void setInputKeys(const Bindings *bindings, uint8_t keys, Uint8 *keyboardState);
+
+/**
+ * @brief Close the log
+ * 
+ * @param replay Pointer to the replay
+*/
+void closeReplay(Replay *replay);
@@ -0,0 +1,146 @@
+#include "resolution.h"
+
+
+static float clampScale(const ResolutionScaler *scaler, float scale)
+{
+    return fminf(fmaxf(scale, scaler->minScale), 1.0f);
+}
+
+// The scene is sampled from its resolved copy when multisampled
+static int initResolvedTarget(ResolutionScaler *scaler, const RenderTarget *target)
+{
+    memset(&scaler->resolved, 0, sizeof(RenderTarget));
+    if (target->samples <= 1) return 0;
+    return initRenderTarget(&scaler->resolved, target->width, target->height, 1);
+}
+
+
+int initResolutionScaler(ResolutionScaler *scaler, const RenderTarget *target, float minScale, double budget)
+{
+    memset(scaler, 0, sizeof(ResolutionScaler));
+    scaler->scale = 1.0f;
+    setResolutionBudget(scaler, minScale, budget);
+
+    Shader vertexShader, fragmentShader;
+    if (loadShader(&vertexShader, "screen.vert", GL_VERTEX_SHADER) < 0) return -1;
+    if (loadShader(&fragmentShader, "upscale.frag", GL_FRAGMENT_SHADER) < 0) {destroyShader(&vertexShader); return -1;}
+    const int result = initShaderProgram(&scaler->shaderProgramUpscale, 2, &vertexShader, &fragmentShader);
+    destroyShader(&vertexShader);
+    destroyShader(&fragmentShader);
+    if (result < 0)
+    {
+        LOG_ERROR("Could not create upscale shader program\n");
+        return -1;
+    }
+
+    glGenSamplers(1, &scaler->sampler);
+    glSamplerParameteri(scaler->sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(scaler->sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(scaler->sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(scaler->sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenVertexArrays(1, &scaler->screenVAO);
+
+    if (initResolvedTarget(scaler, target) < 0)
+    {
+        destroyResolutionScaler(scaler);
+        return -1;
+    }
+    LOG_TRACE("Initialized resolution scaler\n");
+    return 0;
+}
+
+void setResolutionBudget(ResolutionScaler *scaler, float minScale, double budget)
+{
+    scaler->minScale = fminf(minScale, 1.0f);
+    scaler->budget = budget;
+    scaler->scale = clampScale(scaler, scaler->scale);
+    scaler->frameTime = 0.0;
+    scaler->frames = 0;
+    if (scaler->minScale < 1.0f) LOG_INFO("Dynamic resolution from %.0f%% to 100%%, GPU budget %.2lf ms\n", 100.0f * scaler->minScale, budget);
+    else LOG_INFO("Dynamic resolution disabled\n");
+}
+
+int resizeResolutionScaler(ResolutionScaler *scaler, const RenderTarget *target)
+{
+    destroyRenderTarget(&scaler->resolved);
+    scaler->frameTime = 0.0;
+    scaler->frames = 0;
+    return initResolvedTarget(scaler, target);
+}
+
+
+void updateResolutionScale(ResolutionScaler *scaler, RenderTarget *target, const Profiler *profiler)
+{
+    // Frames still in flight were rendered at the previous scale
+    const double time = profiler->latest[PROFILE_FRAME];
+    if (++scaler->frames > PROFILER_LATENCY && time > 0.0)
+        scaler->frameTime = scaler->frameTime > 0.0 ? scaler->frameTime + (time - scaler->frameTime)*RESOLUTION_SMOOTHING : time;
+
+    // Over budget, or far enough under it to go up without coming back down right away
+    const bool settled = scaler->frames >= PROFILER_LATENCY + RESOLUTION_SAMPLES && scaler->frameTime > 0.0;
+    if (scaler->minScale < 1.0f && settled && (scaler->frameTime > scaler->budget || scaler->frameTime < scaler->budget * RESOLUTION_RAISE))
+    {
+        const float wanted = scaler->scale * (float)sqrt(scaler->budget * RESOLUTION_TARGET / scaler->frameTime);
+        const float scale = clampScale(scaler, fminf(fmaxf(wanted, scaler->scale - RESOLUTION_STEP_DOWN), scaler->scale + RESOLUTION_STEP_UP));
+        if (fabsf(scale - scaler->scale) >= RESOLUTION_STEP_MIN)
+        {
+            scaler->scale = scale;
+            scaler->frameTime = 0.0;
+            scaler->frames = 0;
+        }
+    }
+
+    setRenderTargetViewport(target, (unsigned int)lroundf(target->width * scaler->scale), (unsigned int)lroundf(target->height * scaler->scale));
+}
+
+
+void upscaleToScreen(const ResolutionScaler *scaler, const RenderTarget *target, unsigned int windowWidth, unsigned int windowHeight)
+{
+    // Full scale is a plain copy, a single blit that also resolves the samples
+    if (target->viewWidth == windowWidth && target->viewHeight == windowHeight)
+    {
+        blitRenderTargetToScreen(target, windowWidth, windowHeight);
+        glViewport(0, 0, windowWidth, windowHeight);
+        return;
+    }
+
+    const RenderTarget *source = target;
+    if (target->samples > 1)
+    {
+        resolveRenderTarget(target, &scaler->resolved);
+        source = &scaler->resolved;
+    }
+
+    // The sharpening only makes up for the bilinear blur of an upscale
+    const bool upscaled = target->viewWidth < windowWidth || target->viewHeight < windowHeight;
+    const float sharpness = upscaled ? RESOLUTION_SHARPNESS * fminf(2.0f * (1.0f - scaler->scale), 1.0f) : 0.0f;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(scaler->shaderProgramUpscale);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source->colorTexture);
+    glBindSampler(0, scaler->sampler);
+    glUniform1i(glGetUniformLocation(scaler->shaderProgramUpscale, "scene"), 0);
+    glUniform2f(glGetUniformLocation(scaler->shaderProgramUpscale, "renderSize"), (float)target->viewWidth, (float)target->viewHeight);
+    glUniform2f(glGetUniformLocation(scaler->shaderProgramUpscale, "windowSize"), (float)windowWidth, (float)windowHeight);
+    glUniform1f(glGetUniformLocation(scaler->shaderProgramUpscale, "sharpness"), sharpness);
+
+    glBindVertexArray(scaler->screenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindSampler(0, 0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+
+void destroyResolutionScaler(ResolutionScaler *scaler)
+{
+    destroyRenderTarget(&scaler->resolved);
+    if (scaler->shaderProgramUpscale) {glDeleteProgram(scaler->shaderProgramUpscale); scaler->shaderProgramUpscale = 0;}
+    if (scaler->sampler) {glDeleteSamplers(1, &scaler->sampler); scaler->sampler = 0;}
+    if (scaler->screenVAO) {glDeleteVertexArrays(1, &scaler->screenVAO); scaler->screenVAO = 0;}
+}
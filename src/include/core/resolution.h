@@ -0,0 +1,125 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdbool.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "core/profiler.h"
+#include "game/framebuffer.h"
+#include "game/logs.h"
+#include "game/shader.h"
+
+
+/* --- MACROS --- */
+
+#define RESOLUTION_MIN_DEFAULT 0.5f  // Lowest scale of the scene, 1 disables dynamic resolution, the resolution-min setting changes it
+#define RESOLUTION_BUDGET_RATE 60.0  // Frame rate the GPU budget follows when neither the frame rate cap nor the display sets it
+#define RESOLUTION_TARGET 0.9  // Share of the budget aimed at, so that spikes have some room
+#define RESOLUTION_RAISE 0.8  // Share of the budget under which the scale goes up again, above RESOLUTION_TARGET it would oscillate
+#define RESOLUTION_SMOOTHING 0.1  // Weight of the newest GPU frame time in its moving average
+#define RESOLUTION_SAMPLES 8  // Frames averaged before the scale changes again, on top of the PROFILER_LATENCY frames still in flight
+#define RESOLUTION_STEP_DOWN 0.15f  // Largest drop of the scale at once
+#define RESOLUTION_STEP_UP 0.05f  // Largest rise of the scale at once, slower so that a spike is not followed by a blurry-sharp flicker
+#define RESOLUTION_STEP_MIN 0.01f  // Smaller changes are not worth the sudden change of sharpness
+#define RESOLUTION_SHARPNESS 0.6f  // Sharpening of the upscale at half the resolution and below, lessened as the scale gets closer to 1
+
+
+/* --- TYPEDEFS --- */
+
+/**
+ * @brief Dynamic resolution structure
+ * 
+ * @param scale Size of the rendered region relative to the window, on each axis
+ * @param minScale Lowest scale, 1 if dynamic resolution is disabled
+ * @param budget GPU time a frame should take, in milliseconds
+ * @param frameTime Moving average of the GPU frame time since the last change of scale, in milliseconds
+ * @param frames Frames since the last change of scale
+ * @param resolved Single sample copy of a multisampled scene, unused otherwise
+ * @param shaderProgramUpscale Shader program drawing the scene to the window
+ * @param sampler Bilinear sampler, the render targets are sampled with nearest filtering otherwise
+ * @param screenVAO Empty vertex array, for fullscreen triangles
+ * 
+ * @note GPU time is assumed to grow with the pixel count, i.e. with the square of the scale
+*/
+typedef struct {
+    float scale;
+    float minScale;
+    double budget;
+    double frameTime;
+    unsigned int frames;
+
+    RenderTarget resolved;
+    GLuint shaderProgramUpscale;
+    GLuint sampler;
+    GLuint screenVAO;
+} ResolutionScaler;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Create the upscale pass of the dynamic resolution
+ * 
+ * @param scaler Pointer to the scaler
+ * @param target Scene render target, allocated at the size of the window
+ * @param minScale Lowest scale, 1 to disable dynamic resolution
+ * @param budget GPU time a frame should take, in milliseconds
+ * @return int 0 if success, -1 if error
+*/
+int initResolutionScaler(ResolutionScaler *scaler, const RenderTarget *target, float minScale, double budget);
+
+/**
+ * @brief Change the lowest scale and the GPU budget
+ * 
+ * @param scaler Pointer to the scaler
+ * @param minScale Lowest scale, 1 to disable dynamic resolution
+ * @param budget GPU time a frame should take, in milliseconds
+*/
+void setResolutionBudget(ResolutionScaler *scaler, float minScale, double budget);
+
+/**
+ * @brief Reallocate what depends on the scene render target after it changed
+ * 
+ * @param scaler Pointer to the scaler
+ * @param target Scene render target
+ * @return int 0 if success, -1 if error
+*/
+int resizeResolutionScaler(ResolutionScaler *scaler, const RenderTarget *target);
+
+/**
+ * @brief Adjust the scale to the GPU time of the latest frames, and the rendered region of the scene to the scale
+ * 
+ * @param scaler Pointer to the scaler
+ * @param target Scene render target
+ * @param profiler Profiler timing the frames (PROFILE_FRAME)
+ * 
+ * @note Should be called once per frame, before the scene is rendered
+*/
+void updateResolutionScale(ResolutionScaler *scaler, RenderTarget *target, const Profiler *profiler);
+
+/**
+ * @brief Draw the rendered region of the scene over the whole window, sharpened when upscaled
+ * 
+ * @param scaler Pointer to the scaler
+ * @param target Scene render target, resolved first if multisampled
+ * @param windowWidth Width of the window
+ * @param windowHeight Height of the window
+ * 
+ * @note Default framebuffer is bound after the function call, with a viewport covering the window
+ * @note At full scale, the region is blitted (blitRenderTargetToScreen) rather than drawn
+*/
+void upscaleToScreen(const ResolutionScaler *scaler, const RenderTarget *target, unsigned int windowWidth, unsigned int windowHeight);
+
+/**
+ * @brief Destroy the upscale pass of the dynamic resolution
+ * 
+ * @param scaler Pointer to the scaler
+*/
+void destroyResolutionScaler(ResolutionScaler *scaler);
@@ -0,0 +1,158 @@
+#include "settings.h"
+
+
+static const char *presetNames[PRESET_COUNT] = PRESET_NAMES;
+
+// What each preset changes, from the cheapest to the sharpest
+static const struct {
+    unsigned int msaa;
+    unsigned int shadowResolution;
+    float shadowFar;
+    float zFar;
+} presets[PRESET_COUNT] = {
+    {1, 256, 24.0f, 48.0f},  // Low
+    {2, 512, 28.0f, 56.0f},  // Medium
+    {4, 1024, 32.0f, 64.0f},  // High
+    {8, 2048, 40.0f, 96.0f}  // Ultra
+};
+
+
+void initSettings(Settings *settings)
+{
+    settings->vsync = false;
+    settings->fullscreen = false;
+    settings->fov = 70.0f;
+    settings->audioRate = AUDIO_SAMPLERATE;
+    settings->audioFrames = 1024;
+    settings->frameRate = PACING_FPS_DEFAULT;
+    settings->resolutionMin = RESOLUTION_MIN_DEFAULT;
+    settings->gpuBudget = 0.0;
+    applyPreset(settings, PRESET_DEFAULT);
+}
+
+void applyPreset(Settings *settings, QualityPreset preset)
+{
+    settings->preset = preset;
+    settings->msaa = presets[preset].msaa;
+    settings->shadowResolution = presets[preset].shadowResolution;
+    settings->shadowFar = presets[preset].shadowFar;
+    settings->zFar = presets[preset].zFar;
+}
+
+
+static bool isPowerOfTwo(long value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+static int parseBool(const char *value, bool *dest)
+{
+    if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "on") == 0) *dest = true;
+    else if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0 || strcmp(value, "off") == 0) *dest = false;
+    else return -1;
+    return 0;
+}
+
+static int parseInt(const char *value, long min, long max, long *dest)
+{
+    char *end;
+    const long result = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || result < min || result > max) return -1;
+    *dest = result;
+    return 0;
+}
+
+static int parseFloat(const char *value, double min, double max, double *dest)
+{
+    char *end;
+    const double result = strtod(value, &end);
+    // NaN fails every comparison, it is rejected with the values out of range
+    if (end == value || *end != '\0' || !(result >= min && result <= max)) return -1;
+    *dest = result;
+    return 0;
+}
+
+int parseSetting(Settings *settings, const char *setting)
+{
+    char line[SETTINGS_LINE_SIZE];
+    snprintf(line, sizeof(line), "%s", setting);
+    line[strcspn(line, "\r\n")] = '\0';
+
+    char *value = strchr(line, '=');
+    if (value == NULL)
+    {
+        LOG_ERROR("Invalid setting : %s\n", line);
+        return -1;
+    }
+    *value++ = '\0';
+    const char *key = line;
+
+    long integer;
+    double real;
+    int result = -1;
+    if (strcmp(key, "preset") == 0)
+    {
+        for (int p=0; p<PRESET_COUNT; p++)
+            if (strcmp(value, presetNames[p]) == 0) {applyPreset(settings, p); result = 0;}
+    }
+    else if (strcmp(key, "vsync") == 0) result = parseBool(value, &settings->vsync);
+    else if (strcmp(key, "fullscreen") == 0) result = parseBool(value, &settings->fullscreen);
+    else if (strcmp(key, "msaa") == 0)
+    {
+        if ((result = parseInt(value, 1, 16, &integer)) == 0 && !isPowerOfTwo(integer)) result = -1;
+        if (result == 0) settings->msaa = integer;
+    }
+    else if (strcmp(key, "fov") == 0) {if ((result = parseFloat(value, 30.0, 120.0, &real)) == 0) settings->fov = real;}
+    else if (strcmp(key, "zfar") == 0) {if ((result = parseFloat(value, 1.0, 1000.0, &real)) == 0) settings->zFar = real;}
+    else if (strcmp(key, "shadow-resolution") == 0)
+    {
+        // The coarsest tier is a quarter of it
+        if ((result = parseInt(value, 64, 8192, &integer)) == 0 && !isPowerOfTwo(integer)) result = -1;
+        if (result == 0) settings->shadowResolution = integer;
+    }
+    else if (strcmp(key, "shadow-far") == 0) {if ((result = parseFloat(value, 1.0, 256.0, &real)) == 0) settings->shadowFar = real;}
+    else if (strcmp(key, "audio-rate") == 0) {if ((result = parseInt(value, 8000, 192000, &integer)) == 0) settings->audioRate = integer;}
+    else if (strcmp(key, "audio-buffer") == 0) {if ((result = parseInt(value, 64, 16384, &integer)) == 0) settings->audioFrames = integer;}
+    else if (strcmp(key, "fps") == 0) {if ((result = parseFloat(value, 0.0, 1000.0, &real)) == 0) settings->frameRate = real;}
+    else if (strcmp(key, "resolution-min") == 0) {if ((result = parseFloat(value, 0.25, 1.0, &real)) == 0) settings->resolutionMin = real;}
+    else if (strcmp(key, "gpu-budget") == 0) {if ((result = parseFloat(value, 0.0, 1000.0, &real)) == 0) settings->gpuBudget = real;}
+    else
+    {
+        LOG_ERROR("Unknown setting : %s\n", key);
+        return -1;
+    }
+
+    if (result < 0) LOG_ERROR("Invalid value for setting %s : %s\n", key, value);
+    return result;
+}
+
+int loadSettings(Settings *settings, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    int result = 0;
+    char line[SETTINGS_LINE_SIZE];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (parseSetting(settings, line) < 0) result = -1;
+    }
+
+    fclose(file);
+    LOG_INFO("Settings loaded from %s\n", path);
+    return result;
+}
+
+void logSettings(const Settings *settings)
+{
+    LOG_INFO("Settings (preset %s) : vsync %d, fullscreen %d, msaa %u, fov %.1f, zfar %.1f\n",
+        presetNames[settings->preset], settings->vsync, settings->fullscreen, settings->msaa, settings->fov, settings->zFar);
+    LOG_INFO("  shadow-resolution %u, shadow-far %.1f, audio-rate %d, audio-buffer %d, fps %.1lf\n",
+        settings->shadowResolution, settings->shadowFar, settings->audioRate, settings->audioFrames, settings->frameRate);
+    LOG_INFO("  resolution-min %.2f, gpu-budget %.2lf\n", settings->resolutionMin, settings->gpuBudget);
+}
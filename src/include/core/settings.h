@@ -0,0 +1,114 @@
+#pragma once
+
+
+/* --- INCLUDES --- */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/pacing.h"
+#include "core/resolution.h"
+#include "game/audio.h"
+#include "game/logs.h"
+
+
+/* --- MACROS --- */
+
+#define SETTINGS_PATH "assets/settings/settings.stg"  // Next to the bindings, read at startup and with F7
+#define SETTINGS_LINE_SIZE 128
+
+#define PRESET_DEFAULT PRESET_HIGH
+#define PRESET_NAMES {"low", "medium", "high", "ultra"}
+
+
+/* --- TYPEDEFS --- */
+
+// Quality presets, each sets the settings that trade image quality for speed
+typedef enum {
+    PRESET_LOW,
+    PRESET_MEDIUM,
+    PRESET_HIGH,
+    PRESET_ULTRA,
+    PRESET_COUNT
+} QualityPreset;
+
+/**
+ * @brief Settings that can be changed without rebuilding the game
+ * 
+ * @param preset Last preset applied, the settings may have been changed since
+ * @param vsync Whether buffer swaps wait for the display (adaptive if supported)
+ * @param fullscreen Whether the window covers the display, at the resolution of the display
+ * @param msaa Samples per pixel of the scene, forward renderer only
+ * @param fov Vertical field of view in degrees
+ * @param zFar Far plane of the camera
+ * @param shadowResolution Resolution of the sharpest shadow maps, the coarser tiers follow
+ * @param shadowFar Far plane of the shadow maps, and range of the shadow casting lights
+ * @param audioRate Frequency of the audio device in Hz
+ * @param audioFrames Frames mixed at once, smaller is less latency and more CPU
+ * @param frameRate Frame rate cap, 0 for none
+ * @param resolutionMin Lowest scale of the scene under dynamic resolution, 1 to disable it
+ * @param gpuBudget GPU time a frame should take in milliseconds, 0 to follow the frame rate cap or the display
+ * 
+ * @note Applied in order : defaults (PRESET_DEFAULT), SETTINGS_PATH, then the command line
+*/
+typedef struct {
+    QualityPreset preset;
+    bool vsync;
+    bool fullscreen;
+    unsigned int msaa;
+    float fov;
+    float zFar;
+    unsigned int shadowResolution;
+    float shadowFar;
+    int audioRate;
+    int audioFrames;
+    double frameRate;
+    float resolutionMin;
+    double gpuBudget;
+} Settings;
+
+
+/* --- FUNCTIONS --- */
+
+/**
+ * @brief Set the default settings
+ * 
+ * @param settings Pointer to the settings
+*/
+void initSettings(Settings *settings);
+
+/**
+ * @brief Set the settings of a quality preset, the others are left untouched
+ * 
+ * @param settings Pointer to the settings
+ * @param preset Preset to apply
+*/
+void applyPreset(Settings *settings, QualityPreset preset);
+
+/**
+ * @brief Change a setting from its text form, as in the settings file or the command line
+ * 
+ * @param settings Pointer to the settings
+ * @param setting Setting like "msaa=4", "preset=low" or "shadow-resolution=2048"
+ * @return int 0 on success, -1 on failure (unknown setting or value out of range, nothing is changed)
+*/
+int parseSetting(Settings *settings, const char *setting);
+
+/**
+ * @brief Read a settings file, one setting per line, lines starting with # are ignored
+ * 
+ * @param settings Pointer to the settings
+ * @param path Path to the settings file
+ * @return int 0 on success, -1 on failure (the valid lines are still applied)
+*/
+int loadSettings(Settings *settings, const char *path);
+
+/**
+ * @brief Log every setting
+ * 
+ * @param settings Pointer to the settings
+*/
+void logSettings(const Settings *settings);
@@ -1,41 +1,1247 @@
 #include "audio.h"
 
 
+// Decoded sound file, shared by the sounds loading it
+typedef struct {
+    char path[256];
+    SoundBuffer buffer;
+    int references;
+} CachedSound;
+
+/**
+ * @brief Sound played by the mixer, mixed only when it ranks among the AUDIO_VOICES most important
+ * 
+ * @param buffer Samples played, NULL if the voice is free
+ * @param start Frame of the mixer the voice started at, or was last rebased at, it plays at the same pace whether it is mixed or not
+ * @param offset Source frame played at start
+ * @param length Source frames played, loops included
+ * @param end Frame of the mixer the voice ends at
+ * @param filter Resampler filter of the rate of the sound, -1 if it is the rate of the device
+ * @param position Position of the source (spatial voices)
+ * @param spatial Whether the voice is attenuated and panned from the listener
+ * @param volume Volume, 0 to 1
+ * @param priority Priority of the sound
+ * @param gains Gains of each side at the end of the last mix, 0 if the voice was not mixed
+ * @param targets Gains of each side for the next mix
+ * @param audibility Volume heard by the listener, voices of the same priority are ranked by it
+ * @param generation Incremented each time the voice is reused, so that stale handles are ignored
+*/
+typedef struct {
+    const SoundBuffer *buffer;
+    Uint64 start;
+    Uint64 offset;
+    Uint64 length;
+    Uint64 end;
+    int filter;
+
+    vec3 position;
+    bool spatial;
+    float volume;
+    int priority;
+
+    float gains[2];
+    float targets[2];
+    float audibility;
+    Uint16 generation;
+} MixerVoice;
+
+/**
+ * @brief Polyphase filter resampling the sounds of one rate to the device rate
+ * 
+ * @param rate Rate of the sounds
+ * @param coefficients AUDIO_RESAMPLER_PHASES + 1 rows of AUDIO_RESAMPLER_TAPS coefficients, scaled to 16 bits samples
+*/
+typedef struct {
+    int rate;
+    float *coefficients;
+} ResamplerFilter;
+
+// Mixer state, shared by the game, streaming and audio threads
+static struct {
+    bool open;
+    SDL_AudioDeviceID device;
+    int rate;
+    int frames;
+    SDL_AudioFormat format;
+    int channels;
+    int frameSize;
+
+    // Locked with the audio device
+    MixerVoice voices[AUDIO_VIRTUAL_VOICES];
+    ResamplerFilter filters[AUDIO_MAX_RATES];
+    int filterCount;
+    Uint64 frame;  // Frames mixed since the device was opened
+    vec3 listener;
+    vec3 right;  // Right of the listener, sounds on this side are panned right
+
+    SDL_Thread *thread;
+    SDL_sem *wake;
+    SDL_mutex *lock;  // Held while the streams are decoded
+    SDL_atomic_t running;
+    void *streams[AUDIO_MAX_STREAMS];  // Streams played, Stream* read by the audio thread
+} mixer;
+
+static CachedSound soundCache[AUDIO_CACHE_SIZE];
+
+
+int openAudioDecoder(AudioDecoder *decoder, const char *path)
+{
+    // The encoding is found from the header rather than the extension
+    unsigned char header[36] = {0};
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+    size_t headerSize = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    if (headerSize >= 4 && memcmp(header, "RIFF", 4) == 0)
+    {
+        SDL_AudioSpec spec;
+        if (SDL_LoadWAV(path, &spec, &decoder->wav.data, &decoder->wav.length) == NULL)
+        {
+            LOG_ERROR("Could not load WAV file %s: %s\n", path, SDL_GetError());
+            return -1;
+        }
+        decoder->type = DECODER_WAV;
+        decoder->format = spec.format;
+        decoder->channels = spec.channels;
+        decoder->rate = spec.freq;
+        decoder->wav.position = 0;
+    }
+    else if (headerSize >= 35 && memcmp(header, "OggS", 4) == 0 && memcmp(header + 28, "\x01vorbis", 7) == 0)
+    {
+        if (ov_fopen(path, &decoder->vorbis) != 0)
+        {
+            LOG_ERROR("Could not open Ogg Vorbis file %s\n", path);
+            return -1;
+        }
+        vorbis_info *info = ov_info(&decoder->vorbis, -1);
+        decoder->type = DECODER_VORBIS;
+        decoder->format = AUDIO_S16SYS;
+        decoder->channels = info->channels;
+        decoder->rate = (int)info->rate;
+    }
+    else
+    {
+        LOG_ERROR("Unsupported audio file %s, expected WAV or Ogg Vorbis\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int readAudioDecoder(AudioDecoder *decoder, Uint8 *dest, int size)
+{
+    if (decoder->type == DECODER_WAV)
+    {
+        Uint32 left = decoder->wav.length - decoder->wav.position;
+        int length = left < (Uint32)size ? (int)left : size;
+        memcpy(dest, decoder->wav.data + decoder->wav.position, length);
+        decoder->wav.position += length;
+        return length;
+    }
+
+    int bitstream;
+    long length;
+    // Holes are gaps in corrupted files, the next samples can still be read
+    do length = ov_read(&decoder->vorbis, (char*)dest, size, SDL_BYTEORDER == SDL_BIG_ENDIAN, 2, 1, &bitstream);
+    while (length == OV_HOLE);
+    if (length < 0)
+    {
+        LOG_ERROR("Could not decode Ogg Vorbis samples (%ld)\n", length);
+        return -1;
+    }
+    return (int)length;
+}
+
+int rewindAudioDecoder(AudioDecoder *decoder)
+{
+    if (decoder->type == DECODER_WAV)
+    {
+        decoder->wav.position = 0;
+        return 0;
+    }
+
+    if (ov_raw_seek(&decoder->vorbis, 0) != 0)
+    {
+        LOG_ERROR("Could not rewind Ogg Vorbis file\n");
+        return -1;
+    }
+    return 0;
+}
+
+void closeAudioDecoder(AudioDecoder *decoder)
+{
+    if (decoder->type == DECODER_WAV) SDL_FreeWAV(decoder->wav.data);
+    else ov_clear(&decoder->vorbis);
+}
+
+
+/**
+ * @brief Decode a whole file in 16 bits, at the rate of the file
+ * 
+ * @param path Path to the file
+ * @param buffer Set to the samples, to free with SDL_free
+ * @return int 0 on success, -1 on failure
+ * 
+ * @note Files with more than two channels are mixed down to stereo
+*/
+static int decodeSound(const char *path, SoundBuffer *buffer)
+{
+    AudioDecoder decoder;
+    if (openAudioDecoder(&decoder, path) < 0) return -1;
+
+    buffer->channels = decoder.channels > 1 ? 2 : 1;
+    buffer->rate = decoder.rate;
+    SDL_AudioStream *converter = SDL_NewAudioStream(decoder.format, decoder.channels, decoder.rate, AUDIO_S16SYS, buffer->channels, decoder.rate);
+    if (converter == NULL)
+    {
+        LOG_ERROR("Could not convert sound file %s: %s\n", path, SDL_GetError());
+        closeAudioDecoder(&decoder);
+        return -1;
+    }
+
+    Uint8 decoded[AUDIO_DECODE_SIZE];
+    int size;
+    while ((size = readAudioDecoder(&decoder, decoded, sizeof(decoded))) > 0)
+    {
+        if (SDL_AudioStreamPut(converter, decoded, size) < 0) {size = -1; break;}
+    }
+    closeAudioDecoder(&decoder);
+    if (size < 0 || SDL_AudioStreamFlush(converter) < 0)
+    {
+        LOG_ERROR("Could not decode sound file %s\n", path);
+        SDL_FreeAudioStream(converter);
+        return -1;
+    }
+
+    int available = SDL_AudioStreamAvailable(converter);
+    buffer->samples = SDL_malloc(available > 0 ? available : 1);
+    if (buffer->samples == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for sound file %s\n", path);
+        SDL_FreeAudioStream(converter);
+        return -1;
+    }
+    int converted = SDL_AudioStreamGet(converter, buffer->samples, available);
+    SDL_FreeAudioStream(converter);
+    buffer->frames = converted > 0 ? (Uint32)converted / (buffer->channels * sizeof(Sint16)) : 0;
+    return 0;
+}
+
 int loadSound(Sound *sound, char* filename, int volume)
 {
     char path[256];
-    sprintf(path, "%s%s", AUDIOPATH, filename);
-    sound->chunk = Mix_LoadWAV(path);
-    if (sound->chunk == NULL)
+    snprintf(path, sizeof(path), "%s%s", AUDIOPATH, filename);
+    sound->volume = volume;
+    sound->priority = AUDIO_PRIORITY_DEFAULT;
+
+    CachedSound *unused = NULL;
+    for (int i=0; i<AUDIO_CACHE_SIZE; i++)
+    {
+        CachedSound *cached = &soundCache[i];
+        if (cached->references > 0 && strcmp(cached->path, path) == 0)
+        {
+            cached->references++;
+            sound->buffer = &cached->buffer;
+            LOG_TRACE("Reused sound file %s\n", path);
+            return 0;
+        }
+        if (cached->references == 0 && unused == NULL) unused = cached;
+    }
+    if (unused == NULL)
+    {
+        LOG_ERROR("Could not load sound file %s: more than %d sound files loaded\n", path, AUDIO_CACHE_SIZE);
+        return -1;
+    }
+
+    if (decodeSound(path, &unused->buffer) < 0)
     {
         LOG_ERROR("Could not load sound file %s\n", path);
         return -1;
     }
-    sound->volume = volume;
-    Mix_VolumeChunk(sound->chunk, volume);
-    LOG_TRACE("Loaded sound file %s\n", path);
+    strcpy(unused->path, path);
+    unused->references = 1;
+
+    sound->buffer = &unused->buffer;
+    LOG_TRACE("Loaded sound file %s (%u frames at %d Hz)\n", path, unused->buffer.frames, unused->buffer.rate);
     return 0;
 }
 
 void destroySound(Sound sound)
 {
-    Mix_FreeChunk(sound.chunk);
+    for (int i=0; i<AUDIO_CACHE_SIZE; i++)
+    {
+        CachedSound *cached = &soundCache[i];
+        if (cached->references == 0 || &cached->buffer != sound.buffer) continue;
+        if (--cached->references == 0)
+        {
+            // Voices still playing the samples are stopped first
+            if (mixer.open) SDL_LockAudioDevice(mixer.device);
+            for (int j=0; j<AUDIO_VIRTUAL_VOICES; j++)
+                if (mixer.voices[j].buffer == &cached->buffer) mixer.voices[j].buffer = NULL;
+            if (mixer.open) SDL_UnlockAudioDevice(mixer.device);
+
+            SDL_free(cached->buffer.samples);
+            cached->buffer.samples = NULL;
+        }
+        return;
+    }
+}
+
+
+/**
+ * @brief Decode the next samples of a stream into one of its buffers (streaming thread)
+ * 
+ * @param stream Pointer to the stream
+ * @param index Buffer to fill, must not be filled
+ * @return int Bytes decoded, 0 once the whole file was played
+*/
+static int fillStreamBuffer(Stream *stream, int index)
+{
+    Uint8 *buffer = stream->buffers[index];
+    int size = AUDIO_STREAM_FRAMES * mixer.frameSize;
+    int length = 0;
+
+    while (length < size)
+    {
+        if (SDL_AudioStreamAvailable(stream->converter) > 0)
+        {
+            int converted = SDL_AudioStreamGet(stream->converter, buffer + length, size - length);
+            if (converted <= 0) break;
+            length += converted;
+            continue;
+        }
+        if (stream->ended) break;
+
+        Uint8 decoded[AUDIO_DECODE_SIZE];
+        int decodedSize = readAudioDecoder(&stream->decoder, decoded, sizeof(decoded));
+        if (decodedSize > 0)
+        {
+            SDL_AudioStreamPut(stream->converter, decoded, decodedSize);
+            continue;
+        }
+
+        // End of the file, looping streams start again without a gap
+        if (decodedSize == 0 && stream->loop && rewindAudioDecoder(&stream->decoder) == 0) continue;
+        stream->ended = true;
+        SDL_AudioStreamFlush(stream->converter);
+    }
+
+    stream->lengths[index] = length;
+    if (length > 0) SDL_AtomicSet(&stream->filled[index], 1);
+    return length;
+}
+
+// Fill the buffers of the streams played that were done with
+static void fillStreams(void)
+{
+    SDL_LockMutex(mixer.lock);
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++)
+    {
+        Stream *stream = SDL_AtomicGetPtr(&mixer.streams[i]);
+        if (stream == NULL) continue;
+
+        for (int j=0; j<2; j++)
+            if (!SDL_AtomicGet(&stream->filled[j])) fillStreamBuffer(stream, j);
+
+        // Both buffers were played and nothing is left to decode
+        if (stream->ended && !SDL_AtomicGet(&stream->filled[0]) && !SDL_AtomicGet(&stream->filled[1]))
+            SDL_AtomicSet(&stream->playing, 0);
+    }
+    SDL_UnlockMutex(mixer.lock);
+}
+
+/**
+ * @brief Fill the buffers played by the audio thread, woken when a buffer is done
+*/
+static int streamThread(void *data)
+{
+    while (SDL_AtomicGet(&mixer.running))
+    {
+        SDL_SemWaitTimeout(mixer.wake, AUDIO_STREAM_POLL);
+        fillStreams();
+    }
+    return 0;
+}
+
+/**
+ * @brief Add frames to the output at constant gains
+ * 
+ * @param dest Stereo output
+ * @param src Interleaved samples, mono or stereo
+ * @param channels Number of channels of src
+ * @param frames Number of frames
+ * @param left Gain of the left side
+ * @param right Gain of the right side
+*/
+static void mixFrames(float *dest, const float *src, int channels, int frames, float left, float right)
+{
+    int i = 0;
+#if defined(__AVX__)
+    const __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    if (channels == 1)
+    {
+        // 8 mono frames make 16 stereo samples, unpacking works within each 128 bits half
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256 samples = _mm256_loadu_ps(src + i);
+            const __m256 low = _mm256_unpacklo_ps(samples, samples);
+            const __m256 high = _mm256_unpackhi_ps(samples, samples);
+            float *out = dest + 2 * i;
+            _mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out), _mm256_mul_ps(_mm256_permute2f128_ps(low, high, 0x20), gains)));
+            _mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_loadu_ps(out + 8), _mm256_mul_ps(_mm256_permute2f128_ps(low, high, 0x31), gains)));
+        }
+    }
+    else
+    {
+        for (; i + 4 <= frames; i += 4)
+        {
+            float *out = dest + 2 * i;
+            _mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out), _mm256_mul_ps(_mm256_loadu_ps(src + 2 * i), gains)));
+        }
+    }
+#elif defined(__SSE__)
+    const __m128 gains = _mm_setr_ps(left, right, left, right);
+    if (channels == 1)
+    {
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 samples = _mm_loadu_ps(src + i);
+            float *out = dest + 2 * i;
+            _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_unpacklo_ps(samples, samples), gains)));
+            _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(_mm_unpackhi_ps(samples, samples), gains)));
+        }
+    }
+    else
+    {
+        for (; i + 2 <= frames; i += 2)
+        {
+            float *out = dest + 2 * i;
+            _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_loadu_ps(src + 2 * i), gains)));
+        }
+    }
+#endif
+
+    for (; i < frames; i++)
+    {
+        dest[2 * i] += src[i * channels] * left;
+        dest[2 * i + 1] += src[i * channels + channels - 1] * right;
+    }
+}
+
+// Same as mixFrames, with gains going from one value to another over AUDIO_RAMP_FRAMES frames, offset frames in
+static void mixRamp(float *dest, const float *src, int channels, int frames, const float from[2], const float to[2], int offset)
+{
+    for (int i=0; i<frames; i++)
+    {
+        const float t = (float)(offset + i + 1) / AUDIO_RAMP_FRAMES;
+        dest[2 * i] += src[i * channels] * (from[0] + (to[0] - from[0]) * t);
+        dest[2 * i + 1] += src[i * channels + channels - 1] * (from[1] + (to[1] - from[1]) * t);
+    }
+}
+
+// Keep the sum of the voices in the range of the device
+static void clampOutput(float *dest, int count)
+{
+    int i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(dest + i), _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f)));
+#elif defined(__SSE__)
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dest + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(dest + i), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f)));
+#endif
+    for (; i < count; i++) dest[i] = glm_clamp(dest[i], -1.0f, 1.0f);
+}
+
+
+// Modified Bessel function of the first kind, for the Kaiser window
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k=1; k<32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Find the filter resampling a rate to the device rate, computed the first time
+ * 
+ * @param rate Rate of the sound
+ * @return int Index of the filter, -1 if the rate is the device rate or on failure
+ * 
+ * @note The audio device must be locked
+*/
+static int getResamplerFilter(int rate)
+{
+    if (rate == mixer.rate) return -1;
+    for (int i=0; i<mixer.filterCount; i++)
+        if (mixer.filters[i].rate == rate) return i;
+    if (mixer.filterCount == AUDIO_MAX_RATES)
+    {
+        LOG_ERROR("Could not resample %d Hz sounds: more than %d sample rates played\n", rate, AUDIO_MAX_RATES);
+        return -1;
+    }
+
+    float *coefficients = malloc((AUDIO_RESAMPLER_PHASES + 1) * AUDIO_RESAMPLER_TAPS * sizeof(float));
+    if (coefficients == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for the %d Hz resampler\n", rate);
+        return -1;
+    }
+
+    // Windowed sinc, its cutoff below the lowest of the two Nyquist frequencies so that downsampling does not alias
+    const double cutoff = 0.92 * (mixer.rate < rate ? (double)mixer.rate / rate : 1.0);
+    const double half = AUDIO_RESAMPLER_TAPS / 2;
+    for (int phase=0; phase<=AUDIO_RESAMPLER_PHASES; phase++)
+    {
+        float *row = coefficients + phase * AUDIO_RESAMPLER_TAPS;
+        double sum = 0.0;
+        for (int tap=0; tap<AUDIO_RESAMPLER_TAPS; tap++)
+        {
+            // Distance from the tap to the position resampled
+            const double t = tap - half + 1 - (double)phase / AUDIO_RESAMPLER_PHASES;
+            const double x = GLM_PI * cutoff * t;
+            const double sinc = fabs(x) < 1e-9 ? 1.0 : sin(x) / x;
+            const double window = fabs(t) < half ? besselI0(AUDIO_RESAMPLER_BETA * sqrt(1.0 - (t / half) * (t / half))) / besselI0(AUDIO_RESAMPLER_BETA) : 0.0;
+            row[tap] = (float)(cutoff * sinc * window);
+            sum += row[tap];
+        }
+        // Unit gain at every phase, and 16 bits samples scaled to [-1, 1]
+        for (int tap=0; tap<AUDIO_RESAMPLER_TAPS; tap++) row[tap] = (float)(row[tap] / (sum * 32768.0));
+    }
+
+    mixer.filters[mixer.filterCount] = (ResamplerFilter){rate, coefficients};
+    return mixer.filterCount++;
+}
+
+static void freeResamplerFilters(void)
+{
+    for (int i=0; i<mixer.filterCount; i++) free(mixer.filters[i].coefficients);
+    mixer.filterCount = 0;
+}
+
+// Source frame played a number of device frames after the start of a voice, and the fraction of frame past it in device frames
+static Uint64 getVoicePosition(const MixerVoice *voice, Uint64 elapsed, Uint32 *remainder)
+{
+    const Uint64 scaled = elapsed * voice->buffer->rate;
+    if (remainder != NULL) *remainder = (Uint32)(scaled % mixer.rate);
+    return voice->offset + scaled / mixer.rate;
+}
+
+/**
+ * @brief Filter one output frame from the taps around a source position
+ * 
+ * @param taps AUDIO_RESAMPLER_TAPS interleaved frames
+ * @param channels Number of channels
+ * @param row Coefficients of the phase before the position
+ * @param weight Fraction of the way to the next phase
+ * @param dest Set to the frame
+*/
+static void filterFrame(const Sint16 *taps, int channels, const float *row, float weight, float *dest)
+{
+    const float *next = row + AUDIO_RESAMPLER_TAPS;
+#if defined(__SSE2__)
+    const __m128 weights = _mm_set1_ps(weight);
+    __m128 sum = _mm_setzero_ps();
+    for (int tap=0; tap<AUDIO_RESAMPLER_TAPS; tap+=4)
+    {
+        const __m128 current = _mm_loadu_ps(row + tap);
+        const __m128 coefficients = _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(next + tap), current), weights));
+        // Sign extended to 32 bits by shifting the 16 bits samples into the high half
+        if (channels == 1)
+        {
+            const __m128i samples = _mm_loadl_epi64((const __m128i*)(taps + tap));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), coefficients));
+        }
+        else
+        {
+            const __m128i samples = _mm_loadu_si128((const __m128i*)(taps + 2 * tap));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), _mm_unpacklo_ps(coefficients, coefficients)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)), _mm_unpackhi_ps(coefficients, coefficients)));
+        }
+    }
+    // Mono adds the four lanes, stereo adds the left lanes and the right lanes
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    if (channels == 1) sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    dest[0] = _mm_cvtss_f32(sum);
+    if (channels == 2) dest[1] = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+#else
+    float sum[2] = {0.0f, 0.0f};
+    for (int tap=0; tap<AUDIO_RESAMPLER_TAPS; tap++)
+    {
+        const float coefficient = row[tap] + (next[tap] - row[tap]) * weight;
+        for (int c=0; c<channels; c++) sum[c] += taps[tap * channels + c] * coefficient;
+    }
+    for (int c=0; c<channels; c++) dest[c] = sum[c];
+#endif
+}
+
+/**
+ * @brief Resample the next frames of a voice to the device rate
+ * 
+ * @param voice Voice to render
+ * @param elapsed Device frames since the start of the voice
+ * @param count Frames to render, at most AUDIO_MIX_BLOCK
+ * @param dest Set to the interleaved frames, in the channels of the sound
+ * 
+ * @note Frames before the start and past the end of the voice are silent, loops wrap around
+*/
+static void renderVoice(const MixerVoice *voice, Uint64 elapsed, int count, float *dest)
+{
+    const SoundBuffer *buffer = voice->buffer;
+    const int channels = buffer->channels;
+    Uint32 remainder;
+    Uint64 position = getVoicePosition(voice, elapsed, &remainder);
+
+    // Same rate, the samples are only converted, up to the end of the sound or of the loop
+    if (voice->filter < 0)
+    {
+        int done = 0;
+        while (done < count && position < voice->length)
+        {
+            const Uint32 index = position % buffer->frames;
+            int size = glm_min(count - done, buffer->frames - index);
+            if ((Uint64)size > voice->length - position) size = voice->length - position;
+            const Sint16 *src = buffer->samples + index * channels;
+            for (int i=0; i<size * channels; i++) dest[done * channels + i] = src[i] / 32768.0f;
+            done += size;
+            position += size;
+        }
+        memset(dest + done * channels, 0, (count - done) * channels * sizeof(float));
+        return;
+    }
+
+    const float *coefficients = mixer.filters[voice->filter].coefficients;
+    Sint16 gathered[AUDIO_RESAMPLER_TAPS * 2];
+    for (int i=0; i<count; i++)
+    {
+        const Sint64 first = (Sint64)position - AUDIO_RESAMPLER_TAPS / 2 + 1;
+        const Sint16 *taps;
+        if (first >= 0 && (Uint64)first + AUDIO_RESAMPLER_TAPS <= voice->length && first % buffer->frames + AUDIO_RESAMPLER_TAPS <= buffer->frames)
+            taps = buffer->samples + (first % buffer->frames) * channels;
+        else
+        {
+            // Around the edges of the sound, or across a loop
+            for (int tap=0; tap<AUDIO_RESAMPLER_TAPS; tap++)
+            {
+                const Sint64 frame = first + tap;
+                for (int c=0; c<channels; c++)
+                    gathered[tap * channels + c] = frame >= 0 && (Uint64)frame < voice->length ? buffer->samples[(frame % buffer->frames) * channels + c] : 0;
+            }
+            taps = gathered;
+        }
+
+        const float phase = (float)remainder / mixer.rate * AUDIO_RESAMPLER_PHASES;
+        const int row = (int)phase;
+        filterFrame(taps, channels, coefficients + row * AUDIO_RESAMPLER_TAPS, phase - row, dest + i * channels);
+
+        remainder += buffer->rate;
+        while (remainder >= (Uint32)mixer.rate)
+        {
+            remainder -= mixer.rate;
+            position++;
+        }
+    }
+}
+
+
+// Gains of a voice from the listener, audibility is what it is ranked by
+static void updateVoiceTargets(MixerVoice *voice)
+{
+    if (!voice->spatial)
+    {
+        voice->targets[0] = voice->targets[1] = voice->audibility = voice->volume;
+        return;
+    }
+
+    vec3 offset;
+    glm_vec3_sub(voice->position, mixer.listener, offset);
+    const float distance = glm_vec3_norm(offset);
+    float attenuation = 1.0f;
+    if (distance >= AUDIO_MAX_DISTANCE) attenuation = 0.0f;
+    else if (distance > AUDIO_REFERENCE_DISTANCE) attenuation = AUDIO_REFERENCE_DISTANCE / (AUDIO_REFERENCE_DISTANCE + AUDIO_ROLLOFF * (distance - AUDIO_REFERENCE_DISTANCE));
+
+    // Equal power panning, a source straight ahead is 3 dB quieter on each side
+    const float pan = distance > 1e-4f ? glm_clamp(glm_vec3_dot(offset, mixer.right) / distance, -1.0f, 1.0f) : 0.0f;
+    const float angle = (pan + 1.0f) * GLM_PI_4f;
+    voice->audibility = voice->volume * attenuation;
+    voice->targets[0] = voice->audibility * cosf(angle);
+    voice->targets[1] = voice->audibility * sinf(angle);
+}
+
+// Negative if a is mixed before b : higher priority, then louder, then older, so that the order never depends on timing
+static int rankVoices(const MixerVoice *a, const MixerVoice *b)
+{
+    if (a->priority != b->priority) return a->priority > b->priority ? -1 : 1;
+    if (a->audibility != b->audibility) return a->audibility > b->audibility ? -1 : 1;
+    if (a->start != b->start) return a->start < b->start ? -1 : 1;
+    return a < b ? -1 : (a > b);
+}
+
+static int compareVoices(const void *a, const void *b)
+{
+    return rankVoices(&mixer.voices[*(const int*)a], &mixer.voices[*(const int*)b]);
+}
+
+/**
+ * @brief Add the next frames of a voice to the output
+ * 
+ * @param dest Stereo output
+ * @param frames Frames of the output
+ * @param voice Voice to mix
+ * @param from Gains at the end of the last mix
+ * @param to Gains reached after AUDIO_RAMP_FRAMES frames
+ * @param fadeOut Whether the voice stops once faded out
+*/
+static void mixVoice(float *dest, int frames, const MixerVoice *voice, const float from[2], const float to[2], bool fadeOut)
+{
+    const int channels = voice->buffer->channels;
+    const int ramp = (from[0] != to[0] || from[1] != to[1]) ? AUDIO_RAMP_FRAMES : 0;
+    Uint64 count = voice->end - mixer.frame;
+    if (count > (Uint64)frames) count = frames;
+    if (fadeOut && count > AUDIO_RAMP_FRAMES) count = AUDIO_RAMP_FRAMES;
+
+    // Resampled in blocks small enough to stay in cache, then panned into the output
+    float block[AUDIO_MIX_BLOCK * 2];
+    int done = 0;
+    while (done < (int)count)
+    {
+        const int size = glm_min((int)count - done, AUDIO_MIX_BLOCK);
+        renderVoice(voice, mixer.frame - voice->start + done, size, block);
+
+        int ramped = 0;
+        if (done < ramp)
+        {
+            ramped = glm_min(size, ramp - done);
+            mixRamp(dest + 2 * done, block, channels, ramped, from, to, done);
+        }
+        mixFrames(dest + 2 * (done + ramped), block + ramped * channels, channels, size - ramped, to[0], to[1]);
+        done += size;
+    }
+}
+
+/**
+ * @brief Mix the streams played into the output (audio thread)
+ * 
+ * @param dest Stereo output
+ * @param frames Frames of the output
+*/
+static void mixStreams(float *dest, int frames)
+{
+    const int length = frames * mixer.frameSize;
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++)
+    {
+        Stream *stream = SDL_AtomicGetPtr(&mixer.streams[i]);
+        if (stream == NULL || !SDL_AtomicGet(&stream->playing)) continue;
+
+        const float volume = stream->volume / (float)AUDIO_MAX_VOLUME;
+        int mixed = 0;
+        while (mixed < length)
+        {
+            int front = stream->front;
+            // Underrun, the rest of the output stays silent
+            if (!SDL_AtomicGet(&stream->filled[front])) break;
+
+            int size = stream->lengths[front] - stream->position;
+            if (size > length - mixed) size = length - mixed;
+            mixFrames(dest + mixed / sizeof(float), (const float*)(stream->buffers[front] + stream->position), 2, size / mixer.frameSize, volume, volume);
+            mixed += size;
+            stream->position += size;
+
+            if (stream->position >= stream->lengths[front])
+            {
+                stream->position = 0;
+                stream->front = 1 - front;
+                SDL_AtomicSet(&stream->filled[front], 0);
+                SDL_SemPost(mixer.wake);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Callback of the audio device, mixes the voices and the streams
+ * 
+ * @note Runs with the audio device locked
+*/
+static void mixAudio(void *data, Uint8 *output, int size)
+{
+    float *dest = (float*)output;
+    const int frames = size / mixer.frameSize;
+    memset(output, 0, size);
+
+    // Only the AUDIO_VOICES first audible voices are mixed, the others go on silently
+    int ranked[AUDIO_VIRTUAL_VOICES];
+    int count = 0;
+    for (int i=0; i<AUDIO_VIRTUAL_VOICES; i++)
+    {
+        MixerVoice *voice = &mixer.voices[i];
+        if (voice->buffer == NULL) continue;
+        updateVoiceTargets(voice);
+        if (voice->audibility > 0.0f) ranked[count++] = i;
+    }
+    qsort(ranked, count, sizeof(int), compareVoices);
+    bool mixed[AUDIO_VIRTUAL_VOICES] = {false};
+    for (int i=0; i<count && i<AUDIO_VOICES; i++) mixed[ranked[i]] = true;
+
+    const float silent[2] = {0.0f, 0.0f};
+    for (int i=0; i<AUDIO_VIRTUAL_VOICES; i++)
+    {
+        MixerVoice *voice = &mixer.voices[i];
+        if (voice->buffer == NULL) continue;
+        if (mixed[i])
+        {
+            // Sounds starting now have nothing to ramp from
+            if (voice->start == mixer.frame) memcpy(voice->gains, voice->targets, sizeof(voice->gains));
+            mixVoice(dest, frames, voice, voice->gains, voice->targets, false);
+            memcpy(voice->gains, voice->targets, sizeof(voice->gains));
+        }
+        else if (voice->gains[0] != 0.0f || voice->gains[1] != 0.0f)
+        {
+            // Voice stolen or out of range, faded out so that it does not click
+            mixVoice(dest, frames, voice, voice->gains, silent, true);
+            voice->gains[0] = voice->gains[1] = 0.0f;
+        }
+    }
+    mixStreams(dest, frames);
+    clampOutput(dest, frames * 2);
+
+    mixer.frame += frames;
+    for (int i=0; i<AUDIO_VIRTUAL_VOICES; i++)
+    {
+        MixerVoice *voice = &mixer.voices[i];
+        if (voice->buffer != NULL && mixer.frame >= voice->end) voice->buffer = NULL;
+    }
+}
+
+
+// Voice of a handle, NULL if it ended or was reused, the audio device must be locked
+static MixerVoice* getVoice(int handle)
+{
+    if (handle < 0) return NULL;
+    MixerVoice *voice = &mixer.voices[handle % AUDIO_VIRTUAL_VOICES];
+    if (voice->buffer == NULL || (voice->generation & 0x7fff) != handle / AUDIO_VIRTUAL_VOICES) return NULL;
+    return voice;
+}
+
+/**
+ * @brief Start a voice, stealing the lowest ranked one if every voice is used
+ * 
+ * @param sound Sound to play
+ * @param position Position of the source, NULL to play it at the listener
+ * @param loops Number of times to loop the sound
+ * @return int Handle of the voice, -1 if the sound ranks below every voice playing
+*/
+static int startVoice(Sound sound, const float *position, unsigned int loops)
+{
+    if (!mixer.open || sound.buffer == NULL || sound.buffer->frames == 0) return -1;
+
+    MixerVoice voice = {
+        .buffer = sound.buffer,
+        .length = (Uint64)sound.buffer->frames * ((Uint64)loops + 1),
+        .spatial = position != NULL,
+        .volume = (sound.volume < 0 ? AUDIO_MAX_VOLUME : sound.volume) / (float)AUDIO_MAX_VOLUME,
+        .priority = sound.priority
+    };
+    if (position != NULL) glm_vec3_copy((float*)position, voice.position);
+
+    SDL_LockAudioDevice(mixer.device);
+    voice.start = mixer.frame;
+    voice.end = voice.start + (voice.length * mixer.rate + sound.buffer->rate - 1) / sound.buffer->rate;
+    voice.filter = getResamplerFilter(sound.buffer->rate);
+    if (voice.filter < 0 && sound.buffer->rate != mixer.rate)
+    {
+        SDL_UnlockAudioDevice(mixer.device);
+        return -1;
+    }
+    updateVoiceTargets(&voice);
+
+    int slot = -1;
+    for (int i=0; i<AUDIO_VIRTUAL_VOICES && slot < 0; i++)
+        if (mixer.voices[i].buffer == NULL) slot = i;
+    if (slot < 0)
+    {
+        slot = 0;
+        for (int i=1; i<AUDIO_VIRTUAL_VOICES; i++)
+            if (rankVoices(&mixer.voices[i], &mixer.voices[slot]) > 0) slot = i;
+        // Equal sounds keep the ones already playing
+        if (rankVoices(&voice, &mixer.voices[slot]) > 0)
+        {
+            SDL_UnlockAudioDevice(mixer.device);
+            return -1;
+        }
+    }
+    voice.generation = mixer.voices[slot].generation + 1;
+    mixer.voices[slot] = voice;
+    SDL_UnlockAudioDevice(mixer.device);
+
+    return slot + AUDIO_VIRTUAL_VOICES * (voice.generation & 0x7fff);
+}
+
+int playSound(Sound sound, unsigned int loops)
+{
+    return startVoice(sound, NULL, loops);
+}
+
+int playSoundAt(Sound sound, vec3 position, unsigned int loops)
+{
+    return startVoice(sound, position, loops);
+}
+
+void moveVoice(int voice, vec3 position)
+{
+    if (!mixer.open) return;
+    SDL_LockAudioDevice(mixer.device);
+    MixerVoice *mixerVoice = getVoice(voice);
+    if (mixerVoice != NULL && mixerVoice->spatial) glm_vec3_copy(position, mixerVoice->position);
+    SDL_UnlockAudioDevice(mixer.device);
+}
+
+void stopVoice(int voice)
+{
+    if (!mixer.open) return;
+    SDL_LockAudioDevice(mixer.device);
+    MixerVoice *mixerVoice = getVoice(voice);
+    if (mixerVoice != NULL) mixerVoice->buffer = NULL;
+    SDL_UnlockAudioDevice(mixer.device);
+}
+
+void setListener(vec3 position, vec3 forward, vec3 up)
+{
+    vec3 right;
+    glm_vec3_crossn(forward, up, right);
+
+    if (mixer.open) SDL_LockAudioDevice(mixer.device);
+    glm_vec3_copy(position, mixer.listener);
+    glm_vec3_copy(right, mixer.right);
+    if (mixer.open) SDL_UnlockAudioDevice(mixer.device);
+}
+
+
+/**
+ * @brief Convert a stream to the current device rate, the audio buffered is dropped
+ * 
+ * @param stream Pointer to the stream, not played by the audio thread
+ * @return int 0 on success, -1 on failure
+*/
+static int resetStreamConverter(Stream *stream)
+{
+    SDL_AudioStream *converter = SDL_NewAudioStream(stream->decoder.format, stream->decoder.channels, stream->decoder.rate, mixer.format, mixer.channels, mixer.rate);
+    if (converter == NULL)
+    {
+        LOG_ERROR("Could not convert stream: %s\n", SDL_GetError());
+        return -1;
+    }
+    if (stream->converter != NULL) SDL_FreeAudioStream(stream->converter);
+    stream->converter = converter;
+    stream->rate = mixer.rate;
+
+    SDL_AtomicSet(&stream->filled[0], 0);
+    SDL_AtomicSet(&stream->filled[1], 0);
+    stream->front = 0;
+    stream->position = 0;
+    fillStreamBuffer(stream, 0);
+    fillStreamBuffer(stream, 1);
+    return 0;
+}
+
+int openStream(Stream *stream, char *filename, int volume, bool loop)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s", AUDIOPATH, filename);
+    memset(stream, 0, sizeof(Stream));
+    stream->slot = -1;
+    stream->volume = volume < 0 ? AUDIO_MAX_VOLUME : volume;
+    stream->loop = loop;
+
+    if (!mixer.open)
+    {
+        LOG_ERROR("Could not open stream %s: the mixer is not initialized\n", path);
+        return -1;
+    }
+    if (openAudioDecoder(&stream->decoder, path) < 0) return -1;
+
+    for (int i=0; i<2; i++)
+    {
+        stream->buffers[i] = malloc(AUDIO_STREAM_FRAMES * mixer.frameSize);
+        if (stream->buffers[i] == NULL)
+        {
+            LOG_ERROR("Failed to allocate memory for stream %s\n", path);
+            closeStream(stream);
+            closeAudioDecoder(&stream->decoder);
+            return -1;
+        }
+    }
+
+    // Not played yet, so the buffers can be filled from here
+    if (resetStreamConverter(stream) < 0)
+    {
+        closeStream(stream);
+        closeAudioDecoder(&stream->decoder);
+        return -1;
+    }
+
+    LOG_TRACE("Opened stream %s\n", path);
+    return 0;
+}
+
+int playStream(Stream *stream)
+{
+    if (!mixer.open)
+    {
+        LOG_ERROR("Could not play stream: the mixer is not initialized\n");
+        return -1;
+    }
+    SDL_LockMutex(mixer.lock);
+
+    // Played through, start again
+    if (stream->ended && !SDL_AtomicGet(&stream->playing) && !SDL_AtomicGet(&stream->filled[0]) && !SDL_AtomicGet(&stream->filled[1]))
+    {
+        if (rewindAudioDecoder(&stream->decoder) == 0)
+        {
+            SDL_AudioStreamClear(stream->converter);
+            stream->ended = false;
+            stream->front = 0;
+            stream->position = 0;
+            fillStreamBuffer(stream, 0);
+            fillStreamBuffer(stream, 1);
+        }
+    }
+    // Opened before the device rate changed, streams played at the time were converted by configureMixer
+    else if (stream->slot < 0 && stream->rate != mixer.rate) resetStreamConverter(stream);
+
+    if (stream->slot < 0)
+    {
+        for (int i=0; i<AUDIO_MAX_STREAMS && stream->slot < 0; i++)
+            if (SDL_AtomicCASPtr(&mixer.streams[i], NULL, stream)) stream->slot = i;
+    }
+    SDL_UnlockMutex(mixer.lock);
+
+    if (stream->slot < 0)
+    {
+        LOG_ERROR("Could not play stream: more than %d streams played\n", AUDIO_MAX_STREAMS);
+        return -1;
+    }
+    SDL_AtomicSet(&stream->playing, 1);
+    return 0;
+}
+
+void pauseStream(Stream *stream)
+{
+    SDL_AtomicSet(&stream->playing, 0);
+}
+
+void closeStream(Stream *stream)
+{
+    SDL_AtomicSet(&stream->playing, 0);
+    // Once the mixer is closed, no thread reads the stream anymore
+    if (stream->slot >= 0 && mixer.open)
+    {
+        // Once unlocked the streaming thread no longer sees the stream
+        SDL_LockMutex(mixer.lock);
+        SDL_AtomicCASPtr(&mixer.streams[stream->slot], stream, NULL);
+        SDL_UnlockMutex(mixer.lock);
+
+        // The callback runs with the device locked, so it is done with the stream once the lock is taken
+        SDL_LockAudioDevice(mixer.device);
+        SDL_UnlockAudioDevice(mixer.device);
+    }
+    stream->slot = -1;
+
+    for (int i=0; i<2; i++)
+    {
+        free(stream->buffers[i]);
+        stream->buffers[i] = NULL;
+    }
+    if (stream->converter != NULL)
+    {
+        SDL_FreeAudioStream(stream->converter);
+        stream->converter = NULL;
+        closeAudioDecoder(&stream->decoder);
+    }
 }
 
-void playSound(Sound sound, unsigned int loops)
+
+/**
+ * @brief Open the audio device, mixed in float stereo, SDL converts to what the device plays
+ * 
+ * @param rate Frequency of the device in Hz
+ * @param frames Frames mixed at once
+ * @return int 0 on success, -1 on failure
+*/
+static int openAudioDevice(int rate, int frames)
 {
-    Mix_PlayChannel(-1, sound.chunk, loops);
+    SDL_AudioSpec spec = {0};
+    spec.freq = rate;
+    spec.format = AUDIO_F32SYS;
+    spec.channels = 2;
+    spec.samples = frames;
+    spec.callback = mixAudio;
+    mixer.device = SDL_OpenAudioDevice(NULL, 0, &spec, NULL, 0);
+    if (mixer.device == 0)
+    {
+        LOG_ERROR("Could not open audio device at %d Hz, %d frames: %s\n", rate, frames, SDL_GetError());
+        return -1;
+    }
+    mixer.rate = spec.freq;
+    mixer.frames = spec.samples;
+    mixer.format = spec.format;
+    mixer.channels = spec.channels;
+    mixer.frameSize = spec.channels * sizeof(float);
+    mixer.frame = 0;
+    return 0;
 }
 
-int initMixer(int numchans)
+int initMixer(int rate, int frames)
 {
-    if (Mix_OpenAudio(AUDIO_SAMPLERATE, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, AUDIO_CHUNKSIZE) < 0)
+    memset(mixer.voices, 0, sizeof(mixer.voices));
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++) mixer.streams[i] = NULL;
+    if (openAudioDevice(rate, frames) < 0) return -1;
+
+    mixer.wake = SDL_CreateSemaphore(0);
+    mixer.lock = SDL_CreateMutex();
+    if (mixer.wake == NULL || mixer.lock == NULL)
+    {
+        LOG_ERROR("Could not create audio streaming locks: %s\n", SDL_GetError());
+        closeMixer();
+        return -1;
+    }
+    SDL_AtomicSet(&mixer.running, 1);
+    mixer.thread = SDL_CreateThread(streamThread, "audio streaming", NULL);
+    if (mixer.thread == NULL)
     {
-        LOG_ERROR("Could not initialize audio: %s\n", Mix_GetError());
+        LOG_ERROR("Could not start audio streaming thread: %s\n", SDL_GetError());
+        closeMixer();
         return -1;
     }
-    Mix_AllocateChannels(numchans);
-    LOG_DEBUG("Initialized audio\n");
+    mixer.open = true;
+    SDL_PauseAudioDevice(mixer.device, 0);
+    LOG_DEBUG("Initialized audio (%d Hz, %d frames, %d voices mixed out of %d)\n", mixer.rate, mixer.frames, AUDIO_VOICES, AUDIO_VIRTUAL_VOICES);
 
     return 0;
-}
\ No newline at end of file
+}
+
+int initOfflineMixer(int rate)
+{
+    memset(mixer.voices, 0, sizeof(mixer.voices));
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++) mixer.streams[i] = NULL;
+    mixer.device = 0;
+    mixer.rate = rate;
+    mixer.frames = 0;
+    mixer.format = AUDIO_F32SYS;
+    mixer.channels = 2;
+    mixer.frameSize = mixer.channels * sizeof(float);
+    mixer.frame = 0;
+
+    mixer.lock = SDL_CreateMutex();
+    if (mixer.lock == NULL)
+    {
+        LOG_ERROR("Could not create audio streaming lock: %s\n", SDL_GetError());
+        return -1;
+    }
+    mixer.open = true;
+    LOG_DEBUG("Initialized offline audio (%d Hz)\n", mixer.rate);
+    return 0;
+}
+
+void renderMixer(float *dest, int frames)
+{
+    if (!mixer.open || mixer.device != 0)
+    {
+        LOG_ERROR("Could not render audio: the mixer is not offline\n");
+        memset(dest, 0, frames * 2 * sizeof(float));
+        return;
+    }
+    // The streams are decoded in between, rather than by the streaming thread
+    mixAudio(NULL, (Uint8*)dest, frames * mixer.frameSize);
+    fillStreams();
+}
+
+int configureMixer(int rate, int frames)
+{
+    if (!mixer.open)
+    {
+        LOG_ERROR("Could not configure audio: the mixer is not initialized\n");
+        return -1;
+    }
+    if (mixer.device == 0)
+    {
+        LOG_ERROR("Could not configure audio: the mixer is offline\n");
+        return -1;
+    }
+    if (rate == mixer.rate && frames == mixer.frames) return 0;
+
+    // Nothing reads the voices and streams while the device is closed
+    SDL_LockMutex(mixer.lock);
+    SDL_CloseAudioDevice(mixer.device);
+    const int previousRate = mixer.rate, previousFrames = mixer.frames;
+    const Uint64 previousFrame = mixer.frame;
+
+    int status = openAudioDevice(rate, frames);
+    if (status < 0 && openAudioDevice(previousRate, previousFrames) < 0)
+    {
+        SDL_UnlockMutex(mixer.lock);
+        closeMixer();
+        return -1;
+    }
+
+    // Voices are rebased on the new clock, from where they were on the old one
+    freeResamplerFilters();
+    for (int i=0; i<AUDIO_VIRTUAL_VOICES; i++)
+    {
+        MixerVoice *voice = &mixer.voices[i];
+        if (voice->buffer == NULL) continue;
+        const Uint64 scaled = (previousFrame - voice->start) * voice->buffer->rate;
+        voice->offset += scaled / previousRate;
+        voice->start = 0;
+        voice->end = voice->offset >= voice->length ? 0 : ((voice->length - voice->offset) * mixer.rate + voice->buffer->rate - 1) / voice->buffer->rate;
+        voice->filter = getResamplerFilter(voice->buffer->rate);
+        if (voice->filter < 0 && voice->buffer->rate != mixer.rate) voice->buffer = NULL;
+    }
+
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++)
+    {
+        Stream *stream = mixer.streams[i];
+        if (stream != NULL) resetStreamConverter(stream);
+    }
+    SDL_UnlockMutex(mixer.lock);
+
+    SDL_PauseAudioDevice(mixer.device, 0);
+    if (status == 0) LOG_INFO("Audio configured at %d Hz, %d frames\n", mixer.rate, mixer.frames);
+    return status;
+}
+
+void closeMixer(void)
+{
+    if (mixer.thread != NULL)
+    {
+        SDL_AtomicSet(&mixer.running, 0);
+        SDL_SemPost(mixer.wake);
+        SDL_WaitThread(mixer.thread, NULL);
+        mixer.thread = NULL;
+    }
+    if (mixer.device != 0)
+    {
+        SDL_CloseAudioDevice(mixer.device);
+        mixer.device = 0;
+    }
+    freeResamplerFilters();
+
+    // Sounds and streams destroyed afterwards no longer touch the mixer
+    mixer.open = false;
+    memset(mixer.voices, 0, sizeof(mixer.voices));
+    for (int i=0; i<AUDIO_MAX_STREAMS; i++) mixer.streams[i] = NULL;
+    if (mixer.wake != NULL) SDL_DestroySemaphore(mixer.wake);
+    if (mixer.lock != NULL) SDL_DestroyMutex(mixer.lock);
+    mixer.wake = NULL;
+    mixer.lock = NULL;
+    LOG_DEBUG("Closed audio\n");
+}
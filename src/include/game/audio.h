@@ -8,29 +8,172 @@
 #include <string.h>
 
 
-#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL.h>
+#include <cglm/cglm.h>
+#include <vorbis/vorbisfile.h>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
 
 #include "logs.h"
 
 
-#define AUDIO_SAMPLERATE 96000  // Sample frequency in Hz
-#define AUDIO_CHUNKSIZE 2048  // Buffer size
-#define AUDIO_NUMCHANS 16  // Number of channels
+#define AUDIO_SAMPLERATE 48000  // Default frequency of the device in Hz, sounds keep their own
+#define AUDIO_MAX_VOLUME 128
+
+#define AUDIO_VOICES 32  // Voices mixed at once, the least audible others play silently
+#define AUDIO_VIRTUAL_VOICES 256  // Sounds playing at once, mixed or not
+#define AUDIO_RAMP_FRAMES 64  // Frames over which the gains of a voice change, so that panning and stolen voices do not click
+#define AUDIO_REFERENCE_DISTANCE 2.0f  // Sounds closer than this are heard at full volume
+#define AUDIO_ROLLOFF 1.0f  // How fast sounds fade past the reference distance
+#define AUDIO_MAX_DISTANCE 60.0f  // Sounds further than this are silent
+#define AUDIO_PRIORITY_DEFAULT 0  // Voices with a higher priority are mixed first, whatever their volume
+
+#define AUDIO_RESAMPLER_TAPS 16  // Source frames each output frame is filtered from, a multiple of 4
+#define AUDIO_RESAMPLER_PHASES 128  // Fractional positions the filter is computed at, interpolated in between
+#define AUDIO_RESAMPLER_BETA 7.0  // Kaiser window of the filter, higher rejects more aliasing but blurs the cutoff
+#define AUDIO_MAX_RATES 8  // Different sample rates of the sounds played, each has its own filter
+#define AUDIO_MIX_BLOCK 256  // Frames of a voice resampled at once before being mixed
+
+#define AUDIO_CACHE_SIZE 64  // Sound files decoded at once, shared by the sounds using them
+#define AUDIO_MAX_STREAMS 4  // Streams played at once (music, ambience)
+#define AUDIO_STREAM_FRAMES 16384  // Frames of each of the two buffers of a stream, in the device format
+#define AUDIO_DECODE_SIZE 8192  // Bytes decoded at once
+#define AUDIO_STREAM_POLL 20  // Milliseconds between two checks of the streams, when no buffer was played
 
 #define AUDIOPATH "assets/sounds/"
 
 
+// Encodings a decoder can read
+typedef enum {
+    DECODER_WAV,  // Loaded whole, for short files
+    DECODER_VORBIS  // Ogg Vorbis, decoded as it is read
+} DecoderType;
+
+/**
+ * @brief Audio file being decoded
+ * 
+ * @param type Encoding of the file
+ * @param format Format of the decoded samples (SDL audio format)
+ * @param channels Number of interleaved channels
+ * @param rate Sample frequency in Hz
+ * @param vorbis Ogg Vorbis file (DECODER_VORBIS)
+ * @param wav Samples, length and read position in bytes (DECODER_WAV)
+*/
+typedef struct {
+    DecoderType type;
+    SDL_AudioFormat format;
+    int channels;
+    int rate;
+
+    OggVorbis_File vorbis;
+    struct {
+        Uint8 *data;
+        Uint32 length;
+        Uint32 position;
+    } wav;
+} AudioDecoder;
+
+/**
+ * @brief Decoded samples of a sound file, 16 bits at the rate of the file
+ * 
+ * @param samples Interleaved samples
+ * @param frames Number of frames
+ * @param channels Number of channels, 1 or 2
+ * @param rate Sample frequency in Hz, resampled to the device rate while mixed
+*/
+typedef struct {
+    Sint16 *samples;
+    Uint32 frames;
+    int channels;
+    int rate;
+} SoundBuffer;
+
 /**
  * @brief Sound object
  * 
- * @param chunk Pointer to the Mix_Chunk object
+ * @param buffer Samples of the sound, shared by the sounds of the same file
  * @param volume The volume of the sound
+ * @param priority Voices of sounds with a higher priority are stolen last
 */
 typedef struct {
-    Mix_Chunk *chunk;
+    const SoundBuffer *buffer;
     int volume;
+    int priority;
 } Sound;
 
+/**
+ * @brief Long sound streamed from its file (music, ambience), decoded by a background thread
+ * 
+ * @param decoder File being decoded
+ * @param converter Converts the decoded samples to the device format
+ * @param buffers Two buffers in the device format, one is played while the other is filled
+ * @param lengths Bytes of each buffer
+ * @param filled Whether each buffer is ready to be played
+ * @param front Buffer being played (audio thread)
+ * @param position Read position in the buffer being played (audio thread)
+ * @param slot Index in the streams played, -1 if not played
+ * @param volume Volume of the stream, 0 to AUDIO_MAX_VOLUME
+ * @param loop Whether the stream starts again at the end of the file
+ * @param ended Whether the whole file was decoded (streaming thread)
+ * @param rate Device rate the buffers were converted to
+ * @param playing Whether the stream is heard
+*/
+typedef struct {
+    AudioDecoder decoder;
+    SDL_AudioStream *converter;
+    Uint8 *buffers[2];
+    int lengths[2];
+    SDL_atomic_t filled[2];
+    int front;
+    int position;
+
+    int slot;
+    int volume;
+    bool loop;
+    bool ended;
+    int rate;
+    SDL_atomic_t playing;
+} Stream;
+
+
+/**
+ * @brief Open an audio file for decoding
+ * 
+ * @param decoder Pointer to the decoder
+ * @param path Path to the file
+ * @return int 0 on success, -1 on failure
+ * 
+ * @note The encoding is found from the content of the file, WAV or Ogg Vorbis
+*/
+int openAudioDecoder(AudioDecoder *decoder, const char *path);
+
+/**
+ * @brief Decode the next samples of a file
+ * 
+ * @param decoder Pointer to the decoder
+ * @param dest Destination of the interleaved samples, in decoder->format
+ * @param size Size of dest in bytes
+ * @return int Bytes decoded, 0 at the end of the file, -1 on failure
+*/
+int readAudioDecoder(AudioDecoder *decoder, Uint8 *dest, int size);
+
+/**
+ * @brief Go back to the start of the file
+ * 
+ * @param decoder Pointer to the decoder
+ * @return int 0 on success, -1 on failure
+*/
+int rewindAudioDecoder(AudioDecoder *decoder);
+
+/**
+ * @brief Close an audio file
+ * 
+ * @param decoder Pointer to the decoder
+*/
+void closeAudioDecoder(AudioDecoder *decoder);
+
 
 /**
  * @brief Loads an audio file
@@ -40,7 +183,7 @@ typedef struct {
  * @param volume The volume of the sound
  * @return int 0 on success, -1 on failure
  * 
- * @note The file must be a WAV file
+ * @note The file can be a WAV or an Ogg Vorbis file, it is decoded once and shared by the sounds loading it
  * @note Set volume to -1 to use default volume
 */
 int loadSound(Sound *sound, char* filename, int volume);
@@ -53,21 +196,137 @@ int loadSound(Sound *sound, char* filename, int volume);
 void destroySound(Sound sound);
 
 /**
- * @brief Plays a sound
+ * @brief Plays a sound at the listener, on both sides
  * 
- * @param sound Pointer to the Sound object to play
+ * @param sound Sound object to play
  * @param loops Number of times to loop the sound
+ * @return int Voice playing the sound, -1 if no voice was available
 */
-void playSound(Sound sound, unsigned int loops);
+int playSound(Sound sound, unsigned int loops);
 
+/**
+ * @brief Plays a sound from a point of the world, attenuated and panned from the listener
+ * 
+ * @param sound Sound object to play
+ * @param position Position of the source
+ * @param loops Number of times to loop the sound
+ * @return int Voice playing the sound, -1 if no voice was available
+ * 
+ * @note When every voice is used, the voice with the lowest priority, then the least audible, is stolen if it ranks below the sound
+*/
+int playSoundAt(Sound sound, vec3 position, unsigned int loops);
 
 /**
- * @brief Initializes the audio mixer
+ * @brief Move the source of a voice
  * 
- * @param numchans The number of channels to initialize
+ * @param voice Voice returned by playSoundAt
+ * @param position New position of the source
+ * 
+ * @note Does nothing if the voice ended or was stolen
+*/
+void moveVoice(int voice, vec3 position);
+
+/**
+ * @brief Stop a voice
+ * 
+ * @param voice Voice returned by playSound or playSoundAt
+ * 
+ * @note Does nothing if the voice ended or was stolen
+*/
+void stopVoice(int voice);
+
+/**
+ * @brief Set where sounds are heard from
+ * 
+ * @param position Position of the listener
+ * @param forward Direction the listener looks at
+ * @param up Up direction of the listener
+*/
+void setListener(vec3 position, vec3 forward, vec3 up);
+
+
+/**
+ * @brief Open a stream, the first buffers are decoded right away
+ * 
+ * @param stream Pointer to the stream
+ * @param filename The name of the file to stream
+ * @param volume Volume of the stream, -1 for the default volume
+ * @param loop Whether the stream starts again at the end of the file
  * @return int 0 on success, -1 on failure
+ * 
+ * @note The mixer must be initialized
+*/
+int openStream(Stream *stream, char *filename, int volume, bool loop);
+
+/**
+ * @brief Start or resume playing a stream
+ * 
+ * @param stream Pointer to the stream
+ * @return int 0 on success, -1 on failure (too many streams played)
+*/
+int playStream(Stream *stream);
+
+/**
+ * @brief Pause a stream, it resumes where it stopped
+ * 
+ * @param stream Pointer to the stream
+*/
+void pauseStream(Stream *stream);
+
+/**
+ * @brief Close a stream
+ * 
+ * @param stream Pointer to the stream
+*/
+void closeStream(Stream *stream);
+
+
+/**
+ * @brief Opens the audio device, mixed by the engine, and the thread decoding the streams
+ * 
+ * @param rate Frequency of the device in Hz
+ * @param frames Frames mixed at once, the latency of the device
+ * @return int 0 on success, -1 on failure
+ * 
+ * @note Voices and streams are mixed in float, in the callback of the device
+*/
+int initMixer(int rate, int frames);
+
+/**
+ * @brief Initialize the mixer without an audio device, its frames are mixed when asked with renderMixer
+ * 
+ * @param rate Frequency the frames are mixed at in Hz
+ * @return int 0 on success, -1 on failure
+ * 
+ * @note For offline rendering and benchmarks, closed with closeMixer
+*/
+int initOfflineMixer(int rate);
+
+/**
+ * @brief Mix the next frames of an offline mixer, as the callback of the device would
+ * 
+ * @param dest Set to the interleaved stereo frames
+ * @param frames Number of frames
+*/
+void renderMixer(float *dest, int frames);
+
+/**
+ * @brief Reopens the audio device with another frequency or buffer size
+ * 
+ * @param rate Frequency of the device in Hz
+ * @param frames Frames mixed at once, the latency of the device
+ * @return int 0 on success, -1 on failure (the previous configuration is kept if possible)
+ * 
+ * @note Voices go on where they were, streams skip the audio they had buffered
+*/
+int configureMixer(int rate, int frames);
+
+/**
+ * @brief Stop the streams and close the audio device
+ * 
+ * @note Sounds and streams can still be destroyed afterwards
 */
-int initMixer(int numchans);
+void closeMixer(void);
 
 
 #endif
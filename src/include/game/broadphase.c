@@ -0,0 +1,459 @@
+#include "broadphase.h"
+
+
+/* --- STORAGE --- */
+
+static int growBodies(Broadphase *broadphase, unsigned int count)
+{
+    if (count <= broadphase->bodyCapacity) return 0;
+    unsigned int capacity = broadphase->bodyCapacity ? broadphase->bodyCapacity : 64;
+    while (capacity < count) capacity *= 2;
+
+    vec3 (*boxes)[2] = realloc(broadphase->boxes, capacity * sizeof(vec3[2]));
+    bool *alive = realloc(broadphase->alive, capacity * sizeof(bool));
+    unsigned int *freeBodies = realloc(broadphase->freeBodies, capacity * sizeof(unsigned int));
+    unsigned int *active = realloc(broadphase->active, capacity * sizeof(unsigned int));
+    unsigned int *activeSlots = realloc(broadphase->activeSlots, capacity * sizeof(unsigned int));
+    vec3 (*activeBoxes)[2] = realloc(broadphase->activeBoxes, capacity * sizeof(vec3[2]));
+    uint64_t *endpoints = realloc(broadphase->endpoints, 2 * capacity * sizeof(uint64_t));
+    if (boxes) broadphase->boxes = boxes;
+    if (alive) broadphase->alive = alive;
+    if (freeBodies) broadphase->freeBodies = freeBodies;
+    if (active) broadphase->active = active;
+    if (activeSlots) broadphase->activeSlots = activeSlots;
+    if (activeBoxes) broadphase->activeBoxes = activeBoxes;
+    if (endpoints) broadphase->endpoints = endpoints;
+    if (!boxes || !alive || !freeBodies || !active || !activeSlots || !activeBoxes || !endpoints) {LOG_ERROR("Could not allocate %d broadphase bodies\n", capacity); return -1;}
+
+    broadphase->bodyCapacity = capacity;
+    broadphase->endpointCapacity = 2 * capacity;
+    return 0;
+}
+
+static int growArray(void **array, unsigned int *capacity, unsigned int count, size_t size)
+{
+    if (count <= *capacity) return 0;
+    unsigned int newCapacity = *capacity ? *capacity : 64;
+    while (newCapacity < count) newCapacity *= 2;
+
+    void *grown = realloc(*array, newCapacity * size);
+    if (!grown) {LOG_ERROR("Could not grow broadphase array to %d elements\n", newCapacity); return -1;}
+    *array = grown;
+    *capacity = newCapacity;
+    return 0;
+}
+
+static int pushPair(Broadphase *broadphase, unsigned int a, unsigned int b)
+{
+    if (broadphase->pairCount == broadphase->pairCapacity)
+    {
+        // The arrays share the capacity, pairs and previous pairs are swapped every update
+        uint64_t **arrays[3] = {&broadphase->pairs, &broadphase->previousPairs, &broadphase->pairScratch};
+        unsigned int capacity = 0;
+        for (int i=0; i<3; i++)
+        {
+            capacity = broadphase->pairCapacity;
+            if (growArray((void**)arrays[i], &capacity, broadphase->pairCount + 1, sizeof(uint64_t)) < 0) return -1;
+        }
+        broadphase->pairCapacity = capacity;
+    }
+
+    broadphase->pairs[broadphase->pairCount++] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    return 0;
+}
+
+// Radix sort, one byte at a time, skipping the bytes above the largest identifier
+static void sortPairs(Broadphase *broadphase)
+{
+    unsigned int bytes = 0;
+    while (bytes < 4 && broadphase->bodyCount > 1u << (8 * bytes)) bytes++;
+
+    uint64_t *keys = broadphase->pairs, *scratch = broadphase->pairScratch;
+    for (unsigned int pass=0; pass<2*bytes; pass++)
+    {
+        const unsigned int shift = pass < bytes ? 8 * pass : 32 + 8 * (pass - bytes);
+        unsigned int counts[256] = {0};
+        for (unsigned int i=0; i<broadphase->pairCount; i++) counts[(keys[i] >> shift) & 0xff]++;
+        if (counts[(keys[0] >> shift) & 0xff] == broadphase->pairCount) continue;  // Same byte everywhere
+
+        unsigned int offset = 0;
+        for (int d=0; d<256; d++)
+        {
+            const unsigned int count = counts[d];
+            counts[d] = offset;
+            offset += count;
+        }
+        for (unsigned int i=0; i<broadphase->pairCount; i++) scratch[counts[(keys[i] >> shift) & 0xff]++] = keys[i];
+
+        uint64_t *swap = keys;
+        keys = scratch;
+        scratch = swap;
+    }
+
+    broadphase->pairs = keys;
+    broadphase->pairScratch = scratch;
+}
+
+static int pushEvent(Broadphase *broadphase, BroadphaseEventType type, uint64_t pair)
+{
+    if (growArray((void**)&broadphase->events, &broadphase->eventCapacity, broadphase->eventCount + 1, sizeof(BroadphaseEvent)) < 0) return -1;
+    BroadphaseEvent *event = &broadphase->events[broadphase->eventCount++];
+    event->type = type;
+    getBroadphasePair(pair, &event->a, &event->b);
+    return 0;
+}
+
+static int compareKeys(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool boxesOverlapOn(vec3 a[2], vec3 b[2], int axis)
+{
+    return a[0][axis] <= b[1][axis] && a[1][axis] >= b[0][axis];
+}
+
+static bool boxesOverlap(vec3 a[2], vec3 b[2])
+{
+    return a[0][0] <= b[1][0] && a[1][0] >= b[0][0] &&
+           a[0][1] <= b[1][1] && a[1][1] >= b[0][1] &&
+           a[0][2] <= b[1][2] && a[1][2] >= b[0][2];
+}
+
+
+/* --- SWEEP AND PRUNE --- */
+
+// Endpoint : position on the axis as an ordered integer, then min before max (touching boxes overlap), then body
+#define ENDPOINT_MAX 0x80000000u
+#define ENDPOINT_BODY 0x7fffffffu
+
+static uint32_t orderFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+static uint64_t makeEndpoint(const Broadphase *broadphase, uint32_t data)
+{
+    const unsigned int body = data & ENDPOINT_BODY;
+    const float value = broadphase->boxes[body][data & ENDPOINT_MAX ? 1 : 0][broadphase->axis];
+    return (uint64_t)orderFloat(value) << 32 | data;
+}
+
+// Axis along which the bodies are the most spread, so that the sweep prunes the most
+static int chooseAxis(const Broadphase *broadphase)
+{
+    vec3 sum = {0.0f, 0.0f, 0.0f}, sum2 = {0.0f, 0.0f, 0.0f};
+    unsigned int count = 0;
+    for (unsigned int i=0; i<broadphase->bodyCount; i++)
+    {
+        if (!broadphase->alive[i]) continue;
+        for (int k=0; k<3; k++)
+        {
+            const float center = 0.5f * (broadphase->boxes[i][0][k] + broadphase->boxes[i][1][k]);
+            sum[k] += center;
+            sum2[k] += center * center;
+        }
+        count++;
+    }
+    if (count == 0) return broadphase->axis;
+
+    int axis = 0;
+    float best = -1.0f;
+    for (int k=0; k<3; k++)
+    {
+        const float variance = sum2[k] / count - (sum[k] / count) * (sum[k] / count);
+        if (variance > best) {best = variance; axis = k;}
+    }
+    return axis;
+}
+
+static int updateSweepAndPrune(Broadphase *broadphase)
+{
+    // Drop the ends of removed bodies
+    if (broadphase->removedCount > 0)
+    {
+        unsigned int count = 0;
+        for (unsigned int i=0; i<broadphase->endpointCount; i++)
+            if (broadphase->alive[broadphase->endpoints[i] & ENDPOINT_BODY]) broadphase->endpoints[count++] = broadphase->endpoints[i];
+        broadphase->endpointCount = count;
+    }
+
+    bool resort = false;
+    if (broadphase->updates % BROADPHASE_AXIS_INTERVAL == 0)
+    {
+        const int axis = chooseAxis(broadphase);
+        resort = axis != broadphase->axis;
+        broadphase->axis = axis;
+    }
+
+    // Refresh the positions
+    for (unsigned int i=0; i<broadphase->endpointCount; i++) broadphase->endpoints[i] = makeEndpoint(broadphase, (uint32_t)broadphase->endpoints[i]);
+
+    // Bodies move little between frames, so the list is almost sorted and insertion sort is close to linear
+    if (resort || broadphase->addedCount * 16 > broadphase->endpointCount)
+    {
+        qsort(broadphase->endpoints, broadphase->endpointCount, sizeof(uint64_t), compareKeys);
+    }
+    else
+    {
+        for (unsigned int i=1; i<broadphase->endpointCount; i++)
+        {
+            const uint64_t endpoint = broadphase->endpoints[i];
+            unsigned int j = i;
+            for (; j>0 && broadphase->endpoints[j-1] > endpoint; j--) broadphase->endpoints[j] = broadphase->endpoints[j-1];
+            broadphase->endpoints[j] = endpoint;
+        }
+    }
+    broadphase->addedCount = 0;
+
+    // Sweep : a box overlaps on the axis the boxes opened before it and not closed yet
+    const int u = (broadphase->axis + 1) % 3, v = (broadphase->axis + 2) % 3;
+    unsigned int activeCount = 0;
+    for (unsigned int i=0; i<broadphase->endpointCount; i++)
+    {
+        const uint32_t data = (uint32_t)broadphase->endpoints[i];
+        const unsigned int body = data & ENDPOINT_BODY;
+        if (data & ENDPOINT_MAX)
+        {
+            const unsigned int slot = broadphase->activeSlots[body];
+            activeCount--;
+            broadphase->active[slot] = broadphase->active[activeCount];
+            memcpy(broadphase->activeBoxes[slot], broadphase->activeBoxes[activeCount], sizeof(vec3[2]));
+            broadphase->activeSlots[broadphase->active[slot]] = slot;
+            continue;
+        }
+
+        // Active boxes already overlap on the axis, and are copied next to each other so that the scan reads memory in order
+        vec3 *box = broadphase->boxes[body];
+        for (unsigned int j=0; j<activeCount; j++)
+        {
+            if (!boxesOverlapOn(box, broadphase->activeBoxes[j], u) || !boxesOverlapOn(box, broadphase->activeBoxes[j], v)) continue;
+            if (pushPair(broadphase, body, broadphase->active[j]) < 0) return -1;
+        }
+        broadphase->activeSlots[body] = activeCount;
+        broadphase->active[activeCount] = body;
+        memcpy(broadphase->activeBoxes[activeCount++], box, sizeof(vec3[2]));
+    }
+    return 0;
+}
+
+
+/* --- HASHED GRID --- */
+
+static void getCellRange(const Broadphase *broadphase, vec3 box[2], int low[3], int high[3])
+{
+    for (int k=0; k<3; k++)
+    {
+        low[k] = (int)floorf(box[0][k] / broadphase->cellSize);
+        high[k] = (int)floorf(box[1][k] / broadphase->cellSize);
+    }
+}
+
+static unsigned int hashCell(const Broadphase *broadphase, int x, int y, int z)
+{
+    return ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u) & (broadphase->bucketCount - 1);
+}
+
+static uint64_t getCellCount(const int low[3], const int high[3])
+{
+    return (uint64_t)(high[0] - low[0] + 1) * (uint64_t)(high[1] - low[1] + 1) * (uint64_t)(high[2] - low[2] + 1);
+}
+
+static int updateGrid(Broadphase *broadphase)
+{
+    // Bodies covering too many cells go to the active list, and are tested against everything
+    unsigned int entryCount = 0, bigCount = 0;
+    for (unsigned int i=0; i<broadphase->bodyCount; i++)
+    {
+        if (!broadphase->alive[i]) continue;
+        int low[3], high[3];
+        getCellRange(broadphase, broadphase->boxes[i], low, high);
+        const uint64_t cells = getCellCount(low, high);
+        if (cells > BROADPHASE_GRID_MAX_CELLS) broadphase->active[bigCount++] = i;
+        else entryCount += (unsigned int)cells;
+    }
+
+    unsigned int bucketCount = 64;
+    while (bucketCount < 2 * entryCount) bucketCount *= 2;
+    if (growArray((void**)&broadphase->bucketStart, &broadphase->bucketCapacity, bucketCount + 1, sizeof(unsigned int)) < 0) return -1;
+    if (growArray((void**)&broadphase->cellBodies, &broadphase->entryCapacity, entryCount, sizeof(unsigned int)) < 0) return -1;
+    broadphase->bucketCount = bucketCount;
+    memset(broadphase->bucketStart, 0, (bucketCount + 1) * sizeof(unsigned int));
+
+    // Count, then fill : each bucket lists its bodies contiguously
+    for (int pass=0; pass<2; pass++)
+    {
+        for (unsigned int i=0; i<broadphase->bodyCount; i++)
+        {
+            if (!broadphase->alive[i]) continue;
+            int low[3], high[3];
+            getCellRange(broadphase, broadphase->boxes[i], low, high);
+            if (getCellCount(low, high) > BROADPHASE_GRID_MAX_CELLS) continue;
+            for (int z=low[2]; z<=high[2]; z++)
+                for (int y=low[1]; y<=high[1]; y++)
+                    for (int x=low[0]; x<=high[0]; x++)
+                    {
+                        const unsigned int bucket = hashCell(broadphase, x, y, z);
+                        if (pass == 0) broadphase->bucketStart[bucket+1]++;
+                        else broadphase->cellBodies[broadphase->bucketStart[bucket]++] = i;
+                    }
+        }
+        if (pass == 0) for (unsigned int b=0; b<bucketCount; b++) broadphase->bucketStart[b+1] += broadphase->bucketStart[b];
+    }
+    // Filling moved each start to the next bucket
+    for (unsigned int b=bucketCount; b>0; b--) broadphase->bucketStart[b] = broadphase->bucketStart[b-1];
+    broadphase->bucketStart[0] = 0;
+
+    // A pair is reported by the bucket of the cell where the overlap starts, other cells skip it
+    for (unsigned int b=0; b<bucketCount; b++)
+    {
+        for (unsigned int i=broadphase->bucketStart[b]; i<broadphase->bucketStart[b+1]; i++)
+        {
+            const unsigned int body = broadphase->cellBodies[i];
+            for (unsigned int j=i+1; j<broadphase->bucketStart[b+1]; j++)
+            {
+                const unsigned int other = broadphase->cellBodies[j];
+                if (body == other || !boxesOverlap(broadphase->boxes[body], broadphase->boxes[other])) continue;
+
+                vec3 start;
+                glm_vec3_maxv(broadphase->boxes[body][0], broadphase->boxes[other][0], start);
+                const int x = (int)floorf(start[0] / broadphase->cellSize), y = (int)floorf(start[1] / broadphase->cellSize), z = (int)floorf(start[2] / broadphase->cellSize);
+                if (hashCell(broadphase, x, y, z) == b && pushPair(broadphase, body, other) < 0) return -1;
+            }
+        }
+    }
+
+    for (unsigned int i=0; i<bigCount; i++)
+    {
+        const unsigned int body = broadphase->active[i];
+        for (unsigned int other=0; other<broadphase->bodyCount; other++)
+        {
+            if (other == body || !broadphase->alive[other] || !boxesOverlap(broadphase->boxes[body], broadphase->boxes[other])) continue;
+            if (pushPair(broadphase, body, other) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+
+/* --- BROADPHASE --- */
+
+int initBroadphase(Broadphase *broadphase, BroadphaseMode mode, unsigned int capacity, float cellSize)
+{
+    memset(broadphase, 0, sizeof(Broadphase));
+    broadphase->mode = mode;
+    broadphase->cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+    return growBodies(broadphase, capacity);
+}
+
+
+int addBroadphaseBody(Broadphase *broadphase, vec3 box[2])
+{
+    unsigned int body;
+    if (broadphase->freeCount > 0) body = broadphase->freeBodies[--broadphase->freeCount];
+    else
+    {
+        if (broadphase->bodyCount > ENDPOINT_BODY) {LOG_ERROR("Too many broadphase bodies\n"); return -1;}
+        if (growBodies(broadphase, broadphase->bodyCount + 1) < 0) return -1;
+        body = broadphase->bodyCount++;
+    }
+
+    glm_vec3_copy(box[0], broadphase->boxes[body][0]);
+    glm_vec3_copy(box[1], broadphase->boxes[body][1]);
+    broadphase->alive[body] = true;
+    if (broadphase->mode == BROADPHASE_SAP)
+    {
+        broadphase->endpoints[broadphase->endpointCount++] = body;
+        broadphase->endpoints[broadphase->endpointCount++] = body | ENDPOINT_MAX;
+        broadphase->addedCount++;
+    }
+    return body;
+}
+
+
+void moveBroadphaseBody(Broadphase *broadphase, unsigned int body, vec3 box[2])
+{
+    glm_vec3_copy(box[0], broadphase->boxes[body][0]);
+    glm_vec3_copy(box[1], broadphase->boxes[body][1]);
+}
+
+
+void removeBroadphaseBody(Broadphase *broadphase, unsigned int body)
+{
+    if (body >= broadphase->bodyCount || !broadphase->alive[body]) return;
+    if (growArray((void**)&broadphase->removedBodies, &broadphase->removedCapacity, broadphase->removedCount + 1, sizeof(unsigned int)) < 0) return;
+    broadphase->alive[body] = false;
+    broadphase->removedBodies[broadphase->removedCount++] = body;
+}
+
+
+int updateBroadphase(Broadphase *broadphase)
+{
+    uint64_t *previous = broadphase->previousPairs;
+    broadphase->previousPairs = broadphase->pairs;
+    broadphase->previousCount = broadphase->pairCount;
+    broadphase->pairs = previous;
+    broadphase->pairCount = 0;
+    broadphase->eventCount = 0;
+
+    const int result = broadphase->mode == BROADPHASE_SAP ? updateSweepAndPrune(broadphase) : updateGrid(broadphase);
+    broadphase->updates++;
+
+    // Removed identifiers are free once their pairs are reported
+    for (unsigned int i=0; i<broadphase->removedCount; i++) broadphase->freeBodies[broadphase->freeCount++] = broadphase->removedBodies[i];
+    broadphase->removedCount = 0;
+    if (result < 0) return -1;
+
+    // Sorted pairs, without the duplicates of hash collisions
+    if (broadphase->pairCount > 0) sortPairs(broadphase);
+    unsigned int count = 0;
+    for (unsigned int i=0; i<broadphase->pairCount; i++)
+        if (count == 0 || broadphase->pairs[i] != broadphase->pairs[count-1]) broadphase->pairs[count++] = broadphase->pairs[i];
+    broadphase->pairCount = count;
+
+    // Events : merge of the sorted pair lists
+    unsigned int i = 0, j = 0;
+    while (i < broadphase->pairCount || j < broadphase->previousCount)
+    {
+        if (j == broadphase->previousCount || (i < broadphase->pairCount && broadphase->pairs[i] < broadphase->previousPairs[j]))
+        {
+            if (pushEvent(broadphase, BROADPHASE_PAIR_ADDED, broadphase->pairs[i++]) < 0) return -1;
+        }
+        else if (i == broadphase->pairCount || broadphase->previousPairs[j] < broadphase->pairs[i])
+        {
+            if (pushEvent(broadphase, BROADPHASE_PAIR_REMOVED, broadphase->previousPairs[j++]) < 0) return -1;
+        }
+        else {i++; j++;}
+    }
+    return 0;
+}
+
+
+void getBroadphasePair(uint64_t pair, unsigned int *a, unsigned int *b)
+{
+    *a = (unsigned int)(pair >> 32);
+    *b = (unsigned int)(pair & 0xffffffffu);
+}
+
+
+void destroyBroadphase(Broadphase *broadphase)
+{
+    free(broadphase->boxes);
+    free(broadphase->alive);
+    free(broadphase->freeBodies);
+    free(broadphase->removedBodies);
+    free(broadphase->endpoints);
+    free(broadphase->active);
+    free(broadphase->activeSlots);
+    free(broadphase->activeBoxes);
+    free(broadphase->cellBodies);
+    free(broadphase->bucketStart);
+    free(broadphase->pairs);
+    free(broadphase->previousPairs);
+    free(broadphase->pairScratch);
+    free(broadphase->events);
+    memset(broadphase, 0, sizeof(Broadphase));
+}
@@ -0,0 +1,197 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "logs.h"
+
+
+#define BROADPHASE_AXIS_INTERVAL 64  // Updates between two checks of the sweep axis
+#define BROADPHASE_GRID_MAX_CELLS 64  // Bodies covering more grid cells are tested against every body
+
+
+/**
+ * @brief Broadphase algorithms
+ * 
+ * @note BROADPHASE_SAP : sweep and prune on one axis, for crowded areas
+ * @note BROADPHASE_GRID : hashed uniform grid, for large sparse worlds
+*/
+typedef enum {
+    BROADPHASE_SAP,
+    BROADPHASE_GRID
+} BroadphaseMode;
+
+/**
+ * @brief Pair event types
+*/
+typedef enum {
+    BROADPHASE_PAIR_ADDED,
+    BROADPHASE_PAIR_REMOVED
+} BroadphaseEventType;
+
+/**
+ * @brief Pair event structure
+ * 
+ * @param type Whether the boxes started or stopped overlapping
+ * @param a Smallest body identifier of the pair
+ * @param b Largest body identifier of the pair
+*/
+typedef struct {
+    BroadphaseEventType type;
+    unsigned int a, b;
+} BroadphaseEvent;
+
+/**
+ * @brief Broadphase structure
+ * 
+ * @param mode Algorithm used
+ * @param boxes Box of each body
+ * @param alive Whether each body is used
+ * @param bodyCount Number of body slots, used or not
+ * @param bodyCapacity Allocated body slots
+ * @param freeBodies Identifiers free to reuse
+ * @param freeCount Number of free identifiers
+ * @param removedBodies Identifiers removed since the last update, reused after it
+ * @param removedCount Number of removed identifiers
+ * @param removedCapacity Allocated removed identifiers
+ * @param axis Axis swept (SAP)
+ * @param updates Number of updates done
+ * @param endpoints Sorted ends of the boxes on the axis, kept between updates (SAP)
+ * @param endpointCount Number of endpoints (SAP)
+ * @param endpointCapacity Allocated endpoints (SAP)
+ * @param addedCount Bodies added since the last update, their ends are not sorted yet (SAP)
+ * @param active Bodies overlapping the sweep position (SAP), or bodies too big for the grid (GRID)
+ * @param activeSlots Index of each body in active (SAP)
+ * @param activeBoxes Boxes of the active bodies, in the same order (SAP)
+ * @param cellSize Edge of a grid cell (GRID)
+ * @param cellBodies Body of each cell covered, grouped by hash bucket (GRID)
+ * @param entryCapacity Allocated cell entries (GRID)
+ * @param bucketStart Index of the first entry of each hash bucket, with one more entry for the end (GRID)
+ * @param bucketCount Number of hash buckets, a power of two (GRID)
+ * @param bucketCapacity Allocated hash buckets (GRID)
+ * @param pairs Overlapping pairs, sorted
+ * @param pairCount Number of overlapping pairs
+ * @param previousPairs Overlapping pairs of the last update, sorted
+ * @param previousCount Number of overlapping pairs of the last update
+ * @param pairScratch Room to sort the pairs
+ * @param pairCapacity Allocated pairs, in each pair array
+ * @param events Pairs added and removed by the last update
+ * @param eventCount Number of events
+ * @param eventCapacity Allocated events
+ * 
+ * @note Identifiers are stable while a body lives, and are not reused before the next update
+*/
+typedef struct {
+    BroadphaseMode mode;
+
+    vec3 (*boxes)[2];
+    bool *alive;
+    unsigned int bodyCount, bodyCapacity;
+    unsigned int *freeBodies;
+    unsigned int freeCount;
+    unsigned int *removedBodies;
+    unsigned int removedCount, removedCapacity;
+
+    int axis;
+    unsigned int updates;
+    uint64_t *endpoints;
+    unsigned int endpointCount, endpointCapacity;
+    unsigned int addedCount;
+    unsigned int *active;
+    unsigned int *activeSlots;
+    vec3 (*activeBoxes)[2];
+
+    float cellSize;
+    unsigned int *cellBodies;
+    unsigned int entryCapacity;
+    unsigned int *bucketStart;
+    unsigned int bucketCount, bucketCapacity;
+
+    uint64_t *pairs;
+    unsigned int pairCount;
+    uint64_t *previousPairs;
+    unsigned int previousCount;
+    uint64_t *pairScratch;
+    unsigned int pairCapacity;
+
+    BroadphaseEvent *events;
+    unsigned int eventCount, eventCapacity;
+} Broadphase;
+
+
+/**
+ * @brief Initialize a broadphase
+ * 
+ * @param broadphase Pointer to the broadphase
+ * @param mode Algorithm used
+ * @param capacity Expected number of bodies, grown when needed
+ * @param cellSize Edge of a grid cell, about the size of the common bodies (GRID)
+ * @return int 0 if success, -1 if error
+*/
+int initBroadphase(Broadphase *broadphase, BroadphaseMode mode, unsigned int capacity, float cellSize);
+
+/**
+ * @brief Add a body to a broadphase
+ * 
+ * @param broadphase Pointer to the broadphase
+ * @param box Axis aligned box of the body
+ * @return int Identifier of the body, -1 if error
+ * 
+ * @note Its pairs are found by the next update
+*/
+int addBroadphaseBody(Broadphase *broadphase, vec3 box[2]);
+
+/**
+ * @brief Move a body of a broadphase
+ * 
+ * @param broadphase Pointer to the broadphase
+ * @param body Identifier of the body
+ * @param box New axis aligned box of the body
+*/
+void moveBroadphaseBody(Broadphase *broadphase, unsigned int body, vec3 box[2]);
+
+/**
+ * @brief Remove a body from a broadphase
+ * 
+ * @param broadphase Pointer to the broadphase
+ * @param body Identifier of the body
+ * 
+ * @note Its pairs are reported as removed by the next update
+*/
+void removeBroadphaseBody(Broadphase *broadphase, unsigned int body);
+
+/**
+ * @brief Find the overlapping pairs and the pairs added or removed since the last update
+ * 
+ * @param broadphase Pointer to the broadphase
+ * @return int 0 if success, -1 if error
+ * 
+ * @note Results are in broadphase->pairs and broadphase->events, until the next update
+*/
+int updateBroadphase(Broadphase *broadphase);
+
+/**
+ * @brief Get the bodies of a pair
+ * 
+ * @param pair Pair, from broadphase->pairs
+ * @param a Smallest body identifier
+ * @param b Largest body identifier
+*/
+void getBroadphasePair(uint64_t pair, unsigned int *a, unsigned int *b);
+
+/**
+ * @brief Free a broadphase
+ * 
+ * @param broadphase Pointer to the broadphase
+*/
+void destroyBroadphase(Broadphase *broadphase);
+
+
+#endif
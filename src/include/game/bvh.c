@@ -0,0 +1,673 @@
+#include "bvh.h"
+
+
+/* --- BUILD --- */
+
+/**
+ * @brief Node of the tree being built
+ * 
+ * @param bounds Bounds of the triangles below
+ * @param first First triangle index (leaf)
+ * @param count Number of triangles, 0 for inner nodes
+ * @param right Second child, in the same pool (inner node)
+ * @param task Task building the subtree in place of this node, -1 if none
+*/
+typedef struct {
+    vec3 bounds[2];
+    unsigned int first, count;
+    unsigned int right;
+    int task;
+} BuildNode;
+
+/**
+ * @brief Node pool of one part of the tree
+ * 
+ * @param nodes Nodes, depth first
+ * @param nodeCount Number of nodes
+ * @param nodeCapacity Allocated nodes
+ * @param begin First triangle index of the subtree (task)
+ * @param end Last triangle index of the subtree, excluded (task)
+ * @param depth Depth of the subtree root (task)
+ * @param error Whether an allocation failed
+*/
+typedef struct {
+    BuildNode *nodes;
+    unsigned int nodeCount, nodeCapacity;
+    unsigned int begin, end, depth;
+    bool error;
+} BuildContext;
+
+/**
+ * @brief Data shared by the build jobs
+ * 
+ * @param bounds Bounds of each triangle
+ * @param centroids Center of the bounds of each triangle
+ * @param indices Triangle indices, partitioned in place
+ * @param top Upper part of the tree, built on the calling thread
+ * @param tasks Subtrees built by jobs
+ * @param taskCount Number of subtrees
+ * @param grain Triangles below which a subtree becomes a task
+*/
+typedef struct {
+    vec3 (*bounds)[2];
+    vec3 *centroids;
+    uint32_t *indices;
+
+    BuildContext top;
+    BuildContext tasks[BVH_MAX_TASKS];
+    unsigned int taskCount;
+    unsigned int grain;
+} BVHBuilder;
+
+/**
+ * @brief Job building a subtree
+ * 
+ * @param builder Shared data
+ * @param context Subtree built
+*/
+typedef struct {
+    BVHBuilder *builder;
+    BuildContext *context;
+} BuildJob;
+
+
+static float getSurfaceArea(vec3 bounds[2])
+{
+    vec3 size;
+    glm_vec3_sub(bounds[1], bounds[0], size);
+    return 2.0f * (size[0]*size[1] + size[1]*size[2] + size[2]*size[0]);
+}
+
+static void resetBounds(vec3 bounds[2])
+{
+    glm_vec3_fill(bounds[0], FLT_MAX);
+    glm_vec3_fill(bounds[1], -FLT_MAX);
+}
+
+static unsigned int allocBuildNode(BuildContext *context)
+{
+    if (context->nodeCount == context->nodeCapacity)
+    {
+        const unsigned int capacity = context->nodeCapacity ? context->nodeCapacity * 2 : 64;
+        BuildNode *nodes = realloc(context->nodes, capacity * sizeof(BuildNode));
+        if (!nodes)
+        {
+            context->error = true;
+            return UINT32_MAX;
+        }
+        context->nodes = nodes;
+        context->nodeCapacity = capacity;
+    }
+    return context->nodeCount++;
+}
+
+static inline int getBin(float centroid, float low, float binScale)
+{
+    const int bin = (int)((centroid - low) * binScale);
+    return bin < 0 ? 0 : bin >= BVH_BINS ? BVH_BINS - 1 : bin;
+}
+
+// Binned SAH (Wald, On fast Construction of SAH-based Bounding Volume Hierarchies), returns the middle, or end for a leaf
+static unsigned int splitTriangles(BVHBuilder *builder, unsigned int begin, unsigned int end, unsigned int depth, vec3 bounds[2])
+{
+    const unsigned int count = end - begin;
+    if (count <= 1) return end;
+
+    vec3 centroidBounds[2];
+    resetBounds(centroidBounds);
+    for (unsigned int i=begin; i<end; i++)
+    {
+        glm_vec3_minv(centroidBounds[0], builder->centroids[builder->indices[i]], centroidBounds[0]);
+        glm_vec3_maxv(centroidBounds[1], builder->centroids[builder->indices[i]], centroidBounds[1]);
+    }
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1, bestBin = 0;
+    if (depth < BVH_MAX_DEPTH)
+    {
+        for (int axis=0; axis<3; axis++)
+        {
+            const float extent = centroidBounds[1][axis] - centroidBounds[0][axis];
+            if (extent <= COLLISION_EPSILON) continue;
+            const float binScale = BVH_BINS / extent;
+
+            vec3 binBounds[BVH_BINS][2];
+            unsigned int binCounts[BVH_BINS] = {0};
+            for (int b=0; b<BVH_BINS; b++) resetBounds(binBounds[b]);
+            for (unsigned int i=begin; i<end; i++)
+            {
+                const uint32_t t = builder->indices[i];
+                const int b = getBin(builder->centroids[t][axis], centroidBounds[0][axis], binScale);
+                binCounts[b]++;
+                glm_aabb_merge(binBounds[b], builder->bounds[t], binBounds[b]);
+            }
+
+            // Left sides from the start, then right sides from the end
+            float leftAreas[BVH_BINS];
+            unsigned int leftCounts[BVH_BINS];
+            vec3 sweep[2];
+            unsigned int sweepCount = 0;
+            resetBounds(sweep);
+            for (int b=0; b<BVH_BINS-1; b++)
+            {
+                sweepCount += binCounts[b];
+                glm_aabb_merge(sweep, binBounds[b], sweep);
+                leftCounts[b] = sweepCount;
+                leftAreas[b] = sweepCount ? getSurfaceArea(sweep) : 0.0f;
+            }
+            resetBounds(sweep);
+            sweepCount = 0;
+            for (int b=BVH_BINS-1; b>0; b--)
+            {
+                sweepCount += binCounts[b];
+                glm_aabb_merge(sweep, binBounds[b], sweep);
+                if (!sweepCount || !leftCounts[b-1]) continue;
+                const float cost = leftAreas[b-1] * leftCounts[b-1] + getSurfaceArea(sweep) * sweepCount;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+    }
+
+    // Same centers or too deep : halves, leaves are kept small
+    if (bestAxis < 0) return count <= BVH_MAX_LEAF_TRIANGLES ? end : begin + count / 2;
+
+    const float area = getSurfaceArea(bounds);
+    const float splitCost = BVH_TRAVERSAL_COST + (area > 0.0f ? bestCost / area : 0.0f);
+    if (count <= BVH_MAX_LEAF_TRIANGLES && (float)count <= splitCost) return end;
+
+    // Partition by bin, with the same rounding as the binning
+    const float binScale = BVH_BINS / (centroidBounds[1][bestAxis] - centroidBounds[0][bestAxis]);
+    unsigned int middle = begin;
+    for (unsigned int i=begin; i<end; i++)
+    {
+        const uint32_t t = builder->indices[i];
+        if (getBin(builder->centroids[t][bestAxis], centroidBounds[0][bestAxis], binScale) >= bestBin) continue;
+        builder->indices[i] = builder->indices[middle];
+        builder->indices[middle++] = t;
+    }
+    return middle;
+}
+
+static unsigned int buildNode(BVHBuilder *builder, BuildContext *context, unsigned int begin, unsigned int end, unsigned int depth, bool spawn)
+{
+    const unsigned int index = allocBuildNode(context);
+    if (index == UINT32_MAX) return 0;
+
+    BuildNode node = {.first = begin, .count = 0, .right = 0, .task = -1};
+    resetBounds(node.bounds);
+    for (unsigned int i=begin; i<end; i++) glm_aabb_merge(node.bounds, builder->bounds[builder->indices[i]], node.bounds);
+
+    // Small enough for a job, built after the upper part
+    if (spawn && end - begin <= builder->grain && builder->taskCount < BVH_MAX_TASKS)
+    {
+        BuildContext *task = &builder->tasks[builder->taskCount];
+        memset(task, 0, sizeof(BuildContext));
+        task->begin = begin;
+        task->end = end;
+        task->depth = depth;
+        node.task = builder->taskCount++;
+        context->nodes[index] = node;
+        return index;
+    }
+
+    const unsigned int middle = splitTriangles(builder, begin, end, depth, node.bounds);
+    if (middle == end)
+    {
+        node.count = end - begin;
+        context->nodes[index] = node;
+        return index;
+    }
+
+    context->nodes[index] = node;
+    buildNode(builder, context, begin, middle, depth + 1, spawn);
+    const unsigned int right = buildNode(builder, context, middle, end, depth + 1, spawn);
+    context->nodes[index].right = right;
+    return index;
+}
+
+static void buildJob(void *data)
+{
+    BuildJob *job = data;
+    buildNode(job->builder, job->context, job->context->begin, job->context->end, job->context->depth, false);
+}
+
+static void quantizeNode(const TriangleBVH *bvh, vec3 bounds[2], BVHNode *dest)
+{
+    for (int i=0; i<3; i++)
+    {
+        const float inverse = bvh->scale[i] > 0.0f ? 1.0f / bvh->scale[i] : 0.0f;
+
+        // Rounded outwards, one more step against float rounding
+        const float low = floorf((bounds[0][i] - bvh->origin[i]) * inverse) - 1.0f;
+        const float high = ceilf((bounds[1][i] - bvh->origin[i]) * inverse) + 1.0f;
+        dest->min[i] = (uint16_t)glm_clamp(low, 0.0f, 65535.0f);
+        dest->max[i] = (uint16_t)glm_clamp(high, 0.0f, 65535.0f);
+    }
+}
+
+// Depth first, replacing the task nodes by the subtrees of the tasks
+static unsigned int flattenNode(TriangleBVH *bvh, BVHBuilder *builder, const BuildContext *context, unsigned int index, unsigned int *next)
+{
+    const BuildNode *node = &context->nodes[index];
+    if (node->task >= 0) return flattenNode(bvh, builder, &builder->tasks[node->task], 0, next);
+
+    const unsigned int flat = (*next)++;
+    vec3 bounds[2];
+    glm_vec3_copy((float*)node->bounds[0], bounds[0]);
+    glm_vec3_copy((float*)node->bounds[1], bounds[1]);
+    quantizeNode(bvh, bounds, &bvh->nodes[flat]);
+
+    if (node->count) bvh->nodes[flat].data = node->count << BVH_COUNT_SHIFT | node->first;
+    else
+    {
+        flattenNode(bvh, builder, context, index + 1, next);
+        bvh->nodes[flat].data = flattenNode(bvh, builder, context, node->right, next);
+    }
+    return flat;
+}
+
+// FNV-1a
+static uint64_t hashTriangles(const TriangleCollider *triangles, unsigned int triangleCount)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t *bytes = (const uint8_t*)triangles;
+    const size_t size = triangleCount * sizeof(TriangleCollider);
+    for (size_t i=0; i<size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash ^ triangleCount;
+}
+
+
+int buildTriangleBVH(TriangleBVH *bvh, const TriangleCollider *triangles, unsigned int triangleCount, JobSystem *jobs)
+{
+    memset(bvh, 0, sizeof(TriangleBVH));
+    bvh->triangles = triangles;
+    bvh->triangleCount = triangleCount;
+    bvh->key = hashTriangles(triangles, triangleCount);
+    if (!triangleCount) return 0;
+    if (triangleCount > BVH_INDEX_MASK)
+    {
+        LOG_ERROR("Too many triangles for a BVH : %d\n", triangleCount);
+        return -1;
+    }
+
+    BVHBuilder builder = {0};
+    builder.bounds = malloc(triangleCount * sizeof(vec3[2]));
+    builder.centroids = malloc(triangleCount * sizeof(vec3));
+    bvh->indices = malloc(triangleCount * sizeof(uint32_t));
+    if (!builder.bounds || !builder.centroids || !bvh->indices)
+    {
+        LOG_ERROR("Could not allocate BVH build data for %d triangles\n", triangleCount);
+        free(builder.bounds);
+        free(builder.centroids);
+        destroyTriangleBVH(bvh);
+        return -1;
+    }
+    builder.indices = bvh->indices;
+
+    vec3 bounds[2];
+    resetBounds(bounds);
+    for (unsigned int t=0; t<triangleCount; t++)
+    {
+        glm_vec3_copy((float*)triangles[t].vertices[0], builder.bounds[t][0]);
+        glm_vec3_copy((float*)triangles[t].vertices[0], builder.bounds[t][1]);
+        for (int v=1; v<3; v++)
+        {
+            glm_vec3_minv(builder.bounds[t][0], (float*)triangles[t].vertices[v], builder.bounds[t][0]);
+            glm_vec3_maxv(builder.bounds[t][1], (float*)triangles[t].vertices[v], builder.bounds[t][1]);
+        }
+        glm_aabb_center(builder.bounds[t], builder.centroids[t]);
+        glm_aabb_merge(bounds, builder.bounds[t], bounds);
+        builder.indices[t] = t;
+    }
+
+    // Upper part on this thread, until the subtrees are small enough to be spread over the workers
+    const unsigned int workers = jobs ? jobs->threadCount + 1 : 1;
+    builder.grain = glm_max(BVH_PARALLEL_TRIANGLES, triangleCount / (4 * workers));
+    buildNode(&builder, &builder.top, 0, triangleCount, 0, jobs != NULL);
+
+    BuildJob buildJobs[BVH_MAX_TASKS];
+    for (unsigned int i=0; i<builder.taskCount; i++)
+    {
+        buildJobs[i] = (BuildJob){&builder, &builder.tasks[i]};
+        submitJob(jobs, buildJob, &buildJobs[i]);
+    }
+    if (builder.taskCount) waitJobs(jobs);
+
+    // Flatten
+    bool error = builder.top.error;
+    unsigned int nodeCount = builder.top.nodeCount - builder.taskCount;
+    for (unsigned int i=0; i<builder.taskCount; i++)
+    {
+        error |= builder.tasks[i].error;
+        nodeCount += builder.tasks[i].nodeCount;
+    }
+    if (!error) bvh->nodes = malloc(nodeCount * sizeof(BVHNode));
+    if (error || !bvh->nodes)
+    {
+        LOG_ERROR("Could not allocate BVH nodes for %d triangles\n", triangleCount);
+        error = true;
+    }
+    else
+    {
+        glm_vec3_copy(bounds[0], bvh->origin);
+        glm_vec3_sub(bounds[1], bounds[0], bvh->scale);
+        glm_vec3_divs(bvh->scale, 65535.0f, bvh->scale);
+        unsigned int next = 0;
+        flattenNode(bvh, &builder, &builder.top, 0, &next);
+        bvh->nodeCount = next;
+    }
+
+    free(builder.bounds);
+    free(builder.centroids);
+    free(builder.top.nodes);
+    for (unsigned int i=0; i<builder.taskCount; i++) free(builder.tasks[i].nodes);
+    if (error)
+    {
+        destroyTriangleBVH(bvh);
+        return -1;
+    }
+
+    LOG_DEBUG("Built BVH with %d nodes over %d triangles in %d tasks\n", bvh->nodeCount, triangleCount, builder.taskCount);
+    return 0;
+}
+
+
+/* --- FILES --- */
+
+/**
+ * @brief Header of a BVH file
+ * 
+ * @param magic BVH_FILE_MAGIC
+ * @param version BVH_FILE_VERSION
+ * @param key Hash of the triangles
+ * @param triangleCount Number of triangles
+ * @param nodeCount Number of nodes
+ * @param origin Lower corner of the tree
+ * @param scale Size of a quantization step on each axis
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t triangleCount;
+    uint32_t nodeCount;
+    float origin[3];
+    float scale[3];
+} BVHFileHeader;
+
+
+int saveTriangleBVH(const TriangleBVH *bvh, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        LOG_ERROR("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    BVHFileHeader header = {BVH_FILE_MAGIC, BVH_FILE_VERSION, bvh->key, bvh->triangleCount, bvh->nodeCount, {0}, {0}};
+    memcpy(header.origin, bvh->origin, sizeof(header.origin));
+    memcpy(header.scale, bvh->scale, sizeof(header.scale));
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(bvh->nodes, sizeof(BVHNode), bvh->nodeCount, file) == bvh->nodeCount
+        && fwrite(bvh->indices, sizeof(uint32_t), bvh->triangleCount, file) == bvh->triangleCount;
+    if (fclose(file) != 0 || !written)
+    {
+        LOG_ERROR("Failed to write file: %s\n", path);
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+
+int loadTriangleBVH(TriangleBVH *bvh, const TriangleCollider *triangles, unsigned int triangleCount, const char *path)
+{
+    memset(bvh, 0, sizeof(TriangleBVH));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return -1;
+
+    BVHFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != BVH_FILE_MAGIC || header.version != BVH_FILE_VERSION)
+    {
+        LOG_WARN("Invalid BVH file: %s\n", path);
+        fclose(file);
+        return -1;
+    }
+    if (header.triangleCount != triangleCount || header.key != hashTriangles(triangles, triangleCount))
+    {
+        LOG_DEBUG("BVH file %s is out of date\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    bvh->triangles = triangles;
+    bvh->triangleCount = triangleCount;
+    bvh->nodeCount = header.nodeCount;
+    bvh->key = header.key;
+    memcpy(bvh->origin, header.origin, sizeof(header.origin));
+    memcpy(bvh->scale, header.scale, sizeof(header.scale));
+    bvh->nodes = malloc(bvh->nodeCount * sizeof(BVHNode));
+    bvh->indices = malloc(triangleCount * sizeof(uint32_t));
+    bool valid = bvh->nodes && bvh->indices
+        && fread(bvh->nodes, sizeof(BVHNode), bvh->nodeCount, file) == bvh->nodeCount
+        && fread(bvh->indices, sizeof(uint32_t), triangleCount, file) == triangleCount;
+    fclose(file);
+
+    // Indices and depth are trusted by the queries, whose stacks hold one node per level
+    unsigned int maxDepth = BVH_MAX_DEPTH;
+    for (unsigned int n=1; n<triangleCount; n*=2) maxDepth++;
+    if (maxDepth > BVH_STACK_SIZE - 1) maxDepth = BVH_STACK_SIZE - 1;
+    uint8_t *depths = valid ? calloc(bvh->nodeCount, sizeof(uint8_t)) : NULL;  // Depth + 1 of the reached nodes
+    valid = depths != NULL;
+    if (valid && bvh->nodeCount) depths[0] = 1;
+    for (unsigned int i=0; valid && i<bvh->nodeCount; i++)
+    {
+        // Children come after their parent, so that every node is reached, once, before its turn
+        const unsigned int count = bvh->nodes[i].data >> BVH_COUNT_SHIFT, index = bvh->nodes[i].data & BVH_INDEX_MASK;
+        valid = depths[i] && (count ? index + count <= triangleCount : index > i + 1 && index < bvh->nodeCount && depths[i] <= maxDepth);
+        if (!valid || count) continue;
+        valid = !depths[i + 1] && !depths[index];
+        depths[i + 1] = depths[index] = depths[i] + 1;
+    }
+    free(depths);
+    for (unsigned int i=0; valid && i<triangleCount; i++) valid = bvh->indices[i] < triangleCount;
+    if (!valid)
+    {
+        LOG_WARN("Invalid BVH file: %s\n", path);
+        destroyTriangleBVH(bvh);
+        return -1;
+    }
+    return 0;
+}
+
+
+/* --- QUERIES --- */
+
+static inline void getNodeBounds(const TriangleBVH *bvh, const BVHNode *node, vec3 dest[2])
+{
+    for (int i=0; i<3; i++)
+    {
+        dest[0][i] = bvh->origin[i] + node->min[i] * bvh->scale[i];
+        dest[1][i] = bvh->origin[i] + node->max[i] * bvh->scale[i];
+    }
+}
+
+static inline bool rayNode(const TriangleBVH *bvh, unsigned int index, const Ray *ray, float length, float *entry)
+{
+    vec3 bounds[2];
+    getNodeBounds(bvh, &bvh->nodes[index], bounds);
+    float tmin = 0.0f, tmax = length;
+    for (int i=0; i<3; i++)
+    {
+        const float t1 = (bounds[0][i] - ray->origin[i]) * ray->invDirection[i];
+        const float t2 = (bounds[1][i] - ray->origin[i]) * ray->invDirection[i];
+        tmin = glm_max(tmin, glm_min(t1, t2));
+        tmax = glm_min(tmax, glm_max(t1, t2));
+    }
+    *entry = tmin;
+    return tmin <= tmax;
+}
+
+static bool traverseRay(const TriangleBVH *bvh, const Ray *ray, bool any, float *distance, unsigned int *triangle)
+{
+    struct {uint32_t node; float entry;} stack[BVH_STACK_SIZE];
+    unsigned int size = 0;
+    float closest = ray->length, entry;
+    bool hit = false;
+
+    if (!bvh->nodeCount || !rayNode(bvh, 0, ray, closest, &entry)) return false;
+    stack[size].node = 0;
+    stack[size++].entry = entry;
+
+    while (size)
+    {
+        size--;
+        if (stack[size].entry > closest) continue;
+        const unsigned int index = stack[size].node;
+        const BVHNode *node = &bvh->nodes[index];
+        const unsigned int count = node->data >> BVH_COUNT_SHIFT;
+
+        if (count)
+        {
+            const unsigned int first = node->data & BVH_INDEX_MASK;
+            for (unsigned int i=first; i<first+count; i++)
+            {
+                float t;
+                if (!rayTriangleIntersect(ray, &bvh->triangles[bvh->indices[i]], &t) || t >= closest) continue;
+                closest = t;
+                *triangle = bvh->indices[i];
+                hit = true;
+                if (any) return true;
+            }
+            continue;
+        }
+
+        // Nearest child on top of the stack
+        const unsigned int left = index + 1, right = node->data & BVH_INDEX_MASK;
+        float leftEntry, rightEntry;
+        const bool leftHit = rayNode(bvh, left, ray, closest, &leftEntry);
+        const bool rightHit = rayNode(bvh, right, ray, closest, &rightEntry);
+        if (leftHit && rightHit)
+        {
+            const bool leftFirst = leftEntry <= rightEntry;
+            stack[size].node = leftFirst ? right : left;
+            stack[size++].entry = leftFirst ? rightEntry : leftEntry;
+            stack[size].node = leftFirst ? left : right;
+            stack[size++].entry = leftFirst ? leftEntry : rightEntry;
+        }
+        else if (leftHit || rightHit)
+        {
+            stack[size].node = leftHit ? left : right;
+            stack[size++].entry = leftHit ? leftEntry : rightEntry;
+        }
+    }
+
+    *distance = closest;
+    return hit;
+}
+
+// Triangles whose bounds overlap the box, and that pass the capsule test if any
+static unsigned int traverseBox(const TriangleBVH *bvh, vec3 box[2], const CapsuleCollider *capsule, unsigned int *dest, unsigned int max)
+{
+    uint32_t stack[BVH_STACK_SIZE];
+    unsigned int size = 0, found = 0;
+    if (bvh->nodeCount) stack[size++] = 0;
+
+    while (size)
+    {
+        const unsigned int index = stack[--size];
+        const BVHNode *node = &bvh->nodes[index];
+        vec3 bounds[2];
+        getNodeBounds(bvh, node, bounds);
+        if (!glm_aabb_aabb(bounds, box)) continue;
+
+        const unsigned int count = node->data >> BVH_COUNT_SHIFT;
+        if (!count)
+        {
+            stack[size++] = node->data & BVH_INDEX_MASK;
+            stack[size++] = index + 1;
+            continue;
+        }
+
+        const unsigned int first = node->data & BVH_INDEX_MASK;
+        for (unsigned int i=first; i<first+count; i++)
+        {
+            const TriangleCollider *triangle = &bvh->triangles[bvh->indices[i]];
+            vec3 triangleBounds[2];
+            glm_vec3_copy((float*)triangle->vertices[0], triangleBounds[0]);
+            glm_vec3_copy((float*)triangle->vertices[0], triangleBounds[1]);
+            for (int v=1; v<3; v++)
+            {
+                glm_vec3_minv(triangleBounds[0], (float*)triangle->vertices[v], triangleBounds[0]);
+                glm_vec3_maxv(triangleBounds[1], (float*)triangle->vertices[v], triangleBounds[1]);
+            }
+            if (!glm_aabb_aabb(triangleBounds, box)) continue;
+
+            if (capsule)
+            {
+                vec3 onSegment, onTriangle;
+                const float distance2 = closestPointsSegmentTriangle((float*)capsule->base, (float*)capsule->tip, triangle, onSegment, onTriangle);
+                if (distance2 > capsule->radius * capsule->radius) continue;
+            }
+            if (found == max) return found;
+            dest[found++] = bvh->indices[i];
+        }
+    }
+    return found;
+}
+
+
+bool raycastBVH(const TriangleBVH *bvh, const Ray *ray, float *distance, unsigned int *triangle)
+{
+    return traverseRay(bvh, ray, false, distance, triangle);
+}
+
+
+bool raycastAnyBVH(const TriangleBVH *bvh, const Ray *ray)
+{
+    float distance;
+    unsigned int triangle;
+    return traverseRay(bvh, ray, true, &distance, &triangle);
+}
+
+
+unsigned int overlapSphereBVH(const TriangleBVH *bvh, const SphereCollider *sphere, unsigned int *dest, unsigned int max)
+{
+    // A capsule with both ends at the center
+    CapsuleCollider capsule;
+    glm_vec3_copy((float*)sphere->position, capsule.base);
+    glm_vec3_copy((float*)sphere->position, capsule.tip);
+    capsule.radius = sphere->radius;
+    return overlapCapsuleBVH(bvh, &capsule, dest, max);
+}
+
+
+unsigned int overlapCapsuleBVH(const TriangleBVH *bvh, const CapsuleCollider *capsule, unsigned int *dest, unsigned int max)
+{
+    vec3 box[2];
+    glm_vec3_minv((float*)capsule->base, (float*)capsule->tip, box[0]);
+    glm_vec3_maxv((float*)capsule->base, (float*)capsule->tip, box[1]);
+    glm_vec3_subs(box[0], capsule->radius, box[0]);
+    glm_vec3_adds(box[1], capsule->radius, box[1]);
+    return traverseBox(bvh, box, capsule, dest, max);
+}
+
+
+unsigned int gatherBVHTriangles(const TriangleBVH *bvh, vec3 box[2], unsigned int *dest, unsigned int max)
+{
+    return traverseBox(bvh, box, NULL, dest, max);
+}
+
+
+void destroyTriangleBVH(TriangleBVH *bvh)
+{
+    free(bvh->nodes);
+    free(bvh->indices);
+    memset(bvh, 0, sizeof(TriangleBVH));
+}
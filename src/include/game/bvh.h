@@ -0,0 +1,172 @@
+#ifndef BVH_H
+#define BVH_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "collision.h"
+#include "jobs.h"
+#include "logs.h"
+
+
+#define BVH_BINS 16  // SAH candidate splits per axis
+#define BVH_MAX_LEAF_TRIANGLES 8  // At most 15, the count is stored on 4 bits
+#define BVH_TRAVERSAL_COST 1.0f  // Cost of visiting a node, relative to testing a triangle
+#define BVH_MAX_DEPTH 48  // Deeper nodes are split in halves, which bounds the query stack
+#define BVH_STACK_SIZE 96
+#define BVH_PARALLEL_TRIANGLES 2048  // Subtrees up to this size are built by a single job
+#define BVH_MAX_TASKS 64
+
+#define BVH_COUNT_SHIFT 28  // Triangle count of a node, in the high bits of its data
+#define BVH_INDEX_MASK 0x0fffffffu  // First triangle or second child of a node, in the low bits of its data
+
+#define BVH_FILE_MAGIC 0x31485642u  // "BVH1"
+#define BVH_FILE_VERSION 1
+
+
+/**
+ * @brief Flattened BVH node, 16 bytes
+ * 
+ * @param min Lower corner, quantized in the bounds of the tree
+ * @param max Upper corner, quantized in the bounds of the tree
+ * @param data Triangle count on the 4 high bits, then the first triangle index (leaf) or the second child (inner node)
+ * 
+ * @note Nodes are stored depth first, the first child of an inner node follows it
+*/
+typedef struct {
+    uint16_t min[3];
+    uint16_t max[3];
+    uint32_t data;
+} BVHNode;
+
+/**
+ * @brief Static bounding volume hierarchy over triangles
+ * 
+ * @param triangles Triangles, not owned
+ * @param triangleCount Number of triangles
+ * @param nodes Flattened nodes, the root first
+ * @param nodeCount Number of nodes
+ * @param indices Triangles of the leaves, leaf after leaf
+ * @param origin Lower corner of the tree
+ * @param scale Size of a quantization step on each axis
+ * @param key Hash of the triangles, checked when loading
+ * 
+ * @note Queries only read the tree, and can run from several threads
+*/
+typedef struct {
+    const TriangleCollider *triangles;
+    unsigned int triangleCount;
+
+    BVHNode *nodes;
+    unsigned int nodeCount;
+    uint32_t *indices;
+
+    vec3 origin;
+    vec3 scale;
+    uint64_t key;
+} TriangleBVH;
+
+
+/**
+ * @brief Build a BVH with the surface area heuristic
+ * 
+ * @param bvh Pointer to the BVH
+ * @param triangles Triangles, must outlive the BVH
+ * @param triangleCount Number of triangles
+ * @param jobs Job system building the subtrees, NULL to build on the calling thread
+ * @return int 0 if success, -1 if error
+*/
+int buildTriangleBVH(TriangleBVH *bvh, const TriangleCollider *triangles, unsigned int triangleCount, JobSystem *jobs);
+
+/**
+ * @brief Write a BVH to a file
+ * 
+ * @param bvh Pointer to the BVH
+ * @param path Path of the file
+ * @return int 0 if success, -1 if error
+*/
+int saveTriangleBVH(const TriangleBVH *bvh, const char *path);
+
+/**
+ * @brief Read a BVH written by saveTriangleBVH
+ * 
+ * @param bvh Pointer to the BVH
+ * @param triangles Triangles, must be the ones the BVH was built on
+ * @param triangleCount Number of triangles
+ * @param path Path of the file
+ * @return int 0 if success, -1 if the file is missing, stale or invalid
+ * 
+ * @note Files are in the byte order of the machine, they are a cache and not an asset
+*/
+int loadTriangleBVH(TriangleBVH *bvh, const TriangleCollider *triangles, unsigned int triangleCount, const char *path);
+
+/**
+ * @brief Find the first triangle hit by a ray
+ * 
+ * @param bvh Pointer to the BVH
+ * @param ray Ray, created with initRay
+ * @param distance Distance to the hit, in multiples of the ray direction
+ * @param triangle Index of the triangle hit
+ * @return true The ray hits a triangle within its length
+ * @return false The ray hits nothing
+*/
+bool raycastBVH(const TriangleBVH *bvh, const Ray *ray, float *distance, unsigned int *triangle);
+
+/**
+ * @brief Check whether a ray hits any triangle, cheaper than raycastBVH (visibility, shadows)
+ * 
+ * @param bvh Pointer to the BVH
+ * @param ray Ray, created with initRay
+ * @return true The ray hits a triangle within its length
+ * @return false The ray hits nothing
+*/
+bool raycastAnyBVH(const TriangleBVH *bvh, const Ray *ray);
+
+/**
+ * @brief Find the triangles overlapping a sphere
+ * 
+ * @param bvh Pointer to the BVH
+ * @param sphere Sphere
+ * @param dest Indices of the triangles found
+ * @param max Size of dest
+ * @return unsigned int Number of triangles found, at most max
+*/
+unsigned int overlapSphereBVH(const TriangleBVH *bvh, const SphereCollider *sphere, unsigned int *dest, unsigned int max);
+
+/**
+ * @brief Find the triangles overlapping a capsule
+ * 
+ * @param bvh Pointer to the BVH
+ * @param capsule Capsule
+ * @param dest Indices of the triangles found
+ * @param max Size of dest
+ * @return unsigned int Number of triangles found, at most max
+*/
+unsigned int overlapCapsuleBVH(const TriangleBVH *bvh, const CapsuleCollider *capsule, unsigned int *dest, unsigned int max);
+
+/**
+ * @brief Find the triangles whose bounds overlap a box
+ * 
+ * @param bvh Pointer to the BVH
+ * @param box Axis aligned box
+ * @param dest Indices of the triangles found
+ * @param max Size of dest
+ * @return unsigned int Number of triangles found, at most max
+*/
+unsigned int gatherBVHTriangles(const TriangleBVH *bvh, vec3 box[2], unsigned int *dest, unsigned int max);
+
+/**
+ * @brief Free a BVH
+ * 
+ * @param bvh Pointer to the BVH
+*/
+void destroyTriangleBVH(TriangleBVH *bvh);
+
+
+#endif
@@ -27,7 +27,7 @@ static const Bindings DEFAULT_BINDINGS = {
     SDL_SCANCODE_R
 };
 
-static int importBindings(const char *path, Bindings *dest) {
+int importBindings(const char *path, Bindings *dest) {
     FILE *file = fopen(path, "r");
     if (file == NULL) {
         LOG_ERROR("Erreur : Impossible d'ouvrir le fichier %s\n", path);
@@ -88,9 +88,8 @@ int initCamera(Camera *camera, vec3 pos, vec3 target, const char *bindings)
     camera->speed = SPEED;
     camera->sprintBoost = SPRINTBOOST;
     camera->sensitivity = SENSITIVITY;
-    camera->onGround = 1;
-    camera->jumpSpeed = JUMPSPEED;
-    glm_vec3_copy(GLM_VEC3_ZERO, camera->upVelocity);
+    camera->yaw = 0.0f;
+    camera->pitch = 0.0f;
     if (importBindings(bindings, &camera->bindings))
     {
         LOG_ERROR("Could not import custom bindings, using default bindings.\n");
@@ -101,97 +100,70 @@ int initCamera(Camera *camera, vec3 pos, vec3 target, const char *bindings)
 }
 
 
-void translateCamera(Camera *camera, const Uint8* keyboardState, double dt)
+void getCameraMovement(const Camera *camera, const Uint8* keyboardState, double dt, vec3 move, bool *jump)
 {
-    vec3 translation = {0.0f, 0.0f, 0.0f};
+    glm_vec3_zero(move);
 
     // (Direction2D, Right2D) plane movement
 
     if (keyboardState[camera->bindings.forward])
     {
-        glm_vec3_sub(translation, camera->direction2D, translation);
+        glm_vec3_sub(move, (float*)camera->direction2D, move);
         if (keyboardState[camera->bindings.sprint])
-            glm_vec3_scale(translation, camera->sprintBoost, translation);
+            glm_vec3_scale(move, camera->sprintBoost, move);
     }
     if (keyboardState[camera->bindings.backward])
-        glm_vec3_add(translation, camera->direction2D, translation);
+        glm_vec3_add(move, (float*)camera->direction2D, move);
     if (keyboardState[camera->bindings.left])
-        glm_vec3_sub(translation, camera->right2D, translation);
+        glm_vec3_sub(move, (float*)camera->right2D, move);
     if (keyboardState[camera->bindings.right])
-        glm_vec3_add(translation, camera->right2D, translation);
-    glm_vec3_scale(translation, camera->speed * dt, translation);
-
-    // Up vector (gravity and jumping)
-    
-    // Moving up and down (Debugging purposes)
-    // vec3 upmov;
-    // glm_vec3_scale(camera->up, 5.0f*dt, upmov);
-    // if (keyboardState[SDL_SCANCODE_DOWN])
-    //     glm_vec3_sub(translation, upmov, translation);
-    // if (keyboardState[SDL_SCANCODE_UP])
-    //     glm_vec3_add(translation, upmov, translation);
-
-    // Jumping
-    if (keyboardState[camera->bindings.jump] && camera->onGround)
-    {
-        vec3 jump;
-        glm_vec3_scale(camera->up, camera->jumpSpeed, jump);
-        glm_vec3_copy(jump, camera->upVelocity);
-        camera->onGround = 0;
-    }
-    // Falling
-    else if (!camera->onGround)
-    {
-        vec3 gravity;
-        vec3 yTranslation;
-
-        // Gravity
-        glm_vec3_scale(camera->up, -GRAVITY * dt, gravity);
-        glm_vec3_add(camera->upVelocity, gravity, camera->upVelocity);
-        glm_vec3_scale(camera->upVelocity, dt, yTranslation);
-
-        // Check if camera is below ground
-        // Currently assuming that the ground is at y=0
-        if (camera->pos[1]+yTranslation[1] < EYE_Y)
-        {
-            // Move camera to ground
-            camera->upVelocity[1] = -camera->pos[1] + EYE_Y;
-            glm_vec3_add(translation, camera->upVelocity, translation);
-
-            // Reset velocity
-            camera->onGround = 1;
-            glm_vec3_copy(GLM_VEC3_ZERO, camera->upVelocity);
-        }
-        else
-        {
-            glm_vec3_add(translation, yTranslation, translation);
-        }
-    }
+        glm_vec3_add(move, (float*)camera->right2D, move);
+    glm_vec3_scale(move, camera->speed * dt, move);
+
+    *jump = keyboardState[camera->bindings.jump];
+}
 
-    // Update position
+
+void setCameraPosition(Camera *camera, vec3 pos)
+{
+    vec3 translation;
+    glm_vec3_sub(pos, camera->pos, translation);
     glm_vec3_add(camera->pos, translation, camera->pos);
     glm_vec3_add(camera->target, translation, camera->target);
 }
 
 
-void rotateCamera(Camera *camera, int dx, int dy)
+// Angles are in degrees
+static void lookTarget(const vec3 pos, float yaw, float pitch, vec3 target)
 {
-    static float yaw = 0.0f;
-    static float pitch = 0;
-    vec3 addTarget = {0.0f, 0.0f, 0.0f};
+    vec3 addTarget;
+    addTarget[0] = cosf(glm_rad(yaw)) * cosf(glm_rad(pitch));
+    addTarget[1] = sinf(glm_rad(pitch));
+    addTarget[2] = sinf(glm_rad(yaw)) * cosf(glm_rad(pitch));
+    glm_vec3_add(addTarget, (float*)pos, target);
+}
 
+void rotateCamera(Camera *camera, int dx, int dy)
+{
     // fmod is used to prevent yaw from getting too large
     // thus keeping precision in the float
-    yaw += fmod(dx * camera->sensitivity, 360.0f);
-    pitch -= dy * camera->sensitivity;
+    camera->yaw += fmod(dx * camera->sensitivity, 360.0f);
+    camera->pitch -= dy * camera->sensitivity;
     // This prevents the camera from flipping over
-    pitch = glm_clamp(pitch, -89.0f, 89.0f);
+    camera->pitch = glm_clamp(camera->pitch, -89.0f, 89.0f);
 
     // Update target
-    addTarget[0] = cosf(glm_rad(yaw)) * cosf(glm_rad(pitch));
-    addTarget[1] = sinf(glm_rad(pitch));
-    addTarget[2] = sinf(glm_rad(yaw)) * cosf(glm_rad(pitch));
-    glm_vec3_add(addTarget, camera->pos, camera->target);
+    lookTarget(camera->pos, camera->yaw, camera->pitch, camera->target);
+}
+
+void getRotatedTarget(const Camera *camera, int dx, int dy, vec3 target)
+{
+    // Same steps as rotateCamera, so that the next tick lands on the same view
+    float yaw = camera->yaw, pitch = camera->pitch;
+    yaw += fmod(dx * camera->sensitivity, 360.0f);
+    pitch -= dy * camera->sensitivity;
+    pitch = glm_clamp(pitch, -89.0f, 89.0f);
+    lookTarget(camera->pos, yaw, pitch, target);
 }
 
 
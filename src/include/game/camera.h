@@ -17,12 +17,9 @@
 
 #define EYE_Y 1.8f
 
-#define GRAVITY 20.0f
-#define JUMPSPEED 7.5f
 #define SPEED 4.5f
 #define SPRINTBOOST 2.0f
 #define SENSITIVITY 0.07f
-#define TERMINALVELOCITY 50.0f
 
 
 /**
@@ -52,9 +49,8 @@ typedef struct {
  * @param speed Speed of the camera
  * @param sprintBoost Boost applied to the speed when sprinting
  * @param sensitivity Sensitivity of the camera
- * @param onGround Whether the camera is on the ground
- * @param jumpSpeed Speed of the camera when jumping
- * @param upVelocity Up velocity of the camera
+ * @param yaw Horizontal angle of the camera in degrees, 0 looks along x
+ * @param pitch Vertical angle of the camera in degrees, clamped to [-89, 89]
  * @param bindings Bindings of the camera
  * 
  * @note Direction is pos-target normalized (automatically calculated)
@@ -76,9 +72,7 @@ typedef struct {
     float speed;
     float sprintBoost;
     float sensitivity;
-    bool onGround;
-    float jumpSpeed;
-    vec3 upVelocity;
+    float yaw, pitch;
     Bindings bindings;
 } Camera;
 
@@ -97,18 +91,38 @@ typedef struct {
 int initCamera(Camera *camera, vec3 pos, vec3 target, const char *bindings);
 
 /**
- * @brief Translate the camera
+ * @brief Read a bindings file, lines like forward=Z
  * 
- * @param camera Pointer to the camera to update
+ * @param path Path to the bindings file
+ * @param dest Bindings read, the keys missing from the file are left untouched
+ * @return int 0 on success, -1 on failure
+*/
+int importBindings(const char *path, Bindings *dest);
+
+/**
+ * @brief Get the move wanted by the player from the keyboard
+ * 
+ * @param camera Pointer to the camera
  * @param keyboardState Pointer to the keyboard state
  * @param dt Delta time
+ * @param move Horizontal move for this frame
+ * @param jump Whether the jump key is pressed
+ * 
+ * @note Collisions, gravity and jumping are left to the character controller
+*/
+void getCameraMovement(const Camera *camera, const Uint8* keyboardState, double dt, vec3 move, bool *jump);
+
+/**
+ * @brief Move the camera, keeping the direction
+ * 
+ * @param camera Pointer to the camera to update
+ * @param pos New position of the camera
  * 
  * @note Should be called before rotateCamera
- * @note Assumes that ground is the (y=0) plane
  * @note Camera parameters are NOT updated
  * @note This only updates camera->pos and camera->target
 */
-void translateCamera(Camera *camera, const Uint8* keyboardState, double dt);
+void setCameraPosition(Camera *camera, vec3 pos);
 
 
 /**
@@ -118,15 +132,27 @@ void translateCamera(Camera *camera, const Uint8* keyboardState, double dt);
  * @param dx Delta x
  * @param dy Delta y
  * 
- * @note Should be called after translateCamera
+ * @note Should be called after setCameraPosition
  * @note Camera parameters are NOT updated
  * @note This only updates camera->target
 */
 void rotateCamera(Camera *camera, int dx, int dy);
 
+/**
+ * @brief Get the target the camera would have if rotated, without rotating it
+ * 
+ * @param camera Pointer to the camera
+ * @param dx Delta x
+ * @param dy Delta y
+ * @param target Target after the rotation
+ * 
+ * @note Used to draw the view with the mouse motion received after the game update (late latching)
+*/
+void getRotatedTarget(const Camera *camera, int dx, int dy, vec3 target);
+
 
 /**
- * @brief Update the camera parameters (gravity, jumping, etc.) : normalise vectors
+ * @brief Update the camera parameters : normalise vectors
  * 
  * @param camera Pointer to the camera to update
  * 
@@ -0,0 +1,295 @@
+#include "cluster.h"
+
+
+static inline unsigned int depthToSlice(const LightClusters *clusters, float depth)
+{
+    // Exponential slicing: slices get thicker with the distance, like the depth precision
+    float slice = logf(depth / clusters->zNear) * CLUSTER_Z / logf(clusters->zFar / clusters->zNear);
+    return (unsigned int)glm_clamp(floorf(slice), 0.0f, CLUSTER_Z-1);
+}
+
+static inline unsigned int ndcToTile(float ndc, unsigned int tiles)
+{
+    return (unsigned int)glm_clamp(floorf((ndc*0.5f + 0.5f) * tiles), 0.0f, (float)(tiles-1));
+}
+
+
+int initLightClusters(LightClusters *clusters, float fov, float aspect, float zNear, float zFar)
+{
+    setLightClustersProjection(clusters, fov, aspect, zNear, zFar);
+
+    clusters->lightCount = 0;
+    clusters->indexCount = 0;
+    clusters->lights = (GPUPointLight*)malloc(MAX_POINT_LIGHTS * sizeof(GPUPointLight));
+    clusters->grid = malloc(CLUSTER_COUNT * sizeof(*clusters->grid));
+    clusters->indices = (uint32_t*)malloc(CLUSTER_MAX_INDICES * sizeof(uint32_t));
+    if (!clusters->lights || !clusters->grid || !clusters->indices)
+    {
+        LOG_ERROR("Could not allocate light clusters\n");
+        destroyLightClusters(clusters);
+        return -1;
+    }
+    memset(clusters->grid, 0, CLUSTER_COUNT * sizeof(*clusters->grid));
+
+    glGenBuffers(1, &clusters->lightSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->lightSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_POINT_LIGHTS * sizeof(GPUPointLight), NULL, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &clusters->gridSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->gridSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * sizeof(*clusters->grid), clusters->grid, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &clusters->indexSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->indexSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_MAX_INDICES * sizeof(uint32_t), NULL, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    LOG_TRACE("Initialized %dx%dx%d light clusters\n", CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+    return 0;
+}
+
+void setLightClustersProjection(LightClusters *clusters, float fov, float aspect, float zNear, float zFar)
+{
+    clusters->zNear = zNear;
+    clusters->zFar = zFar;
+    clusters->tanHalfFovY = tanf(fov * 0.5f);
+    clusters->aspect = aspect;
+}
+
+
+/**
+ * @brief Find the clusters touched by a light
+ * 
+ * @param clusters Pointer to the clusters
+ * @param light Light to place
+ * @param view View matrix of the camera
+ * @param range Set to x0, x1, y0, y1, z0, z1 (x0 > x1 when the light is culled)
+*/
+static void findLightRange(const LightClusters *clusters, const PointLight *light, mat4 view, uint8_t range[6])
+{
+    const float xScale = clusters->tanHalfFovY * clusters->aspect;
+    const float yScale = clusters->tanHalfFovY;
+    range[0] = 1; range[1] = 0;  // Culled until proven otherwise
+
+    vec4 viewPos;
+    glm_mat4_mulv(view, (vec4){light->position[0], light->position[1], light->position[2], 1.0f}, viewPos);
+    const float depth = -viewPos[2];
+    const float r = light->radius;
+    if (depth + r < clusters->zNear || depth - r > clusters->zFar) return;
+
+    const float dMin = glm_max(depth - r, clusters->zNear);
+    const float dMax = glm_min(depth + r, clusters->zFar);
+
+    // Conservative screen bounds of the sphere : divide by the depth that maximises each side
+    const float xMax = viewPos[0] + r, xMin = viewPos[0] - r;
+    const float yMax = viewPos[1] + r, yMin = viewPos[1] - r;
+    const float ndcXMax = xMax / ((xMax > 0.0f ? dMin : dMax) * xScale);
+    const float ndcXMin = xMin / ((xMin < 0.0f ? dMin : dMax) * xScale);
+    const float ndcYMax = yMax / ((yMax > 0.0f ? dMin : dMax) * yScale);
+    const float ndcYMin = yMin / ((yMin < 0.0f ? dMin : dMax) * yScale);
+    if (ndcXMin > 1.0f || ndcXMax < -1.0f || ndcYMin > 1.0f || ndcYMax < -1.0f) return;
+
+    range[0] = ndcToTile(ndcXMin, CLUSTER_X); range[1] = ndcToTile(ndcXMax, CLUSTER_X);
+    range[2] = ndcToTile(ndcYMin, CLUSTER_Y); range[3] = ndcToTile(ndcYMax, CLUSTER_Y);
+    range[4] = depthToSlice(clusters, dMin); range[5] = depthToSlice(clusters, dMax);
+}
+
+#if defined(__SSE2__)
+// Tiles of four NDC coordinates, clamped before the truncation so that it rounds down
+static inline __m128i ndcToTiles(__m128 ndc, unsigned int tiles)
+{
+    const __m128 tile = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ndc, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f)), _mm_set1_ps((float)tiles));
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(tile, _mm_setzero_ps()), _mm_set1_ps((float)(tiles-1))));
+}
+
+/**
+ * @brief Find the clusters touched by four lights at once, one in each lane, as findLightRange does
+ * 
+ * @param clusters Pointer to the clusters
+ * @param lights Four lights to place
+ * @param view View matrix of the camera
+ * @param ranges Set to the range of each light
+ * 
+ * @note The depth slices are still found one light at a time, there is no SSE logarithm
+*/
+static void findLightRanges4(const LightClusters *clusters, const PointLight *lights, mat4 view, uint8_t ranges[4][6])
+{
+    const __m128 x = _mm_setr_ps(lights[0].position[0], lights[1].position[0], lights[2].position[0], lights[3].position[0]);
+    const __m128 y = _mm_setr_ps(lights[0].position[1], lights[1].position[1], lights[2].position[1], lights[3].position[1]);
+    const __m128 z = _mm_setr_ps(lights[0].position[2], lights[1].position[2], lights[2].position[2], lights[3].position[2]);
+    const __m128 r = _mm_setr_ps(lights[0].radius, lights[1].radius, lights[2].radius, lights[3].radius);
+    const __m128 zNear = _mm_set1_ps(clusters->zNear), zFar = _mm_set1_ps(clusters->zFar);
+    const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+
+    // Rows of the view matrix (cglm matrices are column major)
+    __m128 viewPos[3];
+    for (int k=0; k<3; k++)
+    {
+        viewPos[k] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(view[0][k]), x), _mm_mul_ps(_mm_set1_ps(view[1][k]), y));
+        viewPos[k] = _mm_add_ps(viewPos[k], _mm_add_ps(_mm_mul_ps(_mm_set1_ps(view[2][k]), z), _mm_set1_ps(view[3][k])));
+    }
+    const __m128 depth = _mm_sub_ps(_mm_setzero_ps(), viewPos[2]);
+    __m128 visible = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(depth, r), zNear), _mm_cmple_ps(_mm_sub_ps(depth, r), zFar));
+
+    // Both depths are at least zNear, the divisions are safe in the culled lanes too
+    const __m128 dMin = _mm_max_ps(_mm_sub_ps(depth, r), zNear);
+    const __m128 dMax = _mm_min_ps(_mm_add_ps(depth, r), zFar);
+    const __m128 scales[2] = {_mm_set1_ps(clusters->tanHalfFovY * clusters->aspect), _mm_set1_ps(clusters->tanHalfFovY)};
+    __m128i tiles[4];
+    for (int k=0; k<2; k++)
+    {
+        const __m128 high = _mm_add_ps(viewPos[k], r), low = _mm_sub_ps(viewPos[k], r);
+        const __m128 highMask = _mm_cmpgt_ps(high, _mm_setzero_ps()), lowMask = _mm_cmplt_ps(low, _mm_setzero_ps());
+        const __m128 highDepth = _mm_or_ps(_mm_and_ps(highMask, dMin), _mm_andnot_ps(highMask, dMax));
+        const __m128 lowDepth = _mm_or_ps(_mm_and_ps(lowMask, dMin), _mm_andnot_ps(lowMask, dMax));
+        const __m128 ndcHigh = _mm_div_ps(high, _mm_mul_ps(highDepth, scales[k]));
+        const __m128 ndcLow = _mm_div_ps(low, _mm_mul_ps(lowDepth, scales[k]));
+        visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmple_ps(ndcLow, one), _mm_cmpge_ps(ndcHigh, minusOne)));
+        tiles[2*k] = ndcToTiles(ndcLow, k == 0 ? CLUSTER_X : CLUSTER_Y);
+        tiles[2*k+1] = ndcToTiles(ndcHigh, k == 0 ? CLUSTER_X : CLUSTER_Y);
+    }
+
+    _Alignas(16) int32_t lanes[4][4];
+    _Alignas(16) float depths[2][4];
+    for (int k=0; k<4; k++) _mm_store_si128((__m128i*)lanes[k], tiles[k]);
+    _mm_store_ps(depths[0], dMin);
+    _mm_store_ps(depths[1], dMax);
+    const int mask = _mm_movemask_ps(visible);
+    for (int i=0; i<4; i++)
+    {
+        if (!(mask & (1 << i))) {ranges[i][0] = 1; ranges[i][1] = 0; continue;}
+        for (int k=0; k<4; k++) ranges[i][k] = (uint8_t)lanes[k][i];
+        ranges[i][4] = depthToSlice(clusters, depths[0][i]); ranges[i][5] = depthToSlice(clusters, depths[1][i]);
+    }
+}
+#endif
+
+// Count a light in the clusters x0 to x1 of a row
+static inline void countRow(uint32_t *row, unsigned int x0, unsigned int x1)
+{
+#if defined(__SSE2__) && CLUSTER_X % 4 == 0
+    // The columns in the range are -1 in the mask, subtracting it adds one to them
+    const __m128i first = _mm_set1_epi32((int)x0 - 1), last = _mm_set1_epi32((int)x1 + 1);
+    for (unsigned int x=x0 & ~3u; x<=x1; x+=4)
+    {
+        const __m128i columns = _mm_setr_epi32(x, x+1, x+2, x+3);
+        const __m128i mask = _mm_and_si128(_mm_cmpgt_epi32(columns, first), _mm_cmplt_epi32(columns, last));
+        _mm_store_si128((__m128i*)(row + x), _mm_sub_epi32(_mm_load_si128((const __m128i*)(row + x)), mask));
+    }
+#else
+    for (unsigned int x=x0; x<=x1; x++) row[x]++;
+#endif
+}
+
+
+void assignLightClusters(LightClusters *clusters, const PointLight *pointLights, unsigned int pointLightCount, mat4 view)
+{
+    // Cluster range of each light : x0, x1, y0, y1, z0, z1 (x0 > x1 when the light is culled)
+    static uint8_t ranges[MAX_POINT_LIGHTS][6];
+    // Lights per cluster, contiguous along x so that a row is counted with a few vector adds
+    static _Alignas(16) uint32_t counts[CLUSTER_COUNT];
+    static bool overflowLogged = false;
+
+    if (pointLightCount > MAX_POINT_LIGHTS) pointLightCount = MAX_POINT_LIGHTS;
+    clusters->lightCount = pointLightCount;
+
+    for (unsigned int i=0; i<pointLightCount; i++)
+    {
+        const PointLight *light = &pointLights[i];
+        GPUPointLight *gpuLight = &clusters->lights[i];
+        glm_vec3_copy((float*)light->position, gpuLight->position);
+        glm_vec3_copy((float*)light->color, gpuLight->color);
+        gpuLight->radius = light->radius;
+        gpuLight->shadowIndex = light->shadowTier < 0 ? -1 : (light->shadowTier << 8) | light->shadowSlot;
+    }
+
+    // First pass : find the clusters touched by each light, four lights at a time when possible, and count lights per cluster
+    unsigned int i = 0;
+#if defined(__SSE2__)
+    for (; i+4<=pointLightCount; i+=4) findLightRanges4(clusters, &pointLights[i], view, &ranges[i]);
+#endif
+    for (; i<pointLightCount; i++) findLightRange(clusters, &pointLights[i], view, ranges[i]);
+
+    memset(counts, 0, sizeof(counts));
+    for (i=0; i<pointLightCount; i++)
+    {
+        if (ranges[i][0] > ranges[i][1]) continue;
+        for (unsigned int z=ranges[i][4]; z<=ranges[i][5]; z++)
+            for (unsigned int y=ranges[i][2]; y<=ranges[i][3]; y++)
+                countRow(&counts[CLUSTER_X*(y + CLUSTER_Y*z)], ranges[i][0], ranges[i][1]);
+    }
+
+    // Prefix sum : turn counts into offsets in the compact index list
+    unsigned int offset = 0;
+    for (unsigned int c=0; c<CLUSTER_COUNT; c++)
+    {
+        uint32_t count = counts[c];
+        if (offset + count > CLUSTER_MAX_INDICES)
+        {
+            if (!overflowLogged) {LOG_WARN("Light cluster index list is full, some lights are dropped\n"); overflowLogged = true;}
+            count = CLUSTER_MAX_INDICES - offset;
+        }
+        clusters->grid[c][0] = offset;
+        clusters->grid[c][1] = 0;  // Reused as a cursor by the second pass
+        offset += count;
+    }
+    clusters->indexCount = offset;
+
+    // Second pass : write light indices, one cluster at a time as they go to scattered places of the list
+    for (i=0; i<pointLightCount; i++)
+    {
+        if (ranges[i][0] > ranges[i][1]) continue;
+        for (unsigned int z=ranges[i][4]; z<=ranges[i][5]; z++)
+            for (unsigned int y=ranges[i][2]; y<=ranges[i][3]; y++)
+                for (unsigned int x=ranges[i][0]; x<=ranges[i][1]; x++)
+                {
+                    const unsigned int c = x + CLUSTER_X*(y + CLUSTER_Y*z);
+                    const unsigned int capacity = (c+1 < CLUSTER_COUNT ? clusters->grid[c+1][0] : clusters->indexCount) - clusters->grid[c][0];
+                    if (clusters->grid[c][1] < capacity)
+                        clusters->indices[clusters->grid[c][0] + clusters->grid[c][1]++] = i;
+                }
+    }
+
+    // Upload
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->lightSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, clusters->lightCount * sizeof(GPUPointLight), clusters->lights);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->gridSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, CLUSTER_COUNT * sizeof(*clusters->grid), clusters->grid);
+    if (clusters->indexCount)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->indexSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, clusters->indexCount * sizeof(uint32_t), clusters->indices);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+void bindLightClusters(const LightClusters *clusters)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING, clusters->lightSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, clusters->gridSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDICES_BINDING, clusters->indexSSBO);
+}
+
+void setLightClustersUniforms(const LightClusters *clusters, GLuint shaderProgram, unsigned int width, unsigned int height)
+{
+    // slice = log(depth)*scale - bias
+    const float scale = CLUSTER_Z / logf(clusters->zFar / clusters->zNear);
+    const float bias = CLUSTER_Z * logf(clusters->zNear) / logf(clusters->zFar / clusters->zNear);
+    glUniform3ui(glGetUniformLocation(shaderProgram, "clusterDims"), CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+    glUniform2f(glGetUniformLocation(shaderProgram, "clusterSliceParams"), scale, bias);
+    glUniform2f(glGetUniformLocation(shaderProgram, "clusterTileSize"), (float)width / CLUSTER_X, (float)height / CLUSTER_Y);
+    glUniform2f(glGetUniformLocation(shaderProgram, "cameraPlanes"), clusters->zNear, clusters->zFar);
+}
+
+
+void destroyLightClusters(LightClusters *clusters)
+{
+    free(clusters->lights); clusters->lights = NULL;
+    free(clusters->grid); clusters->grid = NULL;
+    free(clusters->indices); clusters->indices = NULL;
+    if (clusters->lightSSBO) {glDeleteBuffers(1, &clusters->lightSSBO); clusters->lightSSBO = 0;}
+    if (clusters->gridSSBO) {glDeleteBuffers(1, &clusters->gridSSBO); clusters->gridSSBO = 0;}
+    if (clusters->indexSSBO) {glDeleteBuffers(1, &clusters->indexSSBO); clusters->indexSSBO = 0;}
+}
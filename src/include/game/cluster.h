@@ -0,0 +1,148 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+#include <GL/glew.h>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include "light.h"
+#include "logs.h"
+
+
+// Dimensions of the cluster grid (x and y are screen tiles, z are depth slices)
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X*CLUSTER_Y*CLUSTER_Z)
+
+// Maximum number of light references stored across all clusters
+#define CLUSTER_MAX_INDICES (CLUSTER_COUNT*32)
+
+// Shader storage bindings (must match fragment.frag)
+#define CLUSTER_LIGHTS_BINDING 0
+#define CLUSTER_GRID_BINDING 1
+#define CLUSTER_INDICES_BINDING 2
+
+
+/**
+ * @brief Point light as seen by the shaders (std430 layout)
+ * 
+ * @param position Position of the light
+ * @param radius Range of the light
+ * @param color Color of the light
+ * @param shadowIndex Shadow tier in bits 8+ and slot in bits 0-7, -1 if none
+*/
+typedef struct {
+    vec3 position;
+    float radius;
+    vec3 color;
+    int32_t shadowIndex;
+} GPUPointLight;
+
+/**
+ * @brief Light clusters structure
+ * 
+ * @param lights Lights uploaded to the GPU
+ * @param lightCount Number of lights uploaded
+ * @param grid Offset and count of each cluster in the index list
+ * @param indices Compact list of light indices
+ * @param indexCount Number of indices used
+ * @param zNear Near plane of the camera
+ * @param zFar Far plane of the camera
+ * @param tanHalfFovY Tangent of half the vertical field of view
+ * @param aspect Aspect ratio of the camera
+ * 
+ * @param lightSSBO Shader storage buffer for lights
+ * @param gridSSBO Shader storage buffer for the grid
+ * @param indexSSBO Shader storage buffer for the index list
+ * 
+ * @note The frustum is split in CLUSTER_X*CLUSTER_Y tiles and CLUSTER_Z exponential slices
+*/
+typedef struct {
+    GPUPointLight *lights;
+    unsigned int lightCount;
+    uint32_t (*grid)[2];
+    uint32_t *indices;
+    unsigned int indexCount;
+
+    float zNear, zFar;
+    float tanHalfFovY, aspect;
+
+    GLuint lightSSBO, gridSSBO, indexSSBO;
+} LightClusters;
+
+
+/**
+ * @brief Initialize light clusters
+ * 
+ * @param clusters Pointer to the clusters
+ * @param fov Vertical field of view in radians
+ * @param aspect Aspect ratio of the camera
+ * @param zNear Near plane of the camera
+ * @param zFar Far plane of the camera
+ * @return int 0 if success, -1 if error
+*/
+int initLightClusters(LightClusters *clusters, float fov, float aspect, float zNear, float zFar);
+
+/**
+ * @brief Change the camera the clusters are built for
+ * 
+ * @param clusters Pointer to the clusters
+ * @param fov Vertical field of view in radians
+ * @param aspect Aspect ratio of the camera
+ * @param zNear Near plane of the camera
+ * @param zFar Far plane of the camera
+ * 
+ * @note The shaders reading the clusters need their uniforms again (setLightClustersUniforms)
+*/
+void setLightClustersProjection(LightClusters *clusters, float fov, float aspect, float zNear, float zFar);
+
+/**
+ * @brief Assign lights to clusters and upload the result to the GPU
+ * 
+ * @param clusters Pointer to the clusters
+ * @param pointLights Point lights to assign
+ * @param pointLightCount Number of point lights
+ * @param view View matrix of the camera
+ * 
+ * @note Should be called once per frame, after the view matrix is known
+*/
+void assignLightClusters(LightClusters *clusters, const PointLight *pointLights, unsigned int pointLightCount, mat4 view);
+
+/**
+ * @brief Bind the cluster buffers to their shader storage bindings
+ * 
+ * @param clusters Pointer to the clusters
+*/
+void bindLightClusters(const LightClusters *clusters);
+
+/**
+ * @brief Send the cluster parameters to a shader program
+ * 
+ * @param clusters Pointer to the clusters
+ * @param shaderProgram Shader program to use
+ * @param width Width of the rendered region
+ * @param height Height of the rendered region
+ * 
+ * @note Shader program must be in use, and the uniforms set again when the rendered region changes size
+*/
+void setLightClustersUniforms(const LightClusters *clusters, GLuint shaderProgram, unsigned int width, unsigned int height);
+
+/**
+ * @brief Destroy light clusters
+ * 
+ * @param clusters Pointer to the clusters
+*/
+void destroyLightClusters(LightClusters *clusters);
+
+
+#endif
@@ -1,46 +1,49 @@
 #include "collision.h"
 
 
-bool pointInBox(vec3 point, BoxCollider box) {
-    return point[0] >= box.position[0][0] && point[0] <= box.position[1][0] &&
-           point[1] >= box.position[0][1] && point[1] <= box.position[3][1] &&
-           point[2] >= box.position[0][2] && point[2] <= box.position[4][2];
-}
+// Slab test, entry is where the ray enters the box (0 if it starts inside)
+static bool slabTest(const float origin[3], const float invDirection[3], float length, const BoxCollider *box, float *entry) {
+    float tmin = -FLT_MAX, tmax = FLT_MAX;
+    for (int i=0; i<3; i++)
+    {
+        const float t1 = (box->min[i] - origin[i]) * invDirection[i];
+        const float t2 = (box->max[i] - origin[i]) * invDirection[i];
+        tmin = fmaxf(tmin, fminf(t1, t2));
+        tmax = fminf(tmax, fmaxf(t1, t2));
+    }
 
-bool pointInSphere(vec3 point, SphereCollider sphere) {
-    return glm_vec3_distance2(point, sphere.position) <= sphere.radius * sphere.radius;
+    *entry = fmaxf(tmin, 0.0f);
+    return *entry <= tmax && tmin <= length;
 }
 
-bool rayBoxIntersect(Ray ray, BoxCollider box) {
-    vec3 invDirection = {1.0f / ray.direction[0], 1.0f / ray.direction[1], 1.0f / ray.direction[2]};
-
-    float tmin = (box.position[0][0] - ray.origin[0]) * invDirection[0];
-    float tmax = (box.position[1][0] - ray.origin[0]) * invDirection[0];
-
-    float tymin = (box.position[0][1] - ray.origin[1]) * invDirection[1];
-    float tymax = (box.position[3][1] - ray.origin[1]) * invDirection[1];
-
-    if ((tmin > tymax) || (tymin > tmax)) return false;
-
-    if (tymin > tmin) tmin = tymin;
-    if (tymax < tmax) tmax = tymax;
 
-    float tzmin = (box.position[0][2] - ray.origin[2]) * invDirection[2];
-    float tzmax = (box.position[4][2] - ray.origin[2]) * invDirection[2];
+void initRay(Ray *ray, vec3 origin, vec3 direction, float length) {
+    glm_vec3_copy(origin, ray->origin);
+    glm_vec3_copy(direction, ray->direction);
+    for (int i=0; i<3; i++) ray->invDirection[i] = 1.0f / direction[i];
+    ray->length = length;
+}
 
-    if ((tmin > tzmax) || (tzmin > tmax)) return false;
+bool pointInBox(vec3 point, const BoxCollider *box) {
+    return point[0] >= box->min[0] && point[0] <= box->max[0] &&
+           point[1] >= box->min[1] && point[1] <= box->max[1] &&
+           point[2] >= box->min[2] && point[2] <= box->max[2];
+}
 
-    if (tzmin > tmin) tmin = tzmin;
-    if (tzmax < tmax) tmax = tzmax;
+bool pointInSphere(vec3 point, const SphereCollider *sphere) {
+    return glm_vec3_distance2(point, (float*)sphere->position) <= sphere->radius * sphere->radius;
+}
 
-    return (tmin < ray.length) && (tmax > 0);
+bool rayBoxIntersect(const Ray *ray, const BoxCollider *box) {
+    float entry;
+    return slabTest(ray->origin, ray->invDirection, ray->length, box, &entry);
 }
 
-bool raySphereIntersect(Ray ray, SphereCollider sphere) {
-    vec3 oc = {ray.origin[0] - sphere.position[0], ray.origin[1] - sphere.position[1], ray.origin[2] - sphere.position[2]};
-    float a = glm_vec3_dot(ray.direction, ray.direction);
-    float b = 2.0f * glm_vec3_dot(oc, ray.direction);
-    float c = glm_vec3_dot(oc, oc) - sphere.radius * sphere.radius;
+bool raySphereIntersect(const Ray *ray, const SphereCollider *sphere) {
+    vec3 oc = {ray->origin[0] - sphere->position[0], ray->origin[1] - sphere->position[1], ray->origin[2] - sphere->position[2]};
+    float a = glm_vec3_dot((float*)ray->direction, (float*)ray->direction);
+    float b = 2.0f * glm_vec3_dot(oc, (float*)ray->direction);
+    float c = glm_vec3_dot(oc, oc) - sphere->radius * sphere->radius;
     float discriminant = b * b - 4 * a * c;
 
     if (discriminant < 0) return false;
@@ -48,25 +51,434 @@ bool raySphereIntersect(Ray ray, SphereCollider sphere) {
     float t1 = (-b - sqrt(discriminant)) / (2 * a);
     float t2 = (-b + sqrt(discriminant)) / (2 * a);
     
-    return (t1 > 0 && t1 < ray.length) || (t2 > 0 && t2 < ray.length);
+    return (t1 > 0 && t1 < ray->length) || (t2 > 0 && t2 < ray->length);
+}
+
+bool boxBoxIntersect(const BoxCollider *box1, const BoxCollider *box2) {
+    return box1->min[0] <= box2->max[0] && box1->max[0] >= box2->min[0] &&
+           box1->min[1] <= box2->max[1] && box1->max[1] >= box2->min[1] &&
+           box1->min[2] <= box2->max[2] && box1->max[2] >= box2->min[2];
+}
+
+bool sphereSphereIntersect(const SphereCollider *sphere1, const SphereCollider *sphere2) {
+    return glm_vec3_distance2((float*)sphere1->position, (float*)sphere2->position) <= (sphere1->radius + sphere2->radius) * (sphere1->radius + sphere2->radius);
+}
+
+bool boxSphereIntersect(const BoxCollider *box, const SphereCollider *sphere) {
+    float x = glm_clamp(sphere->position[0], box->min[0], box->max[0]);
+    float y = glm_clamp(sphere->position[1], box->min[1], box->max[1]);
+    float z = glm_clamp(sphere->position[2], box->min[2], box->max[2]);
+
+    float distance = glm_vec3_distance2((vec3){x, y, z}, (float*)sphere->position);
+
+    return distance <= sphere->radius * sphere->radius;
+}
+
+// Moller-Trumbore
+bool rayTriangleIntersect(const Ray *ray, const TriangleCollider *triangle, float *distance) {
+    vec3 e1, e2, h, s, q;
+    glm_vec3_sub((float*)triangle->vertices[1], (float*)triangle->vertices[0], e1);
+    glm_vec3_sub((float*)triangle->vertices[2], (float*)triangle->vertices[0], e2);
+    glm_vec3_cross((float*)ray->direction, e2, h);
+    const float det = glm_vec3_dot(e1, h);
+    if (fabsf(det) <= COLLISION_EPSILON) return false;  // Parallel
+
+    const float invDet = 1.0f / det;
+    glm_vec3_sub((float*)ray->origin, (float*)triangle->vertices[0], s);
+    const float u = glm_vec3_dot(s, h) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm_vec3_cross(s, e1, q);
+    const float v = glm_vec3_dot((float*)ray->direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    const float t = glm_vec3_dot(e2, q) * invDet;
+    if (t < 0.0f || t > ray->length) return false;
+    *distance = t;
+    return true;
+}
+
+
+/* --- PACKETS --- */
+
+void initRayPacket(RayPacket *packet, const Ray *rays, unsigned int count) {
+    memset(packet, 0, sizeof(RayPacket));
+    packet->count = count < COLLISION_PACKET_SIZE ? count : COLLISION_PACKET_SIZE;
+    for (unsigned int i=0; i<packet->count; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            packet->origin[k][i] = rays[i].origin[k];
+            packet->invDirection[k][i] = rays[i].invDirection[k];
+        }
+        packet->length[i] = rays[i].length;
+    }
+}
+
+void initSpherePacket(SpherePacket *packet, const SphereCollider *spheres, unsigned int count) {
+    memset(packet, 0, sizeof(SpherePacket));
+    packet->count = count < COLLISION_PACKET_SIZE ? count : COLLISION_PACKET_SIZE;
+    for (unsigned int i=0; i<packet->count; i++)
+    {
+        for (int k=0; k<3; k++) packet->center[k][i] = spheres[i].position[k];
+        packet->radius2[i] = spheres[i].radius * spheres[i].radius;
+    }
+}
+
+void initBoxPacket(BoxPacket *packet, const BoxCollider *boxes, unsigned int count) {
+    memset(packet, 0, sizeof(BoxPacket));
+    packet->count = count < COLLISION_PACKET_SIZE ? count : COLLISION_PACKET_SIZE;
+    for (unsigned int i=0; i<packet->count; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            packet->min[k][i] = boxes[i].min[k];
+            packet->max[k][i] = boxes[i].max[k];
+        }
+    }
+}
+
+#if defined(__AVX__) || defined(__SSE__)
+
+// Each query goes in a lane, and the boxes are broadcast one after the other
+#if defined(__AVX__)
+#define LANES 8
+typedef __m256 Lanes;
+#define lanesLoad _mm256_load_ps
+#define lanesStore _mm256_store_ps
+#define lanesSet _mm256_set1_ps
+#define lanesSetInt(i) _mm256_castsi256_ps(_mm256_set1_epi32(i))
+#define lanesAdd _mm256_add_ps
+#define lanesSub _mm256_sub_ps
+#define lanesMul _mm256_mul_ps
+#define lanesMin _mm256_min_ps
+#define lanesMax _mm256_max_ps
+#define lanesAnd _mm256_and_ps
+#define lanesLessEqual(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define lanesLess(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define lanesSelect(mask, a, b) _mm256_blendv_ps(b, a, mask)
+#define lanesMask _mm256_movemask_ps
+#else
+#define LANES 4
+typedef __m128 Lanes;
+#define lanesLoad _mm_load_ps
+#define lanesStore _mm_store_ps
+#define lanesSet _mm_set1_ps
+#define lanesSetInt(i) _mm_castsi128_ps(_mm_set1_epi32(i))
+#define lanesAdd _mm_add_ps
+#define lanesSub _mm_sub_ps
+#define lanesMul _mm_mul_ps
+#define lanesMin _mm_min_ps
+#define lanesMax _mm_max_ps
+#define lanesAnd _mm_and_ps
+#define lanesLessEqual _mm_cmple_ps
+#define lanesLess _mm_cmplt_ps
+#define lanesSelect(mask, a, b) _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#define lanesMask _mm_movemask_ps
+#endif
+
+// Lanes of a packet used, unused lanes are masked out of the results
+static uint8_t getPacketMask(unsigned int count) {
+    return (uint8_t)((1u << count) - 1u);
+}
+
+// Slab test of the rays against one box, entry is where they enter the box (0 if they start inside)
+static inline Lanes lanesSlabTest(const Lanes origin[3], const Lanes invDirection[3], Lanes length, const BoxCollider *box, Lanes *entry) {
+    Lanes tmin = lanesSet(-FLT_MAX), tmax = lanesSet(FLT_MAX);
+    for (int k=0; k<3; k++)
+    {
+        const Lanes t1 = lanesMul(lanesSub(lanesSet(box->min[k]), origin[k]), invDirection[k]);
+        const Lanes t2 = lanesMul(lanesSub(lanesSet(box->max[k]), origin[k]), invDirection[k]);
+        tmin = lanesMax(tmin, lanesMin(t1, t2));
+        tmax = lanesMin(tmax, lanesMax(t1, t2));
+    }
+
+    *entry = lanesMax(tmin, lanesSet(0.0f));
+    return lanesAnd(lanesLessEqual(*entry, tmax), lanesLessEqual(tmin, length));
 }
 
-bool boxBoxIntersect(BoxCollider box1, BoxCollider box2) {
-    return box1.position[0][0] <= box2.position[1][0] && box1.position[1][0] >= box2.position[0][0] &&
-           box1.position[0][1] <= box2.position[3][1] && box1.position[3][1] >= box2.position[0][1] &&
-           box1.position[0][2] <= box2.position[4][2] && box1.position[4][2] >= box2.position[0][2];
+void rayPacketBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    memset(masks, 0, boxCount * sizeof(uint8_t));
+    for (int lane=0; lane<COLLISION_PACKET_SIZE; lane+=LANES)
+    {
+        const Lanes origin[3] = {lanesLoad(&packet->origin[0][lane]), lanesLoad(&packet->origin[1][lane]), lanesLoad(&packet->origin[2][lane])};
+        const Lanes invDirection[3] = {lanesLoad(&packet->invDirection[0][lane]), lanesLoad(&packet->invDirection[1][lane]), lanesLoad(&packet->invDirection[2][lane])};
+        const Lanes length = lanesLoad(&packet->length[lane]);
+        for (unsigned int b=0; b<boxCount; b++)
+        {
+            Lanes entry;
+            masks[b] |= lanesMask(lanesSlabTest(origin, invDirection, length, &boxes[b], &entry)) << lane;
+        }
+    }
+    for (unsigned int b=0; b<boxCount; b++) masks[b] &= getPacketMask(packet->count);
 }
 
-bool sphereSphereIntersect(SphereCollider sphere1, SphereCollider sphere2) {
-    return glm_vec3_distance2(sphere1.position, sphere2.position) <= (sphere1.radius + sphere2.radius) * (sphere1.radius + sphere2.radius);
+void rayPacketClosestBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, float distances[COLLISION_PACKET_SIZE], int indices[COLLISION_PACKET_SIZE]) {
+    _Alignas(32) float closestDistances[COLLISION_PACKET_SIZE];
+    _Alignas(32) int closestIndices[COLLISION_PACKET_SIZE];
+    for (int lane=0; lane<COLLISION_PACKET_SIZE; lane+=LANES)
+    {
+        const Lanes origin[3] = {lanesLoad(&packet->origin[0][lane]), lanesLoad(&packet->origin[1][lane]), lanesLoad(&packet->origin[2][lane])};
+        const Lanes invDirection[3] = {lanesLoad(&packet->invDirection[0][lane]), lanesLoad(&packet->invDirection[1][lane]), lanesLoad(&packet->invDirection[2][lane])};
+        const Lanes length = lanesLoad(&packet->length[lane]);
+        Lanes closest = lanesSet(FLT_MAX), index = lanesSetInt(-1);
+        for (unsigned int b=0; b<boxCount; b++)
+        {
+            Lanes entry;
+            Lanes hit = lanesSlabTest(origin, invDirection, length, &boxes[b], &entry);
+            hit = lanesAnd(hit, lanesLess(entry, closest));
+            closest = lanesSelect(hit, entry, closest);
+            index = lanesSelect(hit, lanesSetInt((int)b), index);
+        }
+        lanesStore(&closestDistances[lane], closest);
+        lanesStore((float*)&closestIndices[lane], index);
+    }
+
+    for (unsigned int i=0; i<COLLISION_PACKET_SIZE; i++)
+    {
+        distances[i] = i < packet->count ? closestDistances[i] : FLT_MAX;
+        indices[i] = i < packet->count ? closestIndices[i] : -1;
+    }
+}
+
+void spherePacketBoxes(const SpherePacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    memset(masks, 0, boxCount * sizeof(uint8_t));
+    for (int lane=0; lane<COLLISION_PACKET_SIZE; lane+=LANES)
+    {
+        const Lanes center[3] = {lanesLoad(&packet->center[0][lane]), lanesLoad(&packet->center[1][lane]), lanesLoad(&packet->center[2][lane])};
+        const Lanes radius2 = lanesLoad(&packet->radius2[lane]);
+        for (unsigned int b=0; b<boxCount; b++)
+        {
+            // Squared distance to the closest point of the box
+            Lanes distance2 = lanesSet(0.0f);
+            for (int k=0; k<3; k++)
+            {
+                const Lanes closest = lanesMin(lanesMax(center[k], lanesSet(boxes[b].min[k])), lanesSet(boxes[b].max[k]));
+                const Lanes d = lanesSub(center[k], closest);
+                distance2 = lanesAdd(distance2, lanesMul(d, d));
+            }
+            masks[b] |= lanesMask(lanesLessEqual(distance2, radius2)) << lane;
+        }
+    }
+    for (unsigned int b=0; b<boxCount; b++) masks[b] &= getPacketMask(packet->count);
+}
+
+void boxPacketBoxes(const BoxPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    memset(masks, 0, boxCount * sizeof(uint8_t));
+    for (int lane=0; lane<COLLISION_PACKET_SIZE; lane+=LANES)
+    {
+        const Lanes min[3] = {lanesLoad(&packet->min[0][lane]), lanesLoad(&packet->min[1][lane]), lanesLoad(&packet->min[2][lane])};
+        const Lanes max[3] = {lanesLoad(&packet->max[0][lane]), lanesLoad(&packet->max[1][lane]), lanesLoad(&packet->max[2][lane])};
+        for (unsigned int b=0; b<boxCount; b++)
+        {
+            Lanes overlap = lanesAnd(lanesLessEqual(min[0], lanesSet(boxes[b].max[0])), lanesLessEqual(lanesSet(boxes[b].min[0]), max[0]));
+            for (int k=1; k<3; k++) overlap = lanesAnd(overlap, lanesAnd(lanesLessEqual(min[k], lanesSet(boxes[b].max[k])), lanesLessEqual(lanesSet(boxes[b].min[k]), max[k])));
+            masks[b] |= lanesMask(overlap) << lane;
+        }
+    }
+    for (unsigned int b=0; b<boxCount; b++) masks[b] &= getPacketMask(packet->count);
+}
+
+#else
+
+// No SIMD, one lane at a time
+void rayPacketBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    for (unsigned int b=0; b<boxCount; b++)
+    {
+        masks[b] = 0;
+        for (unsigned int i=0; i<packet->count; i++)
+        {
+            const float origin[3] = {packet->origin[0][i], packet->origin[1][i], packet->origin[2][i]};
+            const float invDirection[3] = {packet->invDirection[0][i], packet->invDirection[1][i], packet->invDirection[2][i]};
+            float entry;
+            if (slabTest(origin, invDirection, packet->length[i], &boxes[b], &entry)) masks[b] |= 1u << i;
+        }
+    }
+}
+
+void rayPacketClosestBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, float distances[COLLISION_PACKET_SIZE], int indices[COLLISION_PACKET_SIZE]) {
+    for (unsigned int i=0; i<COLLISION_PACKET_SIZE; i++)
+    {
+        distances[i] = FLT_MAX;
+        indices[i] = -1;
+        if (i >= packet->count) continue;
+
+        const float origin[3] = {packet->origin[0][i], packet->origin[1][i], packet->origin[2][i]};
+        const float invDirection[3] = {packet->invDirection[0][i], packet->invDirection[1][i], packet->invDirection[2][i]};
+        for (unsigned int b=0; b<boxCount; b++)
+        {
+            float entry;
+            if (slabTest(origin, invDirection, packet->length[i], &boxes[b], &entry) && entry < distances[i]) {distances[i] = entry; indices[i] = b;}
+        }
+    }
+}
+
+void spherePacketBoxes(const SpherePacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    for (unsigned int b=0; b<boxCount; b++)
+    {
+        masks[b] = 0;
+        for (unsigned int i=0; i<packet->count; i++)
+        {
+            const SphereCollider sphere = {{packet->center[0][i], packet->center[1][i], packet->center[2][i]}, sqrtf(packet->radius2[i])};
+            if (boxSphereIntersect(&boxes[b], &sphere)) masks[b] |= 1u << i;
+        }
+    }
+}
+
+void boxPacketBoxes(const BoxPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks) {
+    for (unsigned int b=0; b<boxCount; b++)
+    {
+        masks[b] = 0;
+        for (unsigned int i=0; i<packet->count; i++)
+        {
+            const BoxCollider box = {{packet->min[0][i], packet->min[1][i], packet->min[2][i]}, {packet->max[0][i], packet->max[1][i], packet->max[2][i]}};
+            if (boxBoxIntersect(&boxes[b], &box)) masks[b] |= 1u << i;
+        }
+    }
+}
+
+#endif
+
+
+// Real-Time Collision Detection (Ericson), 5.1.5
+static void closestPointTriangle(vec3 p, const TriangleCollider *triangle, vec3 dest) {
+    const float *a = triangle->vertices[0], *b = triangle->vertices[1], *c = triangle->vertices[2];
+    vec3 ab, ac, ap, bp, cp;
+    glm_vec3_sub((float*)b, (float*)a, ab);
+    glm_vec3_sub((float*)c, (float*)a, ac);
+
+    glm_vec3_sub(p, (float*)a, ap);
+    const float d1 = glm_vec3_dot(ab, ap), d2 = glm_vec3_dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {glm_vec3_copy((float*)a, dest); return;}
+
+    glm_vec3_sub(p, (float*)b, bp);
+    const float d3 = glm_vec3_dot(ab, bp), d4 = glm_vec3_dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {glm_vec3_copy((float*)b, dest); return;}
+
+    const float vc = d1*d4 - d3*d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {glm_vec3_lerp((float*)a, (float*)b, d1 / (d1 - d3), dest); return;}
+
+    glm_vec3_sub(p, (float*)c, cp);
+    const float d5 = glm_vec3_dot(ab, cp), d6 = glm_vec3_dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {glm_vec3_copy((float*)c, dest); return;}
+
+    const float vb = d5*d2 - d1*d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {glm_vec3_lerp((float*)a, (float*)c, d2 / (d2 - d6), dest); return;}
+
+    const float va = d3*d6 - d5*d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {glm_vec3_lerp((float*)b, (float*)c, (d4 - d3) / ((d4 - d3) + (d5 - d6)), dest); return;}
+
+    const float denom = 1.0f / (va + vb + vc);
+    glm_vec3_copy((float*)a, dest);
+    glm_vec3_muladds(ab, vb * denom, dest);
+    glm_vec3_muladds(ac, vc * denom, dest);
+}
+
+// Real-Time Collision Detection (Ericson), 5.1.9
+static float closestPointsSegmentSegment(vec3 p1, vec3 q1, vec3 p2, vec3 q2, vec3 c1, vec3 c2) {
+    vec3 d1, d2, r;
+    glm_vec3_sub(q1, p1, d1);
+    glm_vec3_sub(q2, p2, d2);
+    glm_vec3_sub(p1, p2, r);
+    const float a = glm_vec3_dot(d1, d1), e = glm_vec3_dot(d2, d2), f = glm_vec3_dot(d2, r);
+
+    float s, t;
+    if (a <= COLLISION_EPSILON && e <= COLLISION_EPSILON) s = t = 0.0f;
+    else if (a <= COLLISION_EPSILON) {s = 0.0f; t = glm_clamp(f / e, 0.0f, 1.0f);}
+    else
+    {
+        const float c = glm_vec3_dot(d1, r);
+        if (e <= COLLISION_EPSILON) {t = 0.0f; s = glm_clamp(-c / a, 0.0f, 1.0f);}
+        else
+        {
+            const float b = glm_vec3_dot(d1, d2), denom = a*e - b*b;
+            s = denom != 0.0f ? glm_clamp((b*f - c*e) / denom, 0.0f, 1.0f) : 0.0f;
+            t = (b*s + f) / e;
+            if (t < 0.0f) {t = 0.0f; s = glm_clamp(-c / a, 0.0f, 1.0f);}
+            else if (t > 1.0f) {t = 1.0f; s = glm_clamp((b - c) / a, 0.0f, 1.0f);}
+        }
+    }
+
+    glm_vec3_copy(p1, c1);
+    glm_vec3_muladds(d1, s, c1);
+    glm_vec3_copy(p2, c2);
+    glm_vec3_muladds(d2, t, c2);
+    return glm_vec3_distance2(c1, c2);
 }
 
-bool boxSphereIntersect(BoxCollider box, SphereCollider sphere) {
-    float x = glm_clamp(sphere.position[0], box.position[0][0], box.position[1][0]);
-    float y = glm_clamp(sphere.position[1], box.position[0][1], box.position[3][1]);
-    float z = glm_clamp(sphere.position[2], box.position[0][2], box.position[4][2]);
+float closestPointsSegmentTriangle(vec3 p, vec3 q, const TriangleCollider *triangle, vec3 onSegment, vec3 onTriangle) {
+    // Crossing the triangle
+    vec3 pq, e1, e2, h, s, qv;
+    glm_vec3_sub(q, p, pq);
+    glm_vec3_sub((float*)triangle->vertices[1], (float*)triangle->vertices[0], e1);
+    glm_vec3_sub((float*)triangle->vertices[2], (float*)triangle->vertices[0], e2);
+    glm_vec3_cross(pq, e2, h);
+    const float det = glm_vec3_dot(e1, h);
+    if (fabsf(det) > COLLISION_EPSILON)
+    {
+        glm_vec3_sub(p, (float*)triangle->vertices[0], s);
+        const float u = glm_vec3_dot(s, h) / det;
+        glm_vec3_cross(s, e1, qv);
+        const float v = glm_vec3_dot(pq, qv) / det;
+        const float t = glm_vec3_dot(e2, qv) / det;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= 1.0f)
+        {
+            glm_vec3_copy(p, onSegment);
+            glm_vec3_muladds(pq, t, onSegment);
+            glm_vec3_copy(onSegment, onTriangle);
+            return 0.0f;
+        }
+    }
+
+    // Otherwise the closest points involve an end of the segment or an edge of the triangle
+    float best = FLT_MAX;
+    vec3 a, b;
+    closestPointTriangle(p, triangle, b);
+    if (glm_vec3_distance2(p, b) < best) {best = glm_vec3_distance2(p, b); glm_vec3_copy(p, onSegment); glm_vec3_copy(b, onTriangle);}
+    closestPointTriangle(q, triangle, b);
+    if (glm_vec3_distance2(q, b) < best) {best = glm_vec3_distance2(q, b); glm_vec3_copy(q, onSegment); glm_vec3_copy(b, onTriangle);}
+    for (int i=0; i<3; i++)
+    {
+        const float d = closestPointsSegmentSegment(p, q, (float*)triangle->vertices[i], (float*)triangle->vertices[(i+1)%3], a, b);
+        if (d < best) {best = d; glm_vec3_copy(a, onSegment); glm_vec3_copy(b, onTriangle);}
+    }
+    return best;
+}
+
+bool capsuleTriangleSweep(const CapsuleCollider *capsule, vec3 displacement, const TriangleCollider *triangle, float *toi, vec3 normal) {
+    float t = 0.0f;
+    for (int i=0; i<COLLISION_SWEEP_ITERATIONS; i++)
+    {
+        vec3 p, q, onSegment, onTriangle;
+        glm_vec3_copy((float*)capsule->base, p);
+        glm_vec3_muladds(displacement, t, p);
+        glm_vec3_copy((float*)capsule->tip, q);
+        glm_vec3_muladds(displacement, t, q);
+
+        const float distance = sqrtf(closestPointsSegmentTriangle(p, q, triangle, onSegment, onTriangle));
+        if (distance > COLLISION_EPSILON)
+        {
+            glm_vec3_sub(onSegment, onTriangle, normal);
+            glm_vec3_scale(normal, 1.0f / distance, normal);
+        }
+        else
+        {
+            // Segment crosses the triangle, push back against the move
+            glm_vec3_copy((float*)triangle->normal, normal);
+            if (glm_vec3_dot(normal, displacement) > 0.0f) glm_vec3_negate(normal);
+        }
+
+        // Closing speed, the distance doesn't decrease anymore if it is not positive
+        const float closing = -glm_vec3_dot(displacement, normal);
+        if (closing <= COLLISION_EPSILON) return false;
+
+        const float gap = distance - capsule->radius;
+        if (gap <= 1e-4f) {*toi = t; return true;}
 
-    float distance = glm_vec3_distance2((vec3){x, y, z}, sphere.position);
+        t += gap / closing;
+        if (t > 1.0f) return false;
+    }
 
-    return distance <= sphere.radius * sphere.radius;
+    *toi = t;
+    return true;
 }
@@ -2,16 +2,31 @@
 #define COLLISION_H
 
 
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
 #include <cglm/cglm.h>
 
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+
+#define COLLISION_EPSILON 1e-6f
+#define COLLISION_SWEEP_ITERATIONS 16  // Newton steps of the capsule sweep, they never overshoot the contact
+#define COLLISION_PACKET_SIZE 8  // Queries per packet, one bit each in the masks (two SSE halves without AVX)
+
 
 /**
- * @brief Box collider structure
+ * @brief Box collider structure, axis aligned
  * 
- * @param position Position of the 8 corners of the box
+ * @param min Corner with the smallest coordinates
+ * @param max Corner with the largest coordinates
 */
 typedef struct {
-    vec3 position[8];
+    vec3 min;
+    vec3 max;
 } BoxCollider;
 
 /**
@@ -30,13 +45,93 @@ typedef struct {
  * 
  * @param origin Origin of the ray
  * @param direction Direction of the ray
+ * @param invDirection Inverse of each component of the direction (automatically calculated)
+ * @param length Length of the ray, in multiples of the direction
+ * 
+ * @note Rays should be created with initRay
 */
 typedef struct {
     vec3 origin;
     vec3 direction;
+    vec3 invDirection;
     float length;
 } Ray;
 
+/**
+ * @brief Packet of rays, one per lane
+ * 
+ * @param origin Origins, coordinate after coordinate
+ * @param invDirection Inverse directions, coordinate after coordinate
+ * @param length Lengths of the rays
+ * @param count Number of rays used, the other lanes never hit
+*/
+typedef struct {
+    _Alignas(32) float origin[3][COLLISION_PACKET_SIZE];
+    _Alignas(32) float invDirection[3][COLLISION_PACKET_SIZE];
+    _Alignas(32) float length[COLLISION_PACKET_SIZE];
+    unsigned int count;
+} RayPacket;
+
+/**
+ * @brief Packet of spheres, one per lane
+ * 
+ * @param center Centers, coordinate after coordinate
+ * @param radius2 Squared radii
+ * @param count Number of spheres used, the other lanes never hit
+*/
+typedef struct {
+    _Alignas(32) float center[3][COLLISION_PACKET_SIZE];
+    _Alignas(32) float radius2[COLLISION_PACKET_SIZE];
+    unsigned int count;
+} SpherePacket;
+
+/**
+ * @brief Packet of boxes, one per lane
+ * 
+ * @param min Smallest corners, coordinate after coordinate
+ * @param max Largest corners, coordinate after coordinate
+ * @param count Number of boxes used, the other lanes never hit
+*/
+typedef struct {
+    _Alignas(32) float min[3][COLLISION_PACKET_SIZE];
+    _Alignas(32) float max[3][COLLISION_PACKET_SIZE];
+    unsigned int count;
+} BoxPacket;
+
+/**
+ * @brief Triangle collider structure
+ * 
+ * @param vertices Vertices of the triangle
+ * @param normal Unit normal of the triangle, counter-clockwise winding
+*/
+typedef struct {
+    vec3 vertices[3];
+    vec3 normal;
+} TriangleCollider;
+
+/**
+ * @brief Capsule collider structure
+ * 
+ * @param base Center of the bottom sphere
+ * @param tip Center of the top sphere
+ * @param radius Radius of the capsule
+*/
+typedef struct {
+    vec3 base;
+    vec3 tip;
+    float radius;
+} CapsuleCollider;
+
+/**
+ * @brief Initialize a ray
+ * 
+ * @param ray Pointer to the ray
+ * @param origin Origin of the ray
+ * @param direction Direction of the ray
+ * @param length Length of the ray, in multiples of the direction
+*/
+void initRay(Ray *ray, vec3 origin, vec3 direction, float length);
+
 /**
  * @brief Check if a point is inside a box
  * 
@@ -45,7 +140,7 @@ typedef struct {
  * @return true Point is inside the box
  * @return false Point is not inside the box
 */
-bool pointInBox(vec3 point, BoxCollider box);
+bool pointInBox(vec3 point, const BoxCollider *box);
 
 /**
  * @brief Check if a point is inside a sphere
@@ -55,7 +150,7 @@ bool pointInBox(vec3 point, BoxCollider box);
  * @return true Point is inside the sphere
  * @return false Point is not inside the sphere
 */
-bool pointInSphere(vec3 point, SphereCollider sphere);
+bool pointInSphere(vec3 point, const SphereCollider *sphere);
 
 /**
  * @brief Check if a ray intersects a box
@@ -65,7 +160,7 @@ bool pointInSphere(vec3 point, SphereCollider sphere);
  * @return true Ray intersects the box
  * @return false Ray does not intersect the box
 */
-bool rayBoxIntersect(Ray ray, BoxCollider box);
+bool rayBoxIntersect(const Ray *ray, const BoxCollider *box);
 
 /**
  * @brief Check if a ray intersects a sphere
@@ -75,7 +170,7 @@ bool rayBoxIntersect(Ray ray, BoxCollider box);
  * @return true Ray intersects the sphere
  * @return false Ray does not intersect the sphere
 */
-bool raySphereIntersect(Ray ray, SphereCollider sphere);
+bool raySphereIntersect(const Ray *ray, const SphereCollider *sphere);
 
 /**
  * @brief Check if a box intersects another box
@@ -85,7 +180,7 @@ bool raySphereIntersect(Ray ray, SphereCollider sphere);
  * @return true Boxes intersect
  * @return false Boxes do not intersect
 */
-bool boxBoxIntersect(BoxCollider box1, BoxCollider box2);
+bool boxBoxIntersect(const BoxCollider *box1, const BoxCollider *box2);
 
 /**
  * @brief Check if a sphere intersects another sphere
@@ -95,7 +190,7 @@ bool boxBoxIntersect(BoxCollider box1, BoxCollider box2);
  * @return true Spheres intersect
  * @return false Spheres do not intersect
 */
-bool sphereSphereIntersect(SphereCollider sphere1, SphereCollider sphere2);
+bool sphereSphereIntersect(const SphereCollider *sphere1, const SphereCollider *sphere2);
 
 /**
  * @brief Check if a box intersects a sphere
@@ -105,6 +200,114 @@ bool sphereSphereIntersect(SphereCollider sphere1, SphereCollider sphere2);
  * @return true Box intersects the sphere
  * @return false Box does not intersect the sphere
 */
-bool boxSphereIntersect(BoxCollider box, SphereCollider sphere);
+bool boxSphereIntersect(const BoxCollider *box, const SphereCollider *sphere);
+
+/**
+ * @brief Find where a ray hits a triangle, from either side
+ * 
+ * @param ray Ray
+ * @param triangle Triangle
+ * @param distance Distance to the hit, in multiples of the direction
+ * @return true Ray hits the triangle within its length
+ * @return false Ray does not hit the triangle
+*/
+bool rayTriangleIntersect(const Ray *ray, const TriangleCollider *triangle, float *distance);
+
+/**
+ * @brief Pack rays for the packet queries
+ * 
+ * @param packet Pointer to the packet
+ * @param rays Rays, created with initRay
+ * @param count Number of rays, at most COLLISION_PACKET_SIZE
+*/
+void initRayPacket(RayPacket *packet, const Ray *rays, unsigned int count);
+
+/**
+ * @brief Pack spheres for the packet queries
+ * 
+ * @param packet Pointer to the packet
+ * @param spheres Spheres
+ * @param count Number of spheres, at most COLLISION_PACKET_SIZE
+*/
+void initSpherePacket(SpherePacket *packet, const SphereCollider *spheres, unsigned int count);
+
+/**
+ * @brief Pack boxes for the packet queries
+ * 
+ * @param packet Pointer to the packet
+ * @param boxes Boxes
+ * @param count Number of boxes, at most COLLISION_PACKET_SIZE
+*/
+void initBoxPacket(BoxPacket *packet, const BoxCollider *boxes, unsigned int count);
+
+/**
+ * @brief Check which rays of a packet hit each box
+ * 
+ * @param packet Rays
+ * @param boxes Boxes
+ * @param boxCount Number of boxes
+ * @param masks For each box, bit i is set if ray i hits it
+*/
+void rayPacketBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks);
+
+/**
+ * @brief Find the first box hit by each ray of a packet
+ * 
+ * @param packet Rays
+ * @param boxes Boxes
+ * @param boxCount Number of boxes
+ * @param distances For each ray, distance to the box hit in multiples of the direction, FLT_MAX if none
+ * @param indices For each ray, index of the box hit, -1 if none
+ * 
+ * @note Rays starting inside a box hit it at distance 0
+*/
+void rayPacketClosestBoxes(const RayPacket *packet, const BoxCollider *boxes, unsigned int boxCount, float distances[COLLISION_PACKET_SIZE], int indices[COLLISION_PACKET_SIZE]);
+
+/**
+ * @brief Check which spheres of a packet overlap each box
+ * 
+ * @param packet Spheres
+ * @param boxes Boxes
+ * @param boxCount Number of boxes
+ * @param masks For each box, bit i is set if sphere i overlaps it
+*/
+void spherePacketBoxes(const SpherePacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks);
+
+/**
+ * @brief Check which boxes of a packet overlap each box
+ * 
+ * @param packet Boxes
+ * @param boxes Boxes
+ * @param boxCount Number of boxes
+ * @param masks For each box, bit i is set if box i of the packet overlaps it
+*/
+void boxPacketBoxes(const BoxPacket *packet, const BoxCollider *boxes, unsigned int boxCount, uint8_t *masks);
+
+/**
+ * @brief Find the closest points between a segment and a triangle
+ * 
+ * @param p Start of the segment
+ * @param q End of the segment
+ * @param triangle Triangle
+ * @param onSegment Closest point on the segment
+ * @param onTriangle Closest point on the triangle
+ * @return float Squared distance between the closest points, 0 if the segment crosses the triangle
+*/
+float closestPointsSegmentTriangle(vec3 p, vec3 q, const TriangleCollider *triangle, vec3 onSegment, vec3 onTriangle);
+
+/**
+ * @brief Sweep a capsule against a triangle
+ * 
+ * @param capsule Capsule at the start of the move
+ * @param displacement Move of the capsule
+ * @param triangle Triangle
+ * @param toi Fraction of the displacement done when the capsule touches the triangle
+ * @param normal Contact normal, pointing from the triangle to the capsule
+ * @return true The capsule touches the triangle during the move
+ * @return false The capsule does not touch the triangle, or already overlaps it and moves away
+ * 
+ * @note The distance between a translating segment and a triangle is convex, so Newton steps converge to the first contact from below
+*/
+bool capsuleTriangleSweep(const CapsuleCollider *capsule, vec3 displacement, const TriangleCollider *triangle, float *toi, vec3 normal);
 
 #endif
@@ -0,0 +1,283 @@
+#include "controller.h"
+
+
+/**
+ * @brief Outcome of a collide and slide move
+ * 
+ * @param blocked Whether a steep surface was hit
+ * @param ground Whether walkable ground was hit
+ * @param ceiling Whether a surface facing down was hit
+ * @param groundNormal Normal of the walkable ground hit
+*/
+typedef struct {
+    bool blocked;
+    bool ground;
+    bool ceiling;
+    vec3 groundNormal;
+} SlideResult;
+
+
+static void getCapsule(const CharacterController *controller, vec3 position, CapsuleCollider *capsule)
+{
+    glm_vec3_copy(position, capsule->base);
+    glm_vec3_copy(position, capsule->tip);
+    capsule->base[1] += controller->radius;
+    capsule->tip[1] += controller->height - controller->radius;
+    capsule->radius = controller->radius;
+}
+
+// Contacts on the edge of a walkable face (ledges, steps) count as ground, their normal is as steep as the edge is round
+static bool isWalkable(const CharacterController *controller, const TriangleCollider *triangle, vec3 normal)
+{
+    return normal[1] >= controller->maxSlopeCos || (normal[1] > 0.0f && fabsf(triangle->normal[1]) >= controller->maxSlopeCos);
+}
+
+// Earliest contact against the candidate triangles, false if the move is free
+static bool sweepCapsule(const CharacterController *controller, const LevelCollision *level, vec3 position, vec3 move, float *toi, vec3 normal, bool *walkable)
+{
+    CapsuleCollider capsule;
+    getCapsule(controller, position, &capsule);
+
+    bool hit = false;
+    *toi = 1.0f;
+    for (unsigned int i=0; i<controller->triangleCount; i++)
+    {
+        const TriangleCollider *triangle = &level->triangles[controller->triangles[i]];
+        float t;
+        vec3 n;
+        if (!capsuleTriangleSweep(&capsule, move, triangle, &t, n)) continue;
+
+        // Edges shared by a wall and a floor are hit at once, the floor wins whatever the order of the triangles
+        const bool walkableHit = isWalkable(controller, triangle, n);
+        const bool tie = hit && fabsf(t - *toi) <= COLLISION_EPSILON;
+        if (tie ? *walkable || !walkableHit : t >= *toi) continue;
+        *toi = t;
+        glm_vec3_copy(n, normal);
+        *walkable = walkableHit;
+        hit = true;
+    }
+    return hit;
+}
+
+// Move as far as possible, stopping short by the skin, returns the fraction of the move done
+static float sweepMove(const CharacterController *controller, const LevelCollision *level, vec3 position, vec3 move, vec3 normal, bool *walkable)
+{
+    *walkable = false;
+    const float length = glm_vec3_norm(move);
+    if (length < COLLISION_EPSILON) return 1.0f;
+
+    float toi;
+    const float advance = sweepCapsule(controller, level, position, move, &toi, normal, walkable) ? glm_max(toi*length - CONTROLLER_SKIN, 0.0f) / length : 1.0f;
+    glm_vec3_muladds(move, advance, position);
+    return advance;
+}
+
+static SlideResult slideMove(const CharacterController *controller, const LevelCollision *level, vec3 position, vec3 move, bool flattenSteep)
+{
+    SlideResult result = {0};
+    vec3 remaining, normal;
+    bool walkable;
+    glm_vec3_copy(move, remaining);
+
+    for (int i=0; i<CONTROLLER_MAX_SLIDES; i++)
+    {
+        glm_vec3_zero(normal);
+        const float advance = sweepMove(controller, level, position, remaining, normal, &walkable);
+        if (advance >= 1.0f) break;
+
+        if (walkable)
+        {
+            result.ground = true;
+            glm_vec3_copy(normal, result.groundNormal);
+        }
+        else
+        {
+            result.blocked = true;
+            if (normal[1] < -0.5f) result.ceiling = true;
+
+            // Walls must not lift a grounded controller, so they only push horizontally
+            if (flattenSteep && glm_vec3_norm2((vec3){normal[0], 0.0f, normal[2]}) > COLLISION_EPSILON)
+            {
+                normal[1] = 0.0f;
+                glm_vec3_normalize(normal);
+            }
+        }
+
+        // Slide along the surface with what is left
+        glm_vec3_scale(remaining, 1.0f - advance, remaining);
+        glm_vec3_mulsubs(normal, glm_vec3_dot(remaining, normal), remaining);
+        if (glm_vec3_norm2(remaining) < COLLISION_EPSILON) break;
+    }
+
+    return result;
+}
+
+// Push the capsule out of the triangles it overlaps (spawn, rounding)
+static void depenetrate(const CharacterController *controller, const LevelCollision *level, vec3 position)
+{
+    CapsuleCollider capsule;
+    getCapsule(controller, position, &capsule);
+
+    for (unsigned int i=0; i<controller->triangleCount; i++)
+    {
+        const TriangleCollider *triangle = &level->triangles[controller->triangles[i]];
+        vec3 onSegment, onTriangle, normal;
+        const float distance = sqrtf(closestPointsSegmentTriangle(capsule.base, capsule.tip, triangle, onSegment, onTriangle));
+        if (distance >= controller->radius) continue;
+
+        if (distance > COLLISION_EPSILON)
+        {
+            glm_vec3_sub(onSegment, onTriangle, normal);
+            glm_vec3_scale(normal, 1.0f / distance, normal);
+        }
+        else glm_vec3_copy((float*)triangle->normal, normal);
+
+        const float push = controller->radius - distance + CONTROLLER_SKIN;
+        glm_vec3_muladds(normal, push, position);
+        glm_vec3_muladds(normal, push, capsule.base);
+        glm_vec3_muladds(normal, push, capsule.tip);
+    }
+}
+
+
+// Every triangle the box reaches is needed, the query runs again with a larger buffer until they all fit
+static int queryTriangles(CharacterController *controller, const LevelCollision *level, vec3 box[2])
+{
+    controller->triangleCount = queryLevelTriangles(level, box, controller->triangles, controller->triangleCapacity);
+    while (controller->triangleCount == controller->triangleCapacity)
+    {
+        unsigned int *triangles = realloc(controller->triangles, 2 * controller->triangleCapacity * sizeof(unsigned int));
+        if (triangles == NULL)
+        {
+            LOG_ERROR("Failed to allocate memory for controller triangles\n");
+            return -1;
+        }
+        controller->triangles = triangles;
+        controller->triangleCapacity *= 2;
+        LOG_DEBUG("Controller triangles grown to %u\n", controller->triangleCapacity);
+        controller->triangleCount = queryLevelTriangles(level, box, controller->triangles, controller->triangleCapacity);
+    }
+    return 0;
+}
+
+
+int initCharacterController(CharacterController *controller, vec3 position)
+{
+    glm_vec3_copy(position, controller->position);
+    controller->radius = CAPSULE_RADIUS;
+    controller->height = CAPSULE_HEIGHT;
+    controller->stepHeight = STEP_HEIGHT;
+    controller->maxSlopeCos = cosf(glm_rad(MAX_SLOPE));
+    controller->verticalVelocity = 0.0f;
+    controller->onGround = false;
+    glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, controller->groundNormal);
+    controller->triangleCount = 0;
+    controller->triangleCapacity = CONTROLLER_TRIANGLES;
+    controller->triangles = malloc(controller->triangleCapacity * sizeof(unsigned int));
+    if (controller->triangles == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for controller triangles\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+static void stepCharacterController(CharacterController *controller, const LevelCollision *level, vec3 move, bool jump, float dt)
+{
+    // Broadphase, once per step : everything the capsule can reach during the step
+    const float reach = glm_vec3_norm(move) + controller->stepHeight + GROUND_SNAP + (fabsf(controller->verticalVelocity) + JUMPSPEED) * dt + CONTROLLER_SKIN;
+    vec3 box[2] = {
+        {controller->position[0] - controller->radius - reach, controller->position[1] - reach, controller->position[2] - controller->radius - reach},
+        {controller->position[0] + controller->radius + reach, controller->position[1] + controller->height + reach, controller->position[2] + controller->radius + reach}
+    };
+    if (queryTriangles(controller, level, box) < 0) return;
+
+    depenetrate(controller, level, controller->position);
+
+    // Gravity and jumping
+    if (controller->onGround && jump)
+    {
+        controller->verticalVelocity = JUMPSPEED;
+        controller->onGround = false;
+    }
+    else if (!controller->onGround)
+    {
+        controller->verticalVelocity = glm_max(controller->verticalVelocity - GRAVITY * dt, -TERMINALVELOCITY);
+    }
+
+    // Walking
+    vec3 walked;
+    glm_vec3_copy(controller->position, walked);
+    const SlideResult walk = slideMove(controller, level, walked, move, controller->onGround);
+
+    // Step up : up, forward, then down onto walkable ground, kept if it goes further
+    if (walk.blocked && controller->onGround)
+    {
+        vec3 stepped, normal;
+        bool walkable;
+        glm_vec3_copy(controller->position, stepped);
+        sweepMove(controller, level, stepped, (vec3){0.0f, controller->stepHeight, 0.0f}, normal, &walkable);
+        slideMove(controller, level, stepped, move, true);
+
+        const float climbed = stepped[1] - controller->position[1];
+        glm_vec3_zero(normal);
+        const float landed = sweepMove(controller, level, stepped, (vec3){0.0f, -climbed - CONTROLLER_SKIN, 0.0f}, normal, &walkable);
+        const float steppedDistance = glm_vec2_distance2((vec2){stepped[0], stepped[2]}, (vec2){controller->position[0], controller->position[2]});
+        const float walkedDistance = glm_vec2_distance2((vec2){walked[0], walked[2]}, (vec2){controller->position[0], controller->position[2]});
+        if (landed < 1.0f && walkable && steppedDistance > walkedDistance + COLLISION_EPSILON) glm_vec3_copy(stepped, walked);
+    }
+    glm_vec3_copy(walked, controller->position);
+
+    // Falling or jumping
+    if (!controller->onGround)
+    {
+        SlideResult fall = slideMove(controller, level, controller->position, (vec3){0.0f, controller->verticalVelocity * dt, 0.0f}, false);
+        if (fall.ground && controller->verticalVelocity <= 0.0f)
+        {
+            controller->onGround = true;
+            glm_vec3_copy(fall.groundNormal, controller->groundNormal);
+        }
+        else if (fall.ceiling && controller->verticalVelocity > 0.0f) controller->verticalVelocity = 0.0f;
+    }
+
+    // Ground snapping : stick to slopes and steps going down, or start falling off ledges
+    if (controller->onGround)
+    {
+        vec3 normal = {0.0f, 0.0f, 0.0f};
+        vec3 snapped;
+        bool walkable;
+        glm_vec3_copy(controller->position, snapped);
+        const float advance = sweepMove(controller, level, snapped, (vec3){0.0f, -GROUND_SNAP, 0.0f}, normal, &walkable);
+        if (advance < 1.0f && walkable)
+        {
+            glm_vec3_copy(snapped, controller->position);
+            glm_vec3_copy(normal, controller->groundNormal);
+            controller->verticalVelocity = 0.0f;
+        }
+        else controller->onGround = false;
+    }
+}
+
+void moveCharacterController(CharacterController *controller, const LevelCollision *level, vec3 move, bool jump, float dt)
+{
+    if (dt <= 0.0f) return;
+
+    // Longest step, the move is shortened with it
+    const float maxDt = CONTROLLER_MAX_STEP * CONTROLLER_MAX_SUBSTEPS;
+    vec3 stepMove;
+    glm_vec3_scale(move, dt > maxDt ? maxDt / dt : 1.0f, stepMove);
+    dt = glm_min(dt, maxDt);
+
+    const unsigned int steps = (unsigned int)ceilf(dt / CONTROLLER_MAX_STEP - COLLISION_EPSILON);
+    const unsigned int count = steps > 1 ? steps : 1;
+    glm_vec3_scale(stepMove, 1.0f / count, stepMove);
+    for (unsigned int i=0; i<count; i++) stepCharacterController(controller, level, stepMove, jump && i == 0, dt / count);
+}
+
+
+void destroyCharacterController(CharacterController *controller)
+{
+    free(controller->triangles); controller->triangles = NULL;
+    controller->triangleCount = controller->triangleCapacity = 0;
+}
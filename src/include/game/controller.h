@@ -0,0 +1,95 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+
+#include "collision.h"
+#include "level.h"
+#include "logs.h"
+
+
+#define GRAVITY 20.0f
+#define JUMPSPEED 7.5f
+#define TERMINALVELOCITY 50.0f
+
+#define CAPSULE_RADIUS 0.35f
+#define CAPSULE_HEIGHT 1.9f  // From the feet to the top of the head
+#define STEP_HEIGHT 0.35f  // Ledges up to this height are climbed without jumping
+#define MAX_SLOPE 46.0f  // Steepest walkable slope, in degrees
+#define GROUND_SNAP 0.3f  // Distance the controller sticks to the ground when walking down slopes and steps
+#define CONTROLLER_SKIN 0.01f  // Gap kept between the capsule and the geometry, so that contacts are not lost to rounding
+
+// Cost budget of a step : one broadphase query, then about this many triangles and sweeps
+#define CONTROLLER_TRIANGLES 128  // Candidates expected at most, the buffer grows when a query finds more
+#define CONTROLLER_MAX_SLIDES 4
+#define CONTROLLER_MAX_STEP (1.0f/60.0f)  // Longest step moved at once, longer ones are split so that the broadphase box stays small
+#define CONTROLLER_MAX_SUBSTEPS 8  // Longer delta times (hitches) are clamped, the controller slows down rather than tunnels
+
+
+/**
+ * @brief Capsule character controller structure
+ * 
+ * @param position Position of the feet (bottom of the capsule)
+ * @param radius Radius of the capsule
+ * @param height Height of the capsule
+ * @param stepHeight Height of the steps climbed
+ * @param maxSlopeCos Cosine of the steepest walkable slope
+ * @param verticalVelocity Vertical speed (gravity and jumping)
+ * @param onGround Whether the controller stands on walkable ground
+ * @param groundNormal Normal of the ground, if on ground
+ * @param triangles Candidate triangles of the current step
+ * @param triangleCount Number of candidate triangles
+ * @param triangleCapacity Size of the candidate buffer
+*/
+typedef struct {
+    vec3 position;
+    float radius, height;
+    float stepHeight;
+    float maxSlopeCos;
+
+    float verticalVelocity;
+    bool onGround;
+    vec3 groundNormal;
+
+    unsigned int *triangles;
+    unsigned int triangleCount;
+    unsigned int triangleCapacity;
+} CharacterController;
+
+
+/**
+ * @brief Initialize a character controller
+ * 
+ * @param controller Pointer to the controller
+ * @param position Position of the feet
+ * @return int 0 if success, -1 if error
+*/
+int initCharacterController(CharacterController *controller, vec3 position);
+
+/**
+ * @brief Move a character controller through the level, sliding along walls
+ * 
+ * @param controller Pointer to the controller
+ * @param level Level collision
+ * @param move Horizontal move wanted for this step
+ * @param jump Whether to jump, if on ground
+ * @param dt Delta time
+ * 
+ * @note Steps longer than CONTROLLER_MAX_STEP are split, and clamped to CONTROLLER_MAX_SUBSTEPS of them
+*/
+void moveCharacterController(CharacterController *controller, const LevelCollision *level, vec3 move, bool jump, float dt);
+
+/**
+ * @brief Destroy a character controller
+ * 
+ * @param controller Pointer to the controller
+*/
+void destroyCharacterController(CharacterController *controller);
+
+
+#endif
@@ -0,0 +1,109 @@
+#include "deferred.h"
+
+
+static int loadProgram(GLuint *program, const char *firstPath, GLenum firstType, const char *secondPath, GLenum secondType)
+{
+    Shader first, second;
+    if (loadShader(&first, firstPath, firstType) < 0) return -1;
+    if (secondPath && loadShader(&second, secondPath, secondType) < 0) {destroyShader(&first); return -1;}
+
+    const int result = secondPath ? initShaderProgram(program, 2, &first, &second) : initShaderProgram(program, 1, &first);
+    destroyShader(&first);
+    if (secondPath) destroyShader(&second);
+    return result;
+}
+
+
+int initDeferredRenderer(DeferredRenderer *renderer, const RenderTarget *target, DeferredLighting lighting)
+{
+    renderer->lighting = lighting;
+    if (initGBuffer(&renderer->gbuffer, target) < 0) return -1;
+
+    if (loadProgram(&renderer->shaderProgramGeometry, "vertex.vert", GL_VERTEX_SHADER, "gbuffer.frag", GL_FRAGMENT_SHADER) < 0
+        || (lighting == DEFERRED_TILED
+            ? loadProgram(&renderer->shaderProgramLighting, "tiled.comp", GL_COMPUTE_SHADER, NULL, 0)
+            : loadProgram(&renderer->shaderProgramLighting, "volume.vert", GL_VERTEX_SHADER, "volume.frag", GL_FRAGMENT_SHADER)) < 0)
+    {
+        LOG_ERROR("Could not create deferred shader programs\n");
+        destroyDeferredRenderer(renderer);
+        return -1;
+    }
+
+    LOG_DEBUG("Initialized deferred renderer with %s\n", lighting == DEFERRED_TILED ? "tiled lighting" : "light volumes");
+    return 0;
+}
+
+
+void renderDeferredGeometry(DeferredRenderer *renderer, const RenderTarget *target, const Scene *scene, mat4 view)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->gbuffer.fbo);
+    glViewport(0, 0, target->viewWidth, target->viewHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(renderer->shaderProgramGeometry);
+    glUniformMatrix4fv(glGetUniformLocation(renderer->shaderProgramGeometry, "view"), 1, GL_FALSE, (float*)view);
+    renderScene(scene, renderer->shaderProgramGeometry);
+}
+
+void renderDeferredLighting(DeferredRenderer *renderer, const RenderTarget *target, unsigned int lightCount, GLuint cubeVAO, mat4 view, mat4 projection, vec3 viewPos)
+{
+    const GLuint program = renderer->shaderProgramLighting;
+
+    static mat4 viewProjection, inverseViewProjection, inverseProjection;
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_mat4_inv(viewProjection, inverseViewProjection);
+    glm_mat4_inv(projection, inverseProjection);
+
+    bindGBufferTextures(&renderer->gbuffer, program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "inverseViewProjection"), 1, GL_FALSE, (float*)inverseViewProjection);
+    glUniform3f(glGetUniformLocation(program, "viewPos"), viewPos[0], viewPos[1], viewPos[2]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, (float*)view);
+    glUniform2f(glGetUniformLocation(program, "renderSize"), (float)target->viewWidth, (float)target->viewHeight);
+
+    if (renderer->lighting == DEFERRED_TILED)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program, "inverseProjection"), 1, GL_FALSE, (float*)inverseProjection);
+        glUniform1ui(glGetUniformLocation(program, "lightCount"), lightCount);
+        glBindImageTexture(0, target->colorTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, RENDER_TARGET_COLOR_FORMAT);
+        glDispatchCompute((target->viewWidth + DEFERRED_TILE_SIZE-1) / DEFERRED_TILE_SIZE, (target->viewHeight + DEFERRED_TILE_SIZE-1) / DEFERRED_TILE_SIZE, 1);
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        bindRenderTarget(target);
+    }
+    else
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float*)projection);
+        bindRenderTarget(target);
+
+        // Back faces behind the surface : works with the camera inside a volume, and clamped instead of clipped by the far plane
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_GEQUAL);
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_CLAMP);
+
+        glBindVertexArray(cubeVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lightCount);
+        glBindVertexArray(0);
+
+        glDisable(GL_DEPTH_CLAMP);
+        glCullFace(GL_BACK);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
+}
+
+
+int resizeDeferredRenderer(DeferredRenderer *renderer, const RenderTarget *target)
+{
+    destroyGBuffer(&renderer->gbuffer);
+    return initGBuffer(&renderer->gbuffer, target);
+}
+
+void destroyDeferredRenderer(DeferredRenderer *renderer)
+{
+    destroyGBuffer(&renderer->gbuffer);
+    if (renderer->shaderProgramGeometry) {glDeleteProgram(renderer->shaderProgramGeometry); renderer->shaderProgramGeometry = 0;}
+    if (renderer->shaderProgramLighting) {glDeleteProgram(renderer->shaderProgramLighting); renderer->shaderProgramLighting = 0;}
+}
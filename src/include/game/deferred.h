@@ -0,0 +1,104 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+#include <GL/glew.h>
+
+#include "framebuffer.h"
+#include "logs.h"
+#include "scene.h"
+#include "shader.h"
+
+
+#define DEFERRED_TILE_SIZE 16  // Must match TILE_SIZE in tiled.comp
+
+
+/**
+ * @brief Lighting of the deferred renderer
+ * 
+ * @note DEFERRED_LIGHT_VOLUMES : one instanced cube per light, additively blended, only covering the pixels in its range
+ * @note DEFERRED_TILED : one compute pass, lights are culled per screen tile against its depth bounds
+*/
+typedef enum {
+    DEFERRED_LIGHT_VOLUMES,
+    DEFERRED_TILED
+} DeferredLighting;
+
+/**
+ * @brief Deferred renderer structure
+ * 
+ * @param gbuffer Geometry buffer
+ * @param lighting Lighting technique
+ * @param shaderProgramGeometry Shader program filling the geometry buffer
+ * @param shaderProgramLighting Shader program shading the geometry buffer
+*/
+typedef struct {
+    GBuffer gbuffer;
+    DeferredLighting lighting;
+
+    GLuint shaderProgramGeometry;
+    GLuint shaderProgramLighting;
+} DeferredRenderer;
+
+
+/**
+ * @brief Create the deferred renderer
+ * 
+ * @param renderer Pointer to the renderer
+ * @param target Single sample render target receiving the lighting, its depth is shared with the geometry buffer
+ * @param lighting Lighting technique
+ * @return int 0 if success, -1 if error
+*/
+int initDeferredRenderer(DeferredRenderer *renderer, const RenderTarget *target, DeferredLighting lighting);
+
+/**
+ * @brief Fill the geometry buffer
+ * 
+ * @param renderer Pointer to the renderer
+ * @param target Render target whose depth is shared, only its rendered region is filled
+ * @param scene Scene to render
+ * @param view View matrix of the camera
+ * 
+ * @note Projection uniform of the geometry shader program must already be set
+ * @note Depth of the render target is written
+*/
+void renderDeferredGeometry(DeferredRenderer *renderer, const RenderTarget *target, const Scene *scene, mat4 view);
+
+/**
+ * @brief Shade the geometry buffer into the render target
+ * 
+ * @param renderer Pointer to the renderer
+ * @param target Render target receiving the lighting
+ * @param lightCount Number of lights in the light buffer (see cluster.h)
+ * @param cubeVAO Vertex array of a unit cube, used by light volumes
+ * @param view View matrix of the camera
+ * @param projection Projection matrix of the camera
+ * @param viewPos Position of the camera
+ * 
+ * @note Lighting shader program must be in use with the light buffer and shadow maps bound
+ * @note Render target is bound after the function call
+*/
+void renderDeferredLighting(DeferredRenderer *renderer, const RenderTarget *target, unsigned int lightCount, GLuint cubeVAO, mat4 view, mat4 projection, vec3 viewPos);
+
+/**
+ * @brief Reallocate the geometry buffer after the render target changed size
+ * 
+ * @param renderer Pointer to the renderer
+ * @param target Single sample render target whose depth is shared
+ * @return int 0 if success, -1 if error
+*/
+int resizeDeferredRenderer(DeferredRenderer *renderer, const RenderTarget *target);
+
+/**
+ * @brief Destroy the deferred renderer
+ * 
+ * @param renderer Pointer to the renderer
+*/
+void destroyDeferredRenderer(DeferredRenderer *renderer);
+
+
+#endif
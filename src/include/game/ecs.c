@@ -0,0 +1,426 @@
+#include "ecs.h"
+
+
+/* --- STORAGE --- */
+
+static int growArchetype(World *world, Archetype *archetype)
+{
+    const unsigned int capacity = archetype->capacity ? archetype->capacity * 2 : ECS_INITIAL_CAPACITY;
+
+    Entity *entities = realloc(archetype->entities, capacity * sizeof(Entity));
+    if (!entities) {LOG_ERROR("Could not grow archetype 0x%x\n", archetype->mask); return -1;}
+    archetype->entities = entities;
+
+    for (unsigned int c=0; c<world->componentCount; c++)
+    {
+        if (!(archetype->mask & COMPONENT_BIT(c))) continue;
+        uint8_t *column = realloc(archetype->columns[c], capacity * world->componentSizes[c]);
+        if (!column) {LOG_ERROR("Could not grow archetype 0x%x\n", archetype->mask); return -1;}
+        archetype->columns[c] = column;
+    }
+
+    archetype->capacity = capacity;
+    return 0;
+}
+
+static int findArchetype(World *world, ComponentMask mask)
+{
+    for (unsigned int i=0; i<world->archetypeCount; i++)
+        if (world->archetypes[i].mask == mask) return i;
+
+    if (world->archetypeCount == ECS_MAX_ARCHETYPES)
+    {
+        LOG_ERROR("Too many archetypes (%d)\n", ECS_MAX_ARCHETYPES);
+        return -1;
+    }
+    Archetype *archetype = &world->archetypes[world->archetypeCount];
+    memset(archetype, 0, sizeof(Archetype));
+    archetype->mask = mask;
+    return world->archetypeCount++;
+}
+
+static int appendRow(World *world, int archetypeIndex, Entity entity)
+{
+    Archetype *archetype = &world->archetypes[archetypeIndex];
+    if (archetype->count == archetype->capacity && growArchetype(world, archetype) < 0) return -1;
+    archetype->entities[archetype->count] = entity;
+    return archetype->count++;
+}
+
+// The last row fills the hole, so columns stay packed
+static void removeRow(World *world, int archetypeIndex, unsigned int row)
+{
+    Archetype *archetype = &world->archetypes[archetypeIndex];
+    const unsigned int last = --archetype->count;
+    if (row == last) return;
+
+    archetype->entities[row] = archetype->entities[last];
+    for (unsigned int c=0; c<world->componentCount; c++)
+    {
+        if (!archetype->columns[c]) continue;
+        const size_t size = world->componentSizes[c];
+        memcpy(archetype->columns[c] + row*size, archetype->columns[c] + last*size, size);
+    }
+    world->records[archetype->entities[row].index].row = row;
+}
+
+static int moveEntity(World *world, Entity entity, ComponentMask mask)
+{
+    EntityRecord *record = &world->records[entity.index];
+    const int source = record->archetype;
+    const int destination = findArchetype(world, mask);
+    if (destination < 0) return -1;
+    if (destination == source) return 0;
+
+    const int row = appendRow(world, destination, entity);
+    if (row < 0) return -1;
+
+    const Archetype *from = &world->archetypes[source];
+    Archetype *to = &world->archetypes[destination];
+    for (unsigned int c=0; c<world->componentCount; c++)
+    {
+        if (!(from->mask & to->mask & COMPONENT_BIT(c))) continue;
+        const size_t size = world->componentSizes[c];
+        memcpy(to->columns[c] + row*size, from->columns[c] + record->row*size, size);
+    }
+
+    removeRow(world, source, record->row);
+    record->archetype = destination;
+    record->row = row;
+    return 0;
+}
+
+
+/* --- RECORDS --- */
+
+// Indices reserved by deferCreateEntity become pending records
+static int materializeRecords(World *world)
+{
+    const unsigned int count = world->recordCount + world->reservedCount;
+    if (count > world->recordCapacity)
+    {
+        unsigned int capacity = world->recordCapacity ? world->recordCapacity : ECS_INITIAL_CAPACITY;
+        while (capacity < count) capacity *= 2;
+        EntityRecord *records = realloc(world->records, capacity * sizeof(EntityRecord));
+        uint32_t *freeIndices = realloc(world->freeIndices, capacity * sizeof(uint32_t));
+        if (records) world->records = records;
+        if (freeIndices) world->freeIndices = freeIndices;
+        if (!records || !freeIndices) {LOG_ERROR("Could not allocate %d entity records\n", capacity); return -1;}
+        world->recordCapacity = capacity;
+    }
+
+    for (unsigned int i=world->recordCount; i<count; i++) world->records[i] = (EntityRecord){0, ECS_RECORD_PENDING, 0};
+    world->recordCount = count;
+    world->reservedCount = 0;
+    return 0;
+}
+
+static bool isRecordValid(const World *world, Entity entity)
+{
+    return entity.index < world->recordCount && world->records[entity.index].generation == entity.generation && world->records[entity.index].archetype >= 0;
+}
+
+static void freeRecord(World *world, uint32_t index)
+{
+    world->records[index].generation++;
+    world->records[index].archetype = ECS_RECORD_FREE;
+    world->freeIndices[world->freeCount++] = index;
+}
+
+
+/* --- WORLD --- */
+
+int initWorld(World *world)
+{
+    memset(world, 0, sizeof(World));
+
+    world->commandMutex = SDL_CreateMutex();
+    if (!world->commandMutex)
+    {
+        LOG_ERROR("Could not create world mutex: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    // Entities without components
+    findArchetype(world, 0);
+    return 0;
+}
+
+int registerComponent(World *world, size_t size)
+{
+    if (world->componentCount == ECS_MAX_COMPONENTS)
+    {
+        LOG_ERROR("Too many components (%d)\n", ECS_MAX_COMPONENTS);
+        return -1;
+    }
+    world->componentSizes[world->componentCount] = size;
+    return world->componentCount++;
+}
+
+
+int createEntity(World *world, Entity *entity)
+{
+    if (world->freeCount == 0)
+    {
+        world->reservedCount++;
+        if (materializeRecords(world) < 0) return -1;
+        entity->index = world->recordCount - 1;
+    }
+    else entity->index = world->freeIndices[--world->freeCount];
+    entity->generation = world->records[entity->index].generation;
+
+    const int row = appendRow(world, 0, *entity);
+    if (row < 0) {freeRecord(world, entity->index); return -1;}
+    world->records[entity->index].archetype = 0;
+    world->records[entity->index].row = row;
+    return 0;
+}
+
+void destroyEntity(World *world, Entity entity)
+{
+    if (entity.index < world->recordCount && world->records[entity.index].generation == entity.generation && world->records[entity.index].archetype == ECS_RECORD_PENDING)
+    {
+        freeRecord(world, entity.index);
+        return;
+    }
+    if (!isRecordValid(world, entity)) return;
+    removeRow(world, world->records[entity.index].archetype, world->records[entity.index].row);
+    freeRecord(world, entity.index);
+}
+
+bool isEntityAlive(const World *world, Entity entity)
+{
+    // Reserved past the records, not flushed yet
+    if (entity.index >= world->recordCount) return entity.index < world->recordCount + world->reservedCount && entity.generation == 0;
+    return world->records[entity.index].generation == entity.generation && world->records[entity.index].archetype != ECS_RECORD_FREE;
+}
+
+
+int addComponent(World *world, Entity entity, unsigned int component, const void *data)
+{
+    if (!isRecordValid(world, entity) || component >= world->componentCount) return -1;
+
+    const ComponentMask mask = world->archetypes[world->records[entity.index].archetype].mask | COMPONENT_BIT(component);
+    if (moveEntity(world, entity, mask) < 0) return -1;
+
+    void *value = getComponent(world, entity, component);
+    if (data) memcpy(value, data, world->componentSizes[component]);
+    else memset(value, 0, world->componentSizes[component]);
+    return 0;
+}
+
+int removeComponent(World *world, Entity entity, unsigned int component)
+{
+    if (!isRecordValid(world, entity) || component >= world->componentCount) return -1;
+
+    const ComponentMask mask = world->archetypes[world->records[entity.index].archetype].mask & ~COMPONENT_BIT(component);
+    return moveEntity(world, entity, mask);
+}
+
+void *getComponent(World *world, Entity entity, unsigned int component)
+{
+    if (!isRecordValid(world, entity)) return NULL;
+    const EntityRecord *record = &world->records[entity.index];
+    uint8_t *column = getArchetypeColumn(&world->archetypes[record->archetype], component);
+    return column ? column + record->row * world->componentSizes[component] : NULL;
+}
+
+void *getArchetypeColumn(const Archetype *archetype, unsigned int component)
+{
+    return component < ECS_MAX_COMPONENTS ? archetype->columns[component] : NULL;
+}
+
+void queryWorld(World *world, ComponentMask mask, void (*function)(Archetype *archetype, void *data), void *data)
+{
+    for (unsigned int i=0; i<world->archetypeCount; i++)
+    {
+        Archetype *archetype = &world->archetypes[i];
+        if (archetype->count > 0 && (archetype->mask & mask) == mask) function(archetype, data);
+    }
+}
+
+
+/* --- DEFERRED CHANGES --- */
+
+// Mutex must be locked
+static EcsCommand *pushCommand(World *world, EcsCommandType type, Entity entity, unsigned int component)
+{
+    if (world->commandCount == world->commandCapacity)
+    {
+        const unsigned int capacity = world->commandCapacity ? world->commandCapacity * 2 : ECS_INITIAL_CAPACITY;
+        EcsCommand *commands = realloc(world->commands, capacity * sizeof(EcsCommand));
+        if (!commands) {LOG_ERROR("Could not allocate %d deferred changes\n", capacity); return NULL;}
+        world->commands = commands;
+        world->commandCapacity = capacity;
+    }
+    EcsCommand *command = &world->commands[world->commandCount++];
+    *command = (EcsCommand){type, entity, component, 0};
+    return command;
+}
+
+int deferCreateEntity(World *world, Entity *entity)
+{
+    SDL_LockMutex(world->commandMutex);
+
+    // Records are not reallocated here, other systems may be reading them
+    if (world->freeCount > 0)
+    {
+        entity->index = world->freeIndices[--world->freeCount];
+        entity->generation = world->records[entity->index].generation;
+        world->records[entity->index].archetype = ECS_RECORD_PENDING;
+    }
+    else
+    {
+        entity->index = world->recordCount + world->reservedCount++;
+        entity->generation = 0;
+    }
+    const int result = pushCommand(world, ECS_COMMAND_CREATE, *entity, 0) ? 0 : -1;
+
+    SDL_UnlockMutex(world->commandMutex);
+    return result;
+}
+
+void deferDestroyEntity(World *world, Entity entity)
+{
+    SDL_LockMutex(world->commandMutex);
+    pushCommand(world, ECS_COMMAND_DESTROY, entity, 0);
+    SDL_UnlockMutex(world->commandMutex);
+}
+
+int deferAddComponent(World *world, Entity entity, unsigned int component, const void *data)
+{
+    if (component >= world->componentCount) return -1;
+    const size_t size = world->componentSizes[component];
+
+    SDL_LockMutex(world->commandMutex);
+    if (world->commandDataSize + size > world->commandDataCapacity)
+    {
+        size_t capacity = world->commandDataCapacity ? world->commandDataCapacity : ECS_INITIAL_CAPACITY * sizeof(float) * 4;
+        while (capacity < world->commandDataSize + size) capacity *= 2;
+        uint8_t *commandData = realloc(world->commandData, capacity);
+        if (!commandData)
+        {
+            LOG_ERROR("Could not allocate %zu bytes of deferred components\n", capacity);
+            SDL_UnlockMutex(world->commandMutex);
+            return -1;
+        }
+        world->commandData = commandData;
+        world->commandDataCapacity = capacity;
+    }
+
+    EcsCommand *command = pushCommand(world, ECS_COMMAND_ADD, entity, component);
+    if (command)
+    {
+        command->dataOffset = world->commandDataSize;
+        if (data) memcpy(world->commandData + world->commandDataSize, data, size);
+        else memset(world->commandData + world->commandDataSize, 0, size);
+        world->commandDataSize += size;
+    }
+
+    SDL_UnlockMutex(world->commandMutex);
+    return command ? 0 : -1;
+}
+
+void deferRemoveComponent(World *world, Entity entity, unsigned int component)
+{
+    SDL_LockMutex(world->commandMutex);
+    pushCommand(world, ECS_COMMAND_REMOVE, entity, component);
+    SDL_UnlockMutex(world->commandMutex);
+}
+
+void flushWorld(World *world)
+{
+    if (materializeRecords(world) < 0) return;
+
+    for (unsigned int i=0; i<world->commandCount; i++)
+    {
+        const EcsCommand *command = &world->commands[i];
+        const Entity entity = command->entity;
+        switch (command->type)
+        {
+            case ECS_COMMAND_CREATE:
+            {
+                EntityRecord *record = &world->records[entity.index];
+                if (record->generation != entity.generation || record->archetype != ECS_RECORD_PENDING) break;  // Destroyed meanwhile
+                const int row = appendRow(world, 0, entity);
+                if (row < 0) {freeRecord(world, entity.index); break;}
+                record->archetype = 0;
+                record->row = row;
+                break;
+            }
+            case ECS_COMMAND_DESTROY:
+                destroyEntity(world, entity);
+                break;
+            case ECS_COMMAND_ADD:
+                addComponent(world, entity, command->component, world->commandData + command->dataOffset);
+                break;
+            case ECS_COMMAND_REMOVE:
+                removeComponent(world, entity, command->component);
+                break;
+        }
+    }
+
+    world->commandCount = 0;
+    world->commandDataSize = 0;
+}
+
+
+/* --- SYSTEMS --- */
+
+typedef struct {
+    World *world;
+    const System *system;
+    float dt;
+} SystemJob;
+
+static void runSystemJob(void *data)
+{
+    const SystemJob *job = data;
+    job->system->function(job->world, job->dt);
+}
+
+void runSystems(World *world, const System *systems, unsigned int systemCount, JobSystem *jobs, float dt)
+{
+    static SystemJob systemJobs[ECS_MAX_SYSTEMS];
+    if (systemCount > ECS_MAX_SYSTEMS)
+    {
+        LOG_ERROR("Too many systems (%d), only the first %d run\n", systemCount, ECS_MAX_SYSTEMS);
+        systemCount = ECS_MAX_SYSTEMS;
+    }
+
+    // Systems run in waves, a wave ends before a system touching what the wave writes, or writing what it reads
+    ComponentMask waveReads = 0, waveWrites = 0;
+    for (unsigned int i=0; i<systemCount; i++)
+    {
+        const System *system = &systems[i];
+        if ((system->writes & (waveReads | waveWrites)) || (system->reads & waveWrites))
+        {
+            waitJobs(jobs);
+            waveReads = waveWrites = 0;
+        }
+        waveReads |= system->reads;
+        waveWrites |= system->writes;
+
+        systemJobs[i] = (SystemJob){world, system, dt};
+        submitJob(jobs, runSystemJob, &systemJobs[i]);
+    }
+    waitJobs(jobs);
+
+    flushWorld(world);
+}
+
+
+void destroyWorld(World *world)
+{
+    for (unsigned int i=0; i<world->archetypeCount; i++)
+    {
+        free(world->archetypes[i].entities);
+        for (unsigned int c=0; c<ECS_MAX_COMPONENTS; c++) free(world->archetypes[i].columns[c]);
+    }
+    free(world->records);
+    free(world->freeIndices);
+    free(world->commands);
+    free(world->commandData);
+    if (world->commandMutex) SDL_DestroyMutex(world->commandMutex);
+    memset(world, 0, sizeof(World));
+}
@@ -0,0 +1,316 @@
+#ifndef ECS_H
+#define ECS_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "jobs.h"
+#include "logs.h"
+
+
+#define ECS_MAX_COMPONENTS 32  // Bits of a ComponentMask
+#define ECS_MAX_ARCHETYPES 64
+#define ECS_MAX_SYSTEMS 32
+#define ECS_INITIAL_CAPACITY 64  // Rows allocated the first time an archetype is used
+
+#define COMPONENT_BIT(component) ((ComponentMask)1 << (component))
+
+#define ECS_RECORD_FREE -1  // Entity destroyed, the index can be reused
+#define ECS_RECORD_PENDING -2  // Entity reserved by deferCreateEntity, created on the next flush
+
+
+typedef uint32_t ComponentMask;
+
+/**
+ * @brief Entity handle
+ * 
+ * @param index Index of the entity record
+ * @param generation Generation of the record when the handle was created, stale handles don't match anymore
+*/
+typedef struct {
+    uint32_t index;
+    uint32_t generation;
+} Entity;
+
+/**
+ * @brief Storage of every entity sharing the same set of components
+ * 
+ * @param mask Components of the archetype
+ * @param count Number of entities
+ * @param capacity Number of entities allocated
+ * @param entities Handle of each entity
+ * @param columns One packed array per component in the mask, NULL for the others
+*/
+typedef struct {
+    ComponentMask mask;
+    unsigned int count, capacity;
+    Entity *entities;
+    uint8_t *columns[ECS_MAX_COMPONENTS];
+} Archetype;
+
+/**
+ * @brief Where an entity lives
+ * 
+ * @param generation Incremented each time the record is freed
+ * @param archetype Index of the archetype, ECS_RECORD_FREE or ECS_RECORD_PENDING
+ * @param row Row of the entity in its archetype
+*/
+typedef struct {
+    uint32_t generation;
+    int archetype;
+    unsigned int row;
+} EntityRecord;
+
+typedef enum {
+    ECS_COMMAND_CREATE,
+    ECS_COMMAND_DESTROY,
+    ECS_COMMAND_ADD,
+    ECS_COMMAND_REMOVE
+} EcsCommandType;
+
+/**
+ * @brief Structural change recorded while systems run
+ * 
+ * @param type Type of the change
+ * @param entity Entity changed
+ * @param component Component added or removed
+ * @param dataOffset Offset of the component value in the command data
+*/
+typedef struct {
+    EcsCommandType type;
+    Entity entity;
+    unsigned int component;
+    size_t dataOffset;
+} EcsCommand;
+
+/**
+ * @brief Entity-component world
+ * 
+ * @param componentSizes Size of each registered component
+ * @param componentCount Number of registered components
+ * @param archetypes Archetypes, the first one has no component
+ * @param archetypeCount Number of archetypes
+ * @param records Record of each entity index
+ * @param recordCount Number of records used
+ * @param recordCapacity Number of records allocated
+ * @param reservedCount Number of indices reserved past recordCount by deferCreateEntity, not yet in the records
+ * @param freeIndices Records that can be reused
+ * @param freeCount Number of records that can be reused
+ * @param commands Deferred structural changes
+ * @param commandCount Number of deferred changes
+ * @param commandCapacity Number of deferred changes allocated
+ * @param commandData Component values of the deferred changes
+ * @param commandDataSize Bytes of component values used
+ * @param commandDataCapacity Bytes of component values allocated
+ * @param commandMutex Protects the deferred changes and the free indices, systems may run on several threads
+ * 
+ * @note Entities are moved between archetypes when their components change, handles stay valid
+*/
+typedef struct {
+    size_t componentSizes[ECS_MAX_COMPONENTS];
+    unsigned int componentCount;
+
+    Archetype archetypes[ECS_MAX_ARCHETYPES];
+    unsigned int archetypeCount;
+
+    EntityRecord *records;
+    unsigned int recordCount, recordCapacity;
+    unsigned int reservedCount;
+    uint32_t *freeIndices;
+    unsigned int freeCount;
+
+    EcsCommand *commands;
+    unsigned int commandCount, commandCapacity;
+    uint8_t *commandData;
+    size_t commandDataSize, commandDataCapacity;
+    SDL_mutex *commandMutex;
+} World;
+
+typedef void (*SystemFunction)(World *world, float dt);
+
+/**
+ * @brief System structure
+ * 
+ * @param name Name of the system
+ * @param reads Components read by the system
+ * @param writes Components written by the system
+ * @param function Function updating the components
+ * 
+ * @note Systems whose accesses don't conflict run at the same time, they must only change the structure of the world through deferred functions
+*/
+typedef struct {
+    const char *name;
+    ComponentMask reads, writes;
+    SystemFunction function;
+} System;
+
+
+/**
+ * @brief Create an empty world
+ * 
+ * @param world Pointer to the world
+ * @return int 0 if success, -1 if error
+*/
+int initWorld(World *world);
+
+/**
+ * @brief Register a component type
+ * 
+ * @param world Pointer to the world
+ * @param size Size of the component
+ * @return int Identifier of the component, -1 if error
+ * 
+ * @note Components should be registered before any entity is created
+*/
+int registerComponent(World *world, size_t size);
+
+/**
+ * @brief Create an entity without components
+ * 
+ * @param world Pointer to the world
+ * @param entity Handle of the entity created
+ * @return int 0 if success, -1 if error
+*/
+int createEntity(World *world, Entity *entity);
+
+/**
+ * @brief Destroy an entity and its components
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to destroy
+*/
+void destroyEntity(World *world, Entity entity);
+
+/**
+ * @brief Check whether a handle still refers to a living entity
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to check
+ * @return bool true if alive
+*/
+bool isEntityAlive(const World *world, Entity entity);
+
+/**
+ * @brief Add a component to an entity, or overwrite it
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to change
+ * @param component Component to add
+ * @param data Value of the component, zeroed if NULL
+ * @return int 0 if success, -1 if error
+*/
+int addComponent(World *world, Entity entity, unsigned int component, const void *data);
+
+/**
+ * @brief Remove a component from an entity
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to change
+ * @param component Component to remove
+ * @return int 0 if success, -1 if error
+*/
+int removeComponent(World *world, Entity entity, unsigned int component);
+
+/**
+ * @brief Get a component of an entity
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to read
+ * @param component Component to read
+ * @return void* Pointer to the component, NULL if the entity doesn't have it
+ * 
+ * @note The pointer is invalidated by the next structural change
+*/
+void *getComponent(World *world, Entity entity, unsigned int component);
+
+/**
+ * @brief Get the packed array of a component in an archetype
+ * 
+ * @param archetype Archetype to read
+ * @param component Component to read
+ * @return void* First element of the array, NULL if the archetype doesn't have the component
+*/
+void *getArchetypeColumn(const Archetype *archetype, unsigned int component);
+
+/**
+ * @brief Call a function on every archetype having a set of components
+ * 
+ * @param world Pointer to the world
+ * @param mask Components required
+ * @param function Function called on each matching archetype
+ * @param data Argument of the function
+*/
+void queryWorld(World *world, ComponentMask mask, void (*function)(Archetype *archetype, void *data), void *data);
+
+/**
+ * @brief Reserve an entity, created on the next flush
+ * 
+ * @param world Pointer to the world
+ * @param entity Handle of the entity reserved
+ * @return int 0 if success, -1 if error
+*/
+int deferCreateEntity(World *world, Entity *entity);
+
+/**
+ * @brief Destroy an entity on the next flush
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to destroy
+*/
+void deferDestroyEntity(World *world, Entity entity);
+
+/**
+ * @brief Add a component to an entity on the next flush
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to change
+ * @param component Component to add
+ * @param data Value of the component, copied immediately, zeroed if NULL
+ * @return int 0 if success, -1 if error
+*/
+int deferAddComponent(World *world, Entity entity, unsigned int component, const void *data);
+
+/**
+ * @brief Remove a component from an entity on the next flush
+ * 
+ * @param world Pointer to the world
+ * @param entity Entity to change
+ * @param component Component to remove
+*/
+void deferRemoveComponent(World *world, Entity entity, unsigned int component);
+
+/**
+ * @brief Apply the deferred structural changes, in the order they were recorded
+ * 
+ * @param world Pointer to the world
+*/
+void flushWorld(World *world);
+
+/**
+ * @brief Run systems, in parallel when their accesses allow it, then flush the world
+ * 
+ * @param world Pointer to the world
+ * @param systems Systems to run, in order
+ * @param systemCount Number of systems
+ * @param jobs Job system running the systems
+ * @param dt Time since the last update
+ * 
+ * @note A system never runs before an earlier system it conflicts with
+*/
+void runSystems(World *world, const System *systems, unsigned int systemCount, JobSystem *jobs, float dt);
+
+/**
+ * @brief Free a world
+ * 
+ * @param world Pointer to the world
+*/
+void destroyWorld(World *world);
+
+
+#endif
@@ -0,0 +1,68 @@
+#include "entities.h"
+
+
+typedef struct {
+    World *world;
+    float dt;
+} SystemContext;
+
+
+static void moveArchetype(Archetype *archetype, void *data)
+{
+    const SystemContext *context = data;
+    vec3 *positions = getArchetypeColumn(archetype, COMPONENT_POSITION);
+    vec3 *velocities = getArchetypeColumn(archetype, COMPONENT_VELOCITY);
+    for (unsigned int i=0; i<archetype->count; i++) glm_vec3_muladds(velocities[i], context->dt, positions[i]);
+}
+
+static void movementSystem(World *world, float dt)
+{
+    SystemContext context = {world, dt};
+    queryWorld(world, COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY), moveArchetype, &context);
+}
+
+static void expireArchetype(Archetype *archetype, void *data)
+{
+    const SystemContext *context = data;
+    float *lifetimes = getArchetypeColumn(archetype, COMPONENT_LIFETIME);
+    for (unsigned int i=0; i<archetype->count; i++)
+    {
+        lifetimes[i] -= context->dt;
+        if (lifetimes[i] <= 0.0f) deferDestroyEntity(context->world, archetype->entities[i]);
+    }
+}
+
+static void lifetimeSystem(World *world, float dt)
+{
+    SystemContext context = {world, dt};
+    queryWorld(world, COMPONENT_BIT(COMPONENT_LIFETIME), expireArchetype, &context);
+}
+
+
+static const System gameSystems[] = {
+    {"Movement", COMPONENT_BIT(COMPONENT_VELOCITY), COMPONENT_BIT(COMPONENT_POSITION), movementSystem},
+    {"Lifetime", 0, COMPONENT_BIT(COMPONENT_LIFETIME), lifetimeSystem}
+};
+
+
+int initGameWorld(World *world)
+{
+    if (initWorld(world) < 0) return -1;
+
+    // Identifiers follow ComponentType
+    static const size_t sizes[COMPONENT_COUNT] = {sizeof(vec3), sizeof(vec3), sizeof(float), sizeof(BoxCollider)};
+    for (int c=0; c<COMPONENT_COUNT; c++)
+    {
+        if (registerComponent(world, sizes[c]) != c)
+        {
+            destroyWorld(world);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void updateGameWorld(World *world, JobSystem *jobs, float dt)
+{
+    runSystems(world, gameSystems, sizeof(gameSystems) / sizeof(gameSystems[0]), jobs, dt);
+}
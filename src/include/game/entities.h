@@ -0,0 +1,51 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+
+#include "collision.h"
+#include "ecs.h"
+#include "jobs.h"
+#include "logs.h"
+
+
+/**
+ * @brief Components of the game entities
+ * 
+ * @note COMPONENT_POSITION : vec3, world position
+ * @note COMPONENT_VELOCITY : vec3, world units per second
+ * @note COMPONENT_LIFETIME : float, seconds left before the entity is destroyed
+ * @note COMPONENT_COLLIDER : BoxCollider, relative to the position, hit by shots
+*/
+typedef enum {
+    COMPONENT_POSITION,
+    COMPONENT_VELOCITY,
+    COMPONENT_LIFETIME,
+    COMPONENT_COLLIDER,
+    COMPONENT_COUNT
+} ComponentType;
+
+
+/**
+ * @brief Create the game world and register the game components
+ * 
+ * @param world Pointer to the world
+ * @return int 0 if success, -1 if error
+*/
+int initGameWorld(World *world);
+
+/**
+ * @brief Run the game systems
+ * 
+ * @param world Pointer to the world
+ * @param jobs Job system running the systems
+ * @param dt Time since the last update
+*/
+void updateGameWorld(World *world, JobSystem *jobs, float dt);
+
+
+#endif
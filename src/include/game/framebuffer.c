@@ -0,0 +1,148 @@
+#include "framebuffer.h"
+
+
+static GLuint createAttachment(GLenum format, unsigned int width, unsigned int height, unsigned int samples)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    if (samples > 1)
+    {
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+        glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format, width, height, GL_TRUE);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    return texture;
+}
+
+
+int initRenderTarget(RenderTarget *target, unsigned int width, unsigned int height, unsigned int samples)
+{
+    target->width = width;
+    target->height = height;
+    target->samples = samples > 1 ? samples : 1;
+    target->viewWidth = width;
+    target->viewHeight = height;
+
+    target->colorTexture = createAttachment(RENDER_TARGET_COLOR_FORMAT, width, height, target->samples);
+    target->depthTexture = createAttachment(RENDER_TARGET_DEPTH_FORMAT, width, height, target->samples);
+
+    glGenFramebuffers(1, &target->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target->colorTexture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target->depthTexture, 0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG_ERROR("Render target is incomplete (status 0x%x)\n", status);
+        destroyRenderTarget(target);
+        return -1;
+    }
+    LOG_TRACE("Created %dx%d render target with %d samples\n", width, height, target->samples);
+    return 0;
+}
+
+
+void setRenderTargetViewport(RenderTarget *target, unsigned int width, unsigned int height)
+{
+    target->viewWidth = width < 1 ? 1 : width > target->width ? target->width : width;
+    target->viewHeight = height < 1 ? 1 : height > target->height ? target->height : height;
+}
+
+void bindRenderTarget(const RenderTarget *target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glViewport(0, 0, target->viewWidth, target->viewHeight);
+}
+
+void resolveRenderTarget(const RenderTarget *target, const RenderTarget *resolved)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolved->fbo);
+    glBlitFramebuffer(0, 0, target->viewWidth, target->viewHeight, 0, 0, target->viewWidth, target->viewHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void blitRenderTargetToScreen(const RenderTarget *target, unsigned int windowWidth, unsigned int windowHeight)
+{
+    // Multisampled targets are resolved by the blit, sizes must match in that case
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, target->viewWidth, target->viewHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, target->samples > 1 ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void destroyRenderTarget(RenderTarget *target)
+{
+    if (target->fbo) {glDeleteFramebuffers(1, &target->fbo); target->fbo = 0;}
+    if (target->colorTexture) {glDeleteTextures(1, &target->colorTexture); target->colorTexture = 0;}
+    if (target->depthTexture) {glDeleteTextures(1, &target->depthTexture); target->depthTexture = 0;}
+}
+
+
+int initGBuffer(GBuffer *gbuffer, const RenderTarget *target)
+{
+    if (target->samples > 1)
+    {
+        LOG_ERROR("Geometry buffer can't share a multisampled depth\n");
+        return -1;
+    }
+    gbuffer->width = target->width;
+    gbuffer->height = target->height;
+    gbuffer->depthTexture = target->depthTexture;
+    gbuffer->albedoSpecTexture = createAttachment(GBUFFER_ALBEDO_SPEC_FORMAT, gbuffer->width, gbuffer->height, 1);
+    gbuffer->normalTexture = createAttachment(GBUFFER_NORMAL_FORMAT, gbuffer->width, gbuffer->height, 1);
+
+    glGenFramebuffers(1, &gbuffer->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer->fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, gbuffer->albedoSpecTexture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, gbuffer->normalTexture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, gbuffer->depthTexture, 0);
+    static const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG_ERROR("Geometry buffer is incomplete (status 0x%x)\n", status);
+        destroyGBuffer(gbuffer);
+        return -1;
+    }
+    LOG_TRACE("Created %dx%d geometry buffer\n", gbuffer->width, gbuffer->height);
+    return 0;
+}
+
+void bindGBufferTextures(const GBuffer *gbuffer, GLuint shaderProgram)
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->albedoSpecTexture);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gAlbedoSpec"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->normalTexture);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gNormal"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->depthTexture);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gDepth"), 2);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void destroyGBuffer(GBuffer *gbuffer)
+{
+    if (gbuffer->fbo) {glDeleteFramebuffers(1, &gbuffer->fbo); gbuffer->fbo = 0;}
+    if (gbuffer->albedoSpecTexture) {glDeleteTextures(1, &gbuffer->albedoSpecTexture); gbuffer->albedoSpecTexture = 0;}
+    if (gbuffer->normalTexture) {glDeleteTextures(1, &gbuffer->normalTexture); gbuffer->normalTexture = 0;}
+    gbuffer->depthTexture = 0;
+}
@@ -0,0 +1,150 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+
+#include "logs.h"
+
+
+#define RENDER_TARGET_COLOR_FORMAT GL_RGBA16F
+#define RENDER_TARGET_DEPTH_FORMAT GL_DEPTH_COMPONENT32F
+
+#define GBUFFER_ALBEDO_SPEC_FORMAT GL_RGBA8  // Albedo, specular intensity
+#define GBUFFER_NORMAL_FORMAT GL_RG16_SNORM  // Octahedral normal
+
+
+/**
+ * @brief Offscreen render target structure
+ * 
+ * @param fbo Framebuffer object
+ * @param colorTexture Color attachment
+ * @param depthTexture Depth attachment, can be sampled by later passes
+ * @param width Width of the target
+ * @param height Height of the target
+ * @param samples Number of samples, 1 if not multisampled
+ * @param viewWidth Width of the region rendered to, from the bottom left corner
+ * @param viewHeight Height of the region rendered to
+ * 
+ * @note Textures are GL_TEXTURE_2D_MULTISAMPLE when samples > 1, GL_TEXTURE_2D otherwise
+ * @note Targets are allocated at their largest size, the rendered region shrinks instead of reallocating (dynamic resolution)
+*/
+typedef struct {
+    GLuint fbo;
+    GLuint colorTexture;
+    GLuint depthTexture;
+    unsigned int width, height;
+    unsigned int samples;
+    unsigned int viewWidth, viewHeight;
+} RenderTarget;
+
+/**
+ * @brief Geometry buffer of the deferred renderer
+ * 
+ * @param fbo Framebuffer object
+ * @param albedoSpecTexture Albedo and specular intensity
+ * @param normalTexture World normal, octahedral encoded
+ * @param depthTexture Depth, borrowed from a render target
+ * @param width Width of the buffer
+ * @param height Height of the buffer
+ * 
+ * @note Positions are not stored, they are rebuilt from the depth
+*/
+typedef struct {
+    GLuint fbo;
+    GLuint albedoSpecTexture;
+    GLuint normalTexture;
+    GLuint depthTexture;
+    unsigned int width, height;
+} GBuffer;
+
+
+/**
+ * @brief Create a render target
+ * 
+ * @param target Pointer to the render target
+ * @param width Width of the target
+ * @param height Height of the target
+ * @param samples Number of samples, 1 if not multisampled
+ * @return int 0 if success, -1 if error
+*/
+int initRenderTarget(RenderTarget *target, unsigned int width, unsigned int height, unsigned int samples);
+
+/**
+ * @brief Set the region of a render target that is rendered to
+ * 
+ * @param target Pointer to the render target
+ * @param width Width of the region, clamped to the target
+ * @param height Height of the region, clamped to the target
+*/
+void setRenderTargetViewport(RenderTarget *target, unsigned int width, unsigned int height);
+
+/**
+ * @brief Bind a render target for drawing and set the viewport to its rendered region
+ * 
+ * @param target Render target to bind
+*/
+void bindRenderTarget(const RenderTarget *target);
+
+/**
+ * @brief Resolve the rendered region of a multisampled render target to a single sample one
+ * 
+ * @param target Render target to resolve
+ * @param resolved Single sample render target, at least as large as the rendered region
+ * 
+ * @note The region keeps its size, the default framebuffer is bound after the function call
+*/
+void resolveRenderTarget(const RenderTarget *target, const RenderTarget *resolved);
+
+/**
+ * @brief Copy the rendered region of a render target to the default framebuffer, resolving it if multisampled
+ * 
+ * @param target Render target to resolve
+ * @param windowWidth Width of the window
+ * @param windowHeight Height of the window
+ * 
+ * @note Default framebuffer is bound after the function call
+*/
+void blitRenderTargetToScreen(const RenderTarget *target, unsigned int windowWidth, unsigned int windowHeight);
+
+/**
+ * @brief Destroy a render target
+ * 
+ * @param target Render target to destroy
+*/
+void destroyRenderTarget(RenderTarget *target);
+
+
+/**
+ * @brief Create a geometry buffer
+ * 
+ * @param gbuffer Pointer to the geometry buffer
+ * @param target Single sample render target whose depth is shared
+ * @return int 0 if success, -1 if error
+*/
+int initGBuffer(GBuffer *gbuffer, const RenderTarget *target);
+
+/**
+ * @brief Bind the geometry buffer textures to the first texture units
+ * 
+ * @param gbuffer Geometry buffer to bind
+ * @param shaderProgram Shader program reading the geometry buffer (gbuffer.glsl)
+ * 
+ * @note Shader program must be in use
+*/
+void bindGBufferTextures(const GBuffer *gbuffer, GLuint shaderProgram);
+
+/**
+ * @brief Destroy a geometry buffer
+ * 
+ * @param gbuffer Geometry buffer to destroy
+ * 
+ * @note The shared depth texture is left to its render target
+*/
+void destroyGBuffer(GBuffer *gbuffer);
+
+
+#endif
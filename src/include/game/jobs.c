@@ -0,0 +1,114 @@
+#include "jobs.h"
+
+
+// Mutex must be locked, returns false if the queue is empty
+static bool popJob(JobSystem *jobs, Job *job)
+{
+    if (jobs->head == jobs->tail) return false;
+    *job = jobs->queue[jobs->head++ & (JOBS_QUEUE_SIZE-1)];
+    return true;
+}
+
+// Mutex must be locked, it is released while the job runs
+static void runJob(JobSystem *jobs, Job job)
+{
+    SDL_UnlockMutex(jobs->mutex);
+    job.function(job.data);
+    SDL_LockMutex(jobs->mutex);
+    if (--jobs->pending == 0) SDL_CondBroadcast(jobs->doneCond);
+}
+
+static int jobWorker(void *data)
+{
+    JobSystem *jobs = data;
+    Job job;
+
+    SDL_LockMutex(jobs->mutex);
+    while (true)
+    {
+        while (!jobs->quit && jobs->head == jobs->tail) SDL_CondWait(jobs->workCond, jobs->mutex);
+        if (!popJob(jobs, &job)) break;  // Quit with an empty queue
+        runJob(jobs, job);
+    }
+    SDL_UnlockMutex(jobs->mutex);
+    return 0;
+}
+
+
+int initJobSystem(JobSystem *jobs, int threadCount)
+{
+    memset(jobs, 0, sizeof(JobSystem));
+    if (threadCount < 0) threadCount = SDL_GetCPUCount() - 1;
+    if (threadCount > JOBS_MAX_THREADS) threadCount = JOBS_MAX_THREADS;
+
+    jobs->mutex = SDL_CreateMutex();
+    jobs->workCond = SDL_CreateCond();
+    jobs->doneCond = SDL_CreateCond();
+    if (!jobs->mutex || !jobs->workCond || !jobs->doneCond)
+    {
+        LOG_ERROR("Could not create job system synchronization: %s\n", SDL_GetError());
+        destroyJobSystem(jobs);
+        return -1;
+    }
+
+    for (int i=0; i<threadCount; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "worker%d", i);
+        jobs->threads[i] = SDL_CreateThread(jobWorker, name, jobs);
+        if (!jobs->threads[i])
+        {
+            LOG_ERROR("Could not create worker thread: %s\n", SDL_GetError());
+            destroyJobSystem(jobs);
+            return -1;
+        }
+        jobs->threadCount++;
+    }
+
+    LOG_DEBUG("Initialized job system with %d worker threads\n", jobs->threadCount);
+    return 0;
+}
+
+
+void submitJob(JobSystem *jobs, JobFunction function, void *data)
+{
+    SDL_LockMutex(jobs->mutex);
+    if (jobs->threadCount == 0 || jobs->tail - jobs->head == JOBS_QUEUE_SIZE)
+    {
+        SDL_UnlockMutex(jobs->mutex);
+        function(data);
+        return;
+    }
+    jobs->queue[jobs->tail++ & (JOBS_QUEUE_SIZE-1)] = (Job){function, data};
+    jobs->pending++;
+    SDL_CondSignal(jobs->workCond);
+    SDL_UnlockMutex(jobs->mutex);
+}
+
+void waitJobs(JobSystem *jobs)
+{
+    Job job;
+
+    SDL_LockMutex(jobs->mutex);
+    while (popJob(jobs, &job)) runJob(jobs, job);
+    while (jobs->pending > 0) SDL_CondWait(jobs->doneCond, jobs->mutex);
+    SDL_UnlockMutex(jobs->mutex);
+}
+
+
+void destroyJobSystem(JobSystem *jobs)
+{
+    if (jobs->mutex)
+    {
+        SDL_LockMutex(jobs->mutex);
+        jobs->quit = true;
+        if (jobs->workCond) SDL_CondBroadcast(jobs->workCond);
+        SDL_UnlockMutex(jobs->mutex);
+    }
+    for (unsigned int i=0; i<jobs->threadCount; i++) SDL_WaitThread(jobs->threads[i], NULL);
+    jobs->threadCount = 0;
+
+    if (jobs->doneCond) {SDL_DestroyCond(jobs->doneCond); jobs->doneCond = NULL;}
+    if (jobs->workCond) {SDL_DestroyCond(jobs->workCond); jobs->workCond = NULL;}
+    if (jobs->mutex) {SDL_DestroyMutex(jobs->mutex); jobs->mutex = NULL;}
+}
@@ -0,0 +1,98 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "logs.h"
+
+
+#define JOBS_MAX_THREADS 15  // Worker threads, the calling thread also runs jobs while waiting
+#define JOBS_QUEUE_SIZE 256  // Must be a power of two
+
+
+typedef void (*JobFunction)(void *data);
+
+/**
+ * @brief Job structure
+ * 
+ * @param function Function to run
+ * @param data Argument of the function
+*/
+typedef struct {
+    JobFunction function;
+    void *data;
+} Job;
+
+/**
+ * @brief Pool of worker threads running jobs from a shared queue
+ * 
+ * @param threads Worker threads
+ * @param threadCount Number of worker threads, 0 runs every job on the calling thread
+ * @param queue Ring buffer of queued jobs
+ * @param head Index of the next job to run
+ * @param tail Index of the next free slot
+ * @param pending Number of jobs queued or running
+ * @param mutex Protects the queue and the counters
+ * @param workCond Signaled when a job is queued
+ * @param doneCond Signaled when the last pending job is done
+ * @param quit Whether the workers should stop
+*/
+typedef struct {
+    SDL_Thread *threads[JOBS_MAX_THREADS];
+    unsigned int threadCount;
+
+    Job queue[JOBS_QUEUE_SIZE];
+    unsigned int head, tail;
+    unsigned int pending;
+
+    SDL_mutex *mutex;
+    SDL_cond *workCond;
+    SDL_cond *doneCond;
+    bool quit;
+} JobSystem;
+
+
+/**
+ * @brief Start the worker threads
+ * 
+ * @param jobs Pointer to the job system
+ * @param threadCount Number of worker threads, -1 for one less than the number of cores
+ * @return int 0 if success, -1 if error
+*/
+int initJobSystem(JobSystem *jobs, int threadCount);
+
+/**
+ * @brief Queue a job
+ * 
+ * @param jobs Pointer to the job system
+ * @param function Function to run
+ * @param data Argument of the function, must stay valid until waitJobs returns
+ * 
+ * @note The job runs on the calling thread if there is no worker or if the queue is full
+*/
+void submitJob(JobSystem *jobs, JobFunction function, void *data);
+
+/**
+ * @brief Wait for every queued job to be done, running queued jobs on the calling thread meanwhile
+ * 
+ * @param jobs Pointer to the job system
+*/
+void waitJobs(JobSystem *jobs);
+
+/**
+ * @brief Stop the worker threads
+ * 
+ * @param jobs Pointer to the job system
+ * 
+ * @note Queued jobs are finished first
+*/
+void destroyJobSystem(JobSystem *jobs);
+
+
+#endif
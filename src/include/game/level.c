@@ -0,0 +1,115 @@
+#include "level.h"
+
+
+static void addTriangle(LevelCollision *level, vec3 a, vec3 b, vec3 c, uint16_t material)
+{
+    TriangleCollider *triangle = &level->triangles[level->triangleCount];
+    level->materials[level->triangleCount] = material;
+    glm_vec3_copy(a, triangle->vertices[0]);
+    glm_vec3_copy(b, triangle->vertices[1]);
+    glm_vec3_copy(c, triangle->vertices[2]);
+
+    vec3 e1, e2;
+    glm_vec3_sub(b, a, e1);
+    glm_vec3_sub(c, a, e2);
+    glm_vec3_cross(e1, e2, triangle->normal);
+    const float area = glm_vec3_norm(triangle->normal);
+    if (area <= COLLISION_EPSILON) return;  // Degenerate, dropped
+    glm_vec3_scale(triangle->normal, 1.0f / area, triangle->normal);
+    level->triangleCount++;
+}
+
+int initLevelCollision(LevelCollision *level, const Model *models, unsigned int modelCount, JobSystem *jobs, const char *cachePath)
+{
+    memset(level, 0, sizeof(LevelCollision));
+
+    unsigned int capacity = 2;
+    for (unsigned int m=0; m<modelCount; m++)
+    {
+        if (models[m].dynamic) continue;
+        for (unsigned int i=0; i<models[m].meshCount; i++) capacity += models[m].meshes[i].indexCount / 3;
+    }
+    level->triangles = malloc(capacity * sizeof(TriangleCollider));
+    level->materials = malloc(capacity * sizeof(uint16_t));
+    if (!level->triangles || !level->materials)
+    {
+        LOG_ERROR("Could not allocate %d level triangles\n", capacity);
+        destroyLevelCollision(level);
+        return -1;
+    }
+
+    // Ground
+    addTriangle(level, (vec3){-LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, -LEVEL_GROUND_EXTENT}, (vec3){-LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, LEVEL_GROUND_EXTENT}, (vec3){LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, LEVEL_GROUND_EXTENT}, LEVEL_MATERIAL_GROUND);
+    addTriangle(level, (vec3){-LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, -LEVEL_GROUND_EXTENT}, (vec3){LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, LEVEL_GROUND_EXTENT}, (vec3){LEVEL_GROUND_EXTENT, LEVEL_GROUND_Y, -LEVEL_GROUND_EXTENT}, LEVEL_MATERIAL_GROUND);
+
+    // Static models, in world space
+    for (unsigned int m=0; m<modelCount; m++)
+    {
+        const Model *model = &models[m];
+        if (model->dynamic) continue;
+        vec4 *world = model->transforms->worlds[model->transform];
+        for (unsigned int i=0; i<model->meshCount; i++)
+        {
+            const Mesh *mesh = &model->meshes[i];
+            for (unsigned int j=0; j+2<mesh->indexCount; j+=3)
+            {
+                vec3 v[3];
+                for (int k=0; k<3; k++) glm_mat4_mulv3(world, mesh->vertices[mesh->indices[j+k]].position, 1.0f, v[k]);
+                addTriangle(level, v[0], v[1], v[2], (uint16_t)(m + 1));
+            }
+        }
+    }
+
+    // Cooked BVH if the level did not change, built and cooked otherwise
+    if (cachePath && loadTriangleBVH(&level->bvh, level->triangles, level->triangleCount, cachePath) == 0)
+    {
+        LOG_DEBUG("Loaded level collision with %d triangles from %s\n", level->triangleCount, cachePath);
+        return 0;
+    }
+    if (buildTriangleBVH(&level->bvh, level->triangles, level->triangleCount, jobs) < 0)
+    {
+        destroyLevelCollision(level);
+        return -1;
+    }
+    if (cachePath && saveTriangleBVH(&level->bvh, cachePath) < 0) LOG_WARN("Level collision not cooked, it will be built again next time\n");
+
+    LOG_DEBUG("Built level collision with %d triangles\n", level->triangleCount);
+    return 0;
+}
+
+
+unsigned int queryLevelTriangles(const LevelCollision *level, vec3 box[2], unsigned int *dest, unsigned int max)
+{
+    return gatherBVHTriangles(&level->bvh, box, dest, max);
+}
+
+
+bool raycastLevel(const LevelCollision *level, const Ray *ray, LevelHit *hit)
+{
+    if (!raycastBVH(&level->bvh, ray, &hit->distance, &hit->triangle)) return false;
+
+    glm_vec3_copy((float*)ray->origin, hit->point);
+    glm_vec3_muladds((float*)ray->direction, hit->distance, hit->point);
+    glm_vec3_copy((float*)level->triangles[hit->triangle].normal, hit->normal);
+    if (glm_vec3_dot(hit->normal, (float*)ray->direction) > 0.0f) glm_vec3_negate(hit->normal);
+    return true;
+}
+
+
+bool isLevelVisible(const LevelCollision *level, vec3 from, vec3 to)
+{
+    vec3 direction;
+    glm_vec3_sub(to, from, direction);
+    Ray ray;
+    initRay(&ray, from, direction, 1.0f);
+    return !raycastAnyBVH(&level->bvh, &ray);
+}
+
+
+void destroyLevelCollision(LevelCollision *level)
+{
+    free(level->triangles);
+    free(level->materials);
+    destroyTriangleBVH(&level->bvh);
+    memset(level, 0, sizeof(LevelCollision));
+}
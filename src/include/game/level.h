@@ -0,0 +1,113 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "bvh.h"
+#include "collision.h"
+#include "jobs.h"
+#include "logs.h"
+#include "model.h"
+
+
+#define LEVEL_CACHE_PATH "assets/level.bvh"  // Cooked level collision, rebuilt when the level changes
+#define LEVEL_GROUND_Y 0.0f  // The placeholder level has no floor mesh
+#define LEVEL_GROUND_EXTENT 64.0f  // Half size of the ground quad
+#define LEVEL_MATERIAL_GROUND 0  // Material of the ground quad, the triangles of model i have material i+1
+
+
+/**
+ * @brief Static collision geometry of the level
+ * 
+ * @param triangles Triangles of the static models, in world space
+ * @param materials Material of each triangle
+ * @param triangleCount Number of triangles
+ * @param bvh Hierarchy over the triangles
+ * 
+ * @note Queries only read the level, and can run from several threads
+*/
+typedef struct {
+    TriangleCollider *triangles;
+    uint16_t *materials;
+    unsigned int triangleCount;
+    TriangleBVH bvh;
+} LevelCollision;
+
+/**
+ * @brief Hit of a ray on the level
+ * 
+ * @param distance Distance to the hit, in multiples of the ray direction
+ * @param point Position of the hit
+ * @param normal Normal of the triangle hit, facing the ray
+ * @param triangle Index of the triangle hit
+*/
+typedef struct {
+    float distance;
+    vec3 point;
+    vec3 normal;
+    unsigned int triangle;
+} LevelHit;
+
+
+/**
+ * @brief Gather the triangles of the static models and load or build their BVH
+ * 
+ * @param level Pointer to the level collision
+ * @param models Models of the level, dynamic models are skipped
+ * @param modelCount Number of models
+ * @param jobs Job system building the BVH, NULL to build on the calling thread
+ * @param cachePath File the BVH is loaded from and saved to, NULL to always build it
+ * @return int 0 if success, -1 if error
+ * 
+ * @note World matrices of the models must be up to date
+*/
+int initLevelCollision(LevelCollision *level, const Model *models, unsigned int modelCount, JobSystem *jobs, const char *cachePath);
+
+/**
+ * @brief Find the triangles that may overlap a box
+ * 
+ * @param level Pointer to the level collision
+ * @param box Axis aligned box, in world space
+ * @param dest Indices of the triangles found
+ * @param max Size of dest
+ * @return unsigned int Number of triangles found, at most max
+*/
+unsigned int queryLevelTriangles(const LevelCollision *level, vec3 box[2], unsigned int *dest, unsigned int max);
+
+/**
+ * @brief Find the first triangle hit by a ray
+ * 
+ * @param level Pointer to the level collision
+ * @param ray Ray, created with initRay
+ * @param hit Closest hit, if any
+ * @return true The ray hits the level within its length
+ * @return false The ray hits nothing
+*/
+bool raycastLevel(const LevelCollision *level, const Ray *ray, LevelHit *hit);
+
+/**
+ * @brief Check whether the segment between two points crosses no level triangle (AI visibility)
+ * 
+ * @param level Pointer to the level collision
+ * @param from Start of the segment
+ * @param to End of the segment
+ * @return true Nothing in between
+ * @return false The level blocks the view
+*/
+bool isLevelVisible(const LevelCollision *level, vec3 from, vec3 to);
+
+/**
+ * @brief Free the level collision
+ * 
+ * @param level Pointer to the level collision
+*/
+void destroyLevelCollision(LevelCollision *level);
+
+
+#endif
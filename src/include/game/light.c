@@ -1,81 +1,50 @@
 #include "light.h"
 
 
-int createDepthCubemap(GLuint *depthCubemap, unsigned int resolution)
-{
-    glGenTextures(1, depthCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, *depthCubemap);
-    for (int i=0; i<6; i++)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i, 0, GL_DEPTH_COMPONENT, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    LOG_TRACE("Created depth cubemap with resolution %d\n", resolution);
-    return 0;
-}
-
-inline void bindDepthCubemapToFBO(GLuint depthMapFBO, GLuint depthCubemap)
-{
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-inline void destroyDepthCubemap(GLuint depthCubemap)
-{
-    glDeleteTextures(1, &depthCubemap);
-}
-
-
-int initPointLight(PointLight *light, vec3 position, vec3 color)
+int initPointLight(PointLight *light, vec3 position, vec3 color, float radius, bool castShadows)
 {
     glm_vec3_copy(position, light->position);
     glm_vec3_copy(color, light->color);
-    if (createDepthCubemap(&(light->depthCubemap), SHADOWMAP_RES)<0)
-    {
-        LOG_ERROR("Could not create depth cubemap for point light\n");
-        return -1;
-    }
+    light->radius = radius;
+    light->castShadows = castShadows;
+    light->shadowTier = -1;  // Assigned by the shadow pool
+    light->shadowSlot = -1;
+    light->cacheValid = false;
+    light->staticCacheValid = false;
+    light->dynamicFaces = 0;
     LOG_TRACE("Initialized point light\n");
     return 0;
 }
 
 
-void renderPointLightsShadowMap(const Scene *scene, GLuint shaderProgramDepth, GLuint depthMapFBO, PointLight *pointLights)
+uint8_t pointLightGetBoxFaces(const PointLight *pointLight, vec3 box[2])
 {
-    glViewport(0, 0, SHADOWMAP_RES, SHADOWMAP_RES);
-    glUseProgram(shaderProgramDepth);
-
-    glUniform1f(glGetUniformLocation(shaderProgramDepth, "farPlane"), SHADOWMAP_ZFAR);
-
-    // We don't want to compute projection matrix each tick
-    static bool firstTime = true;
-    static mat4 lightProjection = {0};
-    if (firstTime) {glm_perspective(glm_rad(90.0f), 1.0f, SHADOWMAP_ZNEAR, SHADOWMAP_ZFAR, lightProjection); firstTime=false;}
-
-    // Compute depth map for each light
-    static mat4 shadowMatrices[6];
-    for (uint8_t i=0; i<4; i++)
+    // Box relative to the light
+    vec3 rel[2];
+    glm_vec3_sub(box[0], (float*)pointLight->position, rel[0]);
+    glm_vec3_sub(box[1], (float*)pointLight->position, rel[1]);
+
+    // Out of range
+    vec3 closest;
+    for (int a=0; a<3; a++) closest[a] = glm_clamp(0.0f, rel[0][a], rel[1][a]);
+    if (glm_vec3_norm2(closest) > pointLight->radius*pointLight->radius) return 0;
+
+    // Smallest absolute coordinate of the box on each axis
+    float minAbs[3];
+    for (int a=0; a<3; a++)
+        minAbs[a] = (rel[0][a] <= 0.0f && rel[1][a] >= 0.0f) ? 0.0f : glm_min(fabsf(rel[0][a]), fabsf(rel[1][a]));
+
+    // A face is a 90 degrees pyramid around its axis : the box overlaps it if its furthest
+    // point along the axis is further than its closest point on the two other axes
+    uint8_t faces = 0;
+    for (int a=0; a<3; a++)
     {
-        // Each light has its own depth cubemap
-        bindDepthCubemapToFBO(depthMapFBO, pointLights[i].depthCubemap);
-
-        glUniform3f(glGetUniformLocation(shaderProgramDepth, "lightPos"), pointLights[i].position[0], pointLights[i].position[1], pointLights[i].position[2]);
-
-        pointLightGetProjMatrices(&(pointLights[i]), &lightProjection, &shadowMatrices);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgramDepth, "shadowMatrices"), 6, GL_FALSE, (float*)(shadowMatrices));
-
-        // Rendering
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        renderScene(scene, shaderProgramDepth);
+        const int b = (a+1)%3, c = (a+2)%3;
+        const float positive = rel[1][a], negative = -rel[0][a];
+        if (positive > 0.0f && positive >= minAbs[b] && positive >= minAbs[c]) faces |= 1 << (2*a);
+        if (negative > 0.0f && negative >= minAbs[b] && negative >= minAbs[c]) faces |= 1 << (2*a+1);
     }
+    return faces;
 }
 
 
@@ -98,9 +67,4 @@ void pointLightGetProjMatrices(PointLight *pointLight, mat4 *lightProjection, ma
 
     for (int i=0; i<6; i++)
         glm_mat4_mul(*lightProjection, lightView[i], (*dest)[i]);
-}
-
-inline void destroyPointLight(PointLight *light)
-{
-    destroyDepthCubemap(light->depthCubemap);
 }
\ No newline at end of file
@@ -2,9 +2,9 @@
 #define LIGHT_H
 
 
-#define SHADOWMAP_RES 1024
-#define SHADOWMAP_ZNEAR 0.1f
-#define SHADOWMAP_ZFAR 32.0f
+#define SHADOWMAP_ZNEAR 0.1f  // The far plane is set at runtime (see ShadowPool)
+
+#define MAX_POINT_LIGHTS 512  // Lights handled by the clustered renderer
 
 
 #include <stdio.h>
@@ -19,10 +19,35 @@
 #include "scene.h"
 
 
+/**
+ * @brief Point light structure
+ * 
+ * @param position Position of the light
+ * @param color Color of the light
+ * @param radius Range of the light, it has no influence past this distance
+ * @param castShadows Whether the light can get a depth cubemap from the shadow pool
+ * @param shadowTier Resolution tier of the depth cubemap, -1 if none
+ * @param shadowSlot Cubemap of the tier owned by the light
+ * @param cachedPosition Position of the light when the depth cubemap was built
+ * @param cacheValid Whether the depth cubemap has been built
+ * @param staticCacheValid Whether the static cache of the slot has been built
+ * @param dynamicFaces Faces that contained dynamic models at the last update
+ * 
+ * @note Faces are ordered +X, -X, +Y, -Y, +Z, -Z, as in pointLightGetProjMatrices
+ * @note Depth cubemaps are owned by the shadow pool (see shadow.h)
+*/
 typedef struct {
     vec3 position;
     vec3 color;
-    GLuint depthCubemap;
+    float radius;
+    bool castShadows;
+
+    int shadowTier;
+    int shadowSlot;
+    vec3 cachedPosition;
+    bool cacheValid;
+    bool staticCacheValid;
+    uint8_t dynamicFaces;
 } PointLight;
 
 
@@ -32,49 +57,13 @@ typedef struct {
  * @param light The point light to initialize
  * @param position The position of the light
  * @param color The color of the light
+ * @param radius The range of the light
+ * @param castShadows Whether the light casts shadows
  * @return int 0 if success, -1 if error
  * 
- * @note The depth cubemap is automatically allocated
-*/
-int initPointLight(PointLight *light, vec3 position, vec3 color);
-
-/**
- * @brief Destroy a point light
- * 
- * @param light The point light to destroy
-*/
-void destroyPointLight(PointLight *light);
-
-
-/**
- * @brief Create a depth map
- * 
- * @param depthMap Pointer to the depth map
- * @param width Width of the depth map
- * @param height Height of the depth map
- * @return int 0 if success, -1 if error
+ * @note The depth cubemap is given by the shadow pool every frame
 */
-int createDepthCubemap(GLuint *depthMap, unsigned int resolution);
-
-/**
- * @brief Bind a depth map
- * 
- * @param depthMapFBO Depth map FBO
- * @param depthMap Depth map to bind
- * 
- * @note FBO gets unboud after the function call
-*/
-void bindDepthCubemapToFBO(GLuint depthMapFBO, GLuint depthMap);
-
-/**
- * @brief Bind a point light to a FBO
- * 
- * @param light Point light to bind
- * @param depthMapFBO FBO to bind the light to
- * 
- * @note FBO gets unboud after the function call
-*/
-void bindPointLightToFBO(GLuint depthMapFBO, PointLight *light);
+int initPointLight(PointLight *light, vec3 position, vec3 color, float radius, bool castShadows);
 
 /**
  * @brief Get the 6 projection matrices of a point light for depth cubemapping
@@ -88,24 +77,15 @@ void bindPointLightToFBO(GLuint depthMapFBO, PointLight *light);
 void pointLightGetProjMatrices(PointLight *pointLight, mat4 *lightProjection, mat4 (*dest)[6]);
 
 /**
- * @brief Render the depth cubemap of a point light
- * 
- * @param shaderProgramDepth Shader program to use
- * @param VAO VAO to use
- * @param depthMapFBO FBO to use
- * @param pointLights Point lights to render
- * @param cubePositions Positions of the cubes to render
+ * @brief Get the faces of a point light's depth cubemap that a box overlaps
  * 
- * @note Viewport is modified, and VAO and shader program are binded to 0 after the function call
-*/
-void renderPointLightsShadowMap(const Scene *scene, GLuint shaderProgramDepth, GLuint depthMapFBO, PointLight *pointLights);
-
-/**
- * @brief Destroy a depth map
+ * @param pointLight Point light
+ * @param box Axis aligned bounding box, in world space
+ * @return uint8_t Bitmask of the faces (bit i is face i)
  * 
- * @param depthMap Depth map to destroy
+ * @note Boxes out of the range of the light overlap no face, they cannot shadow what it lights
 */
-void destroyDepthCubemap(GLuint depthMap);
+uint8_t pointLightGetBoxFaces(const PointLight *pointLight, vec3 box[2]);
 
 
 #endif
@@ -1,19 +1,547 @@
+// sigaction is POSIX, strict C17 hides it
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "logs.h"
 
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+
+#define LOGS_RING_MASK (LOGS_RING_SLOTS - 1)
+#define LOGS_ENTRY_DATA (LOGS_SLOT_SIZE - 2 * sizeof(void*) - sizeof(uint64_t) - 4)
+#define LOGS_SPEC_SIZE 32  // Longest conversion specification, like %-12.3lf
+#define LOGS_CRASH_TRIES 1000  // Milliseconds a crashing thread waits for the writer before giving up
+
+
+// Type of an argument of a format, as read by va_arg
+enum {
+    LOG_ARG_NONE,
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING,
+    LOG_ARG_COUNT  // %n, read but never written
+};
+
+/**
+ * @brief Log entry, arguments are kept raw and formatted by the writer
+ * 
+ * @param site Call site
+ * @param format Format of the call
+ * @param time Performance counter when logged
+ * @param argCount Arguments stored, the rest did not fit
+ * @param data Arguments, packed, strings are copied with their terminator
+*/
+typedef struct {
+    const LogSite *site;
+    const char *format;
+    uint64_t time;
+    uint8_t argCount;
+    uint8_t data[LOGS_ENTRY_DATA];
+} LogEntry;
+
+/**
+ * @brief Entries of a thread, written by the thread and read by the writer only
+ * 
+ * @param head Next slot written, owned by the thread
+ * @param tail Next slot read, owned by the writer
+ * @param next Next ring of the list
+ * @param entries Slots
+*/
+typedef struct LogRing {
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+    struct LogRing *next;
+    LogEntry entries[LOGS_RING_SLOTS];
+} LogRing;
+
 
 static const char* log_levels[6] = {"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
 
+static struct {
+    atomic_bool running;
+    unsigned int generation;  // Bumped by initLogs, rings of a previous run are gone
+    _Atomic(LogRing*) rings;
+    atomic_flag writing;  // Held while draining the rings
+
+    FILE *file;
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    bool quit;
+    bool exitHandler;
+} logger = {.writing = ATOMIC_FLAG_INIT};
+
+static Uint64 logsStart = 0;
+static double logsFrequency = 0.0;
+
+static _Thread_local LogRing *threadRing = NULL;
+static _Thread_local unsigned int threadGeneration = 0;
 
-int fprintf_log(FILE *stream, char* file, int line, int level, const char *format, ...)
+
+// Parse a conversion specification after its %, returns the end of it, types gets the * widths then the value
+static const char* parseSpec(const char *spec, uint8_t types[3], int *count)
+{
+    *count = 0;
+    while (*spec && strchr("-+ #0", *spec)) spec++;
+    if (*spec == '*') {types[(*count)++] = LOG_ARG_INT; spec++;}
+    else while (*spec >= '0' && *spec <= '9') spec++;
+    if (*spec == '.')
+    {
+        spec++;
+        if (*spec == '*') {types[(*count)++] = LOG_ARG_INT; spec++;}
+        else while (*spec >= '0' && *spec <= '9') spec++;
+    }
+
+    int longs = 0;
+    bool size = false, longDouble = false;
+    for (;; spec++)
+    {
+        if (*spec == 'l') longs++;
+        else if (*spec == 'z' || *spec == 't') size = true;
+        else if (*spec == 'j') longs = 2;
+        else if (*spec == 'L') longDouble = true;
+        else if (*spec != 'h') break;
+    }
+
+    uint8_t type;
+    switch (*spec)
+    {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            type = size ? LOG_ARG_SIZE : longs >= 2 ? LOG_ARG_LLONG : longs == 1 ? LOG_ARG_LONG : LOG_ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            type = longDouble ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+            break;
+        case 's': type = LOG_ARG_STRING; break;
+        case 'p': type = LOG_ARG_POINTER; break;
+        case 'n': type = LOG_ARG_COUNT; break;
+        default: type = LOG_ARG_NONE; break;
+    }
+    if (type != LOG_ARG_NONE) types[(*count)++] = type;
+    return *spec ? spec + 1 : spec;
+}
+
+// Types of the arguments of a format, the conversions past LOGS_MAX_ARGS arguments are left out
+static int parseFormat(const char *format, uint8_t *args)
 {
+    int argCount = 0;
+    while ((format = strchr(format, '%')) != NULL)
+    {
+        if (format[1] == '%') {format += 2; continue;}
+        uint8_t types[3];
+        int count;
+        format = parseSpec(format + 1, types, &count);
+        if (argCount + count > LOGS_MAX_ARGS) break;
+        memcpy(&args[argCount], types, count);
+        argCount += count;
+    }
+    return argCount;
+}
+
+
+static bool storeArg(LogEntry *entry, size_t *offset, const void *value, size_t size)
+{
+    if (*offset + size > LOGS_ENTRY_DATA) return false;
+    memcpy(&entry->data[*offset], value, size);
+    *offset += size;
+    return true;
+}
+
+static void captureArgs(LogSite *site, const char *format, LogEntry *entry, va_list args)
+{
+    // The types of the arguments are kept by the call site, parsed by the first call
+    uint8_t parsed[LOGS_MAX_ARGS];
+    const uint8_t *types = parsed;
+    int count;
+    if (atomic_load_explicit(&site->state, memory_order_acquire) == 2 && site->format == format)
+    {
+        // Only read once the acquire load saw them published
+        types = site->args;
+        count = site->argCount;
+    }
+    else
+    {
+        count = parseFormat(format, parsed);
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&site->state, &expected, 1))
+        {
+            site->format = format;
+            site->argCount = count;
+            memcpy(site->args, parsed, count);
+            atomic_store_explicit(&site->state, 2, memory_order_release);
+        }
+    }
+
+    entry->argCount = 0;
+    size_t offset = 0;
+    for (int i=0; i<count; i++)
+    {
+        bool stored = true;
+        switch (types[i])
+        {
+            case LOG_ARG_INT: {int value = va_arg(args, int); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_LONG: {long value = va_arg(args, long); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_LLONG: {long long value = va_arg(args, long long); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_SIZE: {size_t value = va_arg(args, size_t); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_DOUBLE: {double value = va_arg(args, double); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_LDOUBLE: {long double value = va_arg(args, long double); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_POINTER: case LOG_ARG_COUNT: {void *value = va_arg(args, void*); stored = storeArg(entry, &offset, &value, sizeof(value)); break;}
+            case LOG_ARG_STRING:
+            {
+                // Copied, the string may not outlive the call
+                const char *value = va_arg(args, const char*);
+                if (value == NULL) value = "(null)";
+                if (offset >= LOGS_ENTRY_DATA) {stored = false; break;}
+                size_t length = strlen(value);
+                if (length > LOGS_ENTRY_DATA - offset - 1) length = LOGS_ENTRY_DATA - offset - 1;
+                memcpy(&entry->data[offset], value, length);
+                entry->data[offset + length] = '\0';
+                offset += length + 1;
+                break;
+            }
+        }
+        if (!stored) return;
+        entry->argCount++;
+    }
+}
+
+
+// Length of a line after snprintf wrote to it, cut lines end before the terminator snprintf wrote
+static size_t advanceLine(size_t length, size_t size, int written)
+{
+    if (written <= 0) return length;
+    return length + (size_t)written < size ? length + written : size - 1;
+}
+
+static void writeEntry(const LogEntry *entry)
+{
+    char line[LOGS_LINE_SIZE];
+    const size_t size = sizeof(line) - 1;
+    const double seconds = (double)(entry->time - logsStart) / logsFrequency;
+    size_t length = advanceLine(0, size, snprintf(line, size, "%.3f %s::%s:%d: ", seconds, log_levels[entry->site->level], entry->site->file, entry->site->line));
+
+    const char *format = entry->format;
+    size_t offset = 0;
+    int arg = 0;
+    while (*format && length < size - 1)
+    {
+        if (*format != '%') {line[length++] = *format++; continue;}
+        if (format[1] == '%') {line[length++] = '%'; format += 2; continue;}
+
+        uint8_t types[3];
+        int count;
+        const char *start = format;
+        format = parseSpec(format + 1, types, &count);
+        if (count == 0) continue;  // Unknown conversion, dropped
+        if (arg + count > entry->argCount || format - start >= LOGS_SPEC_SIZE)
+        {
+            // The other arguments did not fit in the entry
+            length = advanceLine(length, size, snprintf(line + length, size - length, "...\n"));
+            break;
+        }
+        arg += count;
+
+        char spec[LOGS_SPEC_SIZE];
+        memcpy(spec, start, format - start);
+        spec[format - start] = '\0';
+
+        // * widths and precisions come first
+        const int starCount = count - 1;
+        int stars[2] = {0, 0};
+        for (int i=0; i<starCount; i++) {memcpy(&stars[i], &entry->data[offset], sizeof(int)); offset += sizeof(int);}
+
+        char *dest = line + length;
+        const size_t room = size - length;
+        #define FORMAT_ARG(value) (starCount == 0 ? snprintf(dest, room, spec, value) : starCount == 1 ? snprintf(dest, room, spec, stars[0], value) : snprintf(dest, room, spec, stars[0], stars[1], value))
+        #define READ_ARG(type) type value; memcpy(&value, &entry->data[offset], sizeof(value)); offset += sizeof(value)
+
+        int written = 0;
+        switch (types[starCount])
+        {
+            case LOG_ARG_INT: {READ_ARG(int); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_LONG: {READ_ARG(long); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_LLONG: {READ_ARG(long long); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_SIZE: {READ_ARG(size_t); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_DOUBLE: {READ_ARG(double); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_LDOUBLE: {READ_ARG(long double); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_POINTER: {READ_ARG(void*); written = FORMAT_ARG(value); break;}
+            case LOG_ARG_STRING: {const char *value = (const char*)&entry->data[offset]; offset += strlen(value) + 1; written = FORMAT_ARG(value); break;}
+            case LOG_ARG_COUNT: offset += sizeof(void*); break;
+        }
+        #undef READ_ARG
+        #undef FORMAT_ARG
+        length = advanceLine(length, size, written);
+    }
+    if (length >= size - 1 && line[length-1] != '\n') line[length++] = '\n';
+
+    FILE *stream = logger.file ? logger.file : entry->site->level <= ERROR_LOGS ? stderr : stdout;
+    fwrite(line, 1, length, stream);
+}
+
+
+// Write the entries of every ring, oldest first, the caller holds logger.writing
+static void drainRings(void)
+{
+    for (;;)
+    {
+        LogRing *oldest = NULL;
+        const LogEntry *entry = NULL;
+        unsigned int tail = 0;
+        for (LogRing *ring = atomic_load(&logger.rings); ring; ring = ring->next)
+        {
+            const unsigned int ringTail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            if (ringTail == atomic_load_explicit(&ring->head, memory_order_acquire)) continue;
+            const LogEntry *first = &ring->entries[ringTail & LOGS_RING_MASK];
+            if (entry == NULL || first->time < entry->time)
+            {
+                oldest = ring;
+                entry = first;
+                tail = ringTail;
+            }
+        }
+        if (entry == NULL) break;
+
+        writeEntry(entry);
+        atomic_store_explicit(&oldest->tail, tail + 1, memory_order_release);
+    }
+
+    if (logger.file) fflush(logger.file);
+    else
+    {
+        fflush(stdout);
+        fflush(stderr);
+    }
+}
+
+// Whether the rings could be drained, a crashing writer thread would wait for itself forever
+static bool tryFlushLogs(unsigned int tries)
+{
+    for (unsigned int i=0; atomic_flag_test_and_set_explicit(&logger.writing, memory_order_acquire); i++)
+    {
+        if (i >= tries) return false;
+        SDL_Delay(1);
+    }
+    drainRings();
+    atomic_flag_clear_explicit(&logger.writing, memory_order_release);
+    return true;
+}
+
+static int logWriter(void *data)
+{
+    (void)data;
+    SDL_LockMutex(logger.mutex);
+    while (!logger.quit)
+    {
+        SDL_CondWaitTimeout(logger.cond, logger.mutex, LOGS_FLUSH_INTERVAL);
+        SDL_UnlockMutex(logger.mutex);
+        tryFlushLogs(UINT32_MAX);
+        SDL_LockMutex(logger.mutex);
+    }
+    SDL_UnlockMutex(logger.mutex);
+    return 0;
+}
+
+/**
+ * @brief Log from a signal handler, without allocating nor waiting
+ * 
+ * @param site Call site
+ * @param format Format of the log
+ * 
+ * @note The entry is dropped if the thread has no ring yet or its ring is full, the writer is not woken up
+*/
+static void logCrashEntry(LogSite *site, const char *format, ...)
+{
+    // Rings are freed once the logger is closed, the ring of the thread may be gone
+    if (!atomic_load_explicit(&logger.running, memory_order_acquire) || threadRing == NULL || threadGeneration != logger.generation) return;
+    LogRing *ring = threadRing;
+    const unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOGS_RING_SLOTS) return;
+
+    LogEntry *entry = &ring->entries[head & LOGS_RING_MASK];
+    entry->site = site;
+    entry->format = format;
+    entry->time = SDL_GetPerformanceCounter();
     va_list args;
-    int result;
+    va_start(args, format);
+    captureArgs(site, format, entry, args);
+    va_end(args);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// The handler is reset to the default one when called, the signal raised again ends the process
+static void logCrash(int sig)
+{
+    static LogSite site = {.file = __FILE__, .line = __LINE__, .level = FATAL_LOGS};
+    logCrashEntry(&site, "Crashed with signal %d\n", sig);
+    if (atomic_load(&logger.running)) tryFlushLogs(LOGS_CRASH_TRIES);
+    raise(sig);
+}
+
+static void installCrashHandler(int sig)
+{
+#ifdef _WIN32
+    // The C runtime resets the handler before calling it
+    signal(sig, logCrash);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = logCrash;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(sig, &action, NULL);
+#endif
+}
+
+// Ring of the calling thread, created by its first log
+static LogRing* getThreadRing(void)
+{
+    if (threadRing && threadGeneration == logger.generation) return threadRing;
+
+    LogRing *ring = (LogRing*)calloc(1, sizeof(LogRing));
+    if (ring == NULL) return NULL;
+    ring->next = atomic_load(&logger.rings);
+    while (!atomic_compare_exchange_weak(&logger.rings, &ring->next, ring));
+
+    threadRing = ring;
+    threadGeneration = logger.generation;
+    return ring;
+}
 
-    fprintf(stream, "%s::%s:%d: ", log_levels[level], file, line);
 
+int initLogs(const char *path)
+{
+    if (atomic_load(&logger.running)) closeLogs();
+    if (logsStart == 0)
+    {
+        logsStart = SDL_GetPerformanceCounter();
+        logsFrequency = (double)SDL_GetPerformanceFrequency();
+    }
+
+    if (path)
+    {
+        logger.file = fopen(path, "w");
+        if (logger.file == NULL)
+        {
+            LOG_ERROR("Failed to open file: %s\n", path);
+            return -1;
+        }
+    }
+
+    logger.quit = false;
+    logger.mutex = SDL_CreateMutex();
+    logger.cond = SDL_CreateCond();
+    if (logger.mutex == NULL || logger.cond == NULL)
+    {
+        LOG_ERROR("Could not create logger synchronization: %s\n", SDL_GetError());
+        closeLogs();
+        return -1;
+    }
+
+    logger.generation++;
+    atomic_store(&logger.running, true);
+    logger.thread = SDL_CreateThread(logWriter, "logs", NULL);
+    if (logger.thread == NULL)
+    {
+        atomic_store(&logger.running, false);
+        LOG_ERROR("Could not create logger thread: %s\n", SDL_GetError());
+        closeLogs();
+        return -1;
+    }
+
+    installCrashHandler(SIGSEGV);
+    installCrashHandler(SIGABRT);
+    installCrashHandler(SIGFPE);
+    installCrashHandler(SIGILL);
+    if (!logger.exitHandler) logger.exitHandler = atexit(closeLogs) == 0;
+    return 0;
+}
+
+
+void flushLogs(void)
+{
+    if (atomic_load(&logger.running)) tryFlushLogs(UINT32_MAX);
+}
+
+
+void closeLogs(void)
+{
+    // Logs are written right away from now on, the threads still logging must be gone
+    atomic_store(&logger.running, false);
+    if (logger.thread)
+    {
+        SDL_LockMutex(logger.mutex);
+        logger.quit = true;
+        SDL_CondSignal(logger.cond);
+        SDL_UnlockMutex(logger.mutex);
+        SDL_WaitThread(logger.thread, NULL);
+        logger.thread = NULL;
+    }
+    tryFlushLogs(UINT32_MAX);
+
+    LogRing *ring = atomic_exchange(&logger.rings, NULL);
+    while (ring)
+    {
+        LogRing *next = ring->next;
+        free(ring);
+        ring = next;
+    }
+
+    if (logger.cond) {SDL_DestroyCond(logger.cond); logger.cond = NULL;}
+    if (logger.mutex) {SDL_DestroyMutex(logger.mutex); logger.mutex = NULL;}
+    if (logger.file) {fclose(logger.file); logger.file = NULL;}
+}
+
+
+void logWrite(LogSite *site, const char *format, ...)
+{
+    if (logsStart == 0)
+    {
+        logsStart = SDL_GetPerformanceCounter();
+        logsFrequency = (double)SDL_GetPerformanceFrequency();
+    }
+
+    LogEntry local;
+    LogEntry *entry = &local;
+    LogRing *ring = atomic_load_explicit(&logger.running, memory_order_acquire) ? getThreadRing() : NULL;
+    unsigned int head = 0;
+    if (ring)
+    {
+        // Full ring : wait for the writer rather than losing logs
+        head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOGS_RING_SLOTS)
+        {
+            SDL_CondSignal(logger.cond);
+            SDL_Delay(1);
+        }
+        entry = &ring->entries[head & LOGS_RING_MASK];
+    }
+
+    entry->site = site;
+    entry->format = format;
+    entry->time = SDL_GetPerformanceCounter();
+    va_list args;
     va_start(args, format);
-    result = vfprintf(stream, format, args);
+    captureArgs(site, format, entry, args);
     va_end(args);
 
-    return result;
+    // Without the writer, the entry is written right away
+    if (ring == NULL)
+    {
+        writeEntry(entry);
+        return;
+    }
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // Errors are written early, the rest in batches
+    if (site->level <= ERROR_LOGS || ((head + 1) & (LOGS_RING_SLOTS / 2 - 1)) == 0) SDL_CondSignal(logger.cond);
 }
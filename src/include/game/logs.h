@@ -2,6 +2,9 @@
 
 
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #define TRACE_LOGS 5
@@ -17,33 +20,96 @@
 #define LOGS_LEVEL TRACE_LOGS
 #endif
 
+#define LOGS_RING_SLOTS 512  // Entries buffered per thread, must be a power of two
+#define LOGS_SLOT_SIZE 256  // Bytes of an entry, arguments included, longer strings are cut
+#define LOGS_MAX_ARGS 16  // Arguments of a format kept by its call site, the next ones are cut like those that do not fit in the entry
+#define LOGS_FLUSH_INTERVAL 50  // Milliseconds between two writes of the buffered entries
+#define LOGS_LINE_SIZE 1024  // Longest formatted line
 
-int fprintf_log(FILE *stream, char* file, int line, int level, const char *format, ...);
 
+/**
+ * @brief Call site of a log macro, static so that its format is parsed once
+ * 
+ * @param file Source file
+ * @param line Line in the source file
+ * @param level Level of the log
+ * @param format Format of the last call, arguments are parsed against it
+ * @param state 0 if the format has not been parsed, 1 while parsed, 2 once parsed
+ * @param argCount Number of arguments of the format
+ * @param args Type of each argument (see logs.c)
+*/
+typedef struct {
+    const char *file;
+    int line;
+    int level;
+
+    const char *format;
+    atomic_int state;
+    uint8_t argCount;
+    uint8_t args[LOGS_MAX_ARGS];
+} LogSite;
+
+
+/**
+ * @brief Start writing logs from a background thread
+ * 
+ * @param path File the logs are written to, or NULL for the console (stdout, stderr for errors)
+ * @return int 0 if success, -1 if error
+ * 
+ * @note Until then, and if this fails, logs are written right away by the calling thread
+ * @note Buffered logs are written at exit and on crashes
+*/
+int initLogs(const char *path);
+
+/**
+ * @brief Write every buffered log now
+*/
+void flushLogs(void);
+
+/**
+ * @brief Write the buffered logs and stop the background thread
+ * 
+ * @note Logs are written right away by the calling thread afterwards
+*/
+void closeLogs(void);
+
+/**
+ * @brief Buffer a log entry, formatted later by the background thread
+ * 
+ * @param site Call site of the log
+ * @param format printf format, must be a string literal or outlive the program
+ * @param ... Arguments of the format, strings are copied
+ * 
+ * @note Use the LOG_* macros rather than this function
+*/
+void logWrite(LogSite *site, const char *format, ...);
+
+
+#define LOG_AT(logLevel, ...) do {static LogSite logSite = {.file = __FILE__, .line = __LINE__, .level = logLevel}; logWrite(&logSite, __VA_ARGS__);} while (0)
 
 #if LOGS_LEVEL >= TRACE_LOGS
-#define LOG_TRACE(...) fprintf_log(stdout, __FILE__, __LINE__, TRACE_LOGS, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(TRACE_LOGS, __VA_ARGS__)
 #else
 #define LOG_TRACE(...)
 #endif
 
 #if LOGS_LEVEL >= DEBUG_LOGS
-#define LOG_DEBUG(...) fprintf_log(stdout, __FILE__, __LINE__, DEBUG_LOGS, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(DEBUG_LOGS, __VA_ARGS__)
 #else
 #define LOG_DEBUG(...)
 #endif
 
 #if LOGS_LEVEL >= INFO_LOGS
-#define LOG_INFO(...) fprintf_log(stdout, __FILE__, __LINE__, INFO_LOGS, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(INFO_LOGS, __VA_ARGS__)
 #else
 #define LOG_INFO(...)
 #endif
 
 #if LOGS_LEVEL >= WARN_LOGS
-#define LOG_WARN(...) fprintf_log(stdout, __FILE__, __LINE__, WARN_LOGS, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(WARN_LOGS, __VA_ARGS__)
 #else
 #define LOG_WARN(...)
 #endif
 
-#define LOG_ERROR(...) fprintf_log(stderr, __FILE__, __LINE__, ERROR_LOGS, __VA_ARGS__)
-#define LOG_FATAL(...) fprintf_log(stderr, __FILE__, __LINE__, FATAL_LOGS, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(ERROR_LOGS, __VA_ARGS__)
+#define LOG_FATAL(...) LOG_AT(FATAL_LOGS, __VA_ARGS__)
@@ -92,17 +92,26 @@ static inline void loadMeshTexture(Model* model, unsigned int count, struct aiMa
     }
 }
 
-static int processMesh(Model* model, Mesh* mesh, const struct aiMesh *aiMesh, const struct aiScene *scene)
+int convertMesh(Mesh *mesh, const struct aiMesh *aiMesh)
 {
     // Process vertices
     mesh->vertexCount = aiMesh->mNumVertices;
     mesh->vertices = (Vertex*)malloc(mesh->vertexCount * sizeof(Vertex));
+    if (mesh->vertices == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for %d vertices\n", mesh->vertexCount);
+        return -1;
+    }
+    glm_vec3_fill(mesh->bounds[0], FLT_MAX);
+    glm_vec3_fill(mesh->bounds[1], -FLT_MAX);
     for (unsigned int i=0; i<aiMesh->mNumVertices; i++)
     {
         // Position
         mesh->vertices[i].position[0] = aiMesh->mVertices[i].x;
         mesh->vertices[i].position[1] = aiMesh->mVertices[i].y;
         mesh->vertices[i].position[2] = aiMesh->mVertices[i].z;
+        glm_vec3_minv(mesh->bounds[0], mesh->vertices[i].position, mesh->bounds[0]);
+        glm_vec3_maxv(mesh->bounds[1], mesh->vertices[i].position, mesh->bounds[1]);
 
         // Normal
         mesh->vertices[i].normal[0] = aiMesh->mNormals[i].x;
@@ -136,12 +145,26 @@ static int processMesh(Model* model, Mesh* mesh, const struct aiMesh *aiMesh, co
     mesh->indexCount = 0;
     for (unsigned int i=0; i<aiMesh->mNumFaces; i++) mesh->indexCount += aiMesh->mFaces[i].mNumIndices;
     mesh->indices = (unsigned int*)malloc(mesh->indexCount * sizeof(unsigned int));
+    if (mesh->indices == NULL)
+    {
+        LOG_ERROR("Failed to allocate memory for %d indices\n", mesh->indexCount);
+        free(mesh->vertices);
+        mesh->vertices = NULL;
+        return -1;
+    }
     for (unsigned int i=0; i<aiMesh->mNumFaces; i++)
     {
         struct aiFace face = aiMesh->mFaces[i];
         for (unsigned int j=0; j<face.mNumIndices; j++) mesh->indices[i*3+j] = face.mIndices[j];
     }
 
+    return 0;
+}
+
+static int processMesh(Model* model, Mesh* mesh, const struct aiMesh *aiMesh, const struct aiScene *scene)
+{
+    if (convertMesh(mesh, aiMesh) < 0) return -1;
+
     // Process material
     if (aiMesh->mMaterialIndex >= 0)
     {
@@ -231,6 +254,13 @@ void drawMesh(Mesh *mesh, unsigned int programShader)
     glBindVertexArray(0);
 }
 
+void drawMeshDepth(const Mesh *mesh, unsigned int instanceCount)
+{
+    glBindVertexArray(mesh->VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+    glBindVertexArray(0);
+}
+
 void freeMesh(Mesh *mesh)
 {
     free(mesh->vertices);
@@ -286,6 +316,11 @@ static int loadFileIntoModel(Model *model, char *path, bool flipUVs)
 
     aiReleaseImport(scene);
 
+    // Model bounds
+    glm_vec3_fill(model->localBounds[0], FLT_MAX);
+    glm_vec3_fill(model->localBounds[1], -FLT_MAX);
+    for (unsigned int i=0; i<model->meshCount; i++) glm_aabb_merge(model->localBounds, model->meshes[i].bounds, model->localBounds);
+
     #if DEBUG
     Uint64 importEnd = SDL_GetTicks64();
     LOG_DEBUG("Imported model %s in %llu ms\n", path, importEnd-importStart);
@@ -294,35 +329,61 @@ static int loadFileIntoModel(Model *model, char *path, bool flipUVs)
     return 0;
 }
 
-int loadModel(Model *model, char *filename, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs)
+int loadModel(Model *model, char *filename, TransformHierarchy *transforms, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs)
 {
     char path[128];
     snprintf(path, 127, "%s%s", MODELPATH, filename);
 
-    return loadModelFullPath(model, path, position, scale, rotation_vector, rotation_angle, flipUVs);
+    return loadModelFullPath(model, path, transforms, parent, position, scale, rotation_vector, rotation_angle, flipUVs);
 }
 
-int loadModelFullPath(Model *model, char *path, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs)
+int loadModelFullPath(Model *model, char *path, TransformHierarchy *transforms, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs)
 {
     getDirectory(path, model->dir);
     loadFileIntoModel(model, path, flipUVs);
 
-    glm_vec3_copy(position, model->position);
-    glm_vec3_copy(scale, model->scale);
-    glm_vec3_copy(rotation_vector, model->rotation_vector);
-    model->rotation_angle = rotation_angle;
+    const int transform = addTransform(transforms, parent, position, scale, rotation_vector, rotation_angle);
+    if (transform < 0) return -1;
+    model->transforms = transforms;
+    model->transform = transform;
+
+    // World bounds are computed by the first updateModelBounds
+    glm_aabb_invalidate(model->bounds);
+    glm_aabb_invalidate(model->prevBounds);
+    model->dynamic = false;
+    model->changed = true;  // Nothing is cached yet
 
     return 0;
 }
 
+void setModelTransform(Model *model, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle)
+{
+    setTransform(model->transforms, model->transform, position, scale, rotation_vector, rotation_angle);
+}
+
+void updateModelBounds(Model *model)
+{
+    if (!model->transforms->changed[model->transform]) return;
+
+    const bool first = !glm_aabb_isvalid(model->bounds);
+    glm_aabb_transform(model->localBounds, model->transforms->worlds[model->transform], model->bounds);
+    if (first)
+    {
+        glm_vec3_copy(model->bounds[0], model->prevBounds[0]);
+        glm_vec3_copy(model->bounds[1], model->prevBounds[1]);
+    }
+    model->changed = true;
+}
+
+void getModelMatrix(const Model *model, mat4 dest)
+{
+    glm_mat4_copy(model->transforms->worlds[model->transform], dest);
+}
+
 void drawModel(Model *model, unsigned int programShader)
 {
-    static mat4 modelMat = GLM_MAT4_IDENTITY_INIT;
-    glm_mat4_identity(modelMat);
-    glm_translate(modelMat, model->position);
-    glm_scale(modelMat, model->scale);
-    glm_rotate(modelMat, model->rotation_angle, model->rotation_vector);
-    glUniformMatrix4fv(glGetUniformLocation(programShader, "model"), 1, GL_FALSE, (float*)modelMat);
+    glUniformMatrix4fv(glGetUniformLocation(programShader, "model"), 1, GL_FALSE, (float*)model->transforms->worlds[model->transform]);
+    glUniformMatrix3fv(glGetUniformLocation(programShader, "normalMatrix"), 1, GL_FALSE, (float*)model->transforms->normals[model->transform]);
 
     for (unsigned int i=0; i<model->meshCount; i++) drawMesh(&model->meshes[i], programShader);
 }
@@ -2,6 +2,7 @@
 #define MODEL_H
 
 
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +14,7 @@
 #include <SDL2/SDL.h>
 
 #include "textures.h"
+#include "transform.h"
 #include "logs.h"
 
 
@@ -43,6 +45,7 @@ typedef struct {
  * @param indexCount Number of indices
  * @param textures Array of textures
  * @param textureCount Number of textures
+ * @param bounds Axis aligned bounding box of the mesh, in model space
  * 
  * @param VAO Vertex Array Object
  * @param VBO Vertex Buffer Object
@@ -56,16 +59,34 @@ typedef struct {
     Vertex *vertices;
     unsigned int *indices;
     Texture *textures;
+    vec3 bounds[2];
 
     unsigned int VAO, VBO, EBO;
 } Mesh;
 
 
+/**
+ * @brief Model structure
+ * 
+ * @param transforms Hierarchy holding the transform of the model
+ * @param transform Index of the transform of the model in the hierarchy
+ * @param localBounds Axis aligned bounding box of the model, in model space
+ * @param bounds Axis aligned bounding box of the model, in world space
+ * @param prevBounds World bounding box when the shadows were last updated
+ * @param dynamic Whether the model is expected to move (its shadows are not cached)
+ * @param changed Whether the model moved or changed since the shadows were last updated
+ * 
+ * @note Models are static by default
+ * @note Use setModelTransform to move a model, bounds and shadows follow on the next updateModelBounds
+*/
 typedef struct {
-    vec3 position;
-    vec3 scale;
-    vec3 rotation_vector;
-    float rotation_angle;
+    TransformHierarchy *transforms;
+    unsigned int transform;
+    vec3 localBounds[2];
+    vec3 bounds[2];
+    vec3 prevBounds[2];
+    bool dynamic;
+    bool changed;
     unsigned int meshCount;
     Mesh *meshes;
     char dir[64];
@@ -75,6 +96,17 @@ typedef struct {
 } Model;
 
 
+/**
+ * @brief Copy the vertices and indices of an Assimp mesh, and compute its bounds
+ * 
+ * @param mesh Pointer to the mesh to fill
+ * @param aiMesh Assimp mesh, triangulated with tangents
+ * @return int 0 if success, -1 if error
+ * 
+ * @note Nothing is sent to the GPU, processMesh does it once the textures are loaded
+*/
+int convertMesh(Mesh *mesh, const struct aiMesh *aiMesh);
+
 /**
  * @brief Draw a mesh
  * 
@@ -84,6 +116,14 @@ typedef struct {
 */
 void drawMesh(Mesh *mesh, unsigned int programShader);
 
+/**
+ * @brief Draw a mesh without binding its textures (depth only passes)
+ * 
+ * @param mesh Pointer to the mesh to draw
+ * @param instanceCount Number of instances to draw
+*/
+void drawMeshDepth(const Mesh *mesh, unsigned int instanceCount);
+
 /**
  * @brief Free a mesh
  * 
@@ -97,32 +137,68 @@ void freeMesh(Mesh *mesh);
  * 
  * @param model Pointer to the model to load
  * @param filename The name of the file to load
- * @param position Position of the model
- * @param scale Scale of the model
- * @param rotation_vector Vector of the rotation
- * @param rotation_angle Angle of the rotation
+ * @param transforms Hierarchy receiving the transform of the model
+ * @param parent Parent transform, TRANSFORM_NO_PARENT if the model is not attached
+ * @param position Local position of the model
+ * @param scale Local scale of the model
+ * @param rotation_vector Vector of the local rotation
+ * @param rotation_angle Angle of the local rotation
  * @param flipUVs Whether to flip the UVs or not
  * @return 0 on success, -1 on failure
  * 
  * @note The filename must be relative to the MODELPATH
 */
-int loadModel(Model *model, char *filename, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs);
+int loadModel(Model *model, char *filename, TransformHierarchy *transforms, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs);
 
 /**
  * @brief Load a model from a file
  * 
  * @param model Pointer to the model to load
  * @param filename The name of the file to load
- * @param position Position of the model
- * @param scale Scale of the model
- * @param rotation_vector Vector of the rotation
- * @param rotation_angle Angle of the rotation
+ * @param transforms Hierarchy receiving the transform of the model
+ * @param parent Parent transform, TRANSFORM_NO_PARENT if the model is not attached
+ * @param position Local position of the model
+ * @param scale Local scale of the model
+ * @param rotation_vector Vector of the local rotation
+ * @param rotation_angle Angle of the local rotation
  * @param flipUVs Whether to flip the UVs or not
  * @return 0 on success, -1 on failure
  * 
  * @note The filename must be absolute
 */
-int loadModelFullPath(Model *model, char *path, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs);
+int loadModelFullPath(Model *model, char *path, TransformHierarchy *transforms, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle, bool flipUVs);
+
+/**
+ * @brief Move a model
+ * 
+ * @param model Pointer to the model to move
+ * @param position Local position of the model
+ * @param scale Local scale of the model
+ * @param rotation_vector Vector of the local rotation
+ * @param rotation_angle Angle of the local rotation
+ * 
+ * @note Takes effect on the next update of the transform hierarchy
+*/
+void setModelTransform(Model *model, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle);
+
+/**
+ * @brief Update the world bounds of a model if its transform changed, and flag it as changed for the shadows
+ * 
+ * @param model Pointer to the model
+ * 
+ * @note Should be called after updateTransformHierarchy
+*/
+void updateModelBounds(Model *model);
+
+/**
+ * @brief Get the model matrix of a model
+ * 
+ * @param model Pointer to the model
+ * @param dest Destination matrix
+ * 
+ * @note Copy of the world matrix cached by the transform hierarchy
+*/
+void getModelMatrix(const Model *model, mat4 dest);
 
 /**
  * @brief Draw a model
@@ -0,0 +1,18 @@
+#include "random.h"
+
+
+float randomFloat(uint32_t *seed)
+{
+    // xorshift stays at 0 forever
+    uint32_t x = *seed ? *seed : 0x9e3779b9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+float randomRange(uint32_t *seed, float min, float max)
+{
+    return min + (max - min) * randomFloat(seed);
+}
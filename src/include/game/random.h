@@ -0,0 +1,27 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+
+#include <stdint.h>
+
+
+/**
+ * @brief Next random number of a xorshift32 generator, reproducible from its seed
+ * 
+ * @param seed State of the generator, updated (0 starts from a fixed seed)
+ * @return float Number in [0, 1)
+*/
+float randomFloat(uint32_t *seed);
+
+/**
+ * @brief Next random number of a xorshift32 generator, in a range
+ * 
+ * @param seed State of the generator, updated (0 starts from a fixed seed)
+ * @param min Lowest number
+ * @param max Highest number, excluded
+ * @return float Number in [min, max)
+*/
+float randomRange(uint32_t *seed, float min, float max);
+
+
+#endif
@@ -8,6 +8,50 @@ void renderScene(const Scene *scene, GLuint programShader)
     for (unsigned int i=0; i<scene->modelCount; i++) drawModel(&scene->models[i], programShader);
 }
 
+void renderSceneDepth(const Scene *scene, GLuint programShader, vec3 cameraPos)
+{
+    static unsigned int *order = NULL;
+    static float *distances = NULL;
+    static unsigned int capacity = 0;
+    if (capacity < scene->modelCount)
+    {
+        unsigned int *newOrder = realloc(order, scene->modelCount * sizeof(unsigned int));
+        float *newDistances = realloc(distances, scene->modelCount * sizeof(float));
+        if (newOrder) order = newOrder;
+        if (newDistances) distances = newDistances;
+        if (!newOrder || !newDistances) {LOG_ERROR("Could not allocate depth pass order\n"); return;}
+        capacity = scene->modelCount;
+    }
+
+    // Front to back, by distance to the center of the bounds
+    for (unsigned int i=0; i<scene->modelCount; i++)
+    {
+        vec3 center;
+        glm_aabb_center((vec3*)scene->models[i].bounds, center);
+        distances[i] = glm_vec3_distance2(center, cameraPos);
+
+        unsigned int j = i;
+        while (j > 0 && distances[order[j-1]] > distances[i]) {order[j] = order[j-1]; j--;}
+        order[j] = i;
+    }
+
+    glUseProgram(programShader);
+    const GLint modelLocation = glGetUniformLocation(programShader, "model");
+    for (unsigned int i=0; i<scene->modelCount; i++)
+    {
+        const Model *model = &scene->models[order[i]];
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, (float*)model->transforms->worlds[model->transform]);
+        for (unsigned int m=0; m<model->meshCount; m++) drawMeshDepth(&model->meshes[m], 1);
+    }
+}
+
+void updateSceneTransforms(Scene *scene)
+{
+    updateTransformHierarchy(&scene->transforms);
+    for (unsigned int i=0; i<scene->modelCount; i++) updateModelBounds(&scene->models[i]);
+    for (unsigned int i=0; i<scene->uiModelCount; i++) updateModelBounds(&scene->uiModels[i]);
+}
+
 void destroyScene(Scene *scene)
 {
     for (unsigned int i=0; i<scene->modelCount; i++)
@@ -15,7 +59,9 @@ void destroyScene(Scene *scene)
     destroySkybox(scene);
     for (unsigned int i=0; i<scene->soundCount; i++)
         destroySound(scene->sounds[i]);
+    closeStream(&scene->ambience);
     free(scene->models);
+    destroyTransformHierarchy(&scene->transforms);
 }
 
 
@@ -7,9 +7,11 @@
 #include "game/audio.h"
 #include "game/model.h"
 #include "game/textures.h"
+#include "game/transform.h"
 
 
 typedef struct {
+    TransformHierarchy transforms;  // Transforms of every model, and of the nodes they are attached to
     Model *models;
     unsigned int modelCount;
     Model *uiModels;
@@ -19,6 +21,7 @@ typedef struct {
 
     Sound *sounds;
     unsigned int soundCount;
+    Stream ambience;  // Looping background sound, streamed from disk
 
     bool loaded;
 } Scene;
@@ -26,6 +29,27 @@ typedef struct {
 
 void renderScene(const Scene *scene, GLuint programShader);
 
+/**
+ * @brief Recompute the world matrices that changed, and the bounds of the models using them
+ * 
+ * @param scene Scene to update
+ * 
+ * @note Should be called once per frame, before any pass
+*/
+void updateSceneTransforms(Scene *scene);
+
+/**
+ * @brief Render the depth of the scene, without shading
+ * 
+ * @param scene Scene to render
+ * @param programShader Position only shader program (prepass.vert)
+ * @param cameraPos Position of the camera
+ * 
+ * @note Models are drawn front to back, so that hidden meshes are rejected by the depth test
+ * @note Projection and view uniforms must already be set
+*/
+void renderSceneDepth(const Scene *scene, GLuint programShader, vec3 cameraPos);
+
 /**
  * @brief Load a scene
  * 
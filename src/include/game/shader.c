@@ -37,18 +37,82 @@ static char* readSource(const char* filename)
 }
 
 
+static char* expandIncludes(char *source, int depth)
+{
+    // #include "file" lines are replaced by the file, relative to SHADERPATH
+    char *directive = source;
+    while ((directive = strstr(directive, "#include")) != NULL)
+    {
+        // Only directives at the start of a line
+        if (directive != source && directive[-1] != '\n') {directive++; continue;}
+
+        char *nameStart = strchr(directive, '"');
+        char *nameEnd = nameStart ? strchr(nameStart+1, '"') : NULL;
+        char *lineEnd = strchr(directive, '\n');
+        if (!lineEnd) lineEnd = directive + strlen(directive);
+        if (!nameEnd || nameEnd > lineEnd)
+        {
+            LOG_ERROR("Malformed #include in shader source\n");
+            free(source);
+            return NULL;
+        }
+        if (depth >= SHADER_MAX_INCLUDE_DEPTH)
+        {
+            LOG_ERROR("Shader includes are nested too deep\n");
+            free(source);
+            return NULL;
+        }
+
+        char path[256];
+        snprintf(path, sizeof(path), "%s%.*s", SHADERPATH, (int)(nameEnd - nameStart - 1), nameStart+1);
+        char *included = readSource(path);
+        if (included) included = expandIncludes(included, depth+1);
+        if (!included) {free(source); return NULL;}
+
+        // prefix + included + rest of the source
+        const size_t prefixLength = directive - source;
+        const size_t includedLength = strlen(included);
+        char *expanded = (char*)malloc(prefixLength + includedLength + strlen(lineEnd) + 1);
+        if (!expanded)
+        {
+            LOG_ERROR("Failed to allocate memory for shader includes\n");
+            free(included);
+            free(source);
+            return NULL;
+        }
+        memcpy(expanded, source, prefixLength);
+        memcpy(expanded + prefixLength, included, includedLength);
+        strcpy(expanded + prefixLength + includedLength, lineEnd);
+        free(included);
+        free(source);
+
+        source = expanded;
+        directive = source + prefixLength + includedLength;
+    }
+    return source;
+}
+
+
+char* loadShaderSource(const char *sourcePath)
+{
+    char path[256];
+    snprintf(path, 255, "%s%s", SHADERPATH, sourcePath);
+
+    char *source = readSource(path);
+    if (source != NULL) source = expandIncludes(source, 0);
+    return source;
+}
+
+
 int loadShader(Shader *shader, const char *sourcePath, GLenum type)
 {
     int success;
-    char path[256];
     char infolog[512];
 
-    snprintf(path, 255, "%s%s", SHADERPATH, sourcePath);
-
     shader->type = type;
-    shader->id = glCreateShader(type);
-    shader->source = readSource(path);
+    shader->source = loadShaderSource(sourcePath);
     if (shader->source == NULL) return -1;
+    shader->id = glCreateShader(type);
     const GLchar* shaderSource[] = {shader->source};  // Inline ?
     glShaderSource(shader->id, 1, shaderSource, NULL);
     glCompileShader(shader->id);
@@ -58,7 +122,7 @@ int loadShader(Shader *shader, const char *sourcePath, GLenum type)
     if (success != GL_TRUE)
     {
         glGetShaderInfoLog(shader->id, 512, NULL, infolog);
-        LOG_ERROR("Failed to compile shader %s: %s\n", path, infolog);
+        LOG_ERROR("Failed to compile shader %s%s: %s\n", SHADERPATH, sourcePath, infolog);
         destroyShader(shader);
         return -1;
     }
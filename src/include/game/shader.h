@@ -13,6 +13,7 @@
 
 
 #define SHADERPATH "assets/shaders/"
+#define SHADER_MAX_INCLUDE_DEPTH 8
 
 
 typedef struct {
@@ -22,6 +23,14 @@ typedef struct {
 } Shader;
 
 
+/**
+ * @brief Read the source of a shader, with its includes expanded
+ * 
+ * @param sourcePath Path to the source file, relative to SHADERPATH
+ * @return char* Source, to free, or NULL if error
+*/
+char* loadShaderSource(const char *sourcePath);
+
 /**
  * @brief Loads a shader from a file
  * 
@@ -29,6 +38,8 @@ typedef struct {
  * @param sourcePath Path to the source file
  * @param type Type of the shader
  * @return int 0 if success, -1 if error
+ * 
+ * @note Lines like #include "file.glsl" are replaced by the file, relative to SHADERPATH
 */
 int loadShader(Shader *shader, const char *sourcePath, GLenum type);
 
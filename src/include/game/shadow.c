@@ -0,0 +1,461 @@
+#include "shadow.h"
+
+
+static GLuint createDepthCubemapArray(unsigned int resolution, unsigned int slotCount)
+{
+    GLuint array;
+    glGenTextures(1, &array);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, array);
+    glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_DEPTH_COMPONENT24, resolution, resolution, slotCount*6);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+    LOG_TRACE("Created depth cubemap array of %d cubemaps with resolution %d\n", slotCount, resolution);
+    return array;
+}
+
+
+static GLuint createMomentCubemapArray(unsigned int resolution, unsigned int slotCount)
+{
+    GLuint array;
+    glGenTextures(1, &array);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, array);
+    glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_RGBA16F, resolution, resolution, slotCount*6);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);  // Moments can be filtered
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+    LOG_TRACE("Created moment cubemap array of %d cubemaps with resolution %d\n", slotCount, resolution);
+    return array;
+}
+
+
+// Cubemap arrays of every tier, at the resolution of the pool
+static void initShadowTiers(ShadowPool *pool)
+{
+    static const unsigned int divisors[SHADOW_TIER_COUNT] = SHADOW_TIER_DIVISORS;
+    static const unsigned int slots[SHADOW_TIER_COUNT] = SHADOW_TIER_SLOTS;
+
+    for (int t=0; t<SHADOW_TIER_COUNT; t++)
+    {
+        ShadowTier *tier = &pool->tiers[t];
+        tier->resolution = pool->resolution / divisors[t];
+        tier->slotCount = slots[t];
+        tier->depthArray = createDepthCubemapArray(tier->resolution, tier->slotCount);
+        tier->cacheArray = 0;
+        tier->momentArray = pool->filter == SHADOW_FILTER_MOMENTS ? createMomentCubemapArray(tier->resolution, tier->slotCount) : 0;
+        for (int s=0; s<SHADOW_MAX_SLOTS; s++) tier->owners[s] = -1;
+
+        // Depth can't be fetched texel by texel from a cubemap sampler
+        glGenTextures(1, &tier->depthView);
+        glTextureView(tier->depthView, GL_TEXTURE_2D_ARRAY, tier->depthArray, GL_DEPTH_COMPONENT24, 0, 1, 0, tier->slotCount*6);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, tier->depthView);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+}
+
+static void destroyShadowTiers(ShadowPool *pool)
+{
+    for (int t=0; t<SHADOW_TIER_COUNT; t++)
+    {
+        ShadowTier *tier = &pool->tiers[t];
+        if (tier->depthArray) {glDeleteTextures(1, &tier->depthArray); tier->depthArray = 0;}
+        if (tier->cacheArray) {glDeleteTextures(1, &tier->cacheArray); tier->cacheArray = 0;}
+        if (tier->depthView) {glDeleteTextures(1, &tier->depthView); tier->depthView = 0;}
+        if (tier->momentArray) {glDeleteTextures(1, &tier->momentArray); tier->momentArray = 0;}
+    }
+}
+
+int initShadowPool(ShadowPool *pool, GLuint shaderProgramMoments, unsigned int resolution, float farPlane)
+{
+    static const int quality[SHADOW_FILTER_COUNT] = SHADOW_FILTER_QUALITY_DEFAULT;
+
+    if (!GLEW_ARB_texture_cube_map_array)
+    {
+        LOG_ERROR("Cubemap arrays are not supported\n");
+        return -1;
+    }
+
+    pool->resolution = resolution;
+    pool->farPlane = farPlane;
+    pool->filter = SHADOW_FILTER_PCF;
+    initShadowTiers(pool);
+
+    // Hardware comparison is a sampler state, the same cubemap arrays are bound twice
+    glGenSamplers(1, &pool->compareSampler);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);  // 2x2 comparisons per tap
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(pool->compareSampler, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    pool->shaderProgramMoments = shaderProgramMoments;
+    memcpy(pool->filterQuality, quality, sizeof(quality));
+    pool->frame = 0;
+    setShadowFilter(pool, NULL, 0, SHADOW_FILTER_DEFAULT, pool->filterQuality[SHADOW_FILTER_DEFAULT]);
+
+    LOG_DEBUG("Initialized shadow pool\n");
+    return 0;
+}
+
+void setShadowResolution(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, unsigned int resolution)
+{
+    if (resolution == pool->resolution) return;
+    destroyShadowTiers(pool);
+    pool->resolution = resolution;
+    initShadowTiers(pool);
+
+    // Slots are gone with their arrays
+    for (unsigned int i=0; i<pointLightCount; i++)
+    {
+        pointLights[i].shadowTier = -1;
+        pointLights[i].shadowSlot = -1;
+        pointLights[i].cacheValid = false;
+        pointLights[i].staticCacheValid = false;
+        pointLights[i].dynamicFaces = 0;
+    }
+    LOG_INFO("Shadow map resolution : %u\n", resolution);
+}
+
+void setShadowFarPlane(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, float farPlane)
+{
+    pool->farPlane = farPlane;
+    for (unsigned int i=0; i<pointLightCount; i++) pointLights[i].cacheValid = false;
+}
+
+void setShadowFilter(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, ShadowFilter filter, int quality)
+{
+    static const int maxQuality[SHADOW_FILTER_COUNT] = SHADOW_FILTER_QUALITY_MAX;
+    static const char *names[SHADOW_FILTER_COUNT] = SHADOW_FILTER_NAMES;
+
+    const int minQuality = filter == SHADOW_FILTER_MOMENTS ? 0 : 1;
+    if (quality < minQuality) quality = minQuality;
+    if (quality > maxQuality[filter]) quality = maxQuality[filter];
+    const bool rebuild = filter == SHADOW_FILTER_MOMENTS && (pool->filter != filter || pool->filterQuality[filter] != quality);
+    pool->filter = filter;
+    pool->filterQuality[filter] = quality;
+
+    if (filter == SHADOW_FILTER_MOMENTS)
+        for (int t=0; t<SHADOW_TIER_COUNT; t++)
+            if (!pool->tiers[t].momentArray) pool->tiers[t].momentArray = createMomentCubemapArray(pool->tiers[t].resolution, pool->tiers[t].slotCount);
+
+    // Moments are only computed for the faces that get re-rendered
+    if (rebuild) for (unsigned int i=0; i<pointLightCount; i++) pointLights[i].cacheValid = false;
+
+    LOG_INFO("Shadow filter : %s (quality %d)\n", names[filter], quality);
+}
+
+void destroyShadowPool(ShadowPool *pool)
+{
+    destroyShadowTiers(pool);
+    if (pool->compareSampler) {glDeleteSamplers(1, &pool->compareSampler); pool->compareSampler = 0;}
+}
+
+
+static float shadowScore(const PointLight *light, vec3 cameraPos, vec4 planes[6], float tanHalfFovY)
+{
+    // The light only matters if its range is visible
+    for (int i=0; i<6; i++)
+        if (glm_vec3_dot(planes[i], (float*)light->position) + planes[i][3] < -light->radius) return 0.0f;
+
+    // Fraction of the screen height covered by the range of the light
+    const float distance = glm_vec3_distance(cameraPos, (float*)light->position);
+    if (distance <= light->radius) return 1.0f + light->radius;  // Camera inside the range
+    return light->radius / (distance * tanHalfFovY);
+}
+
+static inline void releaseShadowSlot(ShadowPool *pool, PointLight *light)
+{
+    if (light->shadowTier < 0) return;
+    pool->tiers[light->shadowTier].owners[light->shadowSlot] = -1;
+    light->shadowTier = -1;
+    light->shadowSlot = -1;
+}
+
+void assignShadowSlots(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, vec3 cameraPos, mat4 viewProjection, float tanHalfFovY)
+{
+    static const unsigned int slots[SHADOW_TIER_COUNT] = SHADOW_TIER_SLOTS;
+    static unsigned int order[MAX_POINT_LIGHTS];
+    static float scores[MAX_POINT_LIGHTS];
+    static int desiredTiers[MAX_POINT_LIGHTS];
+
+    vec4 planes[6];
+    glm_frustum_planes(viewProjection, planes);
+
+    // Score lights, those keeping their tier get a bonus so that lights don't flicker between tiers
+    unsigned int candidateCount = 0;
+    for (unsigned int i=0; i<pointLightCount; i++)
+    {
+        desiredTiers[i] = -1;
+        if (!pointLights[i].castShadows) continue;
+        scores[i] = shadowScore(&pointLights[i], cameraPos, planes, tanHalfFovY);
+        if (scores[i] <= 0.0f) continue;
+        if (pointLights[i].shadowTier >= 0) scores[i] *= SHADOW_HYSTERESIS;
+
+        // Insertion sort by decreasing score
+        unsigned int j = candidateCount++;
+        while (j > 0 && scores[order[j-1]] < scores[i]) {order[j] = order[j-1]; j--;}
+        order[j] = i;
+    }
+
+    // The biggest lights get the sharpest tiers
+    unsigned int tier = 0, used = 0;
+    for (unsigned int k=0; k<candidateCount && tier<SHADOW_TIER_COUNT; k++)
+    {
+        desiredTiers[order[k]] = tier;
+        if (++used == slots[tier]) {tier++; used = 0;}
+    }
+
+    // Free slots first so that they can be reused in the same frame
+    for (unsigned int i=0; i<pointLightCount; i++)
+        if (pointLights[i].shadowTier != desiredTiers[i]) releaseShadowSlot(pool, &pointLights[i]);
+
+    for (unsigned int i=0; i<pointLightCount; i++)
+    {
+        PointLight *light = &pointLights[i];
+        if (desiredTiers[i] < 0 || light->shadowTier == desiredTiers[i]) continue;
+
+        ShadowTier *shadowTier = &pool->tiers[desiredTiers[i]];
+        for (unsigned int s=0; s<shadowTier->slotCount; s++)
+        {
+            if (shadowTier->owners[s] >= 0) continue;
+            shadowTier->owners[s] = i;
+            light->shadowTier = desiredTiers[i];
+            light->shadowSlot = s;
+            break;
+        }
+        // New slot, nothing is cached
+        light->cacheValid = false;
+        light->staticCacheValid = false;
+        light->dynamicFaces = 0;
+        LOG_TRACE("Light %d moved to shadow tier %d (slot %d)\n", i, light->shadowTier, light->shadowSlot);
+    }
+}
+
+void bindShadowPool(const ShadowPool *pool, GLuint shaderProgram)
+{
+    char locate[32];
+    for (int t=0; t<SHADOW_TIER_COUNT; t++)
+    {
+        // Every sampler uniform needs a unit, even if the filter doesn't use it
+        glActiveTexture(GL_TEXTURE0+SHADOWMAP_TEXTURE_UNIT+t);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, pool->tiers[t].depthArray);
+        sprintf(locate, "shadowTiers[%d]", t);
+        glUniform1i(glGetUniformLocation(shaderProgram, locate), SHADOWMAP_TEXTURE_UNIT+t);
+
+        glActiveTexture(GL_TEXTURE0+SHADOW_COMPARE_TEXTURE_UNIT+t);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, pool->tiers[t].depthArray);
+        glBindSampler(SHADOW_COMPARE_TEXTURE_UNIT+t, pool->compareSampler);
+        sprintf(locate, "shadowCompareTiers[%d]", t);
+        glUniform1i(glGetUniformLocation(shaderProgram, locate), SHADOW_COMPARE_TEXTURE_UNIT+t);
+
+        glActiveTexture(GL_TEXTURE0+SHADOW_MOMENTS_TEXTURE_UNIT+t);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, pool->tiers[t].momentArray);
+        sprintf(locate, "shadowMomentTiers[%d]", t);
+        glUniform1i(glGetUniformLocation(shaderProgram, locate), SHADOW_MOMENTS_TEXTURE_UNIT+t);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(shaderProgram, "shadowFilter"), pool->filter);
+    glUniform1i(glGetUniformLocation(shaderProgram, "shadowQuality"), pool->filterQuality[pool->filter]);
+    glUniform1f(glGetUniformLocation(shaderProgram, "shadowMomentBias"), SHADOW_MOMENT_BIAS);
+    glUniform1ui(glGetUniformLocation(shaderProgram, "shadowFrame"), pool->frame);
+}
+
+
+static void drawShadowCaster(const Model *model, GLuint shaderProgramDepth, const PointLight *light, uint8_t faceMask)
+{
+    vec4 *modelMat = model->transforms->worlds[model->transform];
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgramDepth, "model"), 1, GL_FALSE, (float*)modelMat);
+
+    const GLint facesLocation = glGetUniformLocation(shaderProgramDepth, "faces");
+    for (unsigned int i=0; i<model->meshCount; i++)
+    {
+        const Mesh *mesh = &model->meshes[i];
+        vec3 bounds[2];
+        glm_aabb_transform((vec3*)mesh->bounds, modelMat, bounds);
+        const uint8_t faces = pointLightGetBoxFaces(light, bounds) & faceMask;
+        if (!faces) continue;
+
+        // One instance per face the mesh overlaps, the vertex shader picks the layer
+        GLint faceList[6];
+        unsigned int faceCount = 0;
+        for (int face=0; face<6; face++) if (faces & (1 << face)) faceList[faceCount++] = face;
+        glUniform1iv(facesLocation, faceCount, faceList);
+        drawMeshDepth(mesh, faceCount);
+    }
+}
+
+static void renderShadowCasters(Scene *scene, GLuint shaderProgramDepth, GLuint depthMapFBO, GLuint target, const PointLight *light, bool dynamic, uint8_t faceMask)
+{
+    // Without layer selection from the vertex shader, faces are rendered one by one
+    static int layered = -1;
+    if (layered < 0)
+    {
+        layered = GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_layer;
+        LOG_DEBUG("Shadow pass uses %s\n", layered ? "layered rendering" : "one pass per face");
+    }
+
+    // Layers of the cubemap array : slot*6 + face
+    const int layerBase = light->shadowSlot*6;
+    glUniform1i(glGetUniformLocation(shaderProgramDepth, "layerBase"), layerBase);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    for (int face=0; face<6; face++)
+    {
+        const uint8_t passMask = layered ? faceMask : faceMask & (1 << face);
+        if (!passMask) continue;
+
+        if (layered) glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, 0);
+        else glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, 0, layerBase+face);
+
+        for (unsigned int i=0; i<scene->modelCount; i++)
+        {
+            const Model *model = &scene->models[i];
+            if (model->dynamic != dynamic) continue;
+            if (!(pointLightGetBoxFaces(light, (vec3*)model->bounds) & passMask)) continue;
+            drawShadowCaster(model, shaderProgramDepth, light, passMask);
+        }
+
+        if (layered) break;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static inline void clearCubemapFaces(const ShadowTier *tier, GLuint array, int slot, uint8_t faces)
+{
+    static const float farthest = 1.0f;
+    for (int face=0; face<6; face++)
+        if (faces & (1 << face)) glClearTexSubImage(array, 0, 0, 0, slot*6+face, tier->resolution, tier->resolution, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farthest);
+}
+
+static inline void copyCubemapFaces(const ShadowTier *tier, int slot, uint8_t faces)
+{
+    for (int face=0; face<6; face++)
+        if (faces & (1 << face))
+            glCopyImageSubData(tier->cacheArray, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, slot*6+face,
+                               tier->depthArray, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, slot*6+face,
+                               tier->resolution, tier->resolution, 1);
+}
+
+static void computeMoments(const ShadowPool *pool, const ShadowTier *tier, int slot, uint8_t faces)
+{
+    GLint layers[6];
+    unsigned int faceCount = 0;
+    for (int face=0; face<6; face++) if (faces & (1 << face)) layers[faceCount++] = slot*6 + face;
+    glUniform1iv(glGetUniformLocation(pool->shaderProgramMoments, "layers"), faceCount, layers);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tier->depthView);
+    glBindImageTexture(0, tier->momentArray, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute((tier->resolution + 7) / 8, (tier->resolution + 7) / 8, faceCount);
+}
+
+void renderPointLightsShadowMap(Scene *scene, GLuint shaderProgramDepth, GLuint depthMapFBO, ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount)
+{
+    // Faces written this frame, their moments are recomputed once every depth map is done
+    static uint8_t updatedFaces[MAX_POINT_LIGHTS];
+
+    pool->frame++;
+    glUseProgram(shaderProgramDepth);
+
+    // Shared by every light, the far plane can change at runtime
+    static mat4 lightProjection = {0};
+    glm_perspective(glm_rad(90.0f), 1.0f, SHADOWMAP_ZNEAR, pool->farPlane, lightProjection);
+
+    // Compute depth map for each light
+    static mat4 shadowMatrices[6];
+    for (unsigned int i=0; i<pointLightCount; i++)
+    {
+        PointLight *light = &pointLights[i];
+        updatedFaces[i] = 0;
+        if (light->shadowTier < 0) continue;
+        ShadowTier *tier = &pool->tiers[light->shadowTier];
+
+        // Faces of the static shadows that have to be rebuilt
+        uint8_t staticFaces = 0;
+        if (!light->cacheValid || !glm_vec3_eqv(light->position, light->cachedPosition))
+        {
+            staticFaces = 0x3F;
+            glm_vec3_copy(light->position, light->cachedPosition);
+            light->cacheValid = true;
+            light->staticCacheValid = false;
+        }
+        // Faces where dynamic models are drawn
+        uint8_t dynamicFaces = 0;
+        for (unsigned int j=0; j<scene->modelCount; j++)
+        {
+            Model *model = &scene->models[j];
+            if (model->dynamic) dynamicFaces |= pointLightGetBoxFaces(light, model->bounds);
+            // A static model invalidates the faces it leaves and the faces it enters
+            else if (model->changed) staticFaces |= pointLightGetBoxFaces(light, model->prevBounds) | pointLightGetBoxFaces(light, model->bounds);
+        }
+        // Faces that had dynamic models last time have to be restored from the cache
+        const uint8_t restoredFaces = light->dynamicFaces;
+        light->dynamicFaces = dynamicFaces;
+        if (!(staticFaces | dynamicFaces | restoredFaces)) continue;
+
+        // The cache is only used once dynamic models have to be composited
+        const bool composite = dynamicFaces || light->staticCacheValid;
+        if (composite && !tier->cacheArray) tier->cacheArray = createDepthCubemapArray(tier->resolution, tier->slotCount);
+        if (composite && !light->staticCacheValid)
+        {
+            staticFaces = 0x3F;
+            light->staticCacheValid = true;
+        }
+        const GLuint staticTarget = composite ? tier->cacheArray : tier->depthArray;
+
+        glViewport(0, 0, tier->resolution, tier->resolution);
+        pointLightGetProjMatrices(light, &lightProjection, &shadowMatrices);
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgramDepth, "shadowMatrices"), 6, GL_FALSE, (float*)(shadowMatrices));
+
+        // Static models
+        if (staticFaces)
+        {
+            clearCubemapFaces(tier, staticTarget, light->shadowSlot, staticFaces);
+            renderShadowCasters(scene, shaderProgramDepth, depthMapFBO, staticTarget, light, false, staticFaces);
+        }
+
+        // Dynamic models, on top of a copy of the cache
+        if (composite)
+        {
+            copyCubemapFaces(tier, light->shadowSlot, staticFaces | dynamicFaces | restoredFaces);
+            if (dynamicFaces) renderShadowCasters(scene, shaderProgramDepth, depthMapFBO, tier->depthArray, light, true, dynamicFaces);
+        }
+        updatedFaces[i] = composite ? staticFaces | dynamicFaces | restoredFaces : staticFaces;
+    }
+
+    // Moments are prefiltered here once, instead of every fragment filtering the depth
+    if (pool->filter == SHADOW_FILTER_MOMENTS)
+    {
+        glUseProgram(pool->shaderProgramMoments);
+        glUniform1i(glGetUniformLocation(pool->shaderProgramMoments, "depthFaces"), 0);
+        glUniform1i(glGetUniformLocation(pool->shaderProgramMoments, "blurRadius"), pool->filterQuality[SHADOW_FILTER_MOMENTS]);
+        glUniform2f(glGetUniformLocation(pool->shaderProgramMoments, "shadowPlanes"), SHADOWMAP_ZNEAR, pool->farPlane);
+        for (unsigned int i=0; i<pointLightCount; i++)
+            if (updatedFaces[i]) computeMoments(pool, &pool->tiers[pointLights[i].shadowTier], pointLights[i].shadowSlot, updatedFaces[i]);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);  // Image stores must land before the scene samples them
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+    glUseProgram(0);
+
+    // Changes have been taken into account
+    for (unsigned int j=0; j<scene->modelCount; j++)
+    {
+        Model *model = &scene->models[j];
+        model->changed = false;
+        glm_vec3_copy(model->bounds[0], model->prevBounds[0]);
+        glm_vec3_copy(model->bounds[1], model->prevBounds[1]);
+    }
+}
@@ -0,0 +1,205 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+#include <GL/glew.h>
+
+#include "light.h"
+#include "logs.h"
+#include "scene.h"
+
+
+// Resolution tiers of the pool, from the sharpest to the coarsest
+#define SHADOW_TIER_COUNT 3
+#define SHADOW_TIER_DIVISORS {1, 2, 4}  // Resolution of each tier, as a fraction of the resolution of the pool
+#define SHADOW_TIER_SLOTS {2, 6, 16}
+#define SHADOW_MAX_SLOTS 16  // Largest value of SHADOW_TIER_SLOTS
+
+#define SHADOW_HYSTERESIS 1.25f  // Score bonus of lights keeping their tier
+
+// Texture units used by the pool, one per tier for each kind of sampler
+#define SHADOWMAP_TEXTURE_UNIT 16  // Raw depth
+#define SHADOW_COMPARE_TEXTURE_UNIT (SHADOWMAP_TEXTURE_UNIT + SHADOW_TIER_COUNT)  // Depth with hardware comparison
+#define SHADOW_MOMENTS_TEXTURE_UNIT (SHADOWMAP_TEXTURE_UNIT + 2*SHADOW_TIER_COUNT)  // Moments
+
+// Filtering
+#define SHADOW_FILTER_DEFAULT SHADOW_FILTER_HARDWARE
+#define SHADOW_FILTER_NAMES {"PCF", "Hardware PCF", "Moments"}
+#define SHADOW_FILTER_QUALITY_DEFAULT {20, 6, 1}  // Taps, taps, blur radius
+#define SHADOW_FILTER_QUALITY_MAX {20, 8, 3}
+#define SHADOW_MOMENT_BIAS 3e-5f  // Pulls moments towards a safe distribution, hides 16 bits quantization
+
+
+/**
+ * @brief Filtering of the shadow maps
+ * 
+ * @note SHADOW_FILTER_PCF : manual depth comparisons on a fixed kernel, quality is the number of taps
+ * @note SHADOW_FILTER_HARDWARE : bilinear hardware comparisons on a rotated Poisson disk jittered every frame, quality is the number of taps
+ * @note SHADOW_FILTER_MOMENTS : four moments prefiltered once per update and sampled once, quality is the blur radius in texels
+*/
+typedef enum {
+    SHADOW_FILTER_PCF,
+    SHADOW_FILTER_HARDWARE,
+    SHADOW_FILTER_MOMENTS,
+    SHADOW_FILTER_COUNT
+} ShadowFilter;
+
+/**
+ * @brief Resolution tier of the shadow pool
+ * 
+ * @param resolution Resolution of the faces
+ * @param slotCount Number of cubemaps
+ * @param depthArray Cubemap array read by the shaders
+ * @param cacheArray Cubemap array caching static models, allocated on first use
+ * @param depthView View of depthArray as a 2D array, read by the moments shader
+ * @param momentArray Cubemap array of moments, allocated on first use
+ * @param owners Light owning each slot, -1 if free
+*/
+typedef struct {
+    unsigned int resolution;
+    unsigned int slotCount;
+    GLuint depthArray;
+    GLuint cacheArray;
+    GLuint depthView;
+    GLuint momentArray;
+    int owners[SHADOW_MAX_SLOTS];
+} ShadowTier;
+
+/**
+ * @brief Shadow pool structure
+ * 
+ * @param tiers Resolution tiers
+ * @param resolution Resolution of the sharpest tier
+ * @param farPlane Far plane of the depth cubemaps
+ * @param filter Filtering of the shadow maps
+ * @param filterQuality Quality of each filter
+ * @param compareSampler Sampler object doing hardware depth comparison
+ * @param shaderProgramMoments Compute shader program turning depth into moments
+ * @param frame Frame counter, used to jitter the filter kernels
+ * 
+ * @note Every point light shadow lives in one of a few fixed size cubemap arrays,
+ *       so memory is bounded whatever the number of lights
+*/
+typedef struct {
+    ShadowTier tiers[SHADOW_TIER_COUNT];
+    unsigned int resolution;
+    float farPlane;
+
+    ShadowFilter filter;
+    int filterQuality[SHADOW_FILTER_COUNT];
+    GLuint compareSampler;
+    GLuint shaderProgramMoments;
+    unsigned int frame;
+} ShadowPool;
+
+
+/**
+ * @brief Allocate the shadow pool
+ * 
+ * @param pool Pointer to the pool
+ * @param shaderProgramMoments Compute shader program turning depth into moments (moments.comp)
+ * @param resolution Resolution of the sharpest tier, a power of two
+ * @param farPlane Far plane of the depth cubemaps
+ * @return int 0 if success, -1 if error
+*/
+int initShadowPool(ShadowPool *pool, GLuint shaderProgramMoments, unsigned int resolution, float farPlane);
+
+/**
+ * @brief Reallocate the cubemap arrays of the pool at another resolution
+ * 
+ * @param pool Pointer to the pool
+ * @param pointLights Point lights using the pool
+ * @param pointLightCount Number of point lights
+ * @param resolution Resolution of the sharpest tier, a power of two
+ * 
+ * @note Every light loses its cubemap, they are given again by the next assignShadowSlots
+*/
+void setShadowResolution(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, unsigned int resolution);
+
+/**
+ * @brief Change the far plane of the depth cubemaps
+ * 
+ * @param pool Pointer to the pool
+ * @param pointLights Point lights using the pool
+ * @param pointLightCount Number of point lights
+ * @param farPlane Far plane of the depth cubemaps
+ * 
+ * @note Depth cubemaps are rebuilt, the shaders sampling them need the new far plane too
+*/
+void setShadowFarPlane(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, float farPlane);
+
+/**
+ * @brief Change the filtering of the shadow maps
+ * 
+ * @param pool Pointer to the pool
+ * @param pointLights Point lights using the pool
+ * @param pointLightCount Number of point lights
+ * @param filter Filter to use
+ * @param quality Quality of the filter, clamped to its range
+ * 
+ * @note Shadow maps are rebuilt when moments have to be (re)computed
+*/
+void setShadowFilter(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, ShadowFilter filter, int quality);
+
+/**
+ * @brief Give a depth cubemap to the lights that matter the most
+ * 
+ * @param pool Pointer to the pool
+ * @param pointLights Point lights
+ * @param pointLightCount Number of point lights
+ * @param cameraPos Position of the camera
+ * @param viewProjection View projection matrix of the camera
+ * @param tanHalfFovY Tangent of half the vertical field of view
+ * 
+ * @note Lights are ranked by their screen space size, the biggest ones get the sharpest tiers
+ * @note Lights whose range is out of the view frustum lose their cubemap
+*/
+void assignShadowSlots(ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount, vec3 cameraPos, mat4 viewProjection, float tanHalfFovY);
+
+/**
+ * @brief Bind the cubemap arrays to their texture units and send the filter parameters
+ * 
+ * @param pool Pointer to the pool
+ * @param shaderProgram Shader program sampling the shadows
+ * 
+ * @note Shader program must be in use
+ * @note Should be called every frame, the shadow pass uses texture units of its own
+*/
+void bindShadowPool(const ShadowPool *pool, GLuint shaderProgram);
+
+/**
+ * @brief Render the depth cubemaps of the point lights
+ * 
+ * @param scene Scene to render
+ * @param shaderProgramDepth Shader program to use
+ * @param depthMapFBO FBO to use
+ * @param pool Shadow pool
+ * @param pointLights Point lights to render
+ * @param pointLightCount Number of point lights
+ * 
+ * @note Viewport is modified, and VAO and shader program are binded to 0 after the function call
+ * @note Lights without a slot are skipped
+ * @note Only the faces invalidated by a moving light or a changed model are re-rendered :
+ *       static models are cached and dynamic models are drawn on top of the cache
+ * @note Each mesh is only drawn to the faces its bounds overlap, one instance per face.
+ *       Depth maps store the hardware depth of the distance along the face axis
+ * @note With moment filtering, the moments of the updated faces are recomputed afterwards
+ * @note The changed flag of every model is cleared
+*/
+void renderPointLightsShadowMap(Scene *scene, GLuint shaderProgramDepth, GLuint depthMapFBO, ShadowPool *pool, PointLight *pointLights, unsigned int pointLightCount);
+
+/**
+ * @brief Free the shadow pool
+ * 
+ * @param pool Pointer to the pool
+*/
+void destroyShadowPool(ShadowPool *pool);
+
+
+#endif
@@ -0,0 +1,125 @@
+#include "transform.h"
+
+
+static int growTransformHierarchy(TransformHierarchy *hierarchy, unsigned int capacity)
+{
+    vec3 *positions = realloc(hierarchy->positions, capacity * sizeof(vec3));
+    if (positions) hierarchy->positions = positions;
+    vec3 *scales = realloc(hierarchy->scales, capacity * sizeof(vec3));
+    if (scales) hierarchy->scales = scales;
+    versor *rotations = realloc(hierarchy->rotations, capacity * sizeof(versor));
+    if (rotations) hierarchy->rotations = rotations;
+    int *parents = realloc(hierarchy->parents, capacity * sizeof(int));
+    if (parents) hierarchy->parents = parents;
+    bool *dirty = realloc(hierarchy->dirty, capacity * sizeof(bool));
+    if (dirty) hierarchy->dirty = dirty;
+    bool *changed = realloc(hierarchy->changed, capacity * sizeof(bool));
+    if (changed) hierarchy->changed = changed;
+    mat4 *worlds = realloc(hierarchy->worlds, capacity * sizeof(mat4));
+    if (worlds) hierarchy->worlds = worlds;
+    mat3 *normals = realloc(hierarchy->normals, capacity * sizeof(mat3));
+    if (normals) hierarchy->normals = normals;
+
+    if (!positions || !scales || !rotations || !parents || !dirty || !changed || !worlds || !normals)
+    {
+        LOG_ERROR("Could not allocate %d transforms\n", capacity);
+        return -1;
+    }
+    hierarchy->capacity = capacity;
+    return 0;
+}
+
+
+int initTransformHierarchy(TransformHierarchy *hierarchy, unsigned int capacity)
+{
+    memset(hierarchy, 0, sizeof(TransformHierarchy));
+    return growTransformHierarchy(hierarchy, capacity > 0 ? capacity : 1);
+}
+
+
+int addTransform(TransformHierarchy *hierarchy, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle)
+{
+    if (parent >= (int)hierarchy->count)
+    {
+        LOG_ERROR("Parent transform %d does not exist yet\n", parent);
+        return -1;
+    }
+    if (hierarchy->count == hierarchy->capacity && growTransformHierarchy(hierarchy, hierarchy->capacity * 2) < 0) return -1;
+
+    const unsigned int index = hierarchy->count++;
+    hierarchy->parents[index] = parent < 0 ? TRANSFORM_NO_PARENT : parent;
+    hierarchy->changed[index] = false;
+    glm_mat4_identity(hierarchy->worlds[index]);
+    glm_mat3_identity(hierarchy->normals[index]);
+    setTransform(hierarchy, index, position, scale, rotation_vector, rotation_angle);
+    return index;
+}
+
+
+void setTransform(TransformHierarchy *hierarchy, unsigned int index, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle)
+{
+    glm_vec3_copy(position, hierarchy->positions[index]);
+    glm_vec3_copy(scale, hierarchy->scales[index]);
+    glm_quatv(hierarchy->rotations[index], rotation_angle, rotation_vector);
+    hierarchy->dirty[index] = true;
+}
+
+void setTransformPose(TransformHierarchy *hierarchy, unsigned int index, vec3 position, versor rotation)
+{
+    glm_vec3_copy(position, hierarchy->positions[index]);
+    glm_quat_copy(rotation, hierarchy->rotations[index]);
+    hierarchy->dirty[index] = true;
+}
+
+
+unsigned int updateTransformHierarchy(TransformHierarchy *hierarchy)
+{
+    unsigned int updated = 0;
+
+    // Parents come first, so a changed parent is always known before its children
+    for (unsigned int i=0; i<hierarchy->count; i++)
+    {
+        const int parent = hierarchy->parents[i];
+        hierarchy->changed[i] = hierarchy->dirty[i] || (parent != TRANSFORM_NO_PARENT && hierarchy->changed[parent]);
+        hierarchy->dirty[i] = false;
+        if (!hierarchy->changed[i]) continue;
+
+        // Translate * scale * rotate : the rotation columns are scaled per row
+        mat4 local;
+        glm_quat_mat4(hierarchy->rotations[i], local);
+        glm_vec3_mul(local[0], hierarchy->scales[i], local[0]);
+        glm_vec3_mul(local[1], hierarchy->scales[i], local[1]);
+        glm_vec3_mul(local[2], hierarchy->scales[i], local[2]);
+        glm_vec3_copy(hierarchy->positions[i], local[3]);
+
+        if (parent == TRANSFORM_NO_PARENT) glm_mat4_copy(local, hierarchy->worlds[i]);
+        else glm_mat4_mul(hierarchy->worlds[parent], local, hierarchy->worlds[i]);
+
+        glm_mat4_pick3(hierarchy->worlds[i], hierarchy->normals[i]);
+        glm_mat3_inv(hierarchy->normals[i], hierarchy->normals[i]);
+        glm_mat3_transpose(hierarchy->normals[i]);
+        updated++;
+    }
+
+    return updated;
+}
+
+
+void getTransformWorldPosition(const TransformHierarchy *hierarchy, unsigned int index, vec3 dest)
+{
+    glm_vec3_copy((float*)hierarchy->worlds[index][3], dest);
+}
+
+
+void destroyTransformHierarchy(TransformHierarchy *hierarchy)
+{
+    free(hierarchy->positions);
+    free(hierarchy->scales);
+    free(hierarchy->rotations);
+    free(hierarchy->parents);
+    free(hierarchy->dirty);
+    free(hierarchy->changed);
+    free(hierarchy->worlds);
+    free(hierarchy->normals);
+    memset(hierarchy, 0, sizeof(TransformHierarchy));
+}
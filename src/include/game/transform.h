@@ -0,0 +1,125 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "logs.h"
+
+
+#define TRANSFORM_NO_PARENT -1
+
+
+/**
+ * @brief Transform hierarchy, stored as structure of arrays
+ * 
+ * @param count Number of transforms
+ * @param capacity Number of transforms allocated
+ * @param positions Local position of each transform
+ * @param scales Local scale of each transform
+ * @param rotations Local rotation of each transform
+ * @param parents Parent of each transform, TRANSFORM_NO_PARENT for roots
+ * @param dirty Whether the local transform was changed since the last update
+ * @param changed Whether the world matrix was recomputed by the last update
+ * @param worlds Cached world matrix of each transform
+ * @param normals Cached normal matrix (inverse transpose of the world matrix) of each transform
+ * 
+ * @note Parents always come before their children, so that a single forward pass updates the hierarchy
+ * @note Local matrices are built as translate * scale * rotate
+*/
+typedef struct {
+    unsigned int count, capacity;
+
+    vec3 *positions;
+    vec3 *scales;
+    versor *rotations;
+    int *parents;
+    bool *dirty;
+    bool *changed;
+
+    mat4 *worlds;
+    mat3 *normals;
+} TransformHierarchy;
+
+
+/**
+ * @brief Create an empty transform hierarchy
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @param capacity Number of transforms allocated up front, the hierarchy grows as needed
+ * @return int 0 if success, -1 if error
+*/
+int initTransformHierarchy(TransformHierarchy *hierarchy, unsigned int capacity);
+
+/**
+ * @brief Add a transform to the hierarchy
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @param parent Parent transform, TRANSFORM_NO_PARENT for a root
+ * @param position Local position
+ * @param scale Local scale
+ * @param rotation_vector Vector of the local rotation
+ * @param rotation_angle Angle of the local rotation
+ * @return int Index of the transform, -1 if error
+ * 
+ * @note The parent must already be in the hierarchy
+*/
+int addTransform(TransformHierarchy *hierarchy, int parent, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle);
+
+/**
+ * @brief Change the local transform
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @param index Index of the transform
+ * @param position Local position
+ * @param scale Local scale
+ * @param rotation_vector Vector of the local rotation
+ * @param rotation_angle Angle of the local rotation
+ * 
+ * @note World matrices are recomputed by the next updateTransformHierarchy
+*/
+void setTransform(TransformHierarchy *hierarchy, unsigned int index, vec3 position, vec3 scale, vec3 rotation_vector, float rotation_angle);
+
+/**
+ * @brief Change the local position and rotation, keeping the scale
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @param index Index of the transform
+ * @param position Local position
+ * @param rotation Local rotation
+*/
+void setTransformPose(TransformHierarchy *hierarchy, unsigned int index, vec3 position, versor rotation);
+
+/**
+ * @brief Recompute the world matrices of the changed transforms and of their descendants
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @return unsigned int Number of world matrices recomputed
+*/
+unsigned int updateTransformHierarchy(TransformHierarchy *hierarchy);
+
+/**
+ * @brief Get the world position of a transform
+ * 
+ * @param hierarchy Pointer to the hierarchy
+ * @param index Index of the transform
+ * @param dest Destination vector
+ * 
+ * @note Valid after updateTransformHierarchy
+*/
+void getTransformWorldPosition(const TransformHierarchy *hierarchy, unsigned int index, vec3 dest);
+
+/**
+ * @brief Free a transform hierarchy
+ * 
+ * @param hierarchy Pointer to the hierarchy
+*/
+void destroyTransformHierarchy(TransformHierarchy *hierarchy);
+
+
+#endif
@@ -0,0 +1,164 @@
+#include "weapon.h"
+
+
+/**
+ * @brief World space colliders of the entities that can be shot
+ * 
+ * @param boxes Box of each target
+ * @param entities Entity of each target
+ * @param count Number of targets
+*/
+typedef struct {
+    BoxCollider *boxes;
+    Entity *entities;
+    unsigned int count;
+} HitscanTargets;
+
+
+static void countTargets(Archetype *archetype, void *data)
+{
+    *(unsigned int*)data += archetype->count;
+}
+
+static void gatherTargets(Archetype *archetype, void *data)
+{
+    HitscanTargets *targets = data;
+    vec3 *positions = getArchetypeColumn(archetype, COMPONENT_POSITION);
+    BoxCollider *colliders = getArchetypeColumn(archetype, COMPONENT_COLLIDER);
+    for (unsigned int i=0; i<archetype->count; i++)
+    {
+        BoxCollider *box = &targets->boxes[targets->count];
+        glm_vec3_add(positions[i], colliders[i].min, box->min);
+        glm_vec3_add(positions[i], colliders[i].max, box->max);
+        targets->entities[targets->count++] = archetype->entities[i];
+    }
+}
+
+// Normal of the face of the box closest to a point on its surface
+static void getBoxNormal(const BoxCollider *box, vec3 point, vec3 direction, vec3 normal)
+{
+    float closest = FLT_MAX;
+    glm_vec3_negate_to(direction, normal);
+    for (int i=0; i<3; i++)
+    {
+        const float low = fabsf(point[i] - box->min[i]);
+        const float high = fabsf(box->max[i] - point[i]);
+        if (low < closest && direction[i] > 0.0f) {closest = low; glm_vec3_zero(normal); normal[i] = -1.0f;}
+        if (high < closest && direction[i] < 0.0f) {closest = high; glm_vec3_zero(normal); normal[i] = 1.0f;}
+    }
+}
+
+
+void spreadPellets(Ray *rays, unsigned int count, vec3 origin, vec3 direction, float spread, float range, uint32_t *seed)
+{
+    // Basis around the shot direction
+    vec3 right, up;
+    glm_vec3_cross(direction, fabsf(direction[1]) < 0.99f ? (vec3){0.0f, 1.0f, 0.0f} : (vec3){1.0f, 0.0f, 0.0f}, right);
+    glm_vec3_normalize(right);
+    glm_vec3_cross(right, direction, up);
+
+    // Uniform on the spherical cap, not clumped in the middle
+    const float minCos = cosf(spread);
+    for (unsigned int i=0; i<count; i++)
+    {
+        const float cosTheta = 1.0f - randomFloat(seed) * (1.0f - minCos);
+        const float sinTheta = sqrtf(1.0f - cosTheta*cosTheta);
+        const float phi = 2.0f * GLM_PIf * randomFloat(seed);
+
+        vec3 pellet;
+        glm_vec3_scale(direction, cosTheta, pellet);
+        glm_vec3_muladds(right, sinTheta * cosf(phi), pellet);
+        glm_vec3_muladds(up, sinTheta * sinf(phi), pellet);
+        initRay(&rays[i], origin, pellet, range);
+    }
+}
+
+
+int traceHitscan(const Ray *rays, unsigned int count, const LevelCollision *level, World *world, HitRecord *hits)
+{
+    // Targets, once for all the rays
+    const ComponentMask mask = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_COLLIDER);
+    unsigned int targetCount = 0;
+    queryWorld(world, mask, countTargets, &targetCount);
+
+    HitscanTargets targets = {0};
+    if (targetCount)
+    {
+        targets.boxes = malloc(targetCount * sizeof(BoxCollider));
+        targets.entities = malloc(targetCount * sizeof(Entity));
+        if (!targets.boxes || !targets.entities)
+        {
+            LOG_ERROR("Could not allocate %d hitscan targets\n", targetCount);
+            free(targets.boxes);
+            free(targets.entities);
+            return -1;
+        }
+        queryWorld(world, mask, gatherTargets, &targets);
+    }
+
+    unsigned int hitCount = 0;
+    for (unsigned int first=0; first<count; first+=COLLISION_PACKET_SIZE)
+    {
+        const unsigned int packetCount = count - first < COLLISION_PACKET_SIZE ? count - first : COLLISION_PACKET_SIZE;
+
+        // Level first, each ray then stops at the wall it hits
+        Ray packetRays[COLLISION_PACKET_SIZE];
+        LevelHit levelHits[COLLISION_PACKET_SIZE];
+        bool levelHit[COLLISION_PACKET_SIZE];
+        for (unsigned int i=0; i<packetCount; i++)
+        {
+            packetRays[i] = rays[first + i];
+            levelHit[i] = raycastLevel(level, &packetRays[i], &levelHits[i]);
+            if (levelHit[i]) packetRays[i].length = levelHits[i].distance;
+        }
+
+        // Entities, all the rays of the packet together
+        float distances[COLLISION_PACKET_SIZE];
+        int indices[COLLISION_PACKET_SIZE];
+        if (targets.count)
+        {
+            RayPacket packet;
+            initRayPacket(&packet, packetRays, packetCount);
+            rayPacketClosestBoxes(&packet, targets.boxes, targets.count, distances, indices);
+        }
+        else memset(indices, -1, sizeof(indices));
+
+        for (unsigned int i=0; i<packetCount; i++)
+        {
+            const Ray *ray = &packetRays[i];
+            HitRecord *hit = &hits[hitCount];
+            if (indices[i] >= 0)
+            {
+                hit->distance = distances[i];
+                glm_vec3_copy((float*)ray->origin, hit->point);
+                glm_vec3_muladds((float*)ray->direction, distances[i], hit->point);
+                getBoxNormal(&targets.boxes[indices[i]], hit->point, (float*)ray->direction, hit->normal);
+                hit->entity = targets.entities[indices[i]];
+                hit->material = HIT_MATERIAL_ENTITY;
+            }
+            else if (levelHit[i])
+            {
+                hit->distance = levelHits[i].distance;
+                glm_vec3_copy(levelHits[i].point, hit->point);
+                glm_vec3_copy(levelHits[i].normal, hit->normal);
+                hit->entity = (Entity){0};
+                hit->material = level->materials[levelHits[i].triangle];
+            }
+            else continue;
+            hit->ray = first + i;
+            hitCount++;
+        }
+    }
+    free(targets.boxes);
+    free(targets.entities);
+
+    // Closest first, a few dozens of hits at most
+    for (unsigned int i=1; i<hitCount; i++)
+    {
+        const HitRecord hit = hits[i];
+        unsigned int j = i;
+        for (; j>0 && hits[j-1].distance > hit.distance; j--) hits[j] = hits[j-1];
+        hits[j] = hit;
+    }
+    return (int)hitCount;
+}
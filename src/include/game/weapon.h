@@ -0,0 +1,73 @@
+#ifndef WEAPON_H
+#define WEAPON_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+
+#include "collision.h"
+#include "ecs.h"
+#include "entities.h"
+#include "level.h"
+#include "logs.h"
+#include "random.h"
+
+
+#define SHOTGUN_PELLETS 12
+#define SHOTGUN_SPREAD 4.0f  // Half angle of the pellet cone, in degrees
+#define SHOTGUN_RANGE 60.0f
+
+#define HIT_MATERIAL_ENTITY UINT16_MAX  // Material of the entity hits, level triangles use the level materials
+
+
+/**
+ * @brief Hit of a hitscan ray
+ * 
+ * @param ray Index of the ray
+ * @param distance Distance to the hit, in multiples of the ray direction
+ * @param point Position of the hit
+ * @param normal Normal of the surface hit, facing the ray
+ * @param entity Entity hit, if material is HIT_MATERIAL_ENTITY
+ * @param material Material of the surface hit
+*/
+typedef struct {
+    unsigned int ray;
+    float distance;
+    vec3 point;
+    vec3 normal;
+    Entity entity;
+    uint16_t material;
+} HitRecord;
+
+
+/**
+ * @brief Spread pellet rays uniformly in a cone
+ * 
+ * @param rays Rays created
+ * @param count Number of pellets
+ * @param origin Origin of the pellets
+ * @param direction Direction of the shot, normalized
+ * @param spread Half angle of the cone, in radians
+ * @param range Length of the rays
+ * @param seed State of the random generator, updated
+*/
+void spreadPellets(Ray *rays, unsigned int count, vec3 origin, vec3 direction, float spread, float range, uint32_t *seed);
+
+/**
+ * @brief Trace hitscan rays against the level and the entity colliders
+ * 
+ * @param rays Rays, created with initRay, of one or several shots
+ * @param count Number of rays
+ * @param level Level collision
+ * @param world World of the entities with COMPONENT_POSITION and COMPONENT_COLLIDER
+ * @param hits First hit of each ray that hits something, sorted by distance
+ * @return int Number of hits (at most count), -1 if error
+*/
+int traceHitscan(const Ray *rays, unsigned int count, const LevelCollision *level, World *world, HitRecord *hits);
+
+
+#endif
@@ -21,10 +21,7 @@
 /* --- TODO --- */
 
 /*
-- Use Forward+ rendering
 - Stencil test for UI ?
-- Find other ways to load sounds (WAV is too big)
-    -> OGG ?
 - SDL_image for other formats than BMP ?
 */
 
@@ -45,12 +42,32 @@
 */
 int main(int argc, char *argv[])
 {
-    // These arguments are unused for now
-    (void)argc;
-    (void)argv;
-
     Application app = {0};
+    app.renderMode = RENDER_MODE_DEFAULT;
+
+    const char *logPath = NULL;
+
+    // Settings file first, the command line overrides it
+    initSettings(&app.settings);
+    if (loadSettings(&app.settings, SETTINGS_PATH) < 0) LOG_WARN("Settings file not fully read, defaults are used for the rest\n");
+
+    // --renderer=forward|volumes|tiled, --record=<file>, --replay=<file>, --log=<file>, and any setting as --<setting>=<value>
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--renderer=forward") == 0) app.renderMode = RENDER_FORWARD;
+        else if (strcmp(argv[i], "--renderer=volumes") == 0) app.renderMode = RENDER_DEFERRED_VOLUMES;
+        else if (strcmp(argv[i], "--renderer=tiled") == 0) app.renderMode = RENDER_DEFERRED_TILED;
+        else if (strncmp(argv[i], "--record=", 9) == 0) {app.replayMode = REPLAY_RECORD; app.replayPath = argv[i] + 9;}
+        else if (strncmp(argv[i], "--replay=", 9) == 0) {app.replayMode = REPLAY_PLAY; app.replayPath = argv[i] + 9;}
+        else if (strncmp(argv[i], "--log=", 6) == 0) logPath = argv[i] + 6;
+        else if (strncmp(argv[i], "--", 2) == 0 && strchr(argv[i], '=')) parseSetting(&app.settings, argv[i] + 2);
+        else LOG_WARN("Unknown argument %s\n", argv[i]);
+    }
+
+    // Logs are written by a background thread, so that loading is not slowed down by the console
+    initLogs(logPath);
     appRun(&app);
+    closeLogs();
 
     return EXIT_SUCCESS;
 }